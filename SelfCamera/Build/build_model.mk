@@ -0,0 +1,38 @@
+# Landmark model build script
+#
+# The model from dlib.net is a version 1 file, usable only once it is fully
+# read. Before packaging it is rewritten in place by tools/convert_model.cpp,
+# built for the host, so the app can enable the stickers after the first
+# cascade level. A converted file reads back the same and is rewritten
+# unchanged. Nothing is done while res/ holds no model.
+
+
+MODEL_FILE := $(PROJ_ROOT)/res/shape_predictor_68_face_landmarks.dat
+MODEL_STAMP := $(OBJ_OUTPUT)/shape_predictor.converted
+MODEL_CONVERTER := $(OBJ_OUTPUT)/convert_model
+
+ifeq ($(strip $(HOST_CXX)),)
+HOST_CXX = g++
+endif
+
+MODEL_FILES :=
+
+ifneq ($(wildcard $(MODEL_FILE)),)
+
+$(MODEL_CONVERTER) : $(PROJ_ROOT)/tools/convert_model.cpp
+	@echo '  Building file: $<'
+	@echo '  Invoking: Host C++ Compiler'
+	$(call MAKEDIRS,$(@D))
+	$(HOST_CXX) -O2 -std=c++11 -I$(PROJ_ROOT)/inc "$<" $(wildcard $(PROJ_ROOT)/inc/dlib/threads/*.cpp) -lpthread -o "$@"
+	@echo '  Finished building: $<'
+
+$(MODEL_STAMP) : $(MODEL_FILE) $(MODEL_CONVERTER)
+	@echo '  Converting file: $<'
+	$(MODEL_CONVERTER) "$<" "$<.tmp"
+	mv -f "$<.tmp" "$<"
+	touch "$@"
+	@echo '  Finished converting: $<'
+
+MODEL_FILES += $(MODEL_STAMP)
+
+endif
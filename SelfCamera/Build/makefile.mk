@@ -175,7 +175,10 @@ $(eval $(call MO_PROC_RAW,$(OUTPUT_DIR),$(USER_POS),$(APPID2),MO_FILES))
 endif
 
 
-secondary-outputs : $(EDJ_FILES) $(MO_FILES)
+include $(BUILD_ROOT)/build_model.mk
+
+
+secondary-outputs : $(EDJ_FILES) $(MO_FILES) $(MODEL_FILES)
 
 -include appendix.mk
 
@@ -0,0 +1,33 @@
+/*
+ * beauty.h
+ *
+ * Skin smoothing restricted to the face. The luma plane inside a feathered
+ * mask built from the jaw line and the eyebrows goes through a self-guided
+ * filter, which flattens small blemishes while keeping the eyes, brows and
+ * mouth sharp. Everything is done with integer running box sums over the
+ * bounding box of the mask, so the cost follows the face area rather than
+ * the frame size.
+ */
+
+#ifndef BEAUTY_H_
+#define BEAUTY_H_
+
+#include <camera.h>
+
+#include <dlib/image_processing.h>
+
+#define BEAUTY_STRENGTH 200	/* blend weight out of 256 */
+
+/* Scratch buffers of one caller. Contexts are not shared between threads. */
+typedef struct _beauty_ctx beauty_ctx;
+
+beauty_ctx* beauty_create(void);
+
+void beauty_destroy(beauty_ctx* ctx);
+
+/* Smooths the face described by shape (landmarks in the rotated preview
+ * coordinates face_landmark() uses). strength is out of 256. */
+void beauty_apply(beauty_ctx* ctx, camera_preview_data_s* frame,
+		const dlib::full_object_detection& shape, int strength);
+
+#endif /* BEAUTY_H_ */
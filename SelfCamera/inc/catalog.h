@@ -0,0 +1,26 @@
+/*
+ * catalog.h
+ *
+ * Append-only index of the pictures this app saved, kept in the app data
+ * directory. Finding the newest capture reads the tail of the index instead
+ * of listing the whole Images folder, so it does not slow down as the
+ * folder grows. The folder is only scanned when the index is missing or
+ * every entry in its tail has been deleted.
+ */
+
+#ifndef CATALOG_H_
+#define CATALOG_H_
+
+#include <stddef.h>
+
+/* Opens (or rebuilds) the index. prefix filters the folder scan fallback. */
+void catalog_init(const char* index_path, const char* folder, const char* prefix);
+
+/* Records a newly saved picture. Must be called from the main loop. */
+void catalog_add(const char* file_path);
+
+/* Copies the newest existing picture into file_path, returns its length or
+ * 0 if there is none. */
+size_t catalog_last(char* file_path, size_t size);
+
+#endif /* CATALOG_H_ */
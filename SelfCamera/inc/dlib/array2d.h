@@ -7,6 +7,7 @@
 #include "array2d/array2d_kernel.h"
 #include "array2d/serialize_pixel_overloads.h"
 #include "array2d/array2d_generic_image.h"
+#include "array2d/aligned_array2d.h"
 
 #endif // DLIB_ARRAY2d_
 
@@ -0,0 +1,599 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_ALIGNED_ARRAY2d_
+#define DLIB_ALIGNED_ARRAY2d_
+
+#include "aligned_array2d_abstract.h"
+#include "../algs.h"
+#include "../image_processing/generic_image.h"
+#include <new>
+
+namespace dlib
+{
+    template <
+        typename T,
+        typename mem_manager = default_memory_manager
+        >
+    class aligned_array2d
+    {
+
+        /*!
+            INITIAL VALUE
+                - storage == 0
+                - data == 0
+                - nr_ == 0
+                - nc_ == 0
+                - width_step_ == 0
+                - alignment_ == 32
+                - padding_ == 0
+                - layout_alignment_ == 32
+                - layout_padding_ == 0
+
+            CONVENTION
+                - nr_ == nr()
+                - nc_ == nc()
+                - width_step_ == width_step()
+                - alignment_ == alignment()
+                - padding_ == padding()
+                - layout_alignment_ == layout_alignment()
+                - layout_padding_ == layout_padding()
+                - (*this)[r] == reinterpret_cast<T*>(data + r*width_step_)
+
+                - owns_data() == (storage != 0 || data == 0)
+                - if (storage != 0) then
+                    - storage is the block we got from pool, and data points into it
+                    - the (nr_+2*padding_) by (nc_+2*padding_) elements of the image and
+                      its padding have all been constructed
+                - else if (data != 0) then
+                    - data is the memory given to wrap()
+                    - padding_ == 0
+        !*/
+
+    public:
+
+        typedef T type;
+        typedef mem_manager mem_manager_type;
+
+        aligned_array2d (
+        ) :
+            storage(0),
+            data(0),
+            nr_(0),
+            nc_(0),
+            width_step_(0),
+            alignment_(32),
+            padding_(0),
+            layout_alignment_(32),
+            layout_padding_(0)
+        {
+        }
+
+        aligned_array2d(
+            long rows,
+            long cols
+        ) :
+            storage(0),
+            data(0),
+            nr_(0),
+            nc_(0),
+            width_step_(0),
+            alignment_(32),
+            padding_(0),
+            layout_alignment_(32),
+            layout_padding_(0)
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT((cols >= 0 && rows >= 0),
+                        "\t aligned_array2d::aligned_array2d(long rows, long cols)"
+                        << "\n\t The aligned_array2d can't have negative rows or columns."
+                        << "\n\t this: " << this
+                        << "\n\t cols: " << cols
+                        << "\n\t rows: " << rows
+            );
+
+            set_size(rows,cols);
+        }
+
+        aligned_array2d(
+            T* data_,
+            long rows,
+            long cols,
+            long width_step
+        ) :
+            storage(0),
+            data(0),
+            nr_(0),
+            nc_(0),
+            width_step_(0),
+            alignment_(32),
+            padding_(0),
+            layout_alignment_(32),
+            layout_padding_(0)
+        {
+            wrap(data_,rows,cols,width_step);
+        }
+
+        aligned_array2d(const aligned_array2d&) = delete;        // copy constructor
+        aligned_array2d& operator=(const aligned_array2d&) = delete;    // assignment operator
+
+#ifdef DLIB_HAS_RVALUE_REFERENCES
+        aligned_array2d(aligned_array2d&& item) : aligned_array2d()
+        {
+            swap(item);
+        }
+
+        aligned_array2d& operator= (
+            aligned_array2d&& rhs
+        )
+        {
+            swap(rhs);
+            return *this;
+        }
+#endif
+
+        ~aligned_array2d (
+        ) { clear(); }
+
+        void set_layout (
+            unsigned long alignment,
+            long padding
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(alignment != 0 && (alignment & (alignment-1)) == 0 && padding >= 0,
+                "\tvoid aligned_array2d::set_layout(alignment, padding)"
+                << "\n\tThe alignment must be a power of two and the padding can't be negative."
+                << "\n\tthis:      " << this
+                << "\n\talignment: " << alignment
+                << "\n\tpadding:   " << padding
+            );
+
+            layout_alignment_ = alignment;
+            layout_padding_ = padding;
+        }
+
+        unsigned long layout_alignment (
+        ) const { return layout_alignment_; }
+
+        long layout_padding (
+        ) const { return layout_padding_; }
+
+        void set_size (
+            long rows,
+            long cols
+        );
+
+        void wrap (
+            T* data_,
+            long rows,
+            long cols,
+            long width_step
+        );
+
+        bool owns_data (
+        ) const { return storage != 0 || data == 0; }
+
+        long nr (
+        ) const { return nr_; }
+
+        long nc (
+        ) const { return nc_; }
+
+        unsigned long size (
+        ) const { return static_cast<unsigned long>(nc_ * nr_); }
+
+        long width_step (
+        ) const { return width_step_; }
+
+        unsigned long alignment (
+        ) const { return alignment_; }
+
+        long padding (
+        ) const { return padding_; }
+
+        T* operator[] (
+            long row
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(-padding() <= row && row < nr()+padding(),
+                "\tT* aligned_array2d::operator[](long row)"
+                << "\n\tThe row index given is outside the image and its padding."
+                << "\n\tthis:      " << this
+                << "\n\trow:       " << row
+                << "\n\tnr():      " << nr()
+                << "\n\tpadding(): " << padding()
+                );
+
+            return reinterpret_cast<T*>(data + row*width_step_);
+        }
+
+        const T* operator[] (
+            long row
+        ) const
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(-padding() <= row && row < nr()+padding(),
+                "\tconst T* aligned_array2d::operator[](long row) const"
+                << "\n\tThe row index given is outside the image and its padding."
+                << "\n\tthis:      " << this
+                << "\n\trow:       " << row
+                << "\n\tnr():      " << nr()
+                << "\n\tpadding(): " << padding()
+                );
+
+            return reinterpret_cast<const T*>(data + row*width_step_);
+        }
+
+        T& operator() (
+            long row,
+            long column
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(-padding() <= column && column < nc()+padding(),
+                "\tT& aligned_array2d::operator()(long row, long column)"
+                << "\n\tThe column index given is outside the image and its padding."
+                << "\n\tthis:      " << this
+                << "\n\tcolumn:    " << column
+                << "\n\tnc():      " << nc()
+                << "\n\tpadding(): " << padding()
+                );
+
+            return (*this)[row][column];
+        }
+
+        const T& operator() (
+            long row,
+            long column
+        ) const
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(-padding() <= column && column < nc()+padding(),
+                "\tconst T& aligned_array2d::operator()(long row, long column) const"
+                << "\n\tThe column index given is outside the image and its padding."
+                << "\n\tthis:      " << this
+                << "\n\tcolumn:    " << column
+                << "\n\tnc():      " << nc()
+                << "\n\tpadding(): " << padding()
+                );
+
+            return (*this)[row][column];
+        }
+
+        void fill_padding (
+            const T& value
+        );
+
+        void replicate_edges_into_padding (
+        );
+
+        void clear (
+        )
+        {
+            if (storage != 0)
+            {
+                destroy_elements(nr_+padding_, -padding_);
+                pool.deallocate_array(storage);
+                storage = 0;
+            }
+            data = 0;
+            nr_ = 0;
+            nc_ = 0;
+            width_step_ = 0;
+            alignment_ = layout_alignment_;
+            padding_ = 0;
+        }
+
+        void swap (
+            aligned_array2d& item
+        )
+        {
+            exchange(storage,item.storage);
+            exchange(data,item.data);
+            exchange(nr_,item.nr_);
+            exchange(nc_,item.nc_);
+            exchange(width_step_,item.width_step_);
+            exchange(alignment_,item.alignment_);
+            exchange(padding_,item.padding_);
+            exchange(layout_alignment_,item.layout_alignment_);
+            exchange(layout_padding_,item.layout_padding_);
+            pool.swap(item.pool);
+        }
+
+    private:
+
+        static unsigned long round_up (
+            unsigned long x,
+            unsigned long alignment
+        ) { return (x + alignment - 1) & ~(alignment - 1); }
+
+        void destroy_elements (
+            long end_row,
+            long end_col
+        )
+        /*!
+            ensures
+                - destroys, in this object's owned memory, all the elements of the rows
+                  before end_row and the elements of row end_row before end_col
+        !*/
+        {
+            for (long r = -padding_; r <= end_row && r < nr_+padding_; ++r)
+            {
+                T* row = (*this)[r];
+                const long end = (r == end_row) ? end_col : nc_+padding_;
+                for (long c = -padding_; c < end; ++c)
+                    row[c].~T();
+            }
+        }
+
+        char* storage;
+        char* data;
+        long nr_;
+        long nc_;
+        long width_step_;
+        unsigned long alignment_;
+        long padding_;
+        unsigned long layout_alignment_;
+        long layout_padding_;
+
+        typename mem_manager::template rebind<char>::other pool;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        typename mem_manager
+        >
+    inline void swap (
+        aligned_array2d<T,mem_manager>& a,
+        aligned_array2d<T,mem_manager>& b
+    ) { a.swap(b); }
+
+// ----------------------------------------------------------------------------------------
+
+// Define the global functions that make aligned_array2d a proper "generic image" according
+// to ../image_processing/generic_image.h
+    template <typename T, typename mm>
+    struct image_traits<aligned_array2d<T,mm> >
+    {
+        typedef T pixel_type;
+    };
+    template <typename T, typename mm>
+    struct image_traits<const aligned_array2d<T,mm> >
+    {
+        typedef T pixel_type;
+    };
+
+    template <typename T, typename mm>
+    inline long num_rows( const aligned_array2d<T,mm>& img) { return img.nr(); }
+    template <typename T, typename mm>
+    inline long num_columns( const aligned_array2d<T,mm>& img) { return img.nc(); }
+
+    template <typename T, typename mm>
+    inline void set_image_size(
+        aligned_array2d<T,mm>& img,
+        long rows,
+        long cols
+    ) { img.set_size(rows,cols); }
+
+    template <typename T, typename mm>
+    inline void* image_data(
+        aligned_array2d<T,mm>& img
+    )
+    {
+        if (img.size() != 0)
+            return img[0];
+        else
+            return 0;
+    }
+
+    template <typename T, typename mm>
+    inline const void* image_data(
+        const aligned_array2d<T,mm>& img
+    )
+    {
+        if (img.size() != 0)
+            return img[0];
+        else
+            return 0;
+    }
+
+    template <typename T, typename mm>
+    inline long width_step(
+        const aligned_array2d<T,mm>& img
+    )
+    {
+        return img.width_step();
+    }
+
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+    // member function definitions
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        typename mem_manager
+        >
+    void aligned_array2d<T,mem_manager>::
+    set_size (
+        long rows,
+        long cols
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT((cols >= 0 && rows >= 0) ,
+               "\tvoid aligned_array2d::set_size(long rows, long cols)"
+               << "\n\tThe aligned_array2d can't have negative rows or columns."
+               << "\n\tthis: " << this
+               << "\n\tcols: " << cols
+               << "\n\trows: " << rows
+        );
+
+        // don't do anything if we are already the right size, and in particular keep
+        // writing into wrapped memory.
+        if (nc_ == cols && nr_ == rows)
+            return;
+
+        clear();
+        nr_ = rows;
+        nc_ = cols;
+        if (nr_ == 0 || nc_ == 0)
+            return;
+
+        // Put column 0 of every row on an alignment_ boundary, with at least padding_
+        // elements in front of it and after the end of the row.
+        padding_ = layout_padding_;
+        const unsigned long a = alignment_;
+        const unsigned long p = padding_;
+        const unsigned long left = round_up(p*sizeof(T), a);
+        width_step_ = round_up(left + (nc_+p)*sizeof(T), a);
+
+        long r = -padding_, c = -padding_;
+        try
+        {
+            storage = pool.allocate_array((nr_+2*p)*width_step_ + a - 1);
+            char* const base = storage + (round_up((std::size_t)storage, a) - (std::size_t)storage);
+            data = base + p*width_step_ + left;
+
+            for (; r < nr_+padding_; ++r)
+            {
+                T* row = (*this)[r];
+                for (c = -padding_; c < nc_+padding_; ++c)
+                    new (row + c) T();
+            }
+        }
+        catch (...)
+        {
+            if (storage)
+            {
+                destroy_elements(r, c);
+                pool.deallocate_array(storage);
+                storage = 0;
+            }
+            clear();
+            throw;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        typename mem_manager
+        >
+    void aligned_array2d<T,mem_manager>::
+    wrap (
+        T* data_,
+        long rows,
+        long cols,
+        long width_step
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT(cols >= 0 && rows >= 0 &&
+                    (rows <= 1 || width_step >= cols*(long)sizeof(T)),
+               "\tvoid aligned_array2d::wrap(data, rows, cols, width_step)"
+               << "\n\tThe rows of the wrapped memory can't overlap."
+               << "\n\tthis:       " << this
+               << "\n\trows:       " << rows
+               << "\n\tcols:       " << cols
+               << "\n\twidth_step: " << width_step
+        );
+
+        clear();
+        data = reinterpret_cast<char*>(data_);
+        nr_ = rows;
+        nc_ = cols;
+        width_step_ = width_step;
+
+        // the lowest set bit of the address and the width step together
+        const unsigned long bits = (unsigned long)(std::size_t)data_ | (unsigned long)width_step | 4096;
+        alignment_ = bits & (~bits + 1);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        typename mem_manager
+        >
+    void aligned_array2d<T,mem_manager>::
+    fill_padding (
+        const T& value
+    )
+    {
+        const long p = padding_;
+        for (long r = -p; r < nr_+p; ++r)
+        {
+            T* row = (*this)[r];
+            if (r < 0 || r >= nr_)
+            {
+                for (long c = -p; c < nc_+p; ++c)
+                    row[c] = value;
+            }
+            else
+            {
+                for (long c = 1; c <= p; ++c)
+                {
+                    row[-c] = value;
+                    row[nc_-1+c] = value;
+                }
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T,
+        typename mem_manager
+        >
+    void aligned_array2d<T,mem_manager>::
+    replicate_edges_into_padding (
+    )
+    {
+        const long p = padding_;
+        if (p == 0)
+            return;
+
+        // make sure requires clause is not broken
+        DLIB_ASSERT(nr() > 0 && nc() > 0,
+               "\tvoid aligned_array2d::replicate_edges_into_padding()"
+               << "\n\tThere are no edges to replicate in an empty image."
+               << "\n\tthis: " << this
+        );
+
+        // extend every row to the left and right first, then copy the whole top and
+        // bottom rows, padding included, outward.
+        for (long r = 0; r < nr_; ++r)
+        {
+            T* row = (*this)[r];
+            for (long c = 1; c <= p; ++c)
+            {
+                row[-c] = row[0];
+                row[nc_-1+c] = row[nc_-1];
+            }
+        }
+        const T* top = (*this)[0];
+        const T* bottom = (*this)[nr_-1];
+        for (long r = 1; r <= p; ++r)
+        {
+            T* above = (*this)[-r];
+            T* below = (*this)[nr_-1+r];
+            for (long c = -p; c < nc_+p; ++c)
+            {
+                above[c] = top[c];
+                below[c] = bottom[c];
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_ALIGNED_ARRAY2d_
+
@@ -0,0 +1,377 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_ALIGNED_ARRAY2D_ABSTRACT_
+#ifdef DLIB_ALIGNED_ARRAY2D_ABSTRACT_
+
+#include "../algs.h"
+#include "../image_processing/generic_image.h"
+
+namespace dlib
+{
+
+    template <
+        typename T,
+        typename mem_manager = default_memory_manager
+        >
+    class aligned_array2d
+    {
+        /*!
+            REQUIREMENTS ON T
+                T must have a default constructor.
+
+            REQUIREMENTS ON mem_manager
+                must be an implementation of memory_manager/memory_manager_kernel_abstract.h or
+                must be an implementation of memory_manager_global/memory_manager_global_kernel_abstract.h or
+                must be an implementation of memory_manager_stateless/memory_manager_stateless_kernel_abstract.h
+                mem_manager::type can be set to anything.
+
+            INITIAL VALUE
+                - nr() == 0
+                - nc() == 0
+                - width_step() == 0
+                - owns_data() == true
+                - alignment() == 32
+                - padding() == 0
+                - layout_alignment() == 32
+                - layout_padding() == 0
+
+            WHAT THIS OBJECT REPRESENTS
+                This object is a 2D array of T objects, like array2d, except that the
+                rows are not packed next to each other in memory.  Instead there are
+                width_step() bytes from the start of one row to the start of the next,
+                which lets it be used in two ways:
+
+                    - It can own its memory, in which case the first element of every
+                      row is at an address that is a multiple of alignment() and the
+                      image is surrounded by a border of padding() extra elements on
+                      each side.  So a vector kernel can use aligned loads at the start
+                      of every row and may read up to padding() elements past any edge
+                      of the image without checking.
+
+                    - It can wrap memory that belongs to someone else, such as a camera
+                      buffer, given a pointer to the first row and the distance between
+                      rows.  Nothing is copied and the image reads and writes that
+                      memory directly.
+
+                It implements the generic image interface defined in
+                dlib/image_processing/generic_image.h, so it can be given to any of the
+                image processing routines in dlib, as input or as output, in either mode.
+
+                Row r of the image is (*this)[r], a pointer to its first element.  If
+                padding() != 0 then (*this)[r][c] is also valid for rows in the range
+                -padding() <= r < nr()+padding() and columns in the range
+                -padding() <= c < nc()+padding(), and these are the padding elements.
+        !*/
+
+    public:
+
+        typedef T type;
+        typedef mem_manager mem_manager_type;
+
+        aligned_array2d (
+        );
+        /*!
+            ensures
+                - #*this is properly initialized
+            throws
+                - std::bad_alloc
+        !*/
+
+        aligned_array2d (
+            long rows,
+            long cols
+        );
+        /*!
+            requires
+                - rows >= 0 && cols >= 0
+            ensures
+                - #nc() == cols
+                - #nr() == rows
+                - #owns_data() == true
+                - #alignment() == 32
+                - #padding() == 0
+                - all elements in this image have been value initialized, i.e. T()
+            throws
+                - std::bad_alloc
+                - any exception thrown by T's constructor
+        !*/
+
+        aligned_array2d (
+            T* data,
+            long rows,
+            long cols,
+            long width_step
+        );
+        /*!
+            requires
+                - same as wrap(data, rows, cols, width_step)
+            ensures
+                - #*this wraps the given memory, as if by wrap(data, rows, cols, width_step)
+        !*/
+
+        aligned_array2d (
+            aligned_array2d&& item
+        );
+        /*!
+            ensures
+                - #*this takes the contents and memory of item, owned or wrapped.
+                - #item is in a valid but unspecified state.
+        !*/
+
+        aligned_array2d& operator= (
+            aligned_array2d&& item
+        );
+        /*!
+            ensures
+                - swaps *this and item
+                - returns #*this
+        !*/
+
+        ~aligned_array2d (
+        );
+        /*!
+            ensures
+                - all resources associated with *this have been released.  Wrapped
+                  memory is left alone.
+        !*/
+
+        void set_layout (
+            unsigned long alignment,
+            long padding
+        );
+        /*!
+            requires
+                - alignment is a power of two
+                - padding >= 0
+            ensures
+                - #layout_alignment() == alignment
+                - #layout_padding() == padding
+                - The next time this object allocates its own memory it uses this
+                  layout.  The current image, if any, is not affected.
+        !*/
+
+        unsigned long layout_alignment (
+        ) const;
+        /*!
+            ensures
+                - returns the row alignment this object uses when it allocates memory
+        !*/
+
+        long layout_padding (
+        ) const;
+        /*!
+            ensures
+                - returns the border this object puts around the image when it
+                  allocates memory
+        !*/
+
+        void set_size (
+            long rows,
+            long cols
+        );
+        /*!
+            requires
+                - rows >= 0 && cols >= 0
+            ensures
+                - #nr() == rows
+                - #nc() == cols
+                - if (rows == nr() && cols == nc()) then
+                    - nothing changes.  In particular, if *this wraps external memory it
+                      still does, so routines that write their output with
+                      set_image_size() write straight into the wrapped memory.
+                - else
+                    - #owns_data() == true
+                    - #alignment() == layout_alignment()
+                    - #padding() == layout_padding()
+                    - all elements in this image, padding included, have been value
+                      initialized, i.e. T()
+            throws
+                - std::bad_alloc or any exception thrown by T's constructor.
+                  If an exception is thrown then #*this is empty and owns_data() == true.
+        !*/
+
+        void wrap (
+            T* data,
+            long rows,
+            long cols,
+            long width_step
+        );
+        /*!
+            requires
+                - rows >= 0 && cols >= 0
+                - if (rows > 1) then
+                    - width_step >= cols*sizeof(T)
+                - data points to rows rows of cols T objects, with width_step bytes from
+                  the start of one row to the start of the next, and suitably aligned
+                  for T.
+            ensures
+                - #owns_data() == false
+                - #nr() == rows
+                - #nc() == cols
+                - #width_step() == width_step
+                - &(#*this)[0][0] == data
+                - #padding() == 0
+                - #alignment() == the largest power of two, up to 4096, that divides
+                  both data and width_step
+                - The memory is not copied, and it is not freed when this object lets go
+                  of it, so it must outlive the time it is wrapped.
+        !*/
+
+        bool owns_data (
+        ) const;
+        /*!
+            ensures
+                - returns true if the elements of this image are in memory that belongs
+                  to this object and false if they are in memory that was given to wrap()
+        !*/
+
+        long nr (
+        ) const;
+        /*!
+            ensures
+                - returns the number of rows in this image
+        !*/
+
+        long nc (
+        ) const;
+        /*!
+            ensures
+                - returns the number of columns in this image
+        !*/
+
+        unsigned long size (
+        ) const;
+        /*!
+            ensures
+                - returns nr()*nc()
+        !*/
+
+        long width_step (
+        ) const;
+        /*!
+            ensures
+                - returns the number of bytes from the start of one row of this image to
+                  the start of the next.
+        !*/
+
+        unsigned long alignment (
+        ) const;
+        /*!
+            ensures
+                - returns a power of two.  The address of the first element of every row,
+                  (*this)[r], is a multiple of alignment().
+        !*/
+
+        long padding (
+        ) const;
+        /*!
+            ensures
+                - returns the number of padding elements on each side of this image
+        !*/
+
+        T* operator[] (
+            long row
+        );
+        /*!
+            requires
+                - -padding() <= row < nr()+padding()
+            ensures
+                - returns a pointer to the element in column 0 of the given row.  The
+                  elements of the row, including its padding, are at indices
+                  -padding() through nc()+padding()-1 of this pointer.
+        !*/
+
+        const T* operator[] (
+            long row
+        ) const;
+        /*!
+            requires
+                - -padding() <= row < nr()+padding()
+            ensures
+                - returns a const pointer to the element in column 0 of the given row.
+        !*/
+
+        T& operator() (
+            long row,
+            long column
+        );
+        /*!
+            requires
+                - -padding() <= row < nr()+padding()
+                - -padding() <= column < nc()+padding()
+            ensures
+                - returns (*this)[row][column]
+        !*/
+
+        const T& operator() (
+            long row,
+            long column
+        ) const;
+        /*!
+            requires
+                - -padding() <= row < nr()+padding()
+                - -padding() <= column < nc()+padding()
+            ensures
+                - returns (*this)[row][column]
+        !*/
+
+        void fill_padding (
+            const T& value
+        );
+        /*!
+            ensures
+                - sets every padding element to value.  The image itself is unchanged.
+        !*/
+
+        void replicate_edges_into_padding (
+        );
+        /*!
+            requires
+                - if (padding() != 0) then
+                    - nr() > 0 && nc() > 0
+            ensures
+                - sets every padding element to the nearest element of the image, so
+                  that reads past the edges see the edges extended outward.
+        !*/
+
+        void clear (
+        );
+        /*!
+            ensures
+                - #*this is empty, i.e. #nr() == 0 and #nc() == 0, and lets go of any
+                  memory it owned or wrapped.
+                - #owns_data() == true
+                - layout_alignment() and layout_padding() are unchanged
+        !*/
+
+        void swap (
+            aligned_array2d& item
+        );
+        /*!
+            ensures
+                - swaps *this and item
+        !*/
+
+    private:
+
+        // restricted functions
+        aligned_array2d(const aligned_array2d&);        // copy constructor
+        aligned_array2d& operator=(const aligned_array2d&);    // assignment operator
+
+    };
+
+    template <
+        typename T,
+        typename mem_manager
+        >
+    inline void swap (
+        aligned_array2d<T,mem_manager>& a,
+        aligned_array2d<T,mem_manager>& b
+    ) { a.swap(b); }
+    /*!
+        provides a global swap function
+    !*/
+
+}
+
+#endif // DLIB_ALIGNED_ARRAY2D_ABSTRACT_
+
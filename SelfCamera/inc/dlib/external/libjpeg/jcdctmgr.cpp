@@ -15,6 +15,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
 
 
 /* Private subobject for this module */
@@ -31,6 +32,11 @@ typedef struct {
    */
   DCTELEM * divisors[NUM_QUANT_TBLS];
 
+  /* The same divisors in the form jsimd_fdct_islow takes them, when the
+   * integer DCT is done with it.
+   */
+  jsimd_fdct_table * simd_divisors[NUM_QUANT_TBLS];
+
 #ifdef DCT_FLOAT_SUPPORTED
   /* Same as above for the floating-point case. */
   float_DCT_method_ptr do_float_dct;
@@ -84,6 +90,14 @@ start_pass_fdctmgr (j_compress_ptr cinfo)
       for (i = 0; i < DCTSIZE2; i++) {
 	dtbl[i] = ((DCTELEM) qtbl->quantval[i]) << 3;
       }
+      if (jsimd_can_fdct_islow()) {
+	if (fdct->simd_divisors[qtblno] == NULL) {
+	  fdct->simd_divisors[qtblno] = (jsimd_fdct_table *)
+	    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+					SIZEOF(jsimd_fdct_table));
+	}
+	jsimd_set_fdct_islow_table(fdct->simd_divisors[qtblno], qtbl);
+      }
       break;
 #endif
 #ifdef DCT_IFAST_SUPPORTED
@@ -264,6 +278,31 @@ forward_DCT (j_compress_ptr cinfo, jpeg_component_info * compptr,
 }
 
 
+#ifdef DCT_ISLOW_SUPPORTED
+
+METHODDEF(void)
+forward_DCT_simd (j_compress_ptr cinfo, jpeg_component_info * compptr,
+		  JSAMPARRAY sample_data, JBLOCKROW coef_blocks,
+		  JDIMENSION start_row, JDIMENSION start_col,
+		  JDIMENSION num_blocks)
+/* This version is used for the integer DCT when jsimd.h has it.  The SIMD
+ * code only takes quantizers it can divide by exactly; see jcsimd.c.
+ */
+{
+  my_fdct_ptr fdct = (my_fdct_ptr) cinfo->fdct;
+  const jsimd_fdct_table * table = fdct->simd_divisors[compptr->quant_tbl_no];
+
+  if (table->usable)
+    jsimd_fdct_islow(table, sample_data + start_row, coef_blocks,
+		     start_col, num_blocks);
+  else
+    forward_DCT(cinfo, compptr, sample_data, coef_blocks,
+		start_row, start_col, num_blocks);
+}
+
+#endif /* DCT_ISLOW_SUPPORTED */
+
+
 #ifdef DCT_FLOAT_SUPPORTED
 
 METHODDEF(void)
@@ -356,7 +395,7 @@ jinit_forward_dct (j_compress_ptr cinfo)
   switch (cinfo->dct_method) {
 #ifdef DCT_ISLOW_SUPPORTED
   case JDCT_ISLOW:
-    fdct->pub.forward_DCT = forward_DCT;
+    fdct->pub.forward_DCT = jsimd_can_fdct_islow() ? forward_DCT_simd : forward_DCT;
     fdct->do_dct = jpeg_fdct_islow;
     break;
 #endif
@@ -380,6 +419,7 @@ jinit_forward_dct (j_compress_ptr cinfo)
   /* Mark divisor tables unallocated */
   for (i = 0; i < NUM_QUANT_TBLS; i++) {
     fdct->divisors[i] = NULL;
+    fdct->simd_divisors[i] = NULL;
 #ifdef DCT_FLOAT_SUPPORTED
     fdct->float_divisors[i] = NULL;
 #endif
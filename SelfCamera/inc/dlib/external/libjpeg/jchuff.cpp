@@ -26,8 +26,12 @@
  * but must not be updated permanently until we complete the MCU.
  */
 
+/* The bit-accumulation buffer is 64 bits wide; see emit_bits. */
+
+typedef unsigned long long bit_buf_type;
+
 typedef struct {
-  long put_buffer;		/* current bit-accumulation buffer */
+  bit_buf_type put_buffer;	/* current bit-accumulation buffer */
   int put_bits;			/* # of bits now in it */
   int last_dc_val[MAX_COMPS_IN_SCAN]; /* last DC coef for each component */
 } savable_state;
@@ -243,7 +247,7 @@ jpeg_make_c_derived_tbl (j_compress_ptr cinfo, int isDC, int tblno,
 
   /* Set all codeless symbols to have code length 0;
    * this lets us detect duplicate VAL entries here, and later
-   * allows emit_bits to detect any attempt to emit such symbols.
+   * allows emit_symbol to detect any attempt to emit such symbols.
    */
   MEMZERO(dtbl->ehufsi, SIZEOF(dtbl->ehufsi));
 
@@ -291,59 +295,140 @@ dump_buffer (working_state * state)
 
 /* Outputting bits to the file */
 
-/* Only the right 24 bits of put_buffer are used; the valid bits are
- * left-justified in this part.  At most 16 bits can be passed to emit_bits
- * in one call, and we never retain more than 7 bits in put_buffer
- * between calls, so 24 bits are sufficient.
+/* The valid bits of put_buffer are right-justified, and bits above them
+ * are leftovers that were already output.  Whole 32-bit words are taken
+ * off the top once there are at least 32 bits, so no more than 31 bits
+ * are kept between calls, and since one call adds at most 31 bits (a
+ * Huffman code and the value bits after it), 64 bits are sufficient.
+ * Words without an 0xFF byte, which need no stuffing, are stored in one
+ * go while there is room for them in the output buffer.
  */
 
 inline
 LOCAL(int)
-emit_bits (working_state * state, unsigned int code, int size)
+emit_bits (working_state * state, bit_buf_type code, int size)
 /* Emit some bits; return TRUE if successful, FALSE if must suspend */
+/* code must have no bits set above the low size bits */
 {
   /* This routine is heavily used, so it's worth coding tightly. */
-  long put_buffer = (long) code;
-  int put_bits = state->cur.put_bits;
+  bit_buf_type put_buffer = (state->cur.put_buffer << size) | code;
+  int put_bits = state->cur.put_bits + size;
+
+  if (put_bits >= 32) {
+    unsigned int word = (unsigned int) (put_buffer >> (put_bits - 32));
+
+    put_bits -= 32;
+    if (state->free_in_buffer > 4 &&
+	((~word - 0x01010101U) & word & 0x80808080U) == 0) {
+      /* No byte of ~word is zero, so no byte of word is 0xFF */
+      JOCTET * p = state->next_output_byte;
+      p[0] = (JOCTET) (word >> 24);
+      p[1] = (JOCTET) (word >> 16);
+      p[2] = (JOCTET) (word >> 8);
+      p[3] = (JOCTET) word;
+      state->next_output_byte = p + 4;
+      state->free_in_buffer -= 4;
+    } else {
+      int shift, c;
+
+      for (shift = 24; shift >= 0; shift -= 8) {
+	c = (int) ((word >> shift) & 0xFF);
+	emit_byte(state, c, return FALSE);
+	if (c == 0xFF) {		/* need to stuff a zero byte? */
+	  emit_byte(state, 0, return FALSE);
+	}
+      }
+    }
+  }
+
+  state->cur.put_buffer = put_buffer; /* update state variables */
+  state->cur.put_bits = put_bits;
+
+  return TRUE;
+}
+
+
+/* Emit the Huffman code for a symbol followed by nbits bits of value, in
+ * one call to emit_bits.
+ */
+
+inline
+LOCAL(int)
+emit_symbol (working_state * state, c_derived_tbl * tbl, int symbol,
+	     unsigned int value, int nbits)
+{
+  int size = tbl->ehufsi[symbol];
 
   /* if size is 0, caller used an invalid Huffman table entry */
   if (size == 0)
     ERREXIT(state->cinfo, JERR_HUFF_MISSING_CODE);
 
-  put_buffer &= (((long) 1)<<size) - 1; /* mask off any extra bits in code */
-  
-  put_bits += size;		/* new number of bits in buffer */
-  
-  put_buffer <<= 24 - put_bits; /* align incoming bits */
+  return emit_bits(state,
+		   ((bit_buf_type) tbl->ehufco[symbol] << nbits) |
+		   (value & ((1U << nbits) - 1)),
+		   size + nbits);
+}
+
+
+LOCAL(int)
+flush_bits (working_state * state)
+{
+  /* fill any partial byte with ones */
+  bit_buf_type put_buffer = (state->cur.put_buffer << 7) | 0x7F;
+  int put_bits = state->cur.put_bits + 7;
+  int c;
 
-  put_buffer |= state->cur.put_buffer; /* and merge with old buffer contents */
-  
   while (put_bits >= 8) {
-    int c = (int) ((put_buffer >> 16) & 0xFF);
-    
+    put_bits -= 8;
+    c = (int) ((put_buffer >> put_bits) & 0xFF);
     emit_byte(state, c, return FALSE);
     if (c == 0xFF) {		/* need to stuff a zero byte? */
       emit_byte(state, 0, return FALSE);
     }
-    put_buffer <<= 8;
-    put_bits -= 8;
   }
+  state->cur.put_buffer = 0;	/* and reset bit-buffer to empty */
+  state->cur.put_bits = 0;
+  return TRUE;
+}
 
-  state->cur.put_buffer = put_buffer; /* update state variables */
-  state->cur.put_bits = put_bits;
 
-  return TRUE;
+/* Find the number of bits needed for the magnitude of a coefficient */
+
+inline
+LOCAL(int)
+coef_nbits (unsigned int temp)
+{
+#ifdef __GNUC__
+  return temp ? 32 - __builtin_clz(temp) : 0;
+#else
+  int nbits = 0;
+
+  while (temp) {
+    nbits++;
+    temp >>= 1;
+  }
+  return nbits;
+#endif
 }
 
 
+/* Find the position of the lowest set bit of a nonzero mask */
+
+inline
 LOCAL(int)
-flush_bits (working_state * state)
+lowest_bit (unsigned long long mask)
 {
-  if (! emit_bits(state, 0x7F, 7)) /* fill any partial byte with ones */
-    return FALSE;
-  state->cur.put_buffer = 0;	/* and reset bit-buffer to empty */
-  state->cur.put_bits = 0;
-  return TRUE;
+#ifdef __GNUC__
+  return __builtin_ctzll(mask);
+#else
+  int k = 0;
+
+  while ((mask & 1) == 0) {
+    k++;
+    mask >>= 1;
+  }
+  return k;
+#endif
 }
 
 
@@ -355,7 +440,9 @@ encode_one_block (working_state * state, JCOEFPTR block, int last_dc_val,
 {
   int temp, temp2;
   int nbits;
-  int k, r, i;
+  int k, r, last;
+  int coefs[DCTSIZE2];
+  unsigned long long nonzero;
   
   /* Encode the DC coefficient difference per section F.1.2.1 */
   
@@ -368,75 +455,66 @@ encode_one_block (working_state * state, JCOEFPTR block, int last_dc_val,
     temp2--;
   }
   
-  /* Find the number of bits needed for the magnitude of the coefficient */
-  nbits = 0;
-  while (temp) {
-    nbits++;
-    temp >>= 1;
-  }
+  nbits = coef_nbits((unsigned int) temp);
   /* Check for out-of-range coefficient values.
    * Since we're encoding a difference, the range limit is twice as much.
    */
   if (nbits > MAX_COEF_BITS+1)
     ERREXIT(state->cinfo, JERR_BAD_DCT_COEF);
   
-  /* Emit the Huffman-coded symbol for the number of bits */
-  if (! emit_bits(state, dctbl->ehufco[nbits], dctbl->ehufsi[nbits]))
-    return FALSE;
-
-  /* Emit that number of bits of the value, if positive, */
+  /* Emit the Huffman-coded symbol for the number of bits, and then */
+  /* that number of bits of the value, if positive, */
   /* or the complement of its magnitude, if negative. */
-  if (nbits)			/* emit_bits rejects calls with size 0 */
-    if (! emit_bits(state, (unsigned int) temp2, nbits))
-      return FALSE;
+  if (! emit_symbol(state, dctbl, nbits, (unsigned int) temp2, nbits))
+    return FALSE;
 
   /* Encode the AC coefficients per section F.1.2.2 */
   
-  r = 0;			/* r = run length of zeros */
-  
+  /* Pick out the coefficients in zigzag order and note which are nonzero
+   * first, so that the runs of zeros can be skipped in one step each.
+   */
+  nonzero = 0;
   for (k = 1; k < DCTSIZE2; k++) {
-    if ((temp = block[jpeg_natural_order[k]]) == 0) {
-      r++;
-    } else {
-      /* if run length > 15, must emit special run-length-16 codes (0xF0) */
-      while (r > 15) {
-	if (! emit_bits(state, actbl->ehufco[0xF0], actbl->ehufsi[0xF0]))
-	  return FALSE;
-	r -= 16;
-      }
+    coefs[k] = block[jpeg_natural_order[k]];
+    nonzero |= (unsigned long long) (coefs[k] != 0) << k;
+  }
 
-      temp2 = temp;
-      if (temp < 0) {
-	temp = -temp;		/* temp is abs value of input */
-	/* This code assumes we are on a two's complement machine */
-	temp2--;
-      }
-      
-      /* Find the number of bits needed for the magnitude of the coefficient */
-      nbits = 1;		/* there must be at least one 1 bit */
-      while ((temp >>= 1))
-	nbits++;
-      /* Check for out-of-range coefficient values */
-      if (nbits > MAX_COEF_BITS)
-	ERREXIT(state->cinfo, JERR_BAD_DCT_COEF);
-      
-      /* Emit Huffman symbol for run length / number of bits */
-      i = (r << 4) + nbits;
-      if (! emit_bits(state, actbl->ehufco[i], actbl->ehufsi[i]))
-	return FALSE;
+  last = 0;			/* last = position of last nonzero coef */
+  while (nonzero) {
+    k = lowest_bit(nonzero);
+    nonzero &= nonzero - 1;
+    r = k - last - 1;		/* r = run length of zeros */
+    last = k;
 
-      /* Emit that number of bits of the value, if positive, */
-      /* or the complement of its magnitude, if negative. */
-      if (! emit_bits(state, (unsigned int) temp2, nbits))
+    /* if run length > 15, must emit special run-length-16 codes (0xF0) */
+    while (r > 15) {
+      if (! emit_symbol(state, actbl, 0xF0, 0, 0))
 	return FALSE;
-      
-      r = 0;
+      r -= 16;
     }
+
+    temp = temp2 = coefs[k];
+    if (temp < 0) {
+      temp = -temp;		/* temp is abs value of input */
+      /* This code assumes we are on a two's complement machine */
+      temp2--;
+    }
+      
+    nbits = coef_nbits((unsigned int) temp);
+    /* Check for out-of-range coefficient values */
+    if (nbits > MAX_COEF_BITS)
+      ERREXIT(state->cinfo, JERR_BAD_DCT_COEF);
+      
+    /* Emit Huffman symbol for run length / number of bits, */
+    /* and then that number of bits of the value as above. */
+    if (! emit_symbol(state, actbl, (r << 4) + nbits, (unsigned int) temp2, nbits))
+      return FALSE;
   }
+  r = DCTSIZE2 - 1 - last;
 
   /* If the last coef(s) were zero, emit an end-of-block code */
   if (r > 0)
-    if (! emit_bits(state, actbl->ehufco[0], actbl->ehufsi[0]))
+    if (! emit_symbol(state, actbl, 0, 0, 0))
       return FALSE;
 
   return TRUE;
@@ -816,8 +894,11 @@ jpeg_gen_optimal_table (j_compress_ptr cinfo, JHUFF_TBL * htbl, long freq[])
     i--;
   bits[i]--;
   
-  /* Return final symbol counts (only for lengths 0..16) */
-  MEMCOPY(htbl->bits, bits, SIZEOF(htbl->bits));
+  /* Return final symbol counts (only for lengths 0..16).  bits[] is wider
+   * than htbl->bits, so this can't be a MEMCOPY.
+   */
+  for (i = 0; i <= 16; i++)
+    htbl->bits[i] = (unsigned char) bits[i];
   
   /* Return a list of the symbols sorted by code length */
   /* It's not real clear to me why we don't need to consider the codelength
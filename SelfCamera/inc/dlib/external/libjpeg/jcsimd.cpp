@@ -0,0 +1,1174 @@
+/*
+ * jcsimd.c
+ *
+ * This file is not part of the Independent JPEG Group's release; it was
+ * added to this copy of the library.
+ *
+ * This file contains SSE2, AVX2 and NEON versions of the compressor's
+ * RGB->YCbCr and RGB->grayscale conversion (jccolor.c), its h2v1 and h2v2
+ * downsampling (jcsample.c) and its accurate integer forward DCT with
+ * quantization (jfdctint.c and jcdctmgr.c).  They give exactly the same
+ * output as the C code.  See jsimd.h.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"
+#include "jsimd.h"
+
+#ifdef JSIMD_X86
+#include <immintrin.h>
+#define JSIMD_TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+#ifdef JSIMD_ARM_NEON
+#include <arm_neon.h>
+#endif
+
+/* The small helpers are always inlined: the AVX2 routines share the SSE2
+ * ones, which only get the AVX2 encoding when they are inlined into them.
+ */
+#ifdef __GNUC__
+#define JSIMD_INLINE  __attribute__((always_inline)) inline
+#else
+#define JSIMD_INLINE  inline
+#endif
+
+
+/* Everything here needs one of the instruction sets, and assumes 8-bit
+ * samples, 16-bit coefficients and the library's usual RGB pixel layout.
+ */
+
+#if (defined(JSIMD_X86) || defined(JSIMD_ARM_NEON)) && \
+    BITS_IN_JSAMPLE == 8 && DCTSIZE == 8 && \
+    RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+#define JSIMD_COMPRESS_SUPPORTED
+#endif
+
+#ifdef JSIMD_X86
+#define PAIR16(a,b)  ((int) (((unsigned int) (b) << 16) | ((unsigned int) (a) & 0xFFFF)))
+#endif
+
+
+/**************** RGB->YCbCr conversion ****************/
+
+
+/* jccolor.c's tables hold FIX(0.29900) * R and so on, with the rounding and
+ * the CENTERJSAMPLE offsets folded in, and it adds three of them and shifts
+ * the sum down by 16.  The same sums computed directly are the same bits.
+ * The +0.5 terms are a shift by 15, and Y_G does not fit in a signed 16-bit
+ * multiplier, so the x86 code splits it into two.
+ */
+
+#define Y_R   19595		/* FIX(0.29900) */
+#define Y_G   38470		/* FIX(0.58700) */
+#define Y_B   7471		/* FIX(0.11400) */
+#define CB_R  (-11059)		/* -FIX(0.16874) */
+#define CB_G  (-21709)		/* -FIX(0.33126) */
+#define CR_G  (-27439)		/* -FIX(0.41869) */
+#define CR_B  (-5329)		/* -FIX(0.08131) */
+
+#define ONE_HALF_16  (1 << 15)
+#define CBCR_ROUND   ((CENTERJSAMPLE << 16) + ONE_HALF_16 - 1)
+
+
+#ifdef JSIMD_COMPRESS_SUPPORTED
+
+#ifdef JSIMD_X86
+
+/* Splits 48 bytes of RGB pixels into 16 bytes each of R, G and B.  Each
+ * round of unpacks brings bytes that were 3 apart one step closer, and
+ * after four rounds each register holds one component in order.
+ */
+
+JSIMD_INLINE LOCAL(void)
+deinterleave_rgb_sse2 (__m128i * t0, __m128i * t1, __m128i * t2)
+{
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    const __m128i u0 = _mm_unpacklo_epi8(*t0, _mm_unpackhi_epi64(*t1, *t1));
+    const __m128i u1 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(*t0, *t0), *t2);
+    const __m128i u2 = _mm_unpacklo_epi8(*t1, _mm_unpackhi_epi64(*t2, *t2));
+    *t0 = u0;
+    *t1 = u1;
+    *t2 = u2;
+  }
+}
+
+
+/* Y of 8 pixels from their 16-bit R, G and B. */
+
+JSIMD_INLINE LOCAL(__m128i)
+rgb_y_sse2 (__m128i r, __m128i g, __m128i b)
+{
+  const __m128i crg = _mm_set1_epi32(PAIR16(Y_R, Y_G - 16384));
+  const __m128i cbg = _mm_set1_epi32(PAIR16(Y_B, 16384));
+  const __m128i round = _mm_set1_epi32(ONE_HALF_16);
+  __m128i lo, hi;
+
+  lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r, g), crg),
+		     _mm_madd_epi16(_mm_unpacklo_epi16(b, g), cbg));
+  hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r, g), crg),
+		     _mm_madd_epi16(_mm_unpackhi_epi16(b, g), cbg));
+  lo = _mm_srli_epi32(_mm_add_epi32(lo, round), 16);
+  hi = _mm_srli_epi32(_mm_add_epi32(hi, round), 16);
+  return _mm_packs_epi32(lo, hi);
+}
+
+
+/* Cb (a = R, c = B) or Cr (a = B, c = R) of 8 pixels: the two are the same
+ * but for which component gets the 0.5.
+ */
+
+JSIMD_INLINE LOCAL(__m128i)
+rgb_c_sse2 (__m128i a, __m128i g, __m128i c, int pair)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i cag = _mm_set1_epi32(pair);
+  const __m128i round = _mm_set1_epi32(CBCR_ROUND);
+  __m128i lo, hi;
+
+  lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, g), cag),
+		     _mm_slli_epi32(_mm_unpacklo_epi16(c, zero), 15));
+  hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, g), cag),
+		     _mm_slli_epi32(_mm_unpackhi_epi16(c, zero), 15));
+  lo = _mm_srli_epi32(_mm_add_epi32(lo, round), 16);
+  hi = _mm_srli_epi32(_mm_add_epi32(hi, round), 16);
+  return _mm_packs_epi32(lo, hi);
+}
+
+
+/* These do the columns of one row they have whole vectors for, and return
+ * where they stopped.  outptr1 and outptr2 are NULL for grayscale.
+ */
+
+LOCAL(JDIMENSION)
+rgb_ycc_sse2 (JSAMPROW inptr, JSAMPROW outptr0, JSAMPROW outptr1,
+	      JSAMPROW outptr2, JDIMENSION num_cols)
+{
+  const __m128i zero = _mm_setzero_si128();
+  JDIMENSION col;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    __m128i r = _mm_loadu_si128((const __m128i *) (inptr + 3*col));
+    __m128i g = _mm_loadu_si128((const __m128i *) (inptr + 3*col + 16));
+    __m128i b = _mm_loadu_si128((const __m128i *) (inptr + 3*col + 32));
+    __m128i rl, gl, bl, rh, gh, bh;
+
+    deinterleave_rgb_sse2(&r, &g, &b);
+    rl = _mm_unpacklo_epi8(r, zero);
+    gl = _mm_unpacklo_epi8(g, zero);
+    bl = _mm_unpacklo_epi8(b, zero);
+    rh = _mm_unpackhi_epi8(r, zero);
+    gh = _mm_unpackhi_epi8(g, zero);
+    bh = _mm_unpackhi_epi8(b, zero);
+    _mm_storeu_si128((__m128i *) (outptr0 + col),
+		     _mm_packus_epi16(rgb_y_sse2(rl, gl, bl), rgb_y_sse2(rh, gh, bh)));
+    if (outptr1 != NULL) {
+      _mm_storeu_si128((__m128i *) (outptr1 + col),
+		       _mm_packus_epi16(rgb_c_sse2(rl, gl, bl, PAIR16(CB_R, CB_G)),
+					rgb_c_sse2(rh, gh, bh, PAIR16(CB_R, CB_G))));
+      _mm_storeu_si128((__m128i *) (outptr2 + col),
+		       _mm_packus_epi16(rgb_c_sse2(bl, gl, rl, PAIR16(CR_B, CR_G)),
+					rgb_c_sse2(bh, gh, rh, PAIR16(CR_B, CR_G))));
+    }
+  }
+  return col;
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(void)
+deinterleave_rgb_avx2 (__m256i * t0, __m256i * t1, __m256i * t2)
+{
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    const __m256i u0 = _mm256_unpacklo_epi8(*t0, _mm256_unpackhi_epi64(*t1, *t1));
+    const __m256i u1 = _mm256_unpacklo_epi8(_mm256_unpackhi_epi64(*t0, *t0), *t2);
+    const __m256i u2 = _mm256_unpacklo_epi8(*t1, _mm256_unpackhi_epi64(*t2, *t2));
+    *t0 = u0;
+    *t1 = u1;
+    *t2 = u2;
+  }
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+rgb_y_avx2 (__m256i r, __m256i g, __m256i b)
+{
+  const __m256i crg = _mm256_set1_epi32(PAIR16(Y_R, Y_G - 16384));
+  const __m256i cbg = _mm256_set1_epi32(PAIR16(Y_B, 16384));
+  const __m256i round = _mm256_set1_epi32(ONE_HALF_16);
+  __m256i lo, hi;
+
+  lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(r, g), crg),
+			_mm256_madd_epi16(_mm256_unpacklo_epi16(b, g), cbg));
+  hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(r, g), crg),
+			_mm256_madd_epi16(_mm256_unpackhi_epi16(b, g), cbg));
+  lo = _mm256_srli_epi32(_mm256_add_epi32(lo, round), 16);
+  hi = _mm256_srli_epi32(_mm256_add_epi32(hi, round), 16);
+  return _mm256_packs_epi32(lo, hi);
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+rgb_c_avx2 (__m256i a, __m256i g, __m256i c, int pair)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i cag = _mm256_set1_epi32(pair);
+  const __m256i round = _mm256_set1_epi32(CBCR_ROUND);
+  __m256i lo, hi;
+
+  lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a, g), cag),
+			_mm256_slli_epi32(_mm256_unpacklo_epi16(c, zero), 15));
+  hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a, g), cag),
+			_mm256_slli_epi32(_mm256_unpackhi_epi16(c, zero), 15));
+  lo = _mm256_srli_epi32(_mm256_add_epi32(lo, round), 16);
+  hi = _mm256_srli_epi32(_mm256_add_epi32(hi, round), 16);
+  return _mm256_packs_epi32(lo, hi);
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+load_2x128_avx2 (JSAMPROW lo, JSAMPROW hi)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) lo)),
+				 _mm_loadu_si128((const __m128i *) hi), 1);
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(JDIMENSION)
+rgb_ycc_avx2 (JSAMPROW inptr, JSAMPROW outptr0, JSAMPROW outptr1,
+	      JSAMPROW outptr2, JDIMENSION num_cols)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  JDIMENSION col;
+
+  for (col = 0; col + 32 <= num_cols; col += 32) {
+    /* The low lanes get pixels 0-15 and the high lanes 16-31, and since
+     * all of the unpacks and packs work within lanes, they stay that way.
+     */
+    JSAMPROW p = inptr + 3*col;
+    __m256i r = load_2x128_avx2(p, p + 48);
+    __m256i g = load_2x128_avx2(p + 16, p + 64);
+    __m256i b = load_2x128_avx2(p + 32, p + 80);
+    __m256i rl, gl, bl, rh, gh, bh;
+
+    deinterleave_rgb_avx2(&r, &g, &b);
+    rl = _mm256_unpacklo_epi8(r, zero);
+    gl = _mm256_unpacklo_epi8(g, zero);
+    bl = _mm256_unpacklo_epi8(b, zero);
+    rh = _mm256_unpackhi_epi8(r, zero);
+    gh = _mm256_unpackhi_epi8(g, zero);
+    bh = _mm256_unpackhi_epi8(b, zero);
+    _mm256_storeu_si256((__m256i *) (outptr0 + col),
+			_mm256_packus_epi16(rgb_y_avx2(rl, gl, bl), rgb_y_avx2(rh, gh, bh)));
+    if (outptr1 != NULL) {
+      _mm256_storeu_si256((__m256i *) (outptr1 + col),
+			  _mm256_packus_epi16(rgb_c_avx2(rl, gl, bl, PAIR16(CB_R, CB_G)),
+					      rgb_c_avx2(rh, gh, bh, PAIR16(CB_R, CB_G))));
+      _mm256_storeu_si256((__m256i *) (outptr2 + col),
+			  _mm256_packus_epi16(rgb_c_avx2(bl, gl, rl, PAIR16(CR_B, CR_G)),
+					      rgb_c_avx2(bh, gh, rh, PAIR16(CR_B, CR_G))));
+    }
+  }
+  return col;
+}
+
+#endif /* JSIMD_X86 */
+
+
+#ifdef JSIMD_ARM_NEON
+
+/* NEON has unsigned widening multiplies, so these work on the unsigned
+ * constants and subtract the negative terms.
+ */
+
+JSIMD_INLINE LOCAL(uint8x8_t)
+rgb_y_neon (uint16x8_t r, uint16x8_t g, uint16x8_t b)
+{
+  uint32x4_t lo = vmull_n_u16(vget_low_u16(r), Y_R);
+  uint32x4_t hi = vmull_n_u16(vget_high_u16(r), Y_R);
+
+  lo = vmlal_n_u16(vmlal_n_u16(lo, vget_low_u16(g), Y_G), vget_low_u16(b), Y_B);
+  hi = vmlal_n_u16(vmlal_n_u16(hi, vget_high_u16(g), Y_G), vget_high_u16(b), Y_B);
+  return vmovn_u16(vcombine_u16(vrshrn_n_u32(lo, 16), vrshrn_n_u32(hi, 16)));
+}
+
+
+JSIMD_INLINE LOCAL(uint8x8_t)
+rgb_c_neon (uint16x8_t a, uint16x8_t g, uint16x8_t c, int ka, int kg)
+{
+  uint32x4_t lo = vdupq_n_u32(CBCR_ROUND);
+  uint32x4_t hi = vdupq_n_u32(CBCR_ROUND);
+
+  lo = vmlal_n_u16(lo, vget_low_u16(c), ONE_HALF_16);
+  hi = vmlal_n_u16(hi, vget_high_u16(c), ONE_HALF_16);
+  lo = vmlsl_n_u16(vmlsl_n_u16(lo, vget_low_u16(a), ka), vget_low_u16(g), kg);
+  hi = vmlsl_n_u16(vmlsl_n_u16(hi, vget_high_u16(a), ka), vget_high_u16(g), kg);
+  return vmovn_u16(vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16)));
+}
+
+
+LOCAL(JDIMENSION)
+rgb_ycc_neon (JSAMPROW inptr, JSAMPROW outptr0, JSAMPROW outptr1,
+	      JSAMPROW outptr2, JDIMENSION num_cols)
+{
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    const uint8x8x3_t rgb = vld3_u8(inptr + 3*col);
+    const uint16x8_t r = vmovl_u8(rgb.val[0]);
+    const uint16x8_t g = vmovl_u8(rgb.val[1]);
+    const uint16x8_t b = vmovl_u8(rgb.val[2]);
+
+    vst1_u8(outptr0 + col, rgb_y_neon(r, g, b));
+    if (outptr1 != NULL) {
+      vst1_u8(outptr1 + col, rgb_c_neon(r, g, b, -CB_R, -CB_G));
+      vst1_u8(outptr2 + col, rgb_c_neon(b, g, r, -CR_B, -CR_G));
+    }
+  }
+  return col;
+}
+
+#endif /* JSIMD_ARM_NEON */
+
+#endif /* JSIMD_COMPRESS_SUPPORTED */
+
+
+LOCAL(void)
+rgb_ycc_rows (j_compress_ptr cinfo, JSAMPARRAY input_buf,
+	      JSAMPIMAGE output_buf, JDIMENSION output_row, int num_rows,
+	      int gray)
+{
+  JSAMPROW inptr;
+  JSAMPROW outptr0, outptr1, outptr2;
+  JDIMENSION col;
+  JDIMENSION num_cols = cinfo->image_width;
+  long r, g, b;
+
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr0 = output_buf[0][output_row];
+    outptr1 = gray ? NULL : output_buf[1][output_row];
+    outptr2 = gray ? NULL : output_buf[2][output_row];
+    output_row++;
+    col = 0;
+#ifdef JSIMD_COMPRESS_SUPPORTED
+#ifdef JSIMD_X86
+    if (jsimd_support() & JSIMD_AVX2)
+      col = rgb_ycc_avx2(inptr, outptr0, outptr1, outptr2, num_cols);
+    else
+      col = rgb_ycc_sse2(inptr, outptr0, outptr1, outptr2, num_cols);
+#endif
+#ifdef JSIMD_ARM_NEON
+    col = rgb_ycc_neon(inptr, outptr0, outptr1, outptr2, num_cols);
+#endif
+#endif
+    for (; col < num_cols; col++) {
+      r = GETJSAMPLE(inptr[3*col+RGB_RED]);
+      g = GETJSAMPLE(inptr[3*col+RGB_GREEN]);
+      b = GETJSAMPLE(inptr[3*col+RGB_BLUE]);
+      outptr0[col] = (JSAMPLE) ((Y_R * r + Y_G * g + Y_B * b + ONE_HALF_16) >> 16);
+      if (! gray) {
+	outptr1[col] = (JSAMPLE) ((CB_R * r + CB_G * g + (b << 15) + CBCR_ROUND) >> 16);
+	outptr2[col] = (JSAMPLE) ((CR_B * b + CR_G * g + (r << 15) + CBCR_ROUND) >> 16);
+      }
+    }
+  }
+}
+
+
+GLOBAL(int)
+jsimd_can_rgb_ycc (void)
+{
+#ifdef JSIMD_COMPRESS_SUPPORTED
+  return (jsimd_support() != 0);
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(void)
+jsimd_rgb_ycc_convert (j_compress_ptr cinfo,
+		       JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+		       JDIMENSION output_row, int num_rows)
+{
+  rgb_ycc_rows(cinfo, input_buf, output_buf, output_row, num_rows, FALSE);
+}
+
+
+GLOBAL(int)
+jsimd_can_rgb_gray (void)
+{
+#ifdef JSIMD_COMPRESS_SUPPORTED
+  return (jsimd_support() != 0);
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(void)
+jsimd_rgb_gray_convert (j_compress_ptr cinfo,
+			JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+			JDIMENSION output_row, int num_rows)
+{
+  rgb_ycc_rows(cinfo, input_buf, output_buf, output_row, num_rows, TRUE);
+}
+
+
+/**************** Downsampling ****************/
+
+
+/* These do the output columns of one row they have whole vectors for, and
+ * return where they stopped, which is always an even column.  The input
+ * rows have been expanded to twice the output width by then, so every load
+ * is within them.
+ */
+
+#ifdef JSIMD_COMPRESS_SUPPORTED
+
+#ifdef JSIMD_X86
+
+/* The sums of each two neighbouring samples, as 8 16-bit values. */
+
+JSIMD_INLINE LOCAL(__m128i)
+pair_sums_sse2 (__m128i v)
+{
+  return _mm_add_epi16(_mm_and_si128(v, _mm_set1_epi16(0xFF)), _mm_srli_epi16(v, 8));
+}
+
+
+LOCAL(JDIMENSION)
+h2v1_down_sse2 (JSAMPROW inptr, JSAMPROW outptr, JDIMENSION output_cols)
+{
+  /* bias = 0,1,0,1,... as in jcsample.c */
+  const __m128i bias = _mm_set1_epi32(0x00010000);
+  JDIMENSION outcol;
+
+  for (outcol = 0; outcol + 16 <= output_cols; outcol += 16) {
+    const __m128i a = _mm_loadu_si128((const __m128i *) (inptr + 2*outcol));
+    const __m128i b = _mm_loadu_si128((const __m128i *) (inptr + 2*outcol + 16));
+
+    _mm_storeu_si128((__m128i *) (outptr + outcol),
+		     _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(pair_sums_sse2(a), bias), 1),
+				      _mm_srli_epi16(_mm_add_epi16(pair_sums_sse2(b), bias), 1)));
+  }
+  return outcol;
+}
+
+
+LOCAL(JDIMENSION)
+h2v2_down_sse2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW outptr,
+		JDIMENSION output_cols)
+{
+  /* bias = 1,2,1,2,... as in jcsample.c */
+  const __m128i bias = _mm_set1_epi32(0x00020001);
+  JDIMENSION outcol;
+
+  for (outcol = 0; outcol + 16 <= output_cols; outcol += 16) {
+    const __m128i a0 = _mm_loadu_si128((const __m128i *) (inptr0 + 2*outcol));
+    const __m128i b0 = _mm_loadu_si128((const __m128i *) (inptr0 + 2*outcol + 16));
+    const __m128i a1 = _mm_loadu_si128((const __m128i *) (inptr1 + 2*outcol));
+    const __m128i b1 = _mm_loadu_si128((const __m128i *) (inptr1 + 2*outcol + 16));
+    const __m128i a = _mm_add_epi16(_mm_add_epi16(pair_sums_sse2(a0), pair_sums_sse2(a1)), bias);
+    const __m128i b = _mm_add_epi16(_mm_add_epi16(pair_sums_sse2(b0), pair_sums_sse2(b1)), bias);
+
+    _mm_storeu_si128((__m128i *) (outptr + outcol),
+		     _mm_packus_epi16(_mm_srli_epi16(a, 2), _mm_srli_epi16(b, 2)));
+  }
+  return outcol;
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+pair_sums_avx2 (__m256i v)
+{
+  return _mm256_add_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0xFF)), _mm256_srli_epi16(v, 8));
+}
+
+
+/* packus works within 128-bit lanes, so its output has the middle two
+ * 64-bit quarters swapped.
+ */
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+pack_in_order_avx2 (__m256i a, __m256i b)
+{
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(JDIMENSION)
+h2v1_down_avx2 (JSAMPROW inptr, JSAMPROW outptr, JDIMENSION output_cols)
+{
+  const __m256i bias = _mm256_set1_epi32(0x00010000);
+  JDIMENSION outcol;
+
+  for (outcol = 0; outcol + 32 <= output_cols; outcol += 32) {
+    const __m256i a = _mm256_loadu_si256((const __m256i *) (inptr + 2*outcol));
+    const __m256i b = _mm256_loadu_si256((const __m256i *) (inptr + 2*outcol + 32));
+
+    _mm256_storeu_si256((__m256i *) (outptr + outcol),
+			pack_in_order_avx2(_mm256_srli_epi16(_mm256_add_epi16(pair_sums_avx2(a), bias), 1),
+					   _mm256_srli_epi16(_mm256_add_epi16(pair_sums_avx2(b), bias), 1)));
+  }
+  return outcol;
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(JDIMENSION)
+h2v2_down_avx2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW outptr,
+		JDIMENSION output_cols)
+{
+  const __m256i bias = _mm256_set1_epi32(0x00020001);
+  JDIMENSION outcol;
+
+  for (outcol = 0; outcol + 32 <= output_cols; outcol += 32) {
+    const __m256i a0 = _mm256_loadu_si256((const __m256i *) (inptr0 + 2*outcol));
+    const __m256i b0 = _mm256_loadu_si256((const __m256i *) (inptr0 + 2*outcol + 32));
+    const __m256i a1 = _mm256_loadu_si256((const __m256i *) (inptr1 + 2*outcol));
+    const __m256i b1 = _mm256_loadu_si256((const __m256i *) (inptr1 + 2*outcol + 32));
+    const __m256i a = _mm256_add_epi16(_mm256_add_epi16(pair_sums_avx2(a0), pair_sums_avx2(a1)), bias);
+    const __m256i b = _mm256_add_epi16(_mm256_add_epi16(pair_sums_avx2(b0), pair_sums_avx2(b1)), bias);
+
+    _mm256_storeu_si256((__m256i *) (outptr + outcol),
+			pack_in_order_avx2(_mm256_srli_epi16(a, 2), _mm256_srli_epi16(b, 2)));
+  }
+  return outcol;
+}
+
+#endif /* JSIMD_X86 */
+
+
+#ifdef JSIMD_ARM_NEON
+
+LOCAL(JDIMENSION)
+h2v1_down_neon (JSAMPROW inptr, JSAMPROW outptr, JDIMENSION output_cols)
+{
+  const uint16x8_t bias = vreinterpretq_u16_u32(vdupq_n_u32(0x00010000));
+  JDIMENSION outcol;
+
+  for (outcol = 0; outcol + 8 <= output_cols; outcol += 8) {
+    const uint16x8_t sum = vpaddlq_u8(vld1q_u8(inptr + 2*outcol));
+
+    vst1_u8(outptr + outcol, vshrn_n_u16(vaddq_u16(sum, bias), 1));
+  }
+  return outcol;
+}
+
+
+LOCAL(JDIMENSION)
+h2v2_down_neon (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW outptr,
+		JDIMENSION output_cols)
+{
+  const uint16x8_t bias = vreinterpretq_u16_u32(vdupq_n_u32(0x00020001));
+  JDIMENSION outcol;
+
+  for (outcol = 0; outcol + 8 <= output_cols; outcol += 8) {
+    const uint16x8_t sum = vpadalq_u8(vpaddlq_u8(vld1q_u8(inptr0 + 2*outcol)),
+				      vld1q_u8(inptr1 + 2*outcol));
+
+    vst1_u8(outptr + outcol, vshrn_n_u16(vaddq_u16(sum, bias), 2));
+  }
+  return outcol;
+}
+
+#endif /* JSIMD_ARM_NEON */
+
+#endif /* JSIMD_COMPRESS_SUPPORTED */
+
+
+/* The same as jcsample.c's. */
+
+LOCAL(void)
+expand_right_edge (JSAMPARRAY image_data, int num_rows,
+		   JDIMENSION input_cols, JDIMENSION output_cols)
+{
+  JSAMPROW ptr;
+  JSAMPLE pixval;
+  int count;
+  int row;
+  int numcols = (int) (output_cols - input_cols);
+
+  if (numcols > 0) {
+    for (row = 0; row < num_rows; row++) {
+      ptr = image_data[row] + input_cols;
+      pixval = ptr[-1];		/* don't need GETJSAMPLE() here */
+      for (count = numcols; count > 0; count--)
+	*ptr++ = pixval;
+    }
+  }
+}
+
+
+GLOBAL(int)
+jsimd_can_h2v1_downsample (void)
+{
+#ifdef JSIMD_COMPRESS_SUPPORTED
+  return (jsimd_support() != 0);
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(void)
+jsimd_h2v1_downsample (j_compress_ptr cinfo, jpeg_component_info * compptr,
+		       JSAMPARRAY input_data, JSAMPARRAY output_data)
+{
+  int outrow;
+  JDIMENSION outcol;
+  JDIMENSION output_cols = compptr->width_in_blocks * DCTSIZE;
+  JSAMPROW inptr, outptr;
+  int bias;
+
+  expand_right_edge(input_data, cinfo->max_v_samp_factor,
+		    cinfo->image_width, output_cols * 2);
+
+  for (outrow = 0; outrow < compptr->v_samp_factor; outrow++) {
+    outptr = output_data[outrow];
+    inptr = input_data[outrow];
+    outcol = 0;
+#ifdef JSIMD_COMPRESS_SUPPORTED
+#ifdef JSIMD_X86
+    if (jsimd_support() & JSIMD_AVX2)
+      outcol = h2v1_down_avx2(inptr, outptr, output_cols);
+    else
+      outcol = h2v1_down_sse2(inptr, outptr, output_cols);
+#endif
+#ifdef JSIMD_ARM_NEON
+    outcol = h2v1_down_neon(inptr, outptr, output_cols);
+#endif
+#endif
+    bias = 0;			/* bias = 0,1,0,1,... for successive samples */
+    for (; outcol < output_cols; outcol++) {
+      outptr[outcol] = (JSAMPLE) ((GETJSAMPLE(inptr[2*outcol]) +
+				   GETJSAMPLE(inptr[2*outcol+1]) + bias) >> 1);
+      bias ^= 1;		/* 0=>1, 1=>0 */
+    }
+  }
+}
+
+
+GLOBAL(int)
+jsimd_can_h2v2_downsample (void)
+{
+#ifdef JSIMD_COMPRESS_SUPPORTED
+  return (jsimd_support() != 0);
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(void)
+jsimd_h2v2_downsample (j_compress_ptr cinfo, jpeg_component_info * compptr,
+		       JSAMPARRAY input_data, JSAMPARRAY output_data)
+{
+  int inrow, outrow;
+  JDIMENSION outcol;
+  JDIMENSION output_cols = compptr->width_in_blocks * DCTSIZE;
+  JSAMPROW inptr0, inptr1, outptr;
+  int bias;
+
+  expand_right_edge(input_data, cinfo->max_v_samp_factor,
+		    cinfo->image_width, output_cols * 2);
+
+  inrow = 0;
+  for (outrow = 0; outrow < compptr->v_samp_factor; outrow++) {
+    outptr = output_data[outrow];
+    inptr0 = input_data[inrow];
+    inptr1 = input_data[inrow+1];
+    outcol = 0;
+#ifdef JSIMD_COMPRESS_SUPPORTED
+#ifdef JSIMD_X86
+    if (jsimd_support() & JSIMD_AVX2)
+      outcol = h2v2_down_avx2(inptr0, inptr1, outptr, output_cols);
+    else
+      outcol = h2v2_down_sse2(inptr0, inptr1, outptr, output_cols);
+#endif
+#ifdef JSIMD_ARM_NEON
+    outcol = h2v2_down_neon(inptr0, inptr1, outptr, output_cols);
+#endif
+#endif
+    bias = 1;			/* bias = 1,2,1,2,... for successive samples */
+    for (; outcol < output_cols; outcol++) {
+      outptr[outcol] = (JSAMPLE) ((GETJSAMPLE(inptr0[2*outcol]) +
+				   GETJSAMPLE(inptr0[2*outcol+1]) +
+				   GETJSAMPLE(inptr1[2*outcol]) +
+				   GETJSAMPLE(inptr1[2*outcol+1]) + bias) >> 2);
+      bias ^= 3;		/* 1=>2, 2=>1 */
+    }
+    inrow += 2;
+  }
+}
+
+
+/**************** Forward DCT and quantization ****************/
+
+
+/* The SIMD FDCT follows jpeg_fdct_islow step for step, with the LL&M
+ * multiplies folded into one constant per input of each output as in
+ * jdsimd.c's IDCT, so every output of a 1-D pass is one or two pmaddwd on
+ * pairs of 16-bit values.  Outputs 0 and 4 are done the same way, scaled
+ * up by CONST_BITS, so that all eight are descaled alike; the extra bits
+ * only ever shift out, so the results are the same.
+ *
+ * Nothing overflows: the samples are within +-128, so no pass 1 output is
+ * more than 4096 in magnitude and no tmp value of pass 2 more than 32768.
+ */
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+/* Outputs 0 and 4 from tmp10 and tmp11, and 2 and 6 from tmp13 and tmp12. */
+#define E_0    (1 << CONST_BITS)
+#define E2_13  (4433 + 6270)	/* FIX_0_541196100 + FIX_0_765366865 */
+#define E2_12  4433
+#define E6_13  4433
+#define E6_12  (4433 - 15137)	/* FIX_0_541196100 - FIX_1_847759065 */
+
+/* The constant of each of tmp4, tmp7, tmp6 and tmp5 in outputs 7, 1, 5 and
+ * 3, with z1..z5 multiplied out.
+ */
+#define O7_4   (2446 - 7373 - 16069 + 9633)
+#define O7_7   (-7373 + 9633)
+#define O7_6   (-16069 + 9633)
+#define O7_5   9633
+#define O1_4   (-7373 + 9633)
+#define O1_7   (12299 - 7373 - 3196 + 9633)
+#define O1_6   9633
+#define O1_5   (-3196 + 9633)
+#define O5_4   9633
+#define O5_7   (-3196 + 9633)
+#define O5_6   (-20995 + 9633)
+#define O5_5   (16819 - 20995 - 3196 + 9633)
+#define O3_4   (-16069 + 9633)
+#define O3_7   9633
+#define O3_6   (25172 - 20995 - 16069 + 9633)
+#define O3_5   (-20995 + 9633)
+
+/* The quantizers the reciprocals are used for: every baseline table. */
+#define MAX_QUANT  255
+
+
+GLOBAL(int)
+jsimd_can_fdct_islow (void)
+{
+#ifdef JSIMD_COMPRESS_SUPPORTED
+  if (sizeof(JCOEF) == 2)
+    return (jsimd_support() != 0);
+#endif
+  return FALSE;
+}
+
+
+/* x / d rounded as jcdctmgr.c does it, (x + d/2) / d, becomes
+ * ((x + corr) * recip >> 16) * scale >> 16 with r = 16 + floor(log2(d)),
+ * recip = 2^r / d and scale = 2^(32-r), with recip rounded up if that is
+ * nearer, or corr one more than d/2 to make up for rounding it down.
+ * This has been checked to be exact for every x up to 65535 - corr and
+ * every d up to 8 * 8191.
+ */
+
+GLOBAL(void)
+jsimd_set_fdct_islow_table (jsimd_fdct_table * table, const JQUANT_TBL * qtbl)
+{
+  unsigned long d, recip, rem, corr;
+  int i, r;
+
+  table->usable = TRUE;
+  for (i = 0; i < DCTSIZE2; i++) {
+    if (qtbl->quantval[i] == 0 || qtbl->quantval[i] > MAX_QUANT) {
+      table->usable = FALSE;
+      return;
+    }
+    d = (unsigned long) qtbl->quantval[i] << 3;
+    for (r = 16; (d >> (r - 15)) != 0; r++)
+      ;
+    recip = (1UL << r) / d;
+    rem = (1UL << r) % d;
+    corr = d >> 1;
+    if (rem == 0) {		/* d is a power of 2 */
+      recip >>= 1;
+      r--;
+    } else if (rem <= (d >> 1))
+      corr++;
+    else
+      recip++;
+    table->recip[i] = (unsigned short) recip;
+    table->corr[i] = (unsigned short) corr;
+    table->scale[i] = (unsigned short) (1UL << (32 - r));
+  }
+}
+
+
+#ifdef JSIMD_COMPRESS_SUPPORTED
+
+#ifdef JSIMD_X86
+
+/* transpose_8x8_sse2 and transpose_8x8_neon are the same as jdsimd.c's. */
+
+JSIMD_INLINE LOCAL(void)
+transpose_8x8_sse2 (__m128i r[8])
+{
+  __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+  __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+  __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+  __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+  __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+  __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+  __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+  __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+  __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+  __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+  __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+  __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+  __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+  __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+  __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+  __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+  r[0] = _mm_unpacklo_epi64(b0, b4);
+  r[1] = _mm_unpackhi_epi64(b0, b4);
+  r[2] = _mm_unpacklo_epi64(b1, b5);
+  r[3] = _mm_unpackhi_epi64(b1, b5);
+  r[4] = _mm_unpacklo_epi64(b2, b6);
+  r[5] = _mm_unpackhi_epi64(b2, b6);
+  r[6] = _mm_unpacklo_epi64(b3, b7);
+  r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+
+/* Loads a block with the unsigned->signed conversion, transposed, so that
+ * x[k] holds element k of each of the 8 rows.
+ */
+
+JSIMD_INLINE LOCAL(void)
+fdct_load_sse2 (JSAMPARRAY sample_data, JDIMENSION start_col, __m128i x[8])
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++)
+    x[i] = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)
+							    (sample_data[i] + start_col)),
+					   zero), center);
+  transpose_8x8_sse2(x);
+}
+
+
+/* The butterflies, leaving the pairs the multiplies take. */
+
+JSIMD_INLINE LOCAL(void)
+fdct_pairs_sse2 (const __m128i x[8], __m128i p[8])
+{
+  const __m128i tmp0 = _mm_add_epi16(x[0], x[7]);
+  const __m128i tmp7 = _mm_sub_epi16(x[0], x[7]);
+  const __m128i tmp1 = _mm_add_epi16(x[1], x[6]);
+  const __m128i tmp6 = _mm_sub_epi16(x[1], x[6]);
+  const __m128i tmp2 = _mm_add_epi16(x[2], x[5]);
+  const __m128i tmp5 = _mm_sub_epi16(x[2], x[5]);
+  const __m128i tmp3 = _mm_add_epi16(x[3], x[4]);
+  const __m128i tmp4 = _mm_sub_epi16(x[3], x[4]);
+  const __m128i tmp10 = _mm_add_epi16(tmp0, tmp3);
+  const __m128i tmp13 = _mm_sub_epi16(tmp0, tmp3);
+  const __m128i tmp11 = _mm_add_epi16(tmp1, tmp2);
+  const __m128i tmp12 = _mm_sub_epi16(tmp1, tmp2);
+
+  p[0] = _mm_unpacklo_epi16(tmp10, tmp11);
+  p[1] = _mm_unpackhi_epi16(tmp10, tmp11);
+  p[2] = _mm_unpacklo_epi16(tmp13, tmp12);
+  p[3] = _mm_unpackhi_epi16(tmp13, tmp12);
+  p[4] = _mm_unpacklo_epi16(tmp4, tmp7);
+  p[5] = _mm_unpackhi_epi16(tmp4, tmp7);
+  p[6] = _mm_unpacklo_epi16(tmp6, tmp5);
+  p[7] = _mm_unpackhi_epi16(tmp6, tmp5);
+}
+
+
+/* One 1-D pass on 8 columns, with its outputs descaled by n bits. */
+
+JSIMD_INLINE LOCAL(void)
+fdct_1d_sse2 (__m128i x[8], int n)
+{
+  const __m128i round = _mm_set1_epi32(1 << (n-1));
+  const int c[8][2] = {
+    { PAIR16(E_0, E_0), 0 },
+    { PAIR16(O1_4, O1_7), PAIR16(O1_6, O1_5) },
+    { PAIR16(E2_13, E2_12), 0 },
+    { PAIR16(O3_4, O3_7), PAIR16(O3_6, O3_5) },
+    { PAIR16(E_0, -E_0), 0 },
+    { PAIR16(O5_4, O5_7), PAIR16(O5_6, O5_5) },
+    { PAIR16(E6_13, E6_12), 0 },
+    { PAIR16(O7_4, O7_7), PAIR16(O7_6, O7_5) }
+  };
+  __m128i p[8], lo, hi;
+  int k;
+
+  fdct_pairs_sse2(x, p);
+  for (k = 0; k < DCTSIZE; k++) {
+    if (k & 1) {
+      lo = _mm_add_epi32(_mm_madd_epi16(p[4], _mm_set1_epi32(c[k][0])),
+			 _mm_madd_epi16(p[6], _mm_set1_epi32(c[k][1])));
+      hi = _mm_add_epi32(_mm_madd_epi16(p[5], _mm_set1_epi32(c[k][0])),
+			 _mm_madd_epi16(p[7], _mm_set1_epi32(c[k][1])));
+    } else {
+      const int e = (k & 2) ? 2 : 0;
+      lo = _mm_madd_epi16(p[e], _mm_set1_epi32(c[k][0]));
+      hi = _mm_madd_epi16(p[e+1], _mm_set1_epi32(c[k][0]));
+    }
+    x[k] = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, round), n),
+			   _mm_srai_epi32(_mm_add_epi32(hi, round), n));
+  }
+}
+
+
+/* Divides row by row as jcdctmgr.c does, and stores the coefficients. */
+
+JSIMD_INLINE LOCAL(void)
+quantize_sse2 (const jsimd_fdct_table * table, const __m128i x[8],
+	       JCOEFPTR output_ptr)
+{
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++) {
+    const __m128i sign = _mm_srai_epi16(x[i], 15);
+    __m128i v = _mm_sub_epi16(_mm_xor_si128(x[i], sign), sign);
+
+    v = _mm_add_epi16(v, _mm_loadu_si128((const __m128i *) (table->corr + DCTSIZE*i)));
+    v = _mm_mulhi_epu16(v, _mm_loadu_si128((const __m128i *) (table->recip + DCTSIZE*i)));
+    v = _mm_mulhi_epu16(v, _mm_loadu_si128((const __m128i *) (table->scale + DCTSIZE*i)));
+    _mm_storeu_si128((__m128i *) (output_ptr + DCTSIZE*i),
+		     _mm_sub_epi16(_mm_xor_si128(v, sign), sign));
+  }
+}
+
+
+LOCAL(void)
+fdct_islow_sse2 (const jsimd_fdct_table * table, JSAMPARRAY sample_data,
+		 JDIMENSION start_col, JCOEFPTR output_ptr)
+{
+  __m128i x[8];
+
+  /* Pass 1 does the rows of the block in the lanes, and leaves x[k] with
+   * output k of each row; pass 2 does the columns of that.
+   */
+  fdct_load_sse2(sample_data, start_col, x);
+  fdct_1d_sse2(x, CONST_BITS-PASS1_BITS);
+  transpose_8x8_sse2(x);
+  fdct_1d_sse2(x, CONST_BITS+PASS1_BITS);
+  quantize_sse2(table, x, output_ptr);
+}
+
+
+/* The AVX2 version does the 32-bit arithmetic of all eight columns in one
+ * register.
+ */
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+interleave_avx2 (__m128i lo, __m128i hi)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(void)
+fdct_1d_avx2 (__m128i x[8], int n)
+{
+  const __m256i round = _mm256_set1_epi32(1 << (n-1));
+  __m128i p[8];
+  __m256i p1011, p1312, p47, p65, y[8];
+  int k;
+
+  fdct_pairs_sse2(x, p);
+  p1011 = interleave_avx2(p[0], p[1]);
+  p1312 = interleave_avx2(p[2], p[3]);
+  p47 = interleave_avx2(p[4], p[5]);
+  p65 = interleave_avx2(p[6], p[7]);
+  y[0] = _mm256_madd_epi16(p1011, _mm256_set1_epi32(PAIR16(E_0, E_0)));
+  y[4] = _mm256_madd_epi16(p1011, _mm256_set1_epi32(PAIR16(E_0, -E_0)));
+  y[2] = _mm256_madd_epi16(p1312, _mm256_set1_epi32(PAIR16(E2_13, E2_12)));
+  y[6] = _mm256_madd_epi16(p1312, _mm256_set1_epi32(PAIR16(E6_13, E6_12)));
+  y[1] = _mm256_add_epi32(_mm256_madd_epi16(p47, _mm256_set1_epi32(PAIR16(O1_4, O1_7))),
+			  _mm256_madd_epi16(p65, _mm256_set1_epi32(PAIR16(O1_6, O1_5))));
+  y[3] = _mm256_add_epi32(_mm256_madd_epi16(p47, _mm256_set1_epi32(PAIR16(O3_4, O3_7))),
+			  _mm256_madd_epi16(p65, _mm256_set1_epi32(PAIR16(O3_6, O3_5))));
+  y[5] = _mm256_add_epi32(_mm256_madd_epi16(p47, _mm256_set1_epi32(PAIR16(O5_4, O5_7))),
+			  _mm256_madd_epi16(p65, _mm256_set1_epi32(PAIR16(O5_6, O5_5))));
+  y[7] = _mm256_add_epi32(_mm256_madd_epi16(p47, _mm256_set1_epi32(PAIR16(O7_4, O7_7))),
+			  _mm256_madd_epi16(p65, _mm256_set1_epi32(PAIR16(O7_6, O7_5))));
+  for (k = 0; k < DCTSIZE; k++) {
+    const __m256i v = _mm256_srai_epi32(_mm256_add_epi32(y[k], round), n);
+    x[k] = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  }
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(void)
+fdct_islow_avx2 (const jsimd_fdct_table * table, JSAMPARRAY sample_data,
+		 JDIMENSION start_col, JCOEFPTR output_ptr)
+{
+  __m128i x[8];
+
+  fdct_load_sse2(sample_data, start_col, x);
+  fdct_1d_avx2(x, CONST_BITS-PASS1_BITS);
+  transpose_8x8_sse2(x);
+  fdct_1d_avx2(x, CONST_BITS+PASS1_BITS);
+  quantize_sse2(table, x, output_ptr);
+}
+
+#endif /* JSIMD_X86 */
+
+
+#ifdef JSIMD_ARM_NEON
+
+JSIMD_INLINE LOCAL(void)
+transpose_8x8_neon (int16x8_t r[8])
+{
+  const int16x8x2_t t01 = vtrnq_s16(r[0], r[1]);
+  const int16x8x2_t t23 = vtrnq_s16(r[2], r[3]);
+  const int16x8x2_t t45 = vtrnq_s16(r[4], r[5]);
+  const int16x8x2_t t67 = vtrnq_s16(r[6], r[7]);
+  const int32x4x2_t u02 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]), vreinterpretq_s32_s16(t23.val[0]));
+  const int32x4x2_t u13 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]), vreinterpretq_s32_s16(t23.val[1]));
+  const int32x4x2_t v02 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]), vreinterpretq_s32_s16(t67.val[0]));
+  const int32x4x2_t v13 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]), vreinterpretq_s32_s16(t67.val[1]));
+
+  r[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u02.val[0]), vget_low_s32(v02.val[0])));
+  r[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u02.val[0]), vget_high_s32(v02.val[0])));
+  r[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u02.val[1]), vget_low_s32(v02.val[1])));
+  r[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u02.val[1]), vget_high_s32(v02.val[1])));
+  r[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u13.val[0]), vget_low_s32(v13.val[0])));
+  r[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u13.val[0]), vget_high_s32(v13.val[0])));
+  r[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u13.val[1]), vget_low_s32(v13.val[1])));
+  r[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u13.val[1]), vget_high_s32(v13.val[1])));
+}
+
+
+/* One 1-D pass on 4 columns, giving the 32-bit sums of outputs 0..7. */
+
+JSIMD_INLINE LOCAL(void)
+fdct_1d_neon (const int16x4_t x[8], int32x4_t y[8])
+{
+  const int16x4_t tmp0 = vadd_s16(x[0], x[7]);
+  const int16x4_t tmp7 = vsub_s16(x[0], x[7]);
+  const int16x4_t tmp1 = vadd_s16(x[1], x[6]);
+  const int16x4_t tmp6 = vsub_s16(x[1], x[6]);
+  const int16x4_t tmp2 = vadd_s16(x[2], x[5]);
+  const int16x4_t tmp5 = vsub_s16(x[2], x[5]);
+  const int16x4_t tmp3 = vadd_s16(x[3], x[4]);
+  const int16x4_t tmp4 = vsub_s16(x[3], x[4]);
+  const int16x4_t tmp10 = vadd_s16(tmp0, tmp3);
+  const int16x4_t tmp13 = vsub_s16(tmp0, tmp3);
+  const int16x4_t tmp11 = vadd_s16(tmp1, tmp2);
+  const int16x4_t tmp12 = vsub_s16(tmp1, tmp2);
+
+  y[0] = vshlq_n_s32(vaddl_s16(tmp10, tmp11), CONST_BITS);
+  y[4] = vshlq_n_s32(vsubl_s16(tmp10, tmp11), CONST_BITS);
+  y[2] = vmlal_n_s16(vmull_n_s16(tmp13, E2_13), tmp12, E2_12);
+  y[6] = vmlal_n_s16(vmull_n_s16(tmp13, E6_13), tmp12, E6_12);
+  y[7] = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(tmp4, O7_4),
+			tmp7, O7_7), tmp6, O7_6), tmp5, O7_5);
+  y[1] = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(tmp4, O1_4),
+			tmp7, O1_7), tmp6, O1_6), tmp5, O1_5);
+  y[5] = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(tmp4, O5_4),
+			tmp7, O5_7), tmp6, O5_6), tmp5, O5_5);
+  y[3] = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(tmp4, O3_4),
+			tmp7, O3_7), tmp6, O3_6), tmp5, O3_5);
+}
+
+
+JSIMD_INLINE LOCAL(void)
+fdct_1d_neon_8 (int16x8_t x[8], int pass)
+{
+  int16x4_t half[8];
+  int32x4_t lo[8], hi[8];
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++)
+    half[i] = vget_low_s16(x[i]);
+  fdct_1d_neon(half, lo);
+  for (i = 0; i < DCTSIZE; i++)
+    half[i] = vget_high_s16(x[i]);
+  fdct_1d_neon(half, hi);
+  for (i = 0; i < DCTSIZE; i++) {
+    if (pass == 1)
+      x[i] = vcombine_s16(vrshrn_n_s32(lo[i], CONST_BITS-PASS1_BITS),
+			  vrshrn_n_s32(hi[i], CONST_BITS-PASS1_BITS));
+    else
+      x[i] = vcombine_s16(vrshrn_n_s32(lo[i], CONST_BITS+PASS1_BITS),
+			  vrshrn_n_s32(hi[i], CONST_BITS+PASS1_BITS));
+  }
+}
+
+
+JSIMD_INLINE LOCAL(uint16x4_t)
+mulhi_u16_neon (uint16x4_t a, uint16x4_t b)
+{
+  return vshrn_n_u32(vmull_u16(a, b), 16);
+}
+
+
+LOCAL(void)
+fdct_islow_neon (const jsimd_fdct_table * table, JSAMPARRAY sample_data,
+		 JDIMENSION start_col, JCOEFPTR output_ptr)
+{
+  const uint8x8_t center = vdup_n_u8(CENTERJSAMPLE);
+  int16x8_t x[8];
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++)
+    x[i] = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(sample_data[i] + start_col), center));
+  transpose_8x8_neon(x);
+  fdct_1d_neon_8(x, 1);
+  transpose_8x8_neon(x);
+  fdct_1d_neon_8(x, 2);
+
+  for (i = 0; i < DCTSIZE; i++) {
+    const int16x8_t sign = vshrq_n_s16(x[i], 15);
+    const uint16x8_t v = vaddq_u16(vreinterpretq_u16_s16(vabsq_s16(x[i])),
+				   vld1q_u16(table->corr + DCTSIZE*i));
+    const uint16x8_t recip = vld1q_u16(table->recip + DCTSIZE*i);
+    const uint16x8_t scale = vld1q_u16(table->scale + DCTSIZE*i);
+    const uint16x4_t lo = mulhi_u16_neon(mulhi_u16_neon(vget_low_u16(v), vget_low_u16(recip)),
+					 vget_low_u16(scale));
+    const uint16x4_t hi = mulhi_u16_neon(mulhi_u16_neon(vget_high_u16(v), vget_high_u16(recip)),
+					 vget_high_u16(scale));
+    const int16x8_t q = vreinterpretq_s16_u16(vcombine_u16(lo, hi));
+
+    vst1q_s16(output_ptr + DCTSIZE*i, vsubq_s16(veorq_s16(q, sign), sign));
+  }
+}
+
+#endif /* JSIMD_ARM_NEON */
+
+#endif /* JSIMD_COMPRESS_SUPPORTED */
+
+
+GLOBAL(void)
+jsimd_fdct_islow (const jsimd_fdct_table * table, JSAMPARRAY sample_data,
+		  JBLOCKROW coef_blocks, JDIMENSION start_col,
+		  JDIMENSION num_blocks)
+{
+#ifdef JSIMD_COMPRESS_SUPPORTED
+  JDIMENSION bi;
+
+  for (bi = 0; bi < num_blocks; bi++, start_col += DCTSIZE) {
+#ifdef JSIMD_X86
+    if (jsimd_support() & JSIMD_AVX2)
+      fdct_islow_avx2(table, sample_data, start_col, coef_blocks[bi]);
+    else
+      fdct_islow_sse2(table, sample_data, start_col, coef_blocks[bi]);
+#endif
+#ifdef JSIMD_ARM_NEON
+    fdct_islow_neon(table, sample_data, start_col, coef_blocks[bi]);
+#endif
+  }
+#endif /* JSIMD_COMPRESS_SUPPORTED */
+}
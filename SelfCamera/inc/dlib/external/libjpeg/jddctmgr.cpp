@@ -19,6 +19,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
 
 
 /*
@@ -58,6 +59,7 @@ typedef my_idct_controller * my_idct_ptr;
 
 typedef union {
   ISLOW_MULT_TYPE islow_array[DCTSIZE2];
+  jsimd_islow_table jsimd_islow;	/* starts with islow_array */
 #ifdef DCT_IFAST_SUPPORTED
   IFAST_MULT_TYPE ifast_array[DCTSIZE2];
 #endif
@@ -117,7 +119,7 @@ start_pass (j_decompress_ptr cinfo)
       switch (cinfo->dct_method) {
 #ifdef DCT_ISLOW_SUPPORTED
       case JDCT_ISLOW:
-	method_ptr = jpeg_idct_islow;
+	method_ptr = jsimd_can_idct_islow() ? jsimd_idct_islow : jpeg_idct_islow;
 	method = JDCT_ISLOW;
 	break;
 #endif
@@ -167,6 +169,7 @@ start_pass (j_decompress_ptr cinfo)
 	for (i = 0; i < DCTSIZE2; i++) {
 	  ismtbl[i] = (ISLOW_MULT_TYPE) qtbl->quantval[i];
 	}
+	jsimd_set_idct_islow_table((jsimd_islow_table *) compptr->dct_table);
       }
       break;
 #endif
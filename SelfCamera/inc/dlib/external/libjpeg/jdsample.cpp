@@ -21,6 +21,7 @@
 #define JPEG_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"
 
 
 /* Pointer to routine to upsample a single component */
@@ -448,14 +449,16 @@ jinit_upsampler (j_decompress_ptr cinfo)
 	       v_in_group == v_out_group) {
       /* Special cases for 2h1v upsampling */
       if (do_fancy && compptr->downsampled_width > 2)
-	upsample->methods[ci] = h2v1_fancy_upsample;
+	upsample->methods[ci] = jsimd_can_h2v1_fancy_upsample() ?
+	  jsimd_h2v1_fancy_upsample : h2v1_fancy_upsample;
       else
 	upsample->methods[ci] = h2v1_upsample;
     } else if (h_in_group * 2 == h_out_group &&
 	       v_in_group * 2 == v_out_group) {
       /* Special cases for 2h2v upsampling */
       if (do_fancy && compptr->downsampled_width > 2) {
-	upsample->methods[ci] = h2v2_fancy_upsample;
+	upsample->methods[ci] = jsimd_can_h2v2_fancy_upsample() ?
+	  jsimd_h2v2_fancy_upsample : h2v2_fancy_upsample;
 	upsample->pub.need_context_rows = TRUE;
       } else
 	upsample->methods[ci] = h2v2_upsample;
@@ -0,0 +1,1243 @@
+/*
+ * jdsimd.c
+ *
+ * This file is not part of the Independent JPEG Group's release; it was
+ * added to this copy of the library.
+ *
+ * This file contains SSE2, AVX2 and NEON versions of the decompressor's
+ * accurate integer inverse DCT (jidctint.c), its h2v1 and h2v2 fancy
+ * upsampling (jdsample.c) and its YCbCr->RGB conversion (jdcolor.c).  They
+ * give exactly the same output as the C code.  See jsimd.h.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"
+#include "jsimd.h"
+
+#ifdef JSIMD_X86
+#include <immintrin.h>
+#define JSIMD_TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+#ifdef JSIMD_ARM_NEON
+#include <arm_neon.h>
+#endif
+
+/* The small helpers are always inlined: the AVX2 routines share the SSE2
+ * ones, which only get the AVX2 encoding when they are inlined into them.
+ */
+#ifdef __GNUC__
+#define JSIMD_INLINE  __attribute__((always_inline)) inline
+#else
+#define JSIMD_INLINE  inline
+#endif
+
+
+/* Everything here needs one of the instruction sets, and assumes 8-bit
+ * samples, 16-bit coefficients and the library's usual RGB pixel layout.
+ */
+
+#if (defined(JSIMD_X86) || defined(JSIMD_ARM_NEON)) && \
+    BITS_IN_JSAMPLE == 8 && DCTSIZE == 8 && \
+    RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+#define JSIMD_DECOMPRESS_SUPPORTED
+#endif
+
+
+/**************** Inverse DCT ****************/
+
+
+/* The SIMD IDCT follows jpeg_idct_islow step for step, except that it folds
+ * the LL&M multiplies into one constant per input of each output, so that
+ * every 1-D output is two pmaddwd (or four multiply-adds on NEON) on pairs
+ * of 16-bit inputs.  All of this is exact integer arithmetic, so as long as
+ * nothing overflows the results are the same bits as the C code's.
+ *
+ * The inputs to each pass have to fit in 16 bits for that.  A dequantized
+ * coefficient of at most LIMIT in magnitude keeps the output of the first
+ * pass within 16 bits, since no output of a 1-D pass sums its inputs times
+ * more than 61214/2048 in magnitude, and then none of the 32-bit sums of
+ * either pass can overflow.  That covers the coefficients of any ordinary
+ * picture; a block with a larger one is left to jpeg_idct_islow.
+ */
+
+#define LIMIT  1096
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+/* Even part: the constants of z2/z3 (inputs 2 and 6) in tmp3 and tmp2 of
+ * jpeg_idct_islow, and those of inputs 0 and 4 in tmp0 and tmp1.
+ */
+#define E3_2   (4433 + 6270)	/* FIX_0_541196100 + FIX_0_765366865 */
+#define E3_6   4433
+#define E2_2   4433
+#define E2_6   (4433 - 15137)	/* FIX_0_541196100 - FIX_1_847759065 */
+#define E_0    (1 << CONST_BITS)
+
+/* Odd part: the constant of each of inputs 7, 1, 3 and 5 in tmp0..tmp3,
+ * with z1..z5 multiplied out.
+ */
+#define O0_7   (2446 - 7373 + 9633 - 16069)
+#define O0_1   (9633 - 7373)
+#define O0_3   (9633 - 16069)
+#define O0_5   9633
+#define O1_7   9633
+#define O1_1   (9633 - 3196)
+#define O1_3   (9633 - 20995)
+#define O1_5   (16819 - 20995 + 9633 - 3196)
+#define O2_7   (9633 - 16069)
+#define O2_1   9633
+#define O2_3   (25172 - 20995 + 9633 - 16069)
+#define O2_5   (9633 - 20995)
+#define O3_7   (9633 - 7373)
+#define O3_1   (12299 - 7373 + 9633 - 3196)
+#define O3_3   9633
+#define O3_5   (9633 - 3196)
+
+/* The post-IDCT range limiting, as sample_range_limit + CENTERJSAMPLE does
+ * it with RANGE_MASK: x is taken modulo 1024 after adding CENTERJSAMPLE,
+ * and then values up to 255 are kept, values up to 639 become 255 and the
+ * rest become 0.
+ */
+#define WRAP_LAST  639
+
+
+GLOBAL(int)
+jsimd_can_idct_islow (void)
+{
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+  if (sizeof(JCOEF) == 2 && RANGE_MASK == 1023)
+    return (jsimd_support() != 0);
+#endif
+  return FALSE;
+}
+
+
+GLOBAL(void)
+jsimd_set_idct_islow_table (jsimd_islow_table * table)
+{
+  int i;
+
+  for (i = 0; i < DCTSIZE2; i++) {
+    long q = (long) table->islow[i];
+    table->quant[i] = (short) (q > 32767 ? 32767 : q);
+    /* A larger quantizer only lets zero through, which is still exact. */
+    table->limit[i] = (short) (q == 0 ? 32767 : LIMIT / q);
+  }
+}
+
+
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+
+/* A block whose AC coefficients are all zero takes both of
+ * jpeg_idct_islow's shortcuts, so it is a single value.
+ */
+
+LOCAL(void)
+idct_dc_only (const jsimd_islow_table * table, JCOEFPTR coef_block,
+	      JSAMPARRAY output_buf, JDIMENSION output_col,
+	      JSAMPLE * range_limit)
+{
+  int dcval = ((ISLOW_MULT_TYPE) coef_block[0] * table->islow[0]) << PASS1_BITS;
+  JSAMPLE value;
+  int ctr;
+  SHIFT_TEMPS
+
+  value = range_limit[(int) DESCALE((long) dcval, PASS1_BITS+3) & RANGE_MASK];
+  for (ctr = 0; ctr < DCTSIZE; ctr++)
+    memset((void *) (output_buf[ctr] + output_col), value, (size_t) DCTSIZE);
+}
+
+
+#ifdef JSIMD_X86
+
+#define PAIR16(a,b)  ((int) (((unsigned int) (b) << 16) | ((unsigned int) (a) & 0xFFFF)))
+
+JSIMD_INLINE LOCAL(void)
+transpose_8x8_sse2 (__m128i r[8])
+{
+  __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+  __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+  __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+  __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+  __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+  __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+  __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+  __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+  __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+  __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+  __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+  __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+  __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+  __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+  __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+  __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+  r[0] = _mm_unpacklo_epi64(b0, b4);
+  r[1] = _mm_unpackhi_epi64(b0, b4);
+  r[2] = _mm_unpacklo_epi64(b1, b5);
+  r[3] = _mm_unpackhi_epi64(b1, b5);
+  r[4] = _mm_unpacklo_epi64(b2, b6);
+  r[5] = _mm_unpackhi_epi64(b2, b6);
+  r[6] = _mm_unpacklo_epi64(b3, b7);
+  r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+
+/* Loads and dequantizes a block into x[].  Returns 0 if the SIMD code can
+ * take it, 1 if all its AC coefficients are zero, and 2 if a coefficient
+ * is over its limit.
+ */
+
+JSIMD_INLINE LOCAL(int)
+idct_load_sse2 (const jsimd_islow_table * table, JCOEFPTR coef_block,
+		__m128i x[8])
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i bad = zero, ac = zero;
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++) {
+    const __m128i c = _mm_loadu_si128((const __m128i *) (coef_block + DCTSIZE*i));
+    const __m128i limit = _mm_loadu_si128((const __m128i *) (table->limit + DCTSIZE*i));
+    const __m128i q = _mm_loadu_si128((const __m128i *) (table->quant + DCTSIZE*i));
+    bad = _mm_or_si128(bad, _mm_or_si128(_mm_cmpgt_epi16(c, limit),
+					 _mm_cmplt_epi16(c, _mm_sub_epi16(zero, limit))));
+    ac = _mm_or_si128(ac, i == 0 ? _mm_slli_si128(_mm_srli_si128(c, 2), 2) : c);
+    x[i] = _mm_mullo_epi16(c, q);
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(ac, zero)) == 0xFFFF)
+    return 1;
+  return _mm_movemask_epi8(bad) ? 2 : 0;
+}
+
+
+/* One 1-D pass on 8 columns, giving the 32-bit sums of outputs 0..7 for
+ * the low and high 4 columns.
+ */
+
+JSIMD_INLINE LOCAL(void)
+idct_1d_sse2 (const __m128i x[8], __m128i lo[8], __m128i hi[8])
+{
+  const __m128i p04l = _mm_unpacklo_epi16(x[0], x[4]);
+  const __m128i p04h = _mm_unpackhi_epi16(x[0], x[4]);
+  const __m128i p26l = _mm_unpacklo_epi16(x[2], x[6]);
+  const __m128i p26h = _mm_unpackhi_epi16(x[2], x[6]);
+  const __m128i p71l = _mm_unpacklo_epi16(x[7], x[1]);
+  const __m128i p71h = _mm_unpackhi_epi16(x[7], x[1]);
+  const __m128i p35l = _mm_unpacklo_epi16(x[3], x[5]);
+  const __m128i p35h = _mm_unpackhi_epi16(x[3], x[5]);
+  const __m128i c0p4 = _mm_set1_epi32(PAIR16(E_0, E_0));
+  const __m128i c0m4 = _mm_set1_epi32(PAIR16(E_0, -E_0));
+  const __m128i c3 = _mm_set1_epi32(PAIR16(E3_2, E3_6));
+  const __m128i c2 = _mm_set1_epi32(PAIR16(E2_2, E2_6));
+  const __m128i o0a = _mm_set1_epi32(PAIR16(O0_7, O0_1));
+  const __m128i o0b = _mm_set1_epi32(PAIR16(O0_3, O0_5));
+  const __m128i o1a = _mm_set1_epi32(PAIR16(O1_7, O1_1));
+  const __m128i o1b = _mm_set1_epi32(PAIR16(O1_3, O1_5));
+  const __m128i o2a = _mm_set1_epi32(PAIR16(O2_7, O2_1));
+  const __m128i o2b = _mm_set1_epi32(PAIR16(O2_3, O2_5));
+  const __m128i o3a = _mm_set1_epi32(PAIR16(O3_7, O3_1));
+  const __m128i o3b = _mm_set1_epi32(PAIR16(O3_3, O3_5));
+  int h;
+
+  for (h = 0; h < 2; h++) {
+    const __m128i p04 = h ? p04h : p04l;
+    const __m128i p26 = h ? p26h : p26l;
+    const __m128i p71 = h ? p71h : p71l;
+    const __m128i p35 = h ? p35h : p35l;
+    __m128i * y = h ? hi : lo;
+    const __m128i t0 = _mm_madd_epi16(p04, c0p4);
+    const __m128i t1 = _mm_madd_epi16(p04, c0m4);
+    const __m128i t3 = _mm_madd_epi16(p26, c3);
+    const __m128i t2 = _mm_madd_epi16(p26, c2);
+    const __m128i t10 = _mm_add_epi32(t0, t3);
+    const __m128i t13 = _mm_sub_epi32(t0, t3);
+    const __m128i t11 = _mm_add_epi32(t1, t2);
+    const __m128i t12 = _mm_sub_epi32(t1, t2);
+    const __m128i o0 = _mm_add_epi32(_mm_madd_epi16(p71, o0a), _mm_madd_epi16(p35, o0b));
+    const __m128i o1 = _mm_add_epi32(_mm_madd_epi16(p71, o1a), _mm_madd_epi16(p35, o1b));
+    const __m128i o2 = _mm_add_epi32(_mm_madd_epi16(p71, o2a), _mm_madd_epi16(p35, o2b));
+    const __m128i o3 = _mm_add_epi32(_mm_madd_epi16(p71, o3a), _mm_madd_epi16(p35, o3b));
+    y[0] = _mm_add_epi32(t10, o3);
+    y[7] = _mm_sub_epi32(t10, o3);
+    y[1] = _mm_add_epi32(t11, o2);
+    y[6] = _mm_sub_epi32(t11, o2);
+    y[2] = _mm_add_epi32(t12, o1);
+    y[5] = _mm_sub_epi32(t12, o1);
+    y[3] = _mm_add_epi32(t13, o0);
+    y[4] = _mm_sub_epi32(t13, o0);
+  }
+}
+
+
+/* The second pass's descaling and range limiting, on 32-bit sums. */
+
+JSIMD_INLINE LOCAL(__m128i)
+idct_range_limit_sse2 (__m128i lo, __m128i hi)
+{
+  const __m128i round = _mm_set1_epi32((1 << (CONST_BITS+PASS1_BITS+2)) +
+				       (CENTERJSAMPLE << (CONST_BITS+PASS1_BITS+3)));
+  const __m128i mask = _mm_set1_epi32(RANGE_MASK);
+  __m128i v;
+
+  lo = _mm_and_si128(_mm_srai_epi32(_mm_add_epi32(lo, round), CONST_BITS+PASS1_BITS+3), mask);
+  hi = _mm_and_si128(_mm_srai_epi32(_mm_add_epi32(hi, round), CONST_BITS+PASS1_BITS+3), mask);
+  v = _mm_packs_epi32(lo, hi);
+  return _mm_andnot_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(WRAP_LAST)),
+			  _mm_min_epi16(v, _mm_set1_epi16(MAXJSAMPLE)));
+}
+
+
+JSIMD_INLINE LOCAL(void)
+idct_store_sse2 (__m128i r[8], JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  int ctr;
+
+  transpose_8x8_sse2(r);
+  for (ctr = 0; ctr < DCTSIZE; ctr += 2) {
+    const __m128i p = _mm_packus_epi16(r[ctr], r[ctr+1]);
+    _mm_storel_epi64((__m128i *) (output_buf[ctr] + output_col), p);
+    _mm_storel_epi64((__m128i *) (output_buf[ctr+1] + output_col), _mm_srli_si128(p, 8));
+  }
+}
+
+
+LOCAL(int)
+idct_islow_sse2 (const jsimd_islow_table * table, JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col,
+		 JSAMPLE * range_limit)
+{
+  const __m128i round1 = _mm_set1_epi32(1 << (CONST_BITS-PASS1_BITS-1));
+  __m128i x[8], lo[8], hi[8];
+  int i;
+
+  switch (idct_load_sse2(table, coef_block, x)) {
+  case 1:
+    idct_dc_only(table, coef_block, output_buf, output_col, range_limit);
+    return TRUE;
+  case 2:
+    return FALSE;
+  }
+
+  /* Pass 1: the rows of x are rows of coefficients, so this does all eight
+   * columns at once and leaves the work array's rows in x.
+   */
+  idct_1d_sse2(x, lo, hi);
+  for (i = 0; i < DCTSIZE; i++)
+    x[i] = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo[i], round1), CONST_BITS-PASS1_BITS),
+			   _mm_srai_epi32(_mm_add_epi32(hi[i], round1), CONST_BITS-PASS1_BITS));
+
+  /* Pass 2 on the transposed work array, whose outputs are transposed
+   * back into rows of samples.
+   */
+  transpose_8x8_sse2(x);
+  idct_1d_sse2(x, lo, hi);
+  for (i = 0; i < DCTSIZE; i++)
+    x[i] = idct_range_limit_sse2(lo[i], hi[i]);
+  idct_store_sse2(x, output_buf, output_col);
+  return TRUE;
+}
+
+
+/* The AVX2 version does the 32-bit arithmetic of all eight columns in one
+ * register.
+ */
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+interleave_avx2 (__m128i a, __m128i b)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(a, b)),
+				 _mm_unpackhi_epi16(a, b), 1);
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(void)
+idct_1d_avx2 (const __m128i x[8], __m256i y[8])
+{
+  const __m256i p04 = interleave_avx2(x[0], x[4]);
+  const __m256i p26 = interleave_avx2(x[2], x[6]);
+  const __m256i p71 = interleave_avx2(x[7], x[1]);
+  const __m256i p35 = interleave_avx2(x[3], x[5]);
+  const __m256i t0 = _mm256_madd_epi16(p04, _mm256_set1_epi32(PAIR16(E_0, E_0)));
+  const __m256i t1 = _mm256_madd_epi16(p04, _mm256_set1_epi32(PAIR16(E_0, -E_0)));
+  const __m256i t3 = _mm256_madd_epi16(p26, _mm256_set1_epi32(PAIR16(E3_2, E3_6)));
+  const __m256i t2 = _mm256_madd_epi16(p26, _mm256_set1_epi32(PAIR16(E2_2, E2_6)));
+  const __m256i t10 = _mm256_add_epi32(t0, t3);
+  const __m256i t13 = _mm256_sub_epi32(t0, t3);
+  const __m256i t11 = _mm256_add_epi32(t1, t2);
+  const __m256i t12 = _mm256_sub_epi32(t1, t2);
+  const __m256i o0 = _mm256_add_epi32(_mm256_madd_epi16(p71, _mm256_set1_epi32(PAIR16(O0_7, O0_1))),
+				      _mm256_madd_epi16(p35, _mm256_set1_epi32(PAIR16(O0_3, O0_5))));
+  const __m256i o1 = _mm256_add_epi32(_mm256_madd_epi16(p71, _mm256_set1_epi32(PAIR16(O1_7, O1_1))),
+				      _mm256_madd_epi16(p35, _mm256_set1_epi32(PAIR16(O1_3, O1_5))));
+  const __m256i o2 = _mm256_add_epi32(_mm256_madd_epi16(p71, _mm256_set1_epi32(PAIR16(O2_7, O2_1))),
+				      _mm256_madd_epi16(p35, _mm256_set1_epi32(PAIR16(O2_3, O2_5))));
+  const __m256i o3 = _mm256_add_epi32(_mm256_madd_epi16(p71, _mm256_set1_epi32(PAIR16(O3_7, O3_1))),
+				      _mm256_madd_epi16(p35, _mm256_set1_epi32(PAIR16(O3_3, O3_5))));
+
+  y[0] = _mm256_add_epi32(t10, o3);
+  y[7] = _mm256_sub_epi32(t10, o3);
+  y[1] = _mm256_add_epi32(t11, o2);
+  y[6] = _mm256_sub_epi32(t11, o2);
+  y[2] = _mm256_add_epi32(t12, o1);
+  y[5] = _mm256_sub_epi32(t12, o1);
+  y[3] = _mm256_add_epi32(t13, o0);
+  y[4] = _mm256_sub_epi32(t13, o0);
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(int)
+idct_islow_avx2 (const jsimd_islow_table * table, JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col,
+		 JSAMPLE * range_limit)
+{
+  const __m256i round1 = _mm256_set1_epi32(1 << (CONST_BITS-PASS1_BITS-1));
+  __m128i x[8];
+  __m256i y[8];
+  int i;
+
+  switch (idct_load_sse2(table, coef_block, x)) {
+  case 1:
+    idct_dc_only(table, coef_block, output_buf, output_col, range_limit);
+    return TRUE;
+  case 2:
+    return FALSE;
+  }
+
+  idct_1d_avx2(x, y);
+  for (i = 0; i < DCTSIZE; i++) {
+    const __m256i v = _mm256_srai_epi32(_mm256_add_epi32(y[i], round1), CONST_BITS-PASS1_BITS);
+    x[i] = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  }
+
+  transpose_8x8_sse2(x);
+  idct_1d_avx2(x, y);
+  for (i = 0; i < DCTSIZE; i++)
+    x[i] = idct_range_limit_sse2(_mm256_castsi256_si128(y[i]), _mm256_extracti128_si256(y[i], 1));
+  idct_store_sse2(x, output_buf, output_col);
+  return TRUE;
+}
+
+#endif /* JSIMD_X86 */
+
+
+#ifdef JSIMD_ARM_NEON
+
+JSIMD_INLINE LOCAL(void)
+transpose_8x8_neon (int16x8_t r[8])
+{
+  const int16x8x2_t t01 = vtrnq_s16(r[0], r[1]);
+  const int16x8x2_t t23 = vtrnq_s16(r[2], r[3]);
+  const int16x8x2_t t45 = vtrnq_s16(r[4], r[5]);
+  const int16x8x2_t t67 = vtrnq_s16(r[6], r[7]);
+  const int32x4x2_t u02 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]), vreinterpretq_s32_s16(t23.val[0]));
+  const int32x4x2_t u13 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]), vreinterpretq_s32_s16(t23.val[1]));
+  const int32x4x2_t v02 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]), vreinterpretq_s32_s16(t67.val[0]));
+  const int32x4x2_t v13 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]), vreinterpretq_s32_s16(t67.val[1]));
+
+  r[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u02.val[0]), vget_low_s32(v02.val[0])));
+  r[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u02.val[0]), vget_high_s32(v02.val[0])));
+  r[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u02.val[1]), vget_low_s32(v02.val[1])));
+  r[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u02.val[1]), vget_high_s32(v02.val[1])));
+  r[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u13.val[0]), vget_low_s32(v13.val[0])));
+  r[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u13.val[0]), vget_high_s32(v13.val[0])));
+  r[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u13.val[1]), vget_low_s32(v13.val[1])));
+  r[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u13.val[1]), vget_high_s32(v13.val[1])));
+}
+
+
+/* One 1-D pass on 4 columns. */
+
+JSIMD_INLINE LOCAL(void)
+idct_1d_neon (const int16x4_t x[8], int32x4_t y[8])
+{
+  const int32x4_t t0 = vshlq_n_s32(vaddl_s16(x[0], x[4]), CONST_BITS);
+  const int32x4_t t1 = vshlq_n_s32(vsubl_s16(x[0], x[4]), CONST_BITS);
+  const int32x4_t t3 = vmlal_n_s16(vmull_n_s16(x[2], E3_2), x[6], E3_6);
+  const int32x4_t t2 = vmlal_n_s16(vmull_n_s16(x[2], E2_2), x[6], E2_6);
+  const int32x4_t t10 = vaddq_s32(t0, t3);
+  const int32x4_t t13 = vsubq_s32(t0, t3);
+  const int32x4_t t11 = vaddq_s32(t1, t2);
+  const int32x4_t t12 = vsubq_s32(t1, t2);
+  const int32x4_t o0 = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(x[7], O0_7),
+				   x[1], O0_1), x[3], O0_3), x[5], O0_5);
+  const int32x4_t o1 = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(x[7], O1_7),
+				   x[1], O1_1), x[3], O1_3), x[5], O1_5);
+  const int32x4_t o2 = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(x[7], O2_7),
+				   x[1], O2_1), x[3], O2_3), x[5], O2_5);
+  const int32x4_t o3 = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(vmull_n_s16(x[7], O3_7),
+				   x[1], O3_1), x[3], O3_3), x[5], O3_5);
+
+  y[0] = vaddq_s32(t10, o3);
+  y[7] = vsubq_s32(t10, o3);
+  y[1] = vaddq_s32(t11, o2);
+  y[6] = vsubq_s32(t11, o2);
+  y[2] = vaddq_s32(t12, o1);
+  y[5] = vsubq_s32(t12, o1);
+  y[3] = vaddq_s32(t13, o0);
+  y[4] = vsubq_s32(t13, o0);
+}
+
+
+JSIMD_INLINE LOCAL(void)
+idct_1d_neon_8 (const int16x8_t x[8], int32x4_t lo[8], int32x4_t hi[8])
+{
+  int16x4_t half[8];
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++)
+    half[i] = vget_low_s16(x[i]);
+  idct_1d_neon(half, lo);
+  for (i = 0; i < DCTSIZE; i++)
+    half[i] = vget_high_s16(x[i]);
+  idct_1d_neon(half, hi);
+}
+
+
+JSIMD_INLINE LOCAL(int16x4_t)
+idct_range_limit_neon (int32x4_t v)
+{
+  v = vaddq_s32(vrshrq_n_s32(v, CONST_BITS+PASS1_BITS+3), vdupq_n_s32(CENTERJSAMPLE));
+  return vmovn_s32(vandq_s32(v, vdupq_n_s32(RANGE_MASK)));
+}
+
+
+LOCAL(int)
+idct_islow_neon (const jsimd_islow_table * table, JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col,
+		 JSAMPLE * range_limit)
+{
+  int16x8_t x[8];
+  int32x4_t lo[8], hi[8];
+  uint16x8_t bad = vdupq_n_u16(0);
+  int16x8_t ac = vdupq_n_s16(0);
+  uint64x2_t any;
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++) {
+    const int16x8_t c = vld1q_s16(coef_block + DCTSIZE*i);
+    bad = vorrq_u16(bad, vcgtq_s16(vqabsq_s16(c), vld1q_s16(table->limit + DCTSIZE*i)));
+    ac = vorrq_s16(ac, i == 0 ? vsetq_lane_s16(0, c, 0) : c);
+    x[i] = vmulq_s16(c, vld1q_s16(table->quant + DCTSIZE*i));
+  }
+  any = vreinterpretq_u64_s16(ac);
+  if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) == 0) {
+    idct_dc_only(table, coef_block, output_buf, output_col, range_limit);
+    return TRUE;
+  }
+  any = vreinterpretq_u64_u16(bad);
+  if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) != 0)
+    return FALSE;
+
+  idct_1d_neon_8(x, lo, hi);
+  for (i = 0; i < DCTSIZE; i++)
+    x[i] = vcombine_s16(vrshrn_n_s32(lo[i], CONST_BITS-PASS1_BITS),
+			vrshrn_n_s32(hi[i], CONST_BITS-PASS1_BITS));
+
+  transpose_8x8_neon(x);
+  idct_1d_neon_8(x, lo, hi);
+  for (i = 0; i < DCTSIZE; i++) {
+    const int16x8_t v = vcombine_s16(idct_range_limit_neon(lo[i]), idct_range_limit_neon(hi[i]));
+    x[i] = vbicq_s16(vminq_s16(v, vdupq_n_s16(MAXJSAMPLE)),
+		     vreinterpretq_s16_u16(vcgtq_s16(v, vdupq_n_s16(WRAP_LAST))));
+  }
+  transpose_8x8_neon(x);
+  for (i = 0; i < DCTSIZE; i++)
+    vst1_u8(output_buf[i] + output_col, vqmovun_s16(x[i]));
+  return TRUE;
+}
+
+#endif /* JSIMD_ARM_NEON */
+
+#endif /* JSIMD_DECOMPRESS_SUPPORTED */
+
+
+GLOBAL(void)
+jsimd_idct_islow (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  int done = FALSE;
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+  const jsimd_islow_table * table = (const jsimd_islow_table *) compptr->dct_table;
+  JSAMPLE * range_limit = IDCT_range_limit(cinfo);
+
+#ifdef JSIMD_X86
+  if (jsimd_support() & JSIMD_AVX2)
+    done = idct_islow_avx2(table, coef_block, output_buf, output_col, range_limit);
+  else
+    done = idct_islow_sse2(table, coef_block, output_buf, output_col, range_limit);
+#endif
+#ifdef JSIMD_ARM_NEON
+  done = idct_islow_neon(table, coef_block, output_buf, output_col, range_limit);
+#endif
+#endif /* JSIMD_DECOMPRESS_SUPPORTED */
+
+  if (! done)
+    jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+}
+
+
+/**************** Fancy upsampling ****************/
+
+
+/* These do the columns jdsample.c's general case covers, from input column
+ * 1 on, as far as the vector loads stay within the row, and return where
+ * they stopped.
+ */
+
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+
+#ifdef JSIMD_X86
+
+LOCAL(JDIMENSION)
+h2v1_fancy_sse2 (JSAMPROW inptr, JSAMPROW outptr, JDIMENSION width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i two = _mm_set1_epi16(2);
+  JDIMENSION col;
+
+  for (col = 1; col + 16 < width; col += 16) {
+    const __m128i a = _mm_loadu_si128((const __m128i *) (inptr + col - 1));
+    const __m128i b = _mm_loadu_si128((const __m128i *) (inptr + col));
+    const __m128i c = _mm_loadu_si128((const __m128i *) (inptr + col + 1));
+    __m128i b3l = _mm_unpacklo_epi8(b, zero);
+    __m128i b3h = _mm_unpackhi_epi8(b, zero);
+    __m128i even, odd;
+
+    b3l = _mm_add_epi16(b3l, _mm_add_epi16(b3l, b3l));
+    b3h = _mm_add_epi16(b3h, _mm_add_epi16(b3h, b3h));
+    even = _mm_packus_epi16(
+      _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(b3l, _mm_unpacklo_epi8(a, zero)), one), 2),
+      _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(b3h, _mm_unpackhi_epi8(a, zero)), one), 2));
+    odd = _mm_packus_epi16(
+      _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(b3l, _mm_unpacklo_epi8(c, zero)), two), 2),
+      _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(b3h, _mm_unpackhi_epi8(c, zero)), two), 2));
+    _mm_storeu_si128((__m128i *) (outptr + 2*col), _mm_unpacklo_epi8(even, odd));
+    _mm_storeu_si128((__m128i *) (outptr + 2*col + 16), _mm_unpackhi_epi8(even, odd));
+  }
+  return col;
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(JDIMENSION)
+h2v1_fancy_avx2 (JSAMPROW inptr, JSAMPROW outptr, JDIMENSION width)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i two = _mm256_set1_epi16(2);
+  JDIMENSION col;
+
+  for (col = 1; col + 32 < width; col += 32) {
+    const __m256i a = _mm256_loadu_si256((const __m256i *) (inptr + col - 1));
+    const __m256i b = _mm256_loadu_si256((const __m256i *) (inptr + col));
+    const __m256i c = _mm256_loadu_si256((const __m256i *) (inptr + col + 1));
+    __m256i b3l = _mm256_unpacklo_epi8(b, zero);
+    __m256i b3h = _mm256_unpackhi_epi8(b, zero);
+    __m256i even, odd, lo, hi;
+
+    b3l = _mm256_add_epi16(b3l, _mm256_add_epi16(b3l, b3l));
+    b3h = _mm256_add_epi16(b3h, _mm256_add_epi16(b3h, b3h));
+    even = _mm256_packus_epi16(
+      _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(b3l, _mm256_unpacklo_epi8(a, zero)), one), 2),
+      _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(b3h, _mm256_unpackhi_epi8(a, zero)), one), 2));
+    odd = _mm256_packus_epi16(
+      _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(b3l, _mm256_unpacklo_epi8(c, zero)), two), 2),
+      _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(b3h, _mm256_unpackhi_epi8(c, zero)), two), 2));
+    /* The unpacks work within 128-bit lanes, so the halves come out as
+     * columns 0-7 and 16-23, then 8-15 and 24-31.
+     */
+    lo = _mm256_unpacklo_epi8(even, odd);
+    hi = _mm256_unpackhi_epi8(even, odd);
+    _mm256_storeu_si256((__m256i *) (outptr + 2*col), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *) (outptr + 2*col + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  return col;
+}
+
+
+/* The column sums 3*nearer + further of one 8-column half. */
+
+JSIMD_INLINE LOCAL(__m128i)
+colsum_sse2 (__m128i near8, __m128i far8)
+{
+  return _mm_add_epi16(_mm_add_epi16(near8, _mm_add_epi16(near8, near8)), far8);
+}
+
+
+LOCAL(JDIMENSION)
+h2v2_fancy_sse2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW outptr,
+		 JDIMENSION width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i seven = _mm_set1_epi16(7);
+  const __m128i eight = _mm_set1_epi16(8);
+  JDIMENSION col;
+
+  for (col = 1; col + 16 < width; col += 16) {
+    const __m128i n0 = _mm_loadu_si128((const __m128i *) (inptr0 + col - 1));
+    const __m128i n1 = _mm_loadu_si128((const __m128i *) (inptr0 + col));
+    const __m128i n2 = _mm_loadu_si128((const __m128i *) (inptr0 + col + 1));
+    const __m128i f0 = _mm_loadu_si128((const __m128i *) (inptr1 + col - 1));
+    const __m128i f1 = _mm_loadu_si128((const __m128i *) (inptr1 + col));
+    const __m128i f2 = _mm_loadu_si128((const __m128i *) (inptr1 + col + 1));
+    __m128i last, this3, next, even[2], odd[2];
+    int h;
+
+    for (h = 0; h < 2; h++) {
+      if (h == 0) {
+	last = colsum_sse2(_mm_unpacklo_epi8(n0, zero), _mm_unpacklo_epi8(f0, zero));
+	this3 = colsum_sse2(_mm_unpacklo_epi8(n1, zero), _mm_unpacklo_epi8(f1, zero));
+	next = colsum_sse2(_mm_unpacklo_epi8(n2, zero), _mm_unpacklo_epi8(f2, zero));
+      } else {
+	last = colsum_sse2(_mm_unpackhi_epi8(n0, zero), _mm_unpackhi_epi8(f0, zero));
+	this3 = colsum_sse2(_mm_unpackhi_epi8(n1, zero), _mm_unpackhi_epi8(f1, zero));
+	next = colsum_sse2(_mm_unpackhi_epi8(n2, zero), _mm_unpackhi_epi8(f2, zero));
+      }
+      this3 = _mm_add_epi16(this3, _mm_add_epi16(this3, this3));
+      even[h] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(this3, last), eight), 4);
+      odd[h] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(this3, next), seven), 4);
+    }
+    even[0] = _mm_packus_epi16(even[0], even[1]);
+    odd[0] = _mm_packus_epi16(odd[0], odd[1]);
+    _mm_storeu_si128((__m128i *) (outptr + 2*col), _mm_unpacklo_epi8(even[0], odd[0]));
+    _mm_storeu_si128((__m128i *) (outptr + 2*col + 16), _mm_unpackhi_epi8(even[0], odd[0]));
+  }
+  return col;
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+colsum_avx2 (__m128i near16, __m128i far16)
+{
+  const __m256i n = _mm256_cvtepu8_epi16(near16);
+
+  return _mm256_add_epi16(_mm256_add_epi16(n, _mm256_add_epi16(n, n)), _mm256_cvtepu8_epi16(far16));
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(JDIMENSION)
+h2v2_fancy_avx2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW outptr,
+		 JDIMENSION width)
+{
+  const __m256i seven = _mm256_set1_epi16(7);
+  const __m256i eight = _mm256_set1_epi16(8);
+  JDIMENSION col;
+
+  /* 16 columns at a time, widened to 16 bits in order, so that the even
+   * and odd outputs can be interleaved without crossing lanes.
+   */
+  for (col = 1; col + 16 < width; col += 16) {
+    const __m256i last = colsum_avx2(_mm_loadu_si128((const __m128i *) (inptr0 + col - 1)),
+				     _mm_loadu_si128((const __m128i *) (inptr1 + col - 1)));
+    __m256i this3 = colsum_avx2(_mm_loadu_si128((const __m128i *) (inptr0 + col)),
+				_mm_loadu_si128((const __m128i *) (inptr1 + col)));
+    const __m256i next = colsum_avx2(_mm_loadu_si128((const __m128i *) (inptr0 + col + 1)),
+				     _mm_loadu_si128((const __m128i *) (inptr1 + col + 1)));
+    __m256i even, odd, out;
+
+    this3 = _mm256_add_epi16(this3, _mm256_add_epi16(this3, this3));
+    even = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(this3, last), eight), 4);
+    odd = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(this3, next), seven), 4);
+    /* Shifting odd up a byte puts each output after its even neighbour. */
+    out = _mm256_or_si256(even, _mm256_slli_epi16(odd, 8));
+    _mm256_storeu_si256((__m256i *) (outptr + 2*col), out);
+  }
+  return col;
+}
+
+#endif /* JSIMD_X86 */
+
+
+#ifdef JSIMD_ARM_NEON
+
+LOCAL(JDIMENSION)
+h2v1_fancy_neon (JSAMPROW inptr, JSAMPROW outptr, JDIMENSION width)
+{
+  const uint8x8_t three = vdup_n_u8(3);
+  const uint16x8_t one = vdupq_n_u16(1);
+  JDIMENSION col;
+
+  for (col = 1; col + 16 < width; col += 16) {
+    const uint8x16_t a = vld1q_u8(inptr + col - 1);
+    const uint8x16_t b = vld1q_u8(inptr + col);
+    const uint8x16_t c = vld1q_u8(inptr + col + 1);
+    const uint16x8_t b3l = vmull_u8(vget_low_u8(b), three);
+    const uint16x8_t b3h = vmull_u8(vget_high_u8(b), three);
+    uint8x16x2_t out;
+
+    out.val[0] = vcombine_u8(vshrn_n_u16(vaddq_u16(vaddw_u8(b3l, vget_low_u8(a)), one), 2),
+			     vshrn_n_u16(vaddq_u16(vaddw_u8(b3h, vget_high_u8(a)), one), 2));
+    out.val[1] = vcombine_u8(vrshrn_n_u16(vaddw_u8(b3l, vget_low_u8(c)), 2),
+			     vrshrn_n_u16(vaddw_u8(b3h, vget_high_u8(c)), 2));
+    vst2q_u8(outptr + 2*col, out);
+  }
+  return col;
+}
+
+
+LOCAL(JDIMENSION)
+h2v2_fancy_neon (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW outptr,
+		 JDIMENSION width)
+{
+  const uint8x8_t three = vdup_n_u8(3);
+  const uint16x8_t seven = vdupq_n_u16(7);
+  JDIMENSION col;
+
+  for (col = 1; col + 8 < width; col += 8) {
+    const uint16x8_t last = vaddw_u8(vmull_u8(vld1_u8(inptr0 + col - 1), three), vld1_u8(inptr1 + col - 1));
+    const uint16x8_t cur = vaddw_u8(vmull_u8(vld1_u8(inptr0 + col), three), vld1_u8(inptr1 + col));
+    const uint16x8_t next = vaddw_u8(vmull_u8(vld1_u8(inptr0 + col + 1), three), vld1_u8(inptr1 + col + 1));
+    const uint16x8_t this3 = vaddq_u16(cur, vaddq_u16(cur, cur));
+    uint8x8x2_t out;
+
+    out.val[0] = vrshrn_n_u16(vaddq_u16(this3, last), 4);
+    out.val[1] = vshrn_n_u16(vaddq_u16(vaddq_u16(this3, next), seven), 4);
+    vst2_u8(outptr + 2*col, out);
+  }
+  return col;
+}
+
+#endif /* JSIMD_ARM_NEON */
+
+#endif /* JSIMD_DECOMPRESS_SUPPORTED */
+
+
+GLOBAL(int)
+jsimd_can_h2v1_fancy_upsample (void)
+{
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+  return (jsimd_support() != 0);
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(void)
+jsimd_h2v1_fancy_upsample (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  JDIMENSION width = compptr->downsampled_width;
+  JSAMPROW inptr, outptr;
+  int invalue;
+  JDIMENSION col;
+  int inrow;
+
+  for (inrow = 0; inrow < cinfo->max_v_samp_factor; inrow++) {
+    inptr = input_data[inrow];
+    outptr = output_data[inrow];
+    /* Special case for first column */
+    invalue = GETJSAMPLE(inptr[0]);
+    outptr[0] = (JSAMPLE) invalue;
+    outptr[1] = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[1]) + 2) >> 2);
+
+    col = 1;
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+#ifdef JSIMD_X86
+    if (jsimd_support() & JSIMD_AVX2)
+      col = h2v1_fancy_avx2(inptr, outptr, width);
+    else
+      col = h2v1_fancy_sse2(inptr, outptr, width);
+#endif
+#ifdef JSIMD_ARM_NEON
+    col = h2v1_fancy_neon(inptr, outptr, width);
+#endif
+#endif
+    for (; col < width - 1; col++) {
+      /* General case: 3/4 * nearer pixel + 1/4 * further pixel */
+      invalue = GETJSAMPLE(inptr[col]) * 3;
+      outptr[2*col] = (JSAMPLE) ((invalue + GETJSAMPLE(inptr[col-1]) + 1) >> 2);
+      outptr[2*col+1] = (JSAMPLE) ((invalue + GETJSAMPLE(inptr[col+1]) + 2) >> 2);
+    }
+
+    /* Special case for last column */
+    invalue = GETJSAMPLE(inptr[width-1]);
+    outptr[2*width-2] = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[width-2]) + 1) >> 2);
+    outptr[2*width-1] = (JSAMPLE) invalue;
+  }
+}
+
+
+GLOBAL(int)
+jsimd_can_h2v2_fancy_upsample (void)
+{
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+  return (jsimd_support() != 0);
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(void)
+jsimd_h2v2_fancy_upsample (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  JDIMENSION width = compptr->downsampled_width;
+  JSAMPROW inptr0, inptr1, outptr;
+  int thiscolsum, lastcolsum, nextcolsum;
+  JDIMENSION col;
+  int inrow, outrow, v;
+
+  inrow = outrow = 0;
+  while (outrow < cinfo->max_v_samp_factor) {
+    for (v = 0; v < 2; v++) {
+      /* inptr0 points to nearest input row, inptr1 points to next nearest */
+      inptr0 = input_data[inrow];
+      if (v == 0)		/* next nearest is row above */
+	inptr1 = input_data[inrow-1];
+      else			/* next nearest is row below */
+	inptr1 = input_data[inrow+1];
+      outptr = output_data[outrow++];
+
+      /* Special case for first column */
+      thiscolsum = GETJSAMPLE(inptr0[0]) * 3 + GETJSAMPLE(inptr1[0]);
+      nextcolsum = GETJSAMPLE(inptr0[1]) * 3 + GETJSAMPLE(inptr1[1]);
+      outptr[0] = (JSAMPLE) ((thiscolsum * 4 + 8) >> 4);
+      outptr[1] = (JSAMPLE) ((thiscolsum * 3 + nextcolsum + 7) >> 4);
+
+      col = 1;
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+#ifdef JSIMD_X86
+      if (jsimd_support() & JSIMD_AVX2)
+	col = h2v2_fancy_avx2(inptr0, inptr1, outptr, width);
+      else
+	col = h2v2_fancy_sse2(inptr0, inptr1, outptr, width);
+#endif
+#ifdef JSIMD_ARM_NEON
+      col = h2v2_fancy_neon(inptr0, inptr1, outptr, width);
+#endif
+#endif
+      lastcolsum = GETJSAMPLE(inptr0[col-1]) * 3 + GETJSAMPLE(inptr1[col-1]);
+      thiscolsum = GETJSAMPLE(inptr0[col]) * 3 + GETJSAMPLE(inptr1[col]);
+      for (; col < width - 1; col++) {
+	/* General case: 3/4 * nearer pixel + 1/4 * further pixel in each */
+	/* dimension, thus 9/16, 3/16, 3/16, 1/16 overall */
+	nextcolsum = GETJSAMPLE(inptr0[col+1]) * 3 + GETJSAMPLE(inptr1[col+1]);
+	outptr[2*col] = (JSAMPLE) ((thiscolsum * 3 + lastcolsum + 8) >> 4);
+	outptr[2*col+1] = (JSAMPLE) ((thiscolsum * 3 + nextcolsum + 7) >> 4);
+	lastcolsum = thiscolsum; thiscolsum = nextcolsum;
+      }
+
+      /* Special case for last column */
+      outptr[2*width-2] = (JSAMPLE) ((thiscolsum * 3 + lastcolsum + 8) >> 4);
+      outptr[2*width-1] = (JSAMPLE) ((thiscolsum * 4 + 7) >> 4);
+    }
+    inrow++;
+  }
+}
+
+
+/**************** YCbCr->RGB conversion ****************/
+
+
+/* jdcolor.c's tables hold, for x = Cb or Cr - CENTERJSAMPLE,
+ *	Cr=>R  (FIX(1.40200) * x + ONE_HALF) >> 16
+ *	Cb=>B  (FIX(1.77200) * x + ONE_HALF) >> 16
+ *	Cb,Cr=>G  (-FIX(0.34414) * Cb - FIX(0.71414) * Cr + ONE_HALF) >> 16
+ * Taking whole multiples of x out of the constants leaves ones that fit in
+ * 16 bits, and adding a multiple of 65536 before the shift is the same as
+ * adding the multiple after it, so the results are the same.
+ */
+
+#define CR_R  (91881 - 65536)	/* R = y + Cr + ((CR_R * Cr + ONE_HALF) >> 16) */
+#define CB_B  (116130 - 131072)	/* B = y + 2*Cb + ((CB_B * Cb + ONE_HALF) >> 16) */
+#define CB_G  (-22554)		/* G = y - Cr + ((CB_G * Cb + CR_G * Cr + ONE_HALF) >> 16) */
+#define CR_G  (-46802 + 65536)
+
+#define ONE_HALF_16  (1 << 15)
+
+
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+
+#ifdef JSIMD_X86
+
+/* (c * x + 32768) >> 16, from the low and high halves of the product. */
+
+JSIMD_INLINE LOCAL(__m128i)
+mul_round_sse2 (__m128i x, __m128i c)
+{
+  return _mm_sub_epi16(_mm_mulhi_epi16(x, c), _mm_srai_epi16(_mm_mullo_epi16(x, c), 15));
+}
+
+
+/* The R, G and B values of 8 pixels, before range limiting. */
+
+JSIMD_INLINE LOCAL(void)
+ycc_rgb_8_sse2 (__m128i y, __m128i cb, __m128i cr,
+		__m128i * r, __m128i * g, __m128i * b)
+{
+  const __m128i round = _mm_set1_epi32(ONE_HALF_16);
+  const __m128i cg = _mm_set1_epi32(PAIR16(CB_G, CR_G));
+  __m128i glo, ghi;
+
+  *r = _mm_add_epi16(_mm_add_epi16(y, cr), mul_round_sse2(cr, _mm_set1_epi16(CR_R)));
+  *b = _mm_add_epi16(_mm_add_epi16(y, _mm_add_epi16(cb, cb)), mul_round_sse2(cb, _mm_set1_epi16(CB_B)));
+  glo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb, cr), cg), round), 16);
+  ghi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb, cr), cg), round), 16);
+  *g = _mm_add_epi16(_mm_sub_epi16(y, cr), _mm_packs_epi32(glo, ghi));
+}
+
+
+/* Stores the 4 pixels held as R,G,B,0 in each 32 bits of v as 12 bytes at
+ * outptr, and 4 more bytes of garbage after them.
+ */
+
+JSIMD_INLINE LOCAL(void)
+store_rgb4_sse2 (JSAMPROW outptr, __m128i v)
+{
+  const __m128i low = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+  const __m128i high = _mm_set_epi32(0x0000FFFF, 0xFF000000, 0x0000FFFF, 0xFF000000);
+  const __m128i lane0 = _mm_set_epi32(0, 0, -1, -1);
+
+  /* Each 64 bits hold 2 pixels; close the gap between them. */
+  v = _mm_or_si128(_mm_and_si128(v, low), _mm_and_si128(_mm_srli_epi64(v, 8), high));
+  /* Then the gap between the two halves. */
+  v = _mm_or_si128(_mm_and_si128(v, lane0), _mm_srli_si128(_mm_andnot_si128(lane0, v), 2));
+  _mm_storeu_si128((__m128i *) outptr, v);
+}
+
+
+LOCAL(JDIMENSION)
+ycc_rgb_sse2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  JDIMENSION col;
+
+  /* The last store writes 4 bytes past the 16 pixels, so there has to be
+   * room for them in the row.
+   */
+  for (col = 0; col + 18 <= num_cols; col += 16) {
+    const __m128i y = _mm_loadu_si128((const __m128i *) (inptr0 + col));
+    const __m128i cb = _mm_loadu_si128((const __m128i *) (inptr1 + col));
+    const __m128i cr = _mm_loadu_si128((const __m128i *) (inptr2 + col));
+    __m128i rl, gl, bl, rh, gh, bh, r, g, b, rg, bz;
+
+    ycc_rgb_8_sse2(_mm_unpacklo_epi8(y, zero),
+		   _mm_sub_epi16(_mm_unpacklo_epi8(cb, zero), center),
+		   _mm_sub_epi16(_mm_unpacklo_epi8(cr, zero), center), &rl, &gl, &bl);
+    ycc_rgb_8_sse2(_mm_unpackhi_epi8(y, zero),
+		   _mm_sub_epi16(_mm_unpackhi_epi8(cb, zero), center),
+		   _mm_sub_epi16(_mm_unpackhi_epi8(cr, zero), center), &rh, &gh, &bh);
+    r = _mm_packus_epi16(rl, rh);
+    g = _mm_packus_epi16(gl, gh);
+    b = _mm_packus_epi16(bl, bh);
+
+    rg = _mm_unpacklo_epi8(r, g);
+    bz = _mm_unpacklo_epi8(b, zero);
+    store_rgb4_sse2(outptr + 3*col, _mm_unpacklo_epi16(rg, bz));
+    store_rgb4_sse2(outptr + 3*col + 12, _mm_unpackhi_epi16(rg, bz));
+    rg = _mm_unpackhi_epi8(r, g);
+    bz = _mm_unpackhi_epi8(b, zero);
+    store_rgb4_sse2(outptr + 3*col + 24, _mm_unpacklo_epi16(rg, bz));
+    store_rgb4_sse2(outptr + 3*col + 36, _mm_unpackhi_epi16(rg, bz));
+  }
+  return col;
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(__m256i)
+mul_round_avx2 (__m256i x, __m256i c)
+{
+  return _mm256_sub_epi16(_mm256_mulhi_epi16(x, c), _mm256_srai_epi16(_mm256_mullo_epi16(x, c), 15));
+}
+
+
+JSIMD_TARGET_AVX2 JSIMD_INLINE LOCAL(void)
+ycc_rgb_16_avx2 (__m256i y, __m256i cb, __m256i cr,
+		 __m256i * r, __m256i * g, __m256i * b)
+{
+  const __m256i round = _mm256_set1_epi32(ONE_HALF_16);
+  const __m256i cg = _mm256_set1_epi32(PAIR16(CB_G, CR_G));
+  __m256i glo, ghi;
+
+  *r = _mm256_add_epi16(_mm256_add_epi16(y, cr), mul_round_avx2(cr, _mm256_set1_epi16(CR_R)));
+  *b = _mm256_add_epi16(_mm256_add_epi16(y, _mm256_add_epi16(cb, cb)), mul_round_avx2(cb, _mm256_set1_epi16(CB_B)));
+  glo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(cb, cr), cg), round), 16);
+  ghi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(cb, cr), cg), round), 16);
+  *g = _mm256_add_epi16(_mm256_sub_epi16(y, cr), _mm256_packs_epi32(glo, ghi));
+}
+
+
+JSIMD_TARGET_AVX2 LOCAL(JDIMENSION)
+ycc_rgb_avx2 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION num_cols)
+{
+  /* pshufb masks that pick the R, G and B bytes of each 16 bytes of output
+   * out of 16 pixels; 0x80 gives a zero.
+   */
+  static const unsigned char shuffle[3][3][16] = {
+    { { 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80, 5 },
+      { 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80 },
+      { 0x80, 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80 } },
+    { { 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10, 0x80 },
+      { 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10 },
+      { 0x80, 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80 } },
+    { { 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80, 0x80 },
+      { 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80 },
+      { 10, 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15 } }
+  };
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i center = _mm256_set1_epi16(CENTERJSAMPLE);
+  __m256i mask[3][3];
+  JDIMENSION col;
+  int i, c;
+
+  for (i = 0; i < 3; i++)
+    for (c = 0; c < 3; c++)
+      mask[i][c] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) shuffle[i][c]));
+
+  for (col = 0; col + 32 <= num_cols; col += 32) {
+    const __m256i y = _mm256_loadu_si256((const __m256i *) (inptr0 + col));
+    const __m256i cb = _mm256_loadu_si256((const __m256i *) (inptr1 + col));
+    const __m256i cr = _mm256_loadu_si256((const __m256i *) (inptr2 + col));
+    __m256i rl, gl, bl, rh, gh, bh, r, g, b, out[3];
+
+    ycc_rgb_16_avx2(_mm256_unpacklo_epi8(y, zero),
+		    _mm256_sub_epi16(_mm256_unpacklo_epi8(cb, zero), center),
+		    _mm256_sub_epi16(_mm256_unpacklo_epi8(cr, zero), center), &rl, &gl, &bl);
+    ycc_rgb_16_avx2(_mm256_unpackhi_epi8(y, zero),
+		    _mm256_sub_epi16(_mm256_unpackhi_epi8(cb, zero), center),
+		    _mm256_sub_epi16(_mm256_unpackhi_epi8(cr, zero), center), &rh, &gh, &bh);
+    /* The unpacks and packs both work within 128-bit lanes, so each lane
+     * ends up with 16 pixels in order.
+     */
+    r = _mm256_packus_epi16(rl, rh);
+    g = _mm256_packus_epi16(gl, gh);
+    b = _mm256_packus_epi16(bl, bh);
+    for (i = 0; i < 3; i++)
+      out[i] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, mask[i][0]),
+					       _mm256_shuffle_epi8(g, mask[i][1])),
+			       _mm256_shuffle_epi8(b, mask[i][2]));
+    for (i = 0; i < 3; i++) {
+      _mm_storeu_si128((__m128i *) (outptr + 3*col + 16*i), _mm256_castsi256_si128(out[i]));
+      _mm_storeu_si128((__m128i *) (outptr + 3*col + 48 + 16*i), _mm256_extracti128_si256(out[i], 1));
+    }
+  }
+  return col;
+}
+
+#endif /* JSIMD_X86 */
+
+
+#ifdef JSIMD_ARM_NEON
+
+JSIMD_INLINE LOCAL(uint8x8_t)
+ycc_r_neon (int16x8_t y, int16x8_t cr)
+{
+  const int16x8_t t = vcombine_s16(vrshrn_n_s32(vmull_n_s16(vget_low_s16(cr), CR_R), 16),
+				   vrshrn_n_s32(vmull_n_s16(vget_high_s16(cr), CR_R), 16));
+  return vqmovun_s16(vaddq_s16(vaddq_s16(y, cr), t));
+}
+
+
+JSIMD_INLINE LOCAL(uint8x8_t)
+ycc_b_neon (int16x8_t y, int16x8_t cb)
+{
+  const int16x8_t t = vcombine_s16(vrshrn_n_s32(vmull_n_s16(vget_low_s16(cb), CB_B), 16),
+				   vrshrn_n_s32(vmull_n_s16(vget_high_s16(cb), CB_B), 16));
+  return vqmovun_s16(vaddq_s16(vaddq_s16(y, vaddq_s16(cb, cb)), t));
+}
+
+
+JSIMD_INLINE LOCAL(uint8x8_t)
+ycc_g_neon (int16x8_t y, int16x8_t cb, int16x8_t cr)
+{
+  const int32x4_t lo = vmlal_n_s16(vmull_n_s16(vget_low_s16(cb), CB_G), vget_low_s16(cr), CR_G);
+  const int32x4_t hi = vmlal_n_s16(vmull_n_s16(vget_high_s16(cb), CB_G), vget_high_s16(cr), CR_G);
+  const int16x8_t t = vcombine_s16(vrshrn_n_s32(lo, 16), vrshrn_n_s32(hi, 16));
+
+  return vqmovun_s16(vaddq_s16(vsubq_s16(y, cr), t));
+}
+
+
+LOCAL(JDIMENSION)
+ycc_rgb_neon (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	      JSAMPROW outptr, JDIMENSION num_cols)
+{
+  const int16x8_t center = vdupq_n_s16(CENTERJSAMPLE);
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    const int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(inptr0 + col)));
+    const int16x8_t cb = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(inptr1 + col))), center);
+    const int16x8_t cr = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(inptr2 + col))), center);
+    uint8x8x3_t rgb;
+
+    rgb.val[0] = ycc_r_neon(y, cr);
+    rgb.val[1] = ycc_g_neon(y, cb, cr);
+    rgb.val[2] = ycc_b_neon(y, cb);
+    vst3_u8(outptr + 3*col, rgb);
+  }
+  return col;
+}
+
+#endif /* JSIMD_ARM_NEON */
+
+#endif /* JSIMD_DECOMPRESS_SUPPORTED */
+
+
+GLOBAL(int)
+jsimd_can_ycc_rgb (void)
+{
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+  return (jsimd_support() != 0);
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(void)
+jsimd_ycc_rgb_convert (j_decompress_ptr cinfo,
+		       JSAMPIMAGE input_buf, JDIMENSION input_row,
+		       JSAMPARRAY output_buf, int num_rows)
+{
+  JSAMPROW outptr;
+  JSAMPROW inptr0, inptr1, inptr2;
+  JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+  JSAMPLE * range_limit = cinfo->sample_range_limit;
+  int y, cb, cr;
+  SHIFT_TEMPS
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    col = 0;
+#ifdef JSIMD_DECOMPRESS_SUPPORTED
+#ifdef JSIMD_X86
+    if (jsimd_support() & JSIMD_AVX2)
+      col = ycc_rgb_avx2(inptr0, inptr1, inptr2, outptr, num_cols);
+    else
+      col = ycc_rgb_sse2(inptr0, inptr1, inptr2, outptr, num_cols);
+#endif
+#ifdef JSIMD_ARM_NEON
+    col = ycc_rgb_neon(inptr0, inptr1, inptr2, outptr, num_cols);
+#endif
+#endif
+    for (; col < num_cols; col++) {
+      y  = GETJSAMPLE(inptr0[col]);
+      cb = GETJSAMPLE(inptr1[col]) - CENTERJSAMPLE;
+      cr = GETJSAMPLE(inptr2[col]) - CENTERJSAMPLE;
+      outptr[3*col+RGB_RED] = range_limit[y + cr +
+				(int) RIGHT_SHIFT((long) CR_R * cr + ONE_HALF_16, 16)];
+      outptr[3*col+RGB_GREEN] = range_limit[y - cr +
+				(int) RIGHT_SHIFT((long) CB_G * cb + (long) CR_G * cr + ONE_HALF_16, 16)];
+      outptr[3*col+RGB_BLUE] = range_limit[y + 2*cb +
+				(int) RIGHT_SHIFT((long) CB_B * cb + ONE_HALF_16, 16)];
+    }
+  }
+}
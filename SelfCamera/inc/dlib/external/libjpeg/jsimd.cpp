@@ -0,0 +1,61 @@
+/*
+ * jsimd.c
+ *
+ * This file is not part of the Independent JPEG Group's release; it was
+ * added to this copy of the library.
+ *
+ * This file works out which of the instruction sets in jsimd.h the CPU
+ * the library is running on supports.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"
+#include "jsimd.h"
+
+
+LOCAL(int)
+env_flag (const char * name)
+{
+  const char * value = getenv(name);
+
+  return (value != NULL && value[0] == '1' && value[1] == '\0');
+}
+
+
+LOCAL(unsigned int)
+detect_support (void)
+{
+  unsigned int support = 0;
+
+  if (env_flag("JSIMD_FORCENONE"))
+    return 0;
+
+#ifdef JSIMD_X86
+  /* SSE2 is part of every x86-64 CPU, and the build asked for it on 32-bit
+   * x86.  The compiler's check for AVX2 also checks that the OS saves the
+   * YMM registers.
+   */
+  support |= JSIMD_SSE2;
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && ! env_flag("JSIMD_FORCESSE2"))
+    support |= JSIMD_AVX2;
+#endif
+#ifdef JSIMD_ARM_NEON
+  /* The build targets NEON, so the compiler may use it anywhere already. */
+  support |= JSIMD_NEON;
+#endif
+
+  return support;
+}
+
+
+GLOBAL(unsigned int)
+jsimd_support (void)
+{
+  /* Worked out once; the initialization of a local static is thread safe. */
+  static const unsigned int support = detect_support();
+
+  return support;
+}
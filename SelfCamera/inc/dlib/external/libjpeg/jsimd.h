@@ -0,0 +1,165 @@
+/*
+ * jsimd.h
+ *
+ * This file is not part of the Independent JPEG Group's release; it was
+ * added to this copy of the library.
+ *
+ * This include file declares SSE2, AVX2 and NEON versions of some of the
+ * library's inner loops, the decompressor's in jdsimd.c and the
+ * compressor's in jcsimd.c.  Which ones are compiled in depends on the
+ * target, and which one is used is decided at run time from what the CPU
+ * supports, so the same build runs on any CPU of its architecture.  Every routine here
+ * produces exactly the same output as the C routine it replaces; where an
+ * input could make the vector arithmetic overflow, the C routine is used
+ * for it instead.
+ *
+ * Setting the environment variable JSIMD_FORCENONE to 1 turns all of this
+ * off, and setting JSIMD_FORCESSE2 to 1 keeps an x86 CPU with AVX2 on the
+ * SSE2 code, which is useful for comparing them.
+ */
+
+
+/* Which instruction sets can be compiled in.  The x86 code is compiled with
+ * GCC style target attributes, so it needs no special compiler flags.
+ * DLIB_DO_NOT_USE_SIMD leaves all of it out, as it does for dlib.
+ */
+
+#ifndef DLIB_DO_NOT_USE_SIMD
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && \
+    (defined(__clang__) || (defined(__GNUC__) && \
+     (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define JSIMD_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define JSIMD_ARM_NEON
+#endif
+
+#endif /* DLIB_DO_NOT_USE_SIMD */
+
+#define JSIMD_SSE2	0x01
+#define JSIMD_AVX2	0x02
+#define JSIMD_NEON	0x04
+
+
+/* Short forms of external names for systems with brain-damaged linkers. */
+
+#ifdef NEED_SHORT_EXTERNAL_NAMES
+#define jsimd_support			jSsupport
+#define jsimd_can_idct_islow		jScidctislow
+#define jsimd_set_idct_islow_table	jSsidcttbl
+#define jsimd_idct_islow		jSidctislow
+#define jsimd_can_h2v1_fancy_upsample	jSch2v1fancy
+#define jsimd_h2v1_fancy_upsample	jSh2v1fancy
+#define jsimd_can_h2v2_fancy_upsample	jSch2v2fancy
+#define jsimd_h2v2_fancy_upsample	jSh2v2fancy
+#define jsimd_can_ycc_rgb		jScyccrgb
+#define jsimd_ycc_rgb_convert		jSyccrgb
+#define jsimd_can_rgb_ycc		jScrgbycc
+#define jsimd_rgb_ycc_convert		jSrgbycc
+#define jsimd_can_rgb_gray		jScrgbgray
+#define jsimd_rgb_gray_convert		jSrgbgray
+#define jsimd_can_h2v1_downsample	jSch2v1down
+#define jsimd_h2v1_downsample		jSh2v1down
+#define jsimd_can_h2v2_downsample	jSch2v2down
+#define jsimd_h2v2_downsample		jSh2v2down
+#define jsimd_can_fdct_islow		jScfdctislow
+#define jsimd_set_fdct_islow_table	jSsfdcttbl
+#define jsimd_fdct_islow		jSfdctislow
+#endif /* NEED_SHORT_EXTERNAL_NAMES */
+
+
+/* The multiplier table for jsimd_idct_islow.  It starts with the table
+ * jpeg_idct_islow uses, so it can be handed to that as it is.
+ */
+
+typedef struct {
+  MULTIPLIER islow[DCTSIZE2];	/* jdct.h's ISLOW_MULT_TYPE */
+  short quant[DCTSIZE2];	/* the same, saturated to 16 bits */
+  short limit[DCTSIZE2];	/* largest |coefficient| the SIMD code takes */
+} jsimd_islow_table;
+
+
+/* The divisors jsimd_fdct_islow quantizes with, as reciprocals, so that
+ * each division is two 16-bit multiplies.  This only works for divisors
+ * up to a limit, so usable says whether every entry could be done.
+ */
+
+typedef struct {
+  unsigned short recip[DCTSIZE2];	/* 2^r / divisor, rounded */
+  unsigned short corr[DCTSIZE2];	/* divisor/2, corrected for the rounding */
+  unsigned short scale[DCTSIZE2];	/* 2^(32-r) */
+  int usable;			/* TRUE if all of the above could be set */
+} jsimd_fdct_table;
+
+
+/* The instruction sets this CPU supports, out of those compiled in, as a
+ * mask of the JSIMD_ values above.
+ */
+
+EXTERN(unsigned int) jsimd_support JPP((void));
+
+/* Inverse DCT. */
+
+EXTERN(int) jsimd_can_idct_islow JPP((void));
+EXTERN(void) jsimd_set_idct_islow_table JPP((jsimd_islow_table * table));
+EXTERN(void) jsimd_idct_islow
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col));
+
+/* Fancy upsampling, with the same interface as jdsample.c's methods. */
+
+EXTERN(int) jsimd_can_h2v1_fancy_upsample JPP((void));
+EXTERN(void) jsimd_h2v1_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(int) jsimd_can_h2v2_fancy_upsample JPP((void));
+EXTERN(void) jsimd_h2v2_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+
+/* YCbCr to RGB conversion, with the same interface as jdcolor.c's. */
+
+EXTERN(int) jsimd_can_ycc_rgb JPP((void));
+EXTERN(void) jsimd_ycc_rgb_convert
+    JPP((j_decompress_ptr cinfo, JSAMPIMAGE input_buf, JDIMENSION input_row,
+	 JSAMPARRAY output_buf, int num_rows));
+
+/* RGB->YCbCr and RGB->grayscale conversion, with the same interface as
+ * jccolor.c's.
+ */
+
+EXTERN(int) jsimd_can_rgb_ycc JPP((void));
+EXTERN(void) jsimd_rgb_ycc_convert
+    JPP((j_compress_ptr cinfo, JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+	 JDIMENSION output_row, int num_rows));
+EXTERN(int) jsimd_can_rgb_gray JPP((void));
+EXTERN(void) jsimd_rgb_gray_convert
+    JPP((j_compress_ptr cinfo, JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+	 JDIMENSION output_row, int num_rows));
+
+/* Downsampling without smoothing, with the same interface as jcsample.c's
+ * methods.
+ */
+
+EXTERN(int) jsimd_can_h2v1_downsample JPP((void));
+EXTERN(void) jsimd_h2v1_downsample
+    JPP((j_compress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY output_data));
+EXTERN(int) jsimd_can_h2v2_downsample JPP((void));
+EXTERN(void) jsimd_h2v2_downsample
+    JPP((j_compress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY output_data));
+
+/* Forward DCT and quantization of num_blocks blocks, as jcdctmgr.c's
+ * forward_DCT does them with jpeg_fdct_islow.  Only for a table whose
+ * usable flag is set.
+ */
+
+EXTERN(int) jsimd_can_fdct_islow JPP((void));
+EXTERN(void) jsimd_set_fdct_islow_table
+    JPP((jsimd_fdct_table * table, const JQUANT_TBL * qtbl));
+EXTERN(void) jsimd_fdct_islow
+    JPP((const jsimd_fdct_table * table, JSAMPARRAY sample_data,
+	 JBLOCKROW coef_blocks, JDIMENSION start_col, JDIMENSION num_blocks));
@@ -25,7 +25,8 @@ namespace dlib
 // ----------------------------------------------------------------------------------------
 
     jpeg_loader::
-    jpeg_loader( const char* filename ) : height_( 0 ), width_( 0 ), output_components_(0)
+    jpeg_loader( const char* filename ) : height_( 0 ), width_( 0 ), output_components_(0),
+        scale_denom_(1), colorspace_(output_native), num_planes_(0)
     {
         read_image( filename );
     }
@@ -33,7 +34,8 @@ namespace dlib
 // ----------------------------------------------------------------------------------------
 
     jpeg_loader::
-    jpeg_loader( const std::string& filename ) : height_( 0 ), width_( 0 ), output_components_(0)
+    jpeg_loader( const std::string& filename ) : height_( 0 ), width_( 0 ), output_components_(0),
+        scale_denom_(1), colorspace_(output_native), num_planes_(0)
     {
         read_image( filename.c_str() );
     }
@@ -41,11 +43,31 @@ namespace dlib
 // ----------------------------------------------------------------------------------------
 
     jpeg_loader::
-    jpeg_loader( const dlib::file& f ) : height_( 0 ), width_( 0 ), output_components_(0)
+    jpeg_loader( const dlib::file& f ) : height_( 0 ), width_( 0 ), output_components_(0),
+        scale_denom_(1), colorspace_(output_native), num_planes_(0)
     {
         read_image( f.full_name().c_str() );
     }
 
+// ----------------------------------------------------------------------------------------
+
+    jpeg_loader::
+    jpeg_loader(
+        const std::string& filename,
+        unsigned long scale_denom,
+        output_colorspace colorspace
+    ) : height_( 0 ), width_( 0 ), output_components_(0),
+        scale_denom_(scale_denom), colorspace_(colorspace), num_planes_(0)
+    {
+        if (scale_denom != 1 && scale_denom != 2 && scale_denom != 4 && scale_denom != 8)
+        {
+            std::ostringstream sout;
+            sout << "jpeg_loader: unsupported scale 1/" << scale_denom << ", must be 1/1, 1/2, 1/4 or 1/8";
+            throw image_load_error(sout.str());
+        }
+        read_image( filename.c_str() );
+    }
+
 // ----------------------------------------------------------------------------------------
 
     bool jpeg_loader::is_gray() const
@@ -67,6 +89,13 @@ namespace dlib
         return (output_components_ == 4);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    bool jpeg_loader::is_ycbcr_planar() const
+    {
+        return (colorspace_ == output_ycbcr_planar);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     struct jpeg_loader_error_mgr 
@@ -100,6 +129,9 @@ namespace dlib
 
         jpeg_decompress_struct cinfo;
         jpeg_loader_error_mgr jerr;
+        // declared before the setjmp() so a longjmp() never skips their destructors
+        std::vector<unsigned char*> rows;
+        std::vector<JSAMPROW> plane_rows[3];
 
         cinfo.err = jpeg_std_error(&jerr.pub);
 
@@ -123,10 +155,73 @@ namespace dlib
 
         jpeg_read_header(&cinfo, TRUE);
 
+        // The reduced size IDCT produces the smaller image straight from the DCT
+        // coefficients, so the full resolution image is never built.
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = scale_denom_;
+
+        if (colorspace_ == output_gray)
+        {
+            // only the luma component gets dequantized and transformed
+            cinfo.out_color_space = JCS_GRAYSCALE;
+        }
+        else if (colorspace_ == output_ycbcr_planar)
+        {
+            if (cinfo.jpeg_color_space != JCS_YCbCr && cinfo.jpeg_color_space != JCS_GRAYSCALE)
+            {
+                fclose( fp );
+                jpeg_destroy_decompress(&cinfo);
+                throw image_load_error(std::string("jpeg_loader: no YCbCr data in file ") + filename);
+            }
+            // skip upsampling and color conversion entirely
+            cinfo.raw_data_out = TRUE;
+        }
+
         jpeg_start_decompress(&cinfo);
 
         height_ = cinfo.output_height;
         width_ = cinfo.output_width;
+
+        if (colorspace_ == output_ycbcr_planar)
+        {
+            output_components_ = 0;
+            num_planes_ = cinfo.num_components;
+
+            // jpeg_read_raw_data() hands back one iMCU row per call, and every
+            // component writes whole blocks, so the planes are padded up to that
+            // and cropped by plane_width_/plane_height_.
+            const int lines = cinfo.max_v_samp_factor * cinfo.min_DCT_scaled_size;
+            for (unsigned long c = 0; c < num_planes_; ++c)
+            {
+                const jpeg_component_info* comp = &cinfo.comp_info[c];
+                const unsigned long rows_per_call = comp->v_samp_factor * comp->DCT_scaled_size;
+                plane_width_[c] = comp->downsampled_width;
+                plane_height_[c] = comp->downsampled_height;
+                plane_stride_[c] = comp->width_in_blocks * comp->DCT_scaled_size;
+                planes[c].resize(plane_stride_[c] * rows_per_call * cinfo.total_iMCU_rows);
+                plane_rows[c].resize(rows_per_call);
+            }
+
+            for (unsigned long row = 0; cinfo.output_scanline < cinfo.output_height; ++row)
+            {
+                JSAMPARRAY arrays[3];
+                for (unsigned long c = 0; c < num_planes_; ++c)
+                {
+                    const unsigned long rows_per_call = plane_rows[c].size();
+                    for (unsigned long r = 0; r < rows_per_call; ++r)
+                        plane_rows[c][r] = &planes[c][(row*rows_per_call + r)*plane_stride_[c]];
+                    arrays[c] = &plane_rows[c][0];
+                }
+                jpeg_read_raw_data(&cinfo, arrays, lines);
+            }
+
+            jpeg_finish_decompress(&cinfo);
+            jpeg_destroy_decompress(&cinfo);
+
+            fclose( fp );
+            return;
+        }
+
         output_components_ = cinfo.output_components;
 
         if (output_components_ != 1 && 
@@ -140,7 +235,6 @@ namespace dlib
             throw image_load_error(sout.str());
         }
 
-        std::vector<unsigned char*> rows;
         rows.resize(height_);
 
         // size the image buffer
@@ -17,13 +17,54 @@ namespace dlib
     {
     public:
 
+        enum output_colorspace
+        {
+            output_native,
+            output_gray,
+            output_ycbcr_planar
+        };
+
         jpeg_loader( const char* filename );
         jpeg_loader( const std::string& filename );
         jpeg_loader( const dlib::file& f );
+        jpeg_loader(
+            const std::string& filename,
+            unsigned long scale_denom,
+            output_colorspace colorspace = output_native
+        );
 
         bool is_gray() const;
         bool is_rgb() const;
         bool is_rgba() const;
+        bool is_ycbcr_planar() const;
+
+        unsigned long num_planes() const { return num_planes_; }
+        unsigned long plane_width( unsigned long idx ) const { return plane_width_[idx]; }
+        unsigned long plane_height( unsigned long idx ) const { return plane_height_[idx]; }
+
+        template<typename T>
+        void get_plane( unsigned long idx, T& t_) const
+        {
+#ifndef DLIB_JPEG_SUPPORT
+            COMPILE_TIME_ASSERT(sizeof(T) == 0);
+#endif
+            DLIB_ASSERT(is_ycbcr_planar() && idx < num_planes(),
+                "\t void jpeg_loader::get_plane()"
+                << "\n\t Invalid arguments were given to this function."
+                << "\n\t is_ycbcr_planar(): " << is_ycbcr_planar()
+                << "\n\t idx:               " << idx
+                << "\n\t num_planes():      " << num_planes()
+                );
+
+            image_view<T> t(t_);
+            t.set_size( plane_height_[idx], plane_width_[idx] );
+            for ( unsigned long n = 0; n < plane_height_[idx]; n++ )
+            {
+                const unsigned char* v = &planes[idx][n*plane_stride_[idx]];
+                for ( unsigned long m = 0; m < plane_width_[idx]; m++ )
+                    assign_pixel( t[n][m], v[m] );
+            }
+        }
 
         template<typename T>
         void get_image( T& t_) const
@@ -37,6 +78,12 @@ namespace dlib
             !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
             COMPILE_TIME_ASSERT(sizeof(T) == 0);
 #endif
+            if ( is_ycbcr_planar() )
+            {
+                get_plane( 0, t_ );
+                return;
+            }
+
             image_view<T> t(t_);
             t.set_size( height_, width_ );
             for ( unsigned n = 0; n < height_;n++ )
@@ -80,6 +127,14 @@ namespace dlib
         unsigned long width_;
         unsigned long output_components_;
         std::vector<unsigned char> data;
+
+        unsigned long scale_denom_;
+        output_colorspace colorspace_;
+        unsigned long num_planes_;
+        unsigned long plane_width_[3];
+        unsigned long plane_height_[3];
+        unsigned long plane_stride_[3];
+        std::vector<unsigned char> planes[3];
     };
 
 // ----------------------------------------------------------------------------------------
@@ -95,6 +150,20 @@ namespace dlib
         jpeg_loader(file_name).get_image(image);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type
+        >
+    void load_jpeg (
+        image_type& image,
+        const std::string& file_name,
+        unsigned long scale_denom
+    )
+    {
+        jpeg_loader(file_name, scale_denom).get_image(image);
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -26,6 +26,13 @@ namespace dlib
 
     public:
 
+        enum output_colorspace
+        {
+            output_native,      // grayscale files stay grayscale, everything else is RGB/RGBA
+            output_gray,        // only the luma component is decoded
+            output_ycbcr_planar // Y, Cb and Cr planes as stored, no upsampling or conversion
+        };
+
         jpeg_loader( 
             const char* filename 
         );
@@ -65,6 +72,36 @@ namespace dlib
                   us from loading the given JPEG file.
         !*/
 
+        jpeg_loader( 
+            const std::string& filename,
+            unsigned long scale_denom,
+            output_colorspace colorspace = output_native
+        );
+        /*!
+            requires
+                - scale_denom == 1, 2, 4 or 8
+            ensures
+                - loads the JPEG file with the given file name into this object,
+                  reduced by a factor of scale_denom in each dimension.  The scaling
+                  is done by the reduced size IDCT, so the full resolution image is
+                  never built and the result is rounded up to whole pixels
+                  (e.g. ceil(width/scale_denom)).
+                - if (colorspace == output_gray) then
+                    - is_gray() == true.  The chroma components are never decoded.
+                      Files without a luma component (e.g. CMYK) can't be loaded
+                      this way.
+                - if (colorspace == output_ycbcr_planar) then
+                    - is_ycbcr_planar() == true
+                    - the components are kept at their stored resolution and can be
+                      obtained with get_plane().  Files that aren't YCbCr or
+                      grayscale can't be loaded this way.
+            throws
+                - std::bad_alloc
+                - image_load_error
+                  This exception is thrown if scale_denom is not valid or there is
+                  some error that prevents us from loading the given JPEG file.
+        !*/
+
         ~jpeg_loader(
         );
         /*!
@@ -92,6 +129,67 @@ namespace dlib
                     - returns false
         !*/
 
+        bool is_ycbcr_planar(
+        ) const;
+        /*!
+            ensures
+                - if (this object was loaded with output_ycbcr_planar) then
+                    - returns true
+                - else
+                    - returns false
+        !*/
+
+        unsigned long num_planes(
+        ) const;
+        /*!
+            ensures
+                - if (is_ycbcr_planar()) then
+                    - returns the number of planes stored in this object.  This is 3
+                      for YCbCr files and 1 for grayscale files.
+                - else
+                    - returns 0
+        !*/
+
+        unsigned long plane_width (
+            unsigned long idx
+        ) const;
+        /*!
+            requires
+                - idx < num_planes()
+            ensures
+                - returns the width of the idx-th plane.  The chroma planes are
+                  narrower than the Y plane when the file is subsampled.
+        !*/
+
+        unsigned long plane_height (
+            unsigned long idx
+        ) const;
+        /*!
+            requires
+                - idx < num_planes()
+            ensures
+                - returns the height of the idx-th plane
+        !*/
+
+        template<
+            typename image_type 
+            >
+        void get_plane( 
+            unsigned long idx,
+            image_type& img
+        ) const;
+        /*!
+            requires
+                - is_ycbcr_planar() == true
+                - idx < num_planes()
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+            ensures
+                - loads the idx-th plane (0 == Y, 1 == Cb, 2 == Cr) into img
+                - #img.nr() == plane_height(idx)
+                - #img.nc() == plane_width(idx)
+        !*/
+
         template<
             typename image_type 
             >
@@ -104,6 +202,8 @@ namespace dlib
                   dlib/image_processing/generic_image.h 
             ensures
                 - loads the JPEG image stored in this object into img
+                - if (is_ycbcr_planar()) then
+                    - loads only the Y plane, i.e. performs get_plane(0, img)
         !*/
 
     };
@@ -125,6 +225,25 @@ namespace dlib
             - performs: jpeg_loader(file_name).get_image(image);
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type
+        >
+    void load_jpeg (
+        image_type& image,
+        const std::string& file_name,
+        unsigned long scale_denom
+    );
+    /*!
+        requires
+            - image_type == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h 
+            - scale_denom == 1, 2, 4 or 8
+        ensures
+            - performs: jpeg_loader(file_name, scale_denom).get_image(image);
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
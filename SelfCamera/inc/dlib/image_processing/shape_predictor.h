@@ -10,7 +10,9 @@
 #include "../geometry.h"
 #include "../pixel.h"
 #include "../statistics.h"
+#include "../threads.h"
 #include <utility>
+#include <atomic>
 
 namespace dlib
 {
@@ -178,22 +180,59 @@ namespace dlib
         )
         {
             DLIB_ASSERT(from_shape.size() == to_shape.size() && (from_shape.size()%2) == 0 && from_shape.size() > 0,"");
-            std::vector<vector<float,2> > from_points, to_points;
             const unsigned long num = from_shape.size()/2;
-            from_points.reserve(num);
-            to_points.reserve(num);
             if (num == 1)
             {
                 // Just use an identity transform if there is only one landmark.
                 return point_transform_affine();
             }
 
+            // This is find_similarity_transform() evaluated directly on the shape
+            // vectors, step for step, so that no point lists need to be allocated.
+            dlib::vector<double,2> mean_from, mean_to;
+            double sigma_from = 0, sigma_to = 0;
+            matrix<double,2,2> cov;
+            cov = 0;
+
+            for (unsigned long i = 0; i < num; ++i)
+            {
+                mean_from += location(from_shape,i);
+                mean_to += location(to_shape,i);
+            }
+            mean_from /= num;
+            mean_to   /= num;
+
             for (unsigned long i = 0; i < num; ++i)
             {
-                from_points.push_back(location(from_shape,i));
-                to_points.push_back(location(to_shape,i));
+                const vector<float,2> from = location(from_shape,i);
+                const vector<float,2> to = location(to_shape,i);
+                sigma_from += length_squared(from - mean_from);
+                sigma_to += length_squared(to - mean_to);
+                cov += (to - mean_to)*trans(from - mean_from);
+            }
+
+            sigma_from /= num;
+            sigma_to   /= num;
+            cov        /= num;
+
+            matrix<double,2,2> u, v, s, d;
+            svd(cov, u,d,v);
+            s = identity_matrix(cov);
+            if (det(cov) < 0 || (det(cov) == 0 && det(u)*det(v)<0))
+            {
+                if (d(1,1) < d(0,0))
+                    s(1,1) = -1;
+                else
+                    s(0,0) = -1;
             }
-            return find_similarity_transform(from_points, to_points);
+
+            matrix<double,2,2> r = u*s*trans(v);
+            double c = 1;
+            if (sigma_from != 0)
+                c = 1.0/sigma_from * trace(d*s);
+            vector<double,2> t = mean_to - c*r*mean_from;
+
+            return point_transform_affine(c*r, t);
         }
 
     // ------------------------------------------------------------------------------------
@@ -225,11 +264,15 @@ namespace dlib
                   rect.br_corner().
         !*/
         {
-            std::vector<vector<float,2> > from_points, to_points;
-            to_points.push_back(rect.tl_corner()); from_points.push_back(point(0,0));
-            to_points.push_back(rect.tr_corner()); from_points.push_back(point(1,0));
-            to_points.push_back(rect.br_corner()); from_points.push_back(point(1,1));
-            return find_affine_transform(from_points, to_points);
+            // Three corners pin the transform down exactly, so it is written out
+            // rather than fitted.
+            const dpoint tl = rect.tl_corner();
+            const dpoint tr = rect.tr_corner();
+            const dpoint br = rect.br_corner();
+            matrix<double,2,2> m;
+            m = tr.x()-tl.x(), br.x()-tr.x(),
+                tr.y()-tl.y(), br.y()-tr.y();
+            return point_transform_affine(m, tl);
         }
 
     // ------------------------------------------------------------------------------------
@@ -282,6 +325,21 @@ namespace dlib
 
     } // end namespace impl
 
+// ----------------------------------------------------------------------------------------
+
+    class shape_predictor_workspace
+    {
+    public:
+        shape_predictor_workspace (
+        ) {}
+
+    private:
+        friend class shape_predictor;
+
+        matrix<float,0,1> current_shape;
+        std::vector<float> feature_pixel_values;
+    };
+
 // ----------------------------------------------------------------------------------------
 
     class shape_predictor
@@ -290,14 +348,58 @@ namespace dlib
 
 
         shape_predictor (
-        ) 
+        ) : levels_ready(0)
+        {}
+
+        shape_predictor (
+            const shape_predictor& item
+        ) : initial_shape(item.initial_shape), forests(item.forests),
+            anchor_idx(item.anchor_idx), deltas(item.deltas),
+            levels_ready(item.levels_ready.load())
+        {}
+
+        shape_predictor& operator= (
+            const shape_predictor& item
+        )
+        {
+            if (this != &item)
+            {
+                initial_shape = item.initial_shape;
+                forests = item.forests;
+                anchor_idx = item.anchor_idx;
+                deltas = item.deltas;
+                levels_ready = item.levels_ready.load();
+            }
+            return *this;
+        }
+
+        shape_predictor (
+            shape_predictor&& item
+        ) : initial_shape(std::move(item.initial_shape)), forests(std::move(item.forests)),
+            anchor_idx(std::move(item.anchor_idx)), deltas(std::move(item.deltas)),
+            levels_ready(item.levels_ready.exchange(0))
         {}
 
+        shape_predictor& operator= (
+            shape_predictor&& item
+        )
+        {
+            if (this != &item)
+            {
+                initial_shape = std::move(item.initial_shape);
+                forests = std::move(item.forests);
+                anchor_idx = std::move(item.anchor_idx);
+                deltas = std::move(item.deltas);
+                levels_ready = item.levels_ready.exchange(0);
+            }
+            return *this;
+        }
+
         shape_predictor (
             const matrix<float,0,1>& initial_shape_,
             const std::vector<std::vector<impl::regression_tree> >& forests_,
             const std::vector<std::vector<dlib::vector<float,2> > >& pixel_coordinates
-        ) : initial_shape(initial_shape_), forests(forests_)
+        ) : initial_shape(initial_shape_), forests(forests_), levels_ready(forests_.size())
         /*!
             requires
                 - initial_shape.size()%2 == 0
@@ -325,6 +427,18 @@ namespace dlib
             return initial_shape.size()/2;
         }
 
+        unsigned long num_levels (
+        ) const
+        {
+            return forests.size();
+        }
+
+        unsigned long num_levels_loaded (
+        ) const
+        {
+            return levels_ready.load(std::memory_order_acquire);
+        }
+
         unsigned long num_features (
         ) const
         {
@@ -340,26 +454,56 @@ namespace dlib
             const image_type& img,
             const rectangle& rect
         ) const
+        {
+            shape_predictor_workspace ws;
+            full_object_detection det;
+            (*this)(img, rect, ws, det);
+            return det;
+        }
+
+        template <typename image_type>
+        void operator()(
+            const image_type& img,
+            const rectangle& rect,
+            shape_predictor_workspace& ws,
+            point* parts
+        ) const
         {
             using namespace impl;
-            matrix<float,0,1> current_shape = initial_shape;
-            std::vector<float> feature_pixel_values;
-            for (unsigned long iter = 0; iter < forests.size(); ++iter)
+            matrix<float,0,1>& current_shape = ws.current_shape;
+            current_shape = initial_shape;
+            const unsigned long levels = num_levels_loaded();
+            for (unsigned long iter = 0; iter < levels; ++iter)
             {
                 extract_feature_pixel_values(img, rect, current_shape, initial_shape,
-                                             anchor_idx[iter], deltas[iter], feature_pixel_values);
+                                             anchor_idx[iter], deltas[iter], ws.feature_pixel_values);
                 unsigned long leaf_idx;
                 // evaluate all the trees at this level of the cascade.
                 for (unsigned long i = 0; i < forests[iter].size(); ++i)
-                    current_shape += forests[iter][i](feature_pixel_values, leaf_idx);
+                    current_shape += forests[iter][i](ws.feature_pixel_values, leaf_idx);
             }
 
-            // convert the current_shape into a full_object_detection
             const point_transform_affine tform_to_img = unnormalizing_tform(rect);
-            std::vector<point> parts(current_shape.size()/2);
-            for (unsigned long i = 0; i < parts.size(); ++i)
+            const unsigned long num = current_shape.size()/2;
+            for (unsigned long i = 0; i < num; ++i)
                 parts[i] = tform_to_img(location(current_shape, i));
-            return full_object_detection(rect, parts);
+        }
+
+        template <typename image_type>
+        void operator()(
+            const image_type& img,
+            const rectangle& rect,
+            shape_predictor_workspace& ws,
+            full_object_detection& det
+        ) const
+        {
+            // Only reshape det when it has the wrong number of parts, so reusing the
+            // same object for every call doesn't touch the heap.
+            if (det.num_parts() != num_parts())
+                det = full_object_detection(rect, std::vector<point>(num_parts()));
+            det.get_rect() = rect;
+            if (num_parts() != 0)
+                (*this)(img, rect, ws, &det.part(0));
         }
 
         template <typename image_type, typename T, typename U>
@@ -374,7 +518,8 @@ namespace dlib
             matrix<float,0,1> current_shape = initial_shape;
             std::vector<float> feature_pixel_values;
             unsigned long feat_offset = 0;
-            for (unsigned long iter = 0; iter < forests.size(); ++iter)
+            const unsigned long levels = num_levels_loaded();
+            for (unsigned long iter = 0; iter < levels; ++iter)
             {
                 extract_feature_pixel_values(img, rect, current_shape, initial_shape,
                                              anchor_idx[iter], deltas[iter], feature_pixel_values);
@@ -397,15 +542,96 @@ namespace dlib
             return full_object_detection(rect, parts);
         }
 
+        template <typename image_array>
+        friend void predict_shapes (
+            const shape_predictor& sp,
+            thread_pool& tp,
+            const image_array& images,
+            const std::vector<std::vector<rectangle> >& rects,
+            std::vector<std::vector<full_object_detection> >& dets
+        );
+
         friend void serialize (const shape_predictor& item, std::ostream& out);
 
         friend void deserialize (shape_predictor& item, std::istream& in);
 
+        template <typename level_callback>
+        friend void deserialize_progressively (
+            shape_predictor& item,
+            std::istream& in,
+            level_callback level_loaded
+        );
+
+        friend void serialize_bulk (const shape_predictor& item, std::ostream& out);
+
     private:
+
+        // How many objects predict_shapes() pushes through each tree together.
+        static const unsigned long batch_size = 8;
+
+        template <typename image_array>
+        void predict_batch (
+            const image_array& images,
+            const std::pair<unsigned long,unsigned long>* jobs,
+            unsigned long num,
+            const std::vector<std::vector<rectangle> >& rects,
+            shape_predictor_workspace* ws,
+            std::vector<std::vector<full_object_detection> >& dets
+        ) const
+        /*!
+            requires
+                - num <= batch_size
+                - jobs[j] == (image index, rectangle index) of the j-th object
+            ensures
+                - for all j < num: dets[jobs[j].first][jobs[j].second] is the shape of
+                  that object, computed exactly as operator() would.  The objects go
+                  through every tree one after another, so each tree is read once for
+                  the whole batch instead of once per object.
+        !*/
+        {
+            using namespace impl;
+            for (unsigned long j = 0; j < num; ++j)
+                ws[j].current_shape = initial_shape;
+
+            const unsigned long levels = num_levels_loaded();
+            for (unsigned long iter = 0; iter < levels; ++iter)
+            {
+                for (unsigned long j = 0; j < num; ++j)
+                {
+                    extract_feature_pixel_values(images[jobs[j].first], rects[jobs[j].first][jobs[j].second],
+                                                 ws[j].current_shape, initial_shape,
+                                                 anchor_idx[iter], deltas[iter], ws[j].feature_pixel_values);
+                }
+                unsigned long leaf_idx;
+                for (unsigned long i = 0; i < forests[iter].size(); ++i)
+                {
+                    for (unsigned long j = 0; j < num; ++j)
+                        ws[j].current_shape += forests[iter][i](ws[j].feature_pixel_values, leaf_idx);
+                }
+            }
+
+            for (unsigned long j = 0; j < num; ++j)
+            {
+                const rectangle& rect = rects[jobs[j].first][jobs[j].second];
+                full_object_detection& det = dets[jobs[j].first][jobs[j].second];
+                const point_transform_affine tform_to_img = unnormalizing_tform(rect);
+                const unsigned long num_parts = ws[j].current_shape.size()/2;
+                std::vector<point> parts(num_parts);
+                for (unsigned long i = 0; i < num_parts; ++i)
+                    parts[i] = tform_to_img(location(ws[j].current_shape, i));
+                det = full_object_detection(rect, parts);
+            }
+        }
+
         matrix<float,0,1> initial_shape;
         std::vector<std::vector<impl::regression_tree> > forests;
         std::vector<std::vector<unsigned long> > anchor_idx; 
         std::vector<std::vector<dlib::vector<float,2> > > deltas;
+
+        // The number of cascade levels prediction runs through.  Only levels below it
+        // are complete, so deserialize_progressively() can fill in the others while
+        // predictions are being made.
+        std::atomic<unsigned long> levels_ready;
     };
 
     inline void serialize (const shape_predictor& item, std::ostream& out)
@@ -418,16 +644,229 @@ namespace dlib
         dlib::serialize(item.deltas, out);
     }
 
-    inline void deserialize (shape_predictor& item, std::istream& in)
+    inline void serialize_bulk (const shape_predictor& item, std::ostream& out)
+    {
+        // Version 2 stores each cascade level as a handful of bulk arrays: the pixel
+        // anchors and deltas, then the split and leaf counts of every tree, and then all
+        // the splits and leaves of the level back to back.  Indices are stored as 32 bit
+        // numbers so the file reads the same on 32 and 64 bit platforms.
+        int version = 2;
+        dlib::serialize(version, out);
+        serialize_bulk(item.initial_shape, out);
+        const unsigned long leaf_size = item.initial_shape.size();
+        dlib::serialize(item.forests.size(), out);
+
+        std::vector<uint32> idx1, idx2, split_counts, leaf_counts;
+        std::vector<float> values;
+        for (unsigned long c = 0; c < item.forests.size(); ++c)
+        {
+            idx1.assign(item.anchor_idx[c].begin(), item.anchor_idx[c].end());
+            serialize_bulk(idx1, out);
+            values.resize(item.deltas[c].size()*2);
+            for (unsigned long i = 0; i < item.deltas[c].size(); ++i)
+            {
+                values[2*i] = item.deltas[c][i].x();
+                values[2*i+1] = item.deltas[c][i].y();
+            }
+            serialize_bulk(values, out);
+
+            const std::vector<impl::regression_tree>& forest = item.forests[c];
+            split_counts.resize(forest.size());
+            leaf_counts.resize(forest.size());
+            idx1.clear();
+            idx2.clear();
+            values.clear();
+            for (unsigned long t = 0; t < forest.size(); ++t)
+            {
+                split_counts[t] = forest[t].splits.size();
+                leaf_counts[t] = forest[t].leaf_values.size();
+                for (unsigned long i = 0; i < forest[t].splits.size(); ++i)
+                {
+                    idx1.push_back(forest[t].splits[i].idx1);
+                    idx2.push_back(forest[t].splits[i].idx2);
+                    values.push_back(forest[t].splits[i].thresh);
+                }
+            }
+            serialize_bulk(split_counts, out);
+            serialize_bulk(leaf_counts, out);
+            serialize_bulk(idx1, out);
+            serialize_bulk(idx2, out);
+            serialize_bulk(values, out);
+
+            values.clear();
+            for (unsigned long t = 0; t < forest.size(); ++t)
+            {
+                for (unsigned long i = 0; i < forest[t].leaf_values.size(); ++i)
+                {
+                    const matrix<float,0,1>& leaf = forest[t].leaf_values[i];
+                    if ((unsigned long)leaf.size() != leaf_size)
+                        throw serialization_error("Error while serializing dlib::shape_predictor.  Leaf and shape sizes differ.");
+                    values.insert(values.end(), leaf.begin(), leaf.end());
+                }
+            }
+            serialize_bulk(values, out);
+        }
+    }
+
+    template <typename level_callback>
+    void deserialize_progressively (
+        shape_predictor& item,
+        std::istream& in,
+        level_callback level_loaded
+    )
     {
+        item.levels_ready.store(0, std::memory_order_relaxed);
         int version = 0;
         dlib::deserialize(version, in);
-        if (version != 1)
+        if (version == 1)
+        {
+            // The pixel coordinates of every level come after all the trees in this
+            // version, so nothing can be used before the end of the file.
+            dlib::deserialize(item.initial_shape, in);
+            dlib::deserialize(item.forests, in);
+            dlib::deserialize(item.anchor_idx, in);
+            dlib::deserialize(item.deltas, in);
+            if (item.anchor_idx.size() != item.forests.size() || item.deltas.size() != item.forests.size())
+                throw serialization_error("Error while deserializing dlib::shape_predictor.  Inconsistent number of levels.");
+            item.levels_ready.store(item.forests.size(), std::memory_order_release);
+            level_loaded(item.forests.size());
+            return;
+        }
+        if (version != 2)
             throw serialization_error("Unexpected version found while deserializing dlib::shape_predictor.");
-        dlib::deserialize(item.initial_shape, in);
-        dlib::deserialize(item.forests, in);
-        dlib::deserialize(item.anchor_idx, in);
-        dlib::deserialize(item.deltas, in);
+
+        deserialize_bulk(item.initial_shape, in);
+        const unsigned long leaf_size = item.initial_shape.size();
+        unsigned long num_levels;
+        dlib::deserialize(num_levels, in);
+        item.forests.resize(num_levels);
+        item.anchor_idx.resize(num_levels);
+        item.deltas.resize(num_levels);
+
+        std::vector<uint32> idx1, idx2, split_counts, leaf_counts;
+        std::vector<float> values;
+        for (unsigned long c = 0; c < num_levels; ++c)
+        {
+            deserialize_bulk(idx1, in);
+            item.anchor_idx[c].assign(idx1.begin(), idx1.end());
+            deserialize_bulk(values, in);
+            if (values.size() != 2*idx1.size())
+                throw serialization_error("Error while deserializing dlib::shape_predictor.  Anchors and deltas differ in size.");
+            item.deltas[c].resize(idx1.size());
+            for (unsigned long i = 0; i < idx1.size(); ++i)
+                item.deltas[c][i] = dlib::vector<float,2>(values[2*i], values[2*i+1]);
+
+            deserialize_bulk(split_counts, in);
+            deserialize_bulk(leaf_counts, in);
+            deserialize_bulk(idx1, in);
+            deserialize_bulk(idx2, in);
+            deserialize_bulk(values, in);
+            unsigned long num_splits = 0, num_leaves = 0;
+            for (unsigned long t = 0; t < split_counts.size(); ++t)
+                num_splits += split_counts[t];
+            for (unsigned long t = 0; t < leaf_counts.size(); ++t)
+                num_leaves += leaf_counts[t];
+            if (leaf_counts.size() != split_counts.size() || idx1.size() != num_splits ||
+                idx2.size() != num_splits || values.size() != num_splits)
+                throw serialization_error("Error while deserializing dlib::shape_predictor.  Inconsistent tree sizes.");
+
+            std::vector<impl::regression_tree>& forest = item.forests[c];
+            forest.resize(split_counts.size());
+            unsigned long k = 0;
+            for (unsigned long t = 0; t < forest.size(); ++t)
+            {
+                forest[t].splits.resize(split_counts[t]);
+                for (unsigned long i = 0; i < forest[t].splits.size(); ++i, ++k)
+                {
+                    forest[t].splits[i].idx1 = idx1[k];
+                    forest[t].splits[i].idx2 = idx2[k];
+                    forest[t].splits[i].thresh = values[k];
+                }
+            }
+
+            deserialize_bulk(values, in);
+            if (values.size() != num_leaves*leaf_size)
+                throw serialization_error("Error while deserializing dlib::shape_predictor.  Inconsistent leaf sizes.");
+            const float* leaf_data = values.size() != 0 ? &values[0] : 0;
+            for (unsigned long t = 0; t < forest.size(); ++t)
+            {
+                forest[t].leaf_values.resize(leaf_counts[t]);
+                for (unsigned long i = 0; i < forest[t].leaf_values.size(); ++i)
+                {
+                    matrix<float,0,1>& leaf = forest[t].leaf_values[i];
+                    leaf.set_size(leaf_size);
+                    std::copy(leaf_data, leaf_data + leaf_size, leaf.begin());
+                    leaf_data += leaf_size;
+                }
+            }
+
+            // level c is complete and is never written again
+            item.levels_ready.store(c+1, std::memory_order_release);
+            level_loaded(c+1);
+        }
+    }
+
+    inline void deserialize (shape_predictor& item, std::istream& in)
+    {
+        deserialize_progressively(item, in, [](unsigned long){});
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_array
+        >
+    void predict_shapes (
+        const shape_predictor& sp,
+        thread_pool& tp,
+        const image_array& images,
+        const std::vector<std::vector<rectangle> >& rects,
+        std::vector<std::vector<full_object_detection> >& dets
+    )
+    {
+        DLIB_ASSERT(images.size() == rects.size(),
+            "\t void predict_shapes()"
+            << "\n\t Invalid inputs were given to this function. "
+            << "\n\t images.size(): " << images.size() 
+            << "\n\t rects.size():  " << rects.size() 
+        );
+
+        std::vector<std::pair<unsigned long,unsigned long> > jobs;
+        dets.resize(rects.size());
+        for (unsigned long i = 0; i < rects.size(); ++i)
+        {
+            dets[i].resize(rects[i].size());
+            for (unsigned long j = 0; j < rects[i].size(); ++j)
+                jobs.push_back(std::make_pair(i,j));
+        }
+
+        const unsigned long batch_size = shape_predictor::batch_size;
+        const long num_batches = (jobs.size() + batch_size - 1)/batch_size;
+        parallel_for_blocked(tp, 0, num_batches, [&](long begin, long end)
+        {
+            shape_predictor_workspace ws[batch_size];
+            for (long b = begin; b < end; ++b)
+            {
+                const unsigned long first = b*batch_size;
+                const unsigned long num = std::min<unsigned long>(batch_size, jobs.size()-first);
+                sp.predict_batch(images, &jobs[first], num, rects, ws, dets);
+            }
+        });
+    }
+
+    template <
+        typename image_array
+        >
+    void predict_shapes (
+        const shape_predictor& sp,
+        unsigned long num_threads,
+        const image_array& images,
+        const std::vector<std::vector<rectangle> >& rects,
+        std::vector<std::vector<full_object_detection> >& dets
+    )
+    {
+        thread_pool tp(num_threads);
+        predict_shapes(sp, tp, images, rects, dets);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -477,6 +916,17 @@ namespace dlib
         }
 #endif
 
+        // Predict everything up front on all the cores, then score in the original
+        // order so the result doesn't depend on the thread count.
+        std::vector<std::vector<rectangle> > rects(objects.size());
+        for (unsigned long i = 0; i < objects.size(); ++i)
+        {
+            for (unsigned long j = 0; j < objects[i].size(); ++j)
+                rects[i].push_back(objects[i][j].get_rect());
+        }
+        std::vector<std::vector<full_object_detection> > dets;
+        predict_shapes(sp, default_thread_pool(), images, rects, dets);
+
         running_stats<double> rs;
         for (unsigned long i = 0; i < objects.size(); ++i)
         {
@@ -486,7 +936,7 @@ namespace dlib
                 // any scales.
                 const double scale = scales.size()==0 ? 1 : scales[i][j]; 
 
-                full_object_detection det = sp(images[i], objects[i][j].get_rect());
+                const full_object_detection& det = dets[i][j];
 
                 for (unsigned long k = 0; k < det.num_parts(); ++k)
                 {
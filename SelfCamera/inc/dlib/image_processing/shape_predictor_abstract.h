@@ -11,6 +11,31 @@
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    class shape_predictor_workspace
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object holds the scratch memory a shape_predictor needs while it
+                runs.  Passing the same workspace to every call lets the predictor reuse
+                that memory instead of allocating it again for each object.
+
+            THREAD SAFETY
+                A workspace must not be used by more than one thread at a time.  Give
+                each thread its own.
+        !*/
+
+    public:
+
+        shape_predictor_workspace (
+        );
+        /*!
+            ensures
+                - this object is properly initialized
+        !*/
+    };
+
 // ----------------------------------------------------------------------------------------
 
     class shape_predictor
@@ -32,7 +57,9 @@ namespace dlib
             THREAD SAFETY
                 No synchronization is required when using this object.  In particular, a
                 single instance of this object can be used from multiple threads at the
-                same time.  
+                same time.  This includes predicting with it while
+                deserialize_progressively() is loading it, once the first level has been
+                announced.
         !*/
 
     public:
@@ -43,6 +70,34 @@ namespace dlib
             ensures
                 - #num_parts() == 0
                 - #num_features() == 0
+                - #num_levels() == 0
+        !*/
+
+        shape_predictor (
+            const shape_predictor& item
+        );
+        shape_predictor& operator= (
+            const shape_predictor& item
+        );
+        /*!
+            requires
+                - item is not being loaded by deserialize_progressively()
+            ensures
+                - copies item, including how many of its levels are loaded
+        !*/
+
+        shape_predictor (
+            shape_predictor&& item
+        );
+        shape_predictor& operator= (
+            shape_predictor&& item
+        );
+        /*!
+            requires
+                - item is not being loaded by deserialize_progressively()
+            ensures
+                - moves the model out of item without copying its trees
+                - #item.num_levels_loaded() == 0
         !*/
 
         unsigned long num_parts (
@@ -52,6 +107,24 @@ namespace dlib
                 - returns the number of parts in the shapes predicted by this object.
         !*/
 
+        unsigned long num_levels (
+        ) const;
+        /*!
+            ensures
+                - returns the number of cascade levels in this object.
+        !*/
+
+        unsigned long num_levels_loaded (
+        ) const;
+        /*!
+            ensures
+                - returns how many of the cascade levels the predictions of this object go
+                  through.  Each level refines the shape of the previous one, so fewer
+                  levels give a coarser but still valid shape.
+                - This is num_levels() unless deserialize_progressively() is still
+                  loading this object.
+        !*/
+
         unsigned long num_features (
         ) const;
         /*!
@@ -111,12 +184,140 @@ namespace dlib
                   where the 3d argument is discarded.
         !*/
 
+        template <typename image_type>
+        void operator()(
+            const image_type& img,
+            const rectangle& rect,
+            shape_predictor_workspace& ws,
+            full_object_detection& det
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+            ensures
+                - #det == (*this)(img, rect)
+                - If det.num_parts() == num_parts() and ws has been used with this object
+                  before then this function does not allocate any memory.
+        !*/
+
+        template <typename image_type>
+        void operator()(
+            const image_type& img,
+            const rectangle& rect,
+            shape_predictor_workspace& ws,
+            point* parts
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+                - parts points to an array of at least num_parts() elements.
+            ensures
+                - for all i < num_parts():
+                    - #parts[i] == (*this)(img, rect).part(i)
+                - If ws has been used with this object before then this function does
+                  not allocate any memory.
+        !*/
+
     };
 
     void serialize (const shape_predictor& item, std::ostream& out);
     void deserialize (shape_predictor& item, std::istream& in);
     /*!
-        provides serialization support
+        provides serialization support.  deserialize() reads both the format written by
+        serialize() and the one written by serialize_bulk().  Only an object with all its
+        levels loaded can be serialized.
+    !*/
+
+    template <typename level_callback>
+    void deserialize_progressively (
+        shape_predictor& item,
+        std::istream& in,
+        level_callback level_loaded
+    );
+    /*!
+        requires
+            - level_loaded is a function object callable as level_loaded(unsigned long)
+            - item is not used by any other thread until the first call to level_loaded.
+        ensures
+            - does what deserialize() does, but makes each cascade level usable as soon
+              as it has been read: after level n is read, item.num_levels_loaded() == n
+              and level_loaded(n) is called from the calling thread.  From the first call
+              on, other threads may make predictions with item while the rest of the
+              levels load.  Every prediction runs through the levels that were loaded
+              when it started.
+            - A model written by serialize() only becomes usable at the end of the
+              file, since its pixel coordinates are stored after all the trees.
+              level_loaded() is then called once with the total number of levels.
+              Models written by serialize_bulk() announce one level at a time.
+        throws
+            - serialization_error
+                Levels announced before the error stay valid and usable.
+    !*/
+
+    void serialize_bulk (const shape_predictor& item, std::ostream& out);
+    /*!
+        ensures
+            - writes item to out in a newer format that stores the trees of each cascade
+              level as a few bulk arrays (see the BULK ARRAY SERIALIZATION FORMAT in
+              dlib/serialize.h), so that deserialize() can load it with a few large reads
+              instead of one small read per number.  The result is also about a third
+              smaller.
+            - Older versions of dlib can't read this format, which is why serialize()
+              doesn't use it.
+        throws
+            - serialization_error
+                if the leaves of item are not all the size of the shape.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_array
+        >
+    void predict_shapes (
+        const shape_predictor& sp,
+        thread_pool& tp,
+        const image_array& images,
+        const std::vector<std::vector<rectangle> >& rects,
+        std::vector<std::vector<full_object_detection> >& dets
+    );
+    /*!
+        requires
+            - image_array is a dlib::array of image objects where each image object
+              implements the interface defined in dlib/image_processing/generic_image.h 
+            - images.size() == rects.size()
+        ensures
+            - Runs sp on every rectangle of every image using the threads in tp.
+            - #dets.size() == rects.size()
+            - for all valid i and j:
+                - #dets[i][j] == sp(images[i], rects[i][j])
+                  The results are exactly the same as calling sp one object at a time,
+                  whatever the number of threads.
+            - Objects are evaluated in small batches that walk each regression tree
+              together, which keeps the trees in cache.  So this is faster than calling
+              sp in a loop even with a single thread.
+    !*/
+
+    template <
+        typename image_array
+        >
+    void predict_shapes (
+        const shape_predictor& sp,
+        unsigned long num_threads,
+        const image_array& images,
+        const std::vector<std::vector<rectangle> >& rects,
+        std::vector<std::vector<full_object_detection> >& dets
+    );
+    /*!
+        requires
+            - image_array is a dlib::array of image objects where each image object
+              implements the interface defined in dlib/image_processing/generic_image.h 
+            - images.size() == rects.size()
+        ensures
+            - performs: predict_shapes(sp, tp, images, rects, dets) where tp is a
+              thread_pool with num_threads threads.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -154,6 +355,8 @@ namespace dlib
               and compare the result with the truth part positions in objects[i][j].  We
               then return the average distance (measured in pixels) between a predicted
               part location and its true position.  
+            - The predictions are made with predict_shapes() on default_thread_pool(), so
+              all the cores are used, and the result is the same as a serial run.
             - Note that any parts in objects that are set to OBJECT_PART_NOT_PRESENT are
               simply ignored.
             - if (scales.size() != 0) then
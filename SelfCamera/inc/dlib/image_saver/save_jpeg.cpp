@@ -8,9 +8,11 @@
 
 #include "../array2d.h"
 #include "../pixel.h"
+#include "../threads.h"
 #include "save_jpeg.h"
 #include <stdio.h>
 #include <sstream>
+#include <vector>
 #include <setjmp.h>
 #include "image_saver.h"
 
@@ -40,6 +42,218 @@ namespace dlib
         longjmp(myerr->setjmp_buffer, 1);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    // A destination manager that collects the compressed data in a std::vector, which
+    // is grown by doubling as libjpeg fills it.
+    struct jpeg_saver_vector_dest
+    {
+        jpeg_destination_mgr pub;
+        std::vector<unsigned char>* buf;
+    };
+
+    void jpeg_saver_init_destination (j_compress_ptr cinfo)
+    {
+        jpeg_saver_vector_dest* dest = (jpeg_saver_vector_dest*) cinfo->dest;
+        dest->pub.next_output_byte = (JOCTET*) &(*dest->buf)[0];
+        dest->pub.free_in_buffer = dest->buf->size();
+    }
+
+    int jpeg_saver_empty_output_buffer (j_compress_ptr cinfo)
+    {
+        jpeg_saver_vector_dest* dest = (jpeg_saver_vector_dest*) cinfo->dest;
+        const size_t used = dest->buf->size();
+        dest->buf->resize(used*2);
+        dest->pub.next_output_byte = (JOCTET*) &(*dest->buf)[used];
+        dest->pub.free_in_buffer = dest->buf->size() - used;
+        return TRUE;
+    }
+
+    void jpeg_saver_term_destination (j_compress_ptr cinfo)
+    {
+        jpeg_saver_vector_dest* dest = (jpeg_saver_vector_dest*) cinfo->dest;
+        dest->buf->resize(dest->buf->size() - dest->pub.free_in_buffer);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    bool jpeg_saver_encode_band (
+        const JSAMPROW* rows,
+        long num_rows,
+        long nc,
+        int components,
+        J_COLOR_SPACE color_space,
+        int quality,
+        unsigned int restart_interval,
+        std::vector<unsigned char>& out
+    )
+    /*!
+        ensures
+            - compresses the num_rows rows in rows[] into out as a complete JPEG file,
+              the same way save_jpeg() does but with the given restart interval.
+            - returns false if libjpeg reported an error.
+    !*/
+    {
+        jpeg_compress_struct cinfo;
+        jpeg_saver_vector_dest dest;
+
+        jpeg_saver_error_mgr jerr;
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = jpeg_saver_error_exit;
+        if (setjmp(jerr.setjmp_buffer)) 
+        {
+            jpeg_destroy_compress(&cinfo);
+            return false;
+        }
+
+        jpeg_create_compress(&cinfo);
+        out.resize(std::max<size_t>(4096, num_rows*nc*components/4));
+        dest.buf = &out;
+        dest.pub.init_destination = jpeg_saver_init_destination;
+        dest.pub.empty_output_buffer = jpeg_saver_empty_output_buffer;
+        dest.pub.term_destination = jpeg_saver_term_destination;
+        cinfo.dest = &dest.pub;
+
+        cinfo.image_width      = nc;
+        cinfo.image_height     = num_rows;
+        cinfo.input_components = components;
+        cinfo.in_color_space   = color_space;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality (&cinfo, quality, TRUE);
+        cinfo.restart_interval = restart_interval;
+        jpeg_start_compress(&cinfo, TRUE);
+        jpeg_write_scanlines(&cinfo, (JSAMPARRAY) rows, num_rows);
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+        return true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void save_jpeg_bands (
+        const std::vector<JSAMPROW>& rows,
+        long nc,
+        int components,
+        J_COLOR_SPACE color_space,
+        const std::string& filename,
+        int quality,
+        thread_pool& tp
+    )
+    /*!
+        ensures
+            - writes the image made of the given rows to filename with save_jpeg()'s
+              settings, cutting it into one horizontal band per thread in tp.
+              Every band is a whole number of MCU rows and is compressed on its own,
+              as one restart interval, so the bands only have to be put back together
+              with an RSTn marker between each pair.  The file is exactly what a
+              single threaded encode with that restart interval writes.
+    !*/
+    {
+        const long nr = rows.size();
+        // Each band checks only its own height, so check the whole image here.
+        if (nr > JPEG_MAX_DIMENSION)
+            throw image_save_error("save_jpeg: " + filename + " would be too tall for a JPEG file");
+
+        // The MCU a scan with these settings uses.  jpeg_set_defaults() samples
+        // chroma at 2x2, and a one component scan isn't interleaved, so its MCU is a
+        // single block.
+        jpeg_compress_struct cinfo;
+        jpeg_saver_error_mgr jerr;
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = jpeg_saver_error_exit;
+        if (setjmp(jerr.setjmp_buffer)) 
+        {
+            jpeg_destroy_compress(&cinfo);
+            throw image_save_error("save_jpeg: error while writing " + filename);
+        }
+        jpeg_create_compress(&cinfo);
+        cinfo.input_components = components;
+        cinfo.in_color_space   = color_space;
+        jpeg_set_defaults(&cinfo);
+        int max_h = 1, max_v = 1;
+        if (cinfo.num_components > 1)
+        {
+            for (int ci = 0; ci < cinfo.num_components; ++ci)
+            {
+                max_h = std::max(max_h, cinfo.comp_info[ci].h_samp_factor);
+                max_v = std::max(max_v, cinfo.comp_info[ci].v_samp_factor);
+            }
+        }
+        jpeg_destroy_compress(&cinfo);
+        const long mcu_width = max_h*DCTSIZE;
+        const long mcu_height = max_v*DCTSIZE;
+        const long mcus_per_row = (nc + mcu_width - 1)/mcu_width;
+        const long mcu_rows = (nr + mcu_height - 1)/mcu_height;
+
+        // DRI only has 16 bits, so very wide images may need more bands than threads.
+        const long num_threads = std::max(1L, (long) tp.num_threads_in_pool());
+        long band_mcu_rows = (mcu_rows + num_threads - 1)/num_threads;
+        band_mcu_rows = std::min(band_mcu_rows, std::max(1L, 65535/mcus_per_row));
+        const long num_bands = (mcu_rows + band_mcu_rows - 1)/band_mcu_rows;
+        const long band_rows = band_mcu_rows*mcu_height;
+        const unsigned int restart_interval = num_bands > 1 ? band_mcu_rows*mcus_per_row : 0;
+
+        std::vector<std::vector<unsigned char> > bands(num_bands);
+        std::vector<char> ok(num_bands);
+        parallel_for(tp, 0, num_bands, [&](long i)
+        {
+            const long first = i*band_rows;
+            ok[i] = jpeg_saver_encode_band(&rows[first], std::min(band_rows, nr-first), nc,
+                                           components, color_space, quality,
+                                           restart_interval, bands[i]);
+        });
+        for (long i = 0; i < num_bands; ++i)
+        {
+            if (!ok[i])
+                throw image_save_error("save_jpeg: error while writing " + filename);
+        }
+
+        // Walk the markers of the first band up to the end of its SOS segment, putting
+        // the full image height into its frame header on the way.  The entropy coded
+        // data of every band then runs from the end of its headers to its EOI.
+        std::vector<unsigned long> data_start(num_bands);
+        for (long i = 0; i < num_bands; ++i)
+        {
+            std::vector<unsigned char>& buf = bands[i];
+            unsigned long pos = 2;
+            while (pos + 4 <= buf.size() && buf[pos] == 0xFF)
+            {
+                const int marker = buf[pos+1];
+                const unsigned long length = (buf[pos+2] << 8) | buf[pos+3];
+                if (i == 0 && marker >= 0xC0 && marker <= 0xCF &&
+                    marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+                {
+                    buf[pos+5] = (unsigned char) (nr >> 8);
+                    buf[pos+6] = (unsigned char) nr;
+                }
+                pos += 2 + length;
+                if (marker == 0xDA)
+                    break;
+            }
+            data_start[i] = pos;
+        }
+
+        FILE* outfile = fopen(filename.c_str(), "wb");
+        if (!outfile)
+            throw image_save_error("Can't open file " + filename + " for writing.");
+
+        bool written = fwrite(&bands[0][0], 1, data_start[0], outfile) == data_start[0];
+        for (long i = 0; i < num_bands && written; ++i)
+        {
+            if (i > 0)
+            {
+                const unsigned char rst[2] = { 0xFF, (unsigned char) (JPEG_RST0 + (i-1)%8) };
+                written = fwrite(rst, 1, 2, outfile) == 2;
+            }
+            const unsigned long length = bands[i].size() - 2 - data_start[i];
+            written = written && fwrite(&bands[i][data_start[i]], 1, length, outfile) == length;
+        }
+        const unsigned char eoi[2] = { 0xFF, JPEG_EOI };
+        written = written && fwrite(eoi, 1, 2, outfile) == 2;
+        if (fclose(outfile) != 0 || !written)
+            throw image_save_error("save_jpeg: error while writing " + filename);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     void save_jpeg (
@@ -163,6 +377,58 @@ namespace dlib
         fclose( outfile );
     }
 
+// ----------------------------------------------------------------------------------------
+
+    void save_jpeg (
+        const array2d<rgb_pixel>& img,
+        const std::string& filename,
+        int quality,
+        thread_pool& tp
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_CASSERT(img.size() != 0,
+            "\t save_jpeg()"
+            << "\n\t You can't save an empty image as a JPEG."
+            );
+        DLIB_CASSERT(0 <= quality && quality <= 100,
+            "\t save_jpeg()"
+            << "\n\t Invalid quality value."
+            << "\n\t quality: " << quality
+            );
+
+        std::vector<JSAMPROW> rows(img.nr());
+        for (long r = 0; r < img.nr(); ++r)
+            rows[r] = (JSAMPROW) &img[r][0];
+        save_jpeg_bands(rows, img.nc(), 3, JCS_RGB, filename, quality, tp);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    void save_jpeg (
+        const array2d<unsigned char>& img,
+        const std::string& filename,
+        int quality,
+        thread_pool& tp
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_CASSERT(img.size() != 0,
+            "\t save_jpeg()"
+            << "\n\t You can't save an empty image as a JPEG."
+            );
+        DLIB_CASSERT(0 <= quality && quality <= 100,
+            "\t save_jpeg()"
+            << "\n\t Invalid quality value."
+            << "\n\t quality: " << quality
+            );
+
+        std::vector<JSAMPROW> rows(img.nr());
+        for (long r = 0; r < img.nr(); ++r)
+            rows[r] = (JSAMPROW) &img[r][0];
+        save_jpeg_bands(rows, img.nc(), 1, JCS_GRAYSCALE, filename, quality, tp);
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
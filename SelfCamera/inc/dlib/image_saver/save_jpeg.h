@@ -15,6 +15,8 @@
 namespace dlib
 {
 
+    class thread_pool;
+
 // ----------------------------------------------------------------------------------------
 
     void save_jpeg (
@@ -23,6 +25,15 @@ namespace dlib
         int quality = 75
     );
 
+// ----------------------------------------------------------------------------------------
+
+    void save_jpeg (
+        const array2d<rgb_pixel>& img,
+        const std::string& filename,
+        int quality,
+        thread_pool& tp
+    );
+
 // ----------------------------------------------------------------------------------------
 
     void save_jpeg (
@@ -31,6 +42,15 @@ namespace dlib
         int quality = 75
     );
 
+// ----------------------------------------------------------------------------------------
+
+    void save_jpeg (
+        const array2d<unsigned char>& img,
+        const std::string& filename,
+        int quality,
+        thread_pool& tp
+    );
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -58,6 +78,32 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type
+        >
+    typename disable_if<is_matrix<image_type> >::type save_jpeg(
+        const image_type& img,
+        const std::string& filename,
+        int quality,
+        thread_pool& tp
+    )
+    {
+        if (pixel_traits<typename image_traits<image_type>::pixel_type>::grayscale)
+        {
+            array2d<unsigned char> temp;
+            assign_image(temp, img);
+            save_jpeg(temp, filename, quality, tp);
+        }
+        else
+        {
+            array2d<rgb_pixel> temp;
+            assign_image(temp, img);
+            save_jpeg(temp, filename, quality, tp);
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -74,6 +120,23 @@ namespace dlib
         save_jpeg(temp, file_name, quality);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename EXP 
+        >
+    void save_jpeg(
+        const matrix_exp<EXP>& img,
+        const std::string& file_name,
+        int quality,
+        thread_pool& tp
+    )
+    {
+        array2d<typename EXP::type> temp;
+        assign_image(temp, img);
+        save_jpeg(temp, file_name, quality, tp);
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
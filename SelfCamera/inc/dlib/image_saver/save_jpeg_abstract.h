@@ -44,6 +44,43 @@ namespace dlib
             - std::bad_alloc 
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type
+        >
+    void save_jpeg (
+        const image_type& img,
+        const std::string& filename,
+        int quality,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - image_type == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h or a matrix expression
+            - image.size() != 0
+            - 0 <= quality <= 100
+        ensures
+            - writes the image to file_name just like save_jpeg(img,filename,quality)
+              except that the compression is spread over the threads in tp.  The image
+              is cut into one horizontal band per thread, each a whole number of MCU
+              rows, and every band is compressed on its own as a single restart
+              interval.  So the file has a DRI marker and an RSTn marker between
+              bands, which every JPEG decoder handles, and is a few bytes larger than
+              the single threaded one.  It is the same file a single threaded encoder
+              writes with that restart interval.
+            - If tp has no threads, or the image is a single MCU row, the file is
+              exactly the one save_jpeg(img,filename,quality) writes.
+            - The bands are chosen from the image size and tp.num_threads_in_pool()
+              alone, so the same image and pool size always give the same file.
+        throws
+            - image_save_error
+                This exception is thrown if there is an error that prevents us from saving 
+                the image.  
+            - std::bad_alloc 
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
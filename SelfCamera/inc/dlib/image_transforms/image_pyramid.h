@@ -8,6 +8,8 @@
 #include "../array2d.h"
 #include "../geometry.h"
 #include "spatial_filtering.h"
+#include "image_pyramid_u8.h"
+#include "../threads/parallel_for_extension.h"
 
 namespace dlib
 {
@@ -127,6 +129,19 @@ namespace dlib
             set_image_size(down, 0, 0);
         }
 
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& original,
+            out_image_type& down,
+            thread_pool&
+        ) const
+        {
+            (*this)(original, down);
+        }
+
         template <
             typename image_type
             >
@@ -237,13 +252,28 @@ namespace dlib
                 typedef typename image_traits<U>::pixel_type U_pix;
                 const static bool value = pixel_traits<T_pix>::rgb && pixel_traits<U_pix>::rgb;
             };
+
+            template <typename T, typename U>
+            struct both_images_u8
+            {
+                typedef typename image_traits<T>::pixel_type T_pix;
+                typedef typename image_traits<U>::pixel_type U_pix;
+                const static bool value = is_same_type<T_pix,unsigned char>::value &&
+                                          is_same_type<U_pix,unsigned char>::value;
+            };
+
+            template <typename T, typename U>
+            struct generic_grayscale
+            {
+                const static bool value = !both_images_rgb<T,U>::value && !both_images_u8<T,U>::value;
+            };
         public:
 
             template <
                 typename in_image_type,
                 typename out_image_type
                 >
-            typename disable_if<both_images_rgb<in_image_type,out_image_type> >::type operator() (
+            typename enable_if<generic_grayscale<in_image_type,out_image_type> >::type operator() (
                 const in_image_type& original_,
                 out_image_type& down_
             ) const
@@ -465,6 +495,47 @@ namespace dlib
 
             }
 
+        // ------------------------------------------
+        //       OVERLOAD FOR UNSIGNED CHAR IMAGES
+        // ------------------------------------------
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<both_images_u8<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original_,
+                out_image_type& down_
+            ) const
+            {
+                down_u8(original_, down_, 0);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<both_images_u8<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original_,
+                out_image_type& down_,
+                thread_pool& tp
+            ) const
+            {
+                down_u8(original_, down_, &tp);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename disable_if<both_images_u8<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original_,
+                out_image_type& down_,
+                thread_pool&
+            ) const
+            {
+                (*this)(original_, down_);
+            }
+
             template <
                 typename image_type
                 >
@@ -479,6 +550,51 @@ namespace dlib
 
         private:
 
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            void down_u8 (
+                const in_image_type& original_,
+                out_image_type& down_,
+                thread_pool* tp
+            ) const
+            {
+                // make sure requires clause is not broken
+                DLIB_ASSERT( is_same_object(original_, down_) == false, 
+                            "\t void pyramid_down_2_1::operator()"
+                            << "\n\t is_same_object(original_, down_): " << is_same_object(original_, down_) 
+                            << "\n\t this:                           " << this
+                            );
+
+                const_image_view<in_image_type> original(original_);
+                image_view<out_image_type> down(down_);
+
+                if (original.nr() <= 8 || original.nc() <= 8)
+                {
+                    down.clear();
+                    return;
+                }
+
+                down.set_size((original.nr()-3)/2, (original.nc()-3)/2);
+
+                const unsigned char* in = static_cast<const unsigned char*>(image_data(original_));
+                const long in_width_step = width_step(original_);
+                const long in_nc = original.nc();
+                unsigned char* out = static_cast<unsigned char*>(image_data(down_));
+                const long out_width_step = width_step(down_);
+                auto rows = [&](long begin, long end)
+                {
+                    impl::pyramid_down_2_1_u8(in, in_width_step, in_nc, out, out_width_step, begin, end);
+                };
+
+                // Every output row is independent of the others, so bands of them can go to
+                // different threads.  Small images aren't worth splitting.
+                if (tp && down.nr()*down.nc() >= 32*1024)
+                    parallel_for_blocked(*tp, 0, down.nr(), rows, 2);
+                else
+                    rows(0, down.nr());
+            }
 
         };
 
@@ -578,13 +694,28 @@ namespace dlib
                 typedef typename image_traits<U>::pixel_type U_pix;
                 const static bool value = pixel_traits<T_pix>::rgb && pixel_traits<U_pix>::rgb;
             };
+
+            template <typename T, typename U>
+            struct both_images_u8
+            {
+                typedef typename image_traits<T>::pixel_type T_pix;
+                typedef typename image_traits<U>::pixel_type U_pix;
+                const static bool value = is_same_type<T_pix,unsigned char>::value &&
+                                          is_same_type<U_pix,unsigned char>::value;
+            };
+
+            template <typename T, typename U>
+            struct generic_grayscale
+            {
+                const static bool value = !both_images_rgb<T,U>::value && !both_images_u8<T,U>::value;
+            };
         public:
 
             template <
                 typename in_image_type,
                 typename out_image_type
                 >
-            typename disable_if<both_images_rgb<in_image_type,out_image_type> >::type operator() (
+            typename enable_if<generic_grayscale<in_image_type,out_image_type> >::type operator() (
                 const in_image_type& original_,
                 out_image_type& down_
             ) const
@@ -810,6 +941,47 @@ namespace dlib
                 }
             }
 
+        // ------------------------------------------
+        //       OVERLOAD FOR UNSIGNED CHAR IMAGES
+        // ------------------------------------------
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<both_images_u8<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original_,
+                out_image_type& down_
+            ) const
+            {
+                down_u8(original_, down_, 0);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<both_images_u8<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original_,
+                out_image_type& down_,
+                thread_pool& tp
+            ) const
+            {
+                down_u8(original_, down_, &tp);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename disable_if<both_images_u8<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original_,
+                out_image_type& down_,
+                thread_pool&
+            ) const
+            {
+                (*this)(original_, down_);
+            }
+
             template <
                 typename image_type
                 >
@@ -821,8 +993,54 @@ namespace dlib
                 (*this)(img, temp);
                 swap(temp, img);
             }
+
         private:
 
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            void down_u8 (
+                const in_image_type& original_,
+                out_image_type& down_,
+                thread_pool* tp
+            ) const
+            {
+                // make sure requires clause is not broken
+                DLIB_ASSERT( is_same_object(original_, down_) == false, 
+                            "\t void pyramid_down_3_2::operator()"
+                            << "\n\t is_same_object(original_, down_): " << is_same_object(original_, down_) 
+                            << "\n\t this:                           " << this
+                            );
+
+                const_image_view<in_image_type> original(original_);
+                image_view<out_image_type> down(down_);
+
+                if (original.nr() <= 8 || original.nc() <= 8)
+                {
+                    down.clear();
+                    return;
+                }
+
+                down.set_size((2*(original.nr()-2))/3, (2*(original.nc()-2))/3);
+
+                const unsigned char* in = static_cast<const unsigned char*>(image_data(original_));
+                const long in_width_step = width_step(original_);
+                const long in_nc = original.nc();
+                unsigned char* out = static_cast<unsigned char*>(image_data(down_));
+                const long out_width_step = width_step(down_);
+                auto rows = [&](long begin, long end)
+                {
+                    impl::pyramid_down_3_2_u8(in, in_width_step, in_nc, out, out_width_step, begin, end);
+                };
+
+                // Every output row is independent of the others, so bands of them can go to
+                // different threads.  Small images aren't worth splitting.
+                if (tp && down.nr()*down.nc() >= 32*1024)
+                    parallel_for_blocked(*tp, 0, down.nr(), rows, 2);
+                else
+                    rows(0, down.nr());
+            }
 
         };
 
@@ -945,6 +1163,19 @@ namespace dlib
             resize_image(original, down);
         }
 
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& original,
+            out_image_type& down,
+            thread_pool&
+        ) const
+        {
+            (*this)(original, down);
+        }
+
         template <
             typename image_type
             >
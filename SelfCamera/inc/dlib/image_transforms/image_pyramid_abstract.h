@@ -7,6 +7,7 @@
 #include "../array2d.h"
 #include "../geometry.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -61,8 +62,31 @@ namespace dlib
                   be in color.  Otherwise, the downsampling will be performed in a grayscale mode.
                 - The location of a point P in original image will show up at point point_down(P)
                   in the #down image.  
-                - Note that some points on the border of the original image might correspond to 
-                  points outside the #down image.  
+                - Note that some points on the border of the original image might correspond to
+                  points outside the #down image.
+                - When N is 2 or 3 and both images contain unsigned char pixels this uses
+                  an integer SIMD implementation (SSE2/SSSE3/AVX2 or NEON, whatever the
+                  build enables) whose output is identical to the generic code's.
+        !*/
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& original,
+            out_image_type& down,
+            thread_pool& tp
+        ) const;
+        /*!
+            requires
+                - same as (*this)(original, down)
+            ensures
+                - performs (*this)(original, down), giving exactly the same #down.
+                - When N is 2 or 3, both images contain unsigned char pixels and the
+                  output is big enough to be worth it, the rows of #down are split into
+                  bands that are computed on tp's threads.  Otherwise this is just the
+                  serial call.
         !*/
 
         template <
@@ -0,0 +1,429 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_IMAGE_PYRAMID_U8_Hh_
+#define DLIB_IMAGE_PYRAMID_U8_Hh_
+
+#include "../algs.h"
+#include "../array2d.h"
+#include "../simd/simd_check.h"
+
+namespace dlib
+{
+    namespace impl
+    {
+
+    /*
+        These are the versions of pyramid_down<2> and pyramid_down<3> used when both
+        images are grayscale unsigned char images.  They work on rows of raw pixels, so
+        the SSE2, SSSE3, AVX2 and NEON code can do 8 to 32 pixels at a time, and on a
+        range of output rows, so the rows can be split between threads.  The output is
+        exactly the same as the generic code gives, since every intermediate value fits
+        in the 16 or 32 bit integers used here and the final division is the same.
+
+        pyramid_down<2> filters with [1 4 6 4 1] both ways, keeps every other row and
+        column and divides by 256.  The horizontal sums are at most 16*255 and the
+        vertical ones 16*16*255 = 65280, so everything fits in a uint16.
+
+        pyramid_down<3> filters with [2 12 2] both ways and then bilinearly interpolates
+        each 3x3 block down to 2x2, dividing by 16*256 at the end.  Folding the
+        interpolation into the filter turns it into a separable 4 tap filter, with the
+        taps [3 19 9 1] for even output rows and columns, which start on input row and
+        column 3*(r/2), and [1 9 19 3] for odd ones, which start one further on.  The
+        sum is then 4 times smaller than the generic code's, so it is divided by 1024.
+        The horizontal sums are at most 32*255 and are kept in uint16, the vertical
+        ones are done in 32 bits.
+    */
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void pyramid_down_2_1_row_u8 (
+            const unsigned char* in,
+            long in_nc,
+            uint16* out,
+            long nc
+        )
+        /*!
+            requires
+                - in points to in_nc pixels
+                - nc == (in_nc-3)/2
+            ensures
+                - out[c] == in[2c] + 4*in[2c+1] + 6*in[2c+2] + 4*in[2c+3] + in[2c+4]
+                  for all 0 <= c < nc
+        !*/
+        {
+            long c = 0;
+#if defined(DLIB_HAVE_NEON)
+            for (; c + 16 <= nc && 2*c + 36 <= in_nc; c += 16)
+            {
+                const uint8x16x2_t a = vld2q_u8(in + 2*c);
+                const uint8x16x2_t b = vld2q_u8(in + 2*c + 2);
+                const uint8x16x2_t d = vld2q_u8(in + 2*c + 4);
+                const uint8x8_t six = vdup_n_u8(6);
+
+                uint16x8_t lo = vaddl_u8(vget_low_u8(a.val[0]), vget_low_u8(d.val[0]));
+                lo = vaddq_u16(lo, vshlq_n_u16(vaddl_u8(vget_low_u8(a.val[1]), vget_low_u8(b.val[1])), 2));
+                lo = vmlal_u8(lo, vget_low_u8(b.val[0]), six);
+
+                uint16x8_t hi = vaddl_u8(vget_high_u8(a.val[0]), vget_high_u8(d.val[0]));
+                hi = vaddq_u16(hi, vshlq_n_u16(vaddl_u8(vget_high_u8(a.val[1]), vget_high_u8(b.val[1])), 2));
+                hi = vmlal_u8(hi, vget_high_u8(b.val[0]), six);
+
+                vst1q_u16(out + c, lo);
+                vst1q_u16(out + c + 8, hi);
+            }
+#elif defined(DLIB_HAVE_AVX2)
+            const __m256i even = _mm256_set1_epi16(0x00ff);
+            for (; c + 16 <= nc && 2*c + 36 <= in_nc; c += 16)
+            {
+                const __m256i a = _mm256_loadu_si256((const __m256i*)(in + 2*c));
+                const __m256i b = _mm256_loadu_si256((const __m256i*)(in + 2*c + 2));
+                const __m256i d = _mm256_loadu_si256((const __m256i*)(in + 2*c + 4));
+                const __m256i b2 = _mm256_slli_epi16(_mm256_and_si256(b, even), 1);
+
+                __m256i s = _mm256_add_epi16(_mm256_and_si256(a, even), _mm256_and_si256(d, even));
+                s = _mm256_add_epi16(s, _mm256_slli_epi16(_mm256_add_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), 2));
+                s = _mm256_add_epi16(s, _mm256_add_epi16(b2, _mm256_slli_epi16(b2, 1)));
+                _mm256_storeu_si256((__m256i*)(out + c), s);
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            const __m128i even = _mm_set1_epi16(0x00ff);
+            for (; c + 8 <= nc && 2*c + 20 <= in_nc; c += 8)
+            {
+                const __m128i a = _mm_loadu_si128((const __m128i*)(in + 2*c));
+                const __m128i b = _mm_loadu_si128((const __m128i*)(in + 2*c + 2));
+                const __m128i d = _mm_loadu_si128((const __m128i*)(in + 2*c + 4));
+                const __m128i b2 = _mm_slli_epi16(_mm_and_si128(b, even), 1);
+
+                __m128i s = _mm_add_epi16(_mm_and_si128(a, even), _mm_and_si128(d, even));
+                s = _mm_add_epi16(s, _mm_slli_epi16(_mm_add_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)), 2));
+                s = _mm_add_epi16(s, _mm_add_epi16(b2, _mm_slli_epi16(b2, 1)));
+                _mm_storeu_si128((__m128i*)(out + c), s);
+            }
+#endif
+            for (; c < nc; ++c)
+            {
+                const unsigned char* p = in + 2*c;
+                out[c] = p[0] + 4*(p[1] + p[3]) + 6*p[2] + p[4];
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void pyramid_down_2_1_column_u8 (
+            const uint16* const (&rows)[5],
+            unsigned char* out,
+            long nc
+        )
+        /*!
+            ensures
+                - out[c] == (rows[0][c] + 4*rows[1][c] + 6*rows[2][c] + 4*rows[3][c] +
+                  rows[4][c])/256 for all 0 <= c < nc
+        !*/
+        {
+            long c = 0;
+#if defined(DLIB_HAVE_NEON)
+            for (; c + 8 <= nc; c += 8)
+            {
+                uint16x8_t s = vaddq_u16(vld1q_u16(rows[0] + c), vld1q_u16(rows[4] + c));
+                s = vaddq_u16(s, vshlq_n_u16(vaddq_u16(vld1q_u16(rows[1] + c), vld1q_u16(rows[3] + c)), 2));
+                s = vmlaq_n_u16(s, vld1q_u16(rows[2] + c), 6);
+                vst1_u8(out + c, vshrn_n_u16(s, 8));
+            }
+#elif defined(DLIB_HAVE_AVX2)
+            for (; c + 32 <= nc; c += 32)
+            {
+                __m256i s[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    const long k = c + 16*i;
+                    const __m256i r2 = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)(rows[2] + k)), 1);
+                    s[i] = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(rows[0] + k)),
+                                            _mm256_loadu_si256((const __m256i*)(rows[4] + k)));
+                    s[i] = _mm256_add_epi16(s[i], _mm256_slli_epi16(_mm256_add_epi16(
+                                _mm256_loadu_si256((const __m256i*)(rows[1] + k)),
+                                _mm256_loadu_si256((const __m256i*)(rows[3] + k))), 2));
+                    s[i] = _mm256_srli_epi16(_mm256_add_epi16(s[i], _mm256_add_epi16(r2, _mm256_slli_epi16(r2, 1))), 8);
+                }
+                // packus works within each 128 bit lane, so put the quarters back in order
+                const __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(s[0], s[1]), 0xD8);
+                _mm256_storeu_si256((__m256i*)(out + c), p);
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            for (; c + 16 <= nc; c += 16)
+            {
+                __m128i s[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    const long k = c + 8*i;
+                    const __m128i r2 = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(rows[2] + k)), 1);
+                    s[i] = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(rows[0] + k)),
+                                         _mm_loadu_si128((const __m128i*)(rows[4] + k)));
+                    s[i] = _mm_add_epi16(s[i], _mm_slli_epi16(_mm_add_epi16(
+                                _mm_loadu_si128((const __m128i*)(rows[1] + k)),
+                                _mm_loadu_si128((const __m128i*)(rows[3] + k))), 2));
+                    s[i] = _mm_srli_epi16(_mm_add_epi16(s[i], _mm_add_epi16(r2, _mm_slli_epi16(r2, 1))), 8);
+                }
+                _mm_storeu_si128((__m128i*)(out + c), _mm_packus_epi16(s[0], s[1]));
+            }
+#endif
+            for (; c < nc; ++c)
+            {
+                const unsigned int s = rows[0][c] + 4*(rows[1][c] + rows[3][c]) + 6*rows[2][c] + rows[4][c];
+                out[c] = static_cast<unsigned char>(s/256);
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void pyramid_down_2_1_u8 (
+            const unsigned char* in,
+            long in_width_step,
+            long in_nc,
+            unsigned char* out,
+            long out_width_step,
+            long begin,
+            long end
+        )
+        /*!
+            requires
+                - in is an image with more than 8 columns and at least 2*end+3 rows
+                - out is an image with (in_nc-3)/2 columns
+            ensures
+                - computes rows begin through end-1 of pyramid_down<2> applied to in
+        !*/
+        {
+            const long nc = (in_nc-3)/2;
+
+            // The last 5 filtered input rows, input row y is in ring row y%5.
+            array2d<uint16> ring(5, nc);
+            long next = 2*begin;
+            for (long r = begin; r < end; ++r)
+            {
+                for (; next <= 2*r+4; ++next)
+                    pyramid_down_2_1_row_u8(in + next*in_width_step, in_nc, &ring[next%5][0], nc);
+
+                const uint16* const rows[5] = {
+                    &ring[(2*r)%5][0], &ring[(2*r+1)%5][0], &ring[(2*r+2)%5][0],
+                    &ring[(2*r+3)%5][0], &ring[(2*r+4)%5][0] };
+                pyramid_down_2_1_column_u8(rows, out + r*out_width_step, nc);
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void pyramid_down_3_2_row_u8 (
+            const unsigned char* in,
+            uint16* out,
+            long nc
+        )
+        /*!
+            requires
+                - in points to at least (3*nc+1)/2 + 2 pixels, which holds for a row
+                  of in_nc pixels when nc == (2*(in_nc-2))/3
+            ensures
+                - for all 0 <= k with 2k < nc:
+                    - out[2k] == 3*in[3k] + 19*in[3k+1] + 9*in[3k+2] + in[3k+3]
+                - for all 0 <= k with 2k+1 < nc:
+                    - out[2k+1] == in[3k+1] + 9*in[3k+2] + 19*in[3k+3] + 3*in[3k+4]
+        !*/
+        {
+            long c = 0;
+#if defined(DLIB_HAVE_NEON)
+            // the pixels the requires clause promises, which bound the vector loads
+            const long in_nc = (3*nc + 1)/2 + 2;
+            // vld3 splits 24 pixels into the three phases, and vst2 interleaves the even
+            // and odd outputs again.
+            for (; c + 16 <= nc && 3*(c/2) + 27 <= in_nc; c += 16)
+            {
+                const uint8x8x3_t x = vld3_u8(in + 3*(c/2));
+                const uint8x8x3_t y = vld3_u8(in + 3*(c/2) + 3);
+
+                uint16x8x2_t s;
+                s.val[0] = vmull_u8(x.val[0], vdup_n_u8(3));
+                s.val[0] = vmlal_u8(s.val[0], x.val[1], vdup_n_u8(19));
+                s.val[0] = vmlal_u8(s.val[0], x.val[2], vdup_n_u8(9));
+                s.val[0] = vaddw_u8(s.val[0], y.val[0]);
+
+                s.val[1] = vmovl_u8(x.val[1]);
+                s.val[1] = vmlal_u8(s.val[1], x.val[2], vdup_n_u8(9));
+                s.val[1] = vmlal_u8(s.val[1], y.val[0], vdup_n_u8(19));
+                s.val[1] = vmlal_u8(s.val[1], y.val[1], vdup_n_u8(3));
+                vst2q_u16(out + c, s);
+            }
+#elif defined(DLIB_HAVE_SSE3)
+            const long in_nc = (3*nc + 1)/2 + 2;
+            // pshufb gathers the first and last two taps of 8 outputs, then pmaddubsw
+            // multiplies them by their weights and adds the pairs.
+            const __m128i first = _mm_setr_epi8(0,1, 1,2, 3,4, 4,5, 6,7, 7,8, 9,10, 10,11);
+            const __m128i last  = _mm_setr_epi8(2,3, 3,4, 5,6, 6,7, 8,9, 9,10, 11,12, 12,13);
+            const __m128i first_w = _mm_setr_epi8(3,19, 1,9, 3,19, 1,9, 3,19, 1,9, 3,19, 1,9);
+            const __m128i last_w  = _mm_setr_epi8(9,1, 19,3, 9,1, 19,3, 9,1, 19,3, 9,1, 19,3);
+#if defined(DLIB_HAVE_AVX2)
+            const __m256i first2 = _mm256_broadcastsi128_si256(first);
+            const __m256i last2 = _mm256_broadcastsi128_si256(last);
+            const __m256i first_w2 = _mm256_broadcastsi128_si256(first_w);
+            const __m256i last_w2 = _mm256_broadcastsi128_si256(last_w);
+            for (; c + 16 <= nc && 3*(c/2) + 28 <= in_nc; c += 16)
+            {
+                // pshufb doesn't cross the 128 bit lanes, so give each lane its own 12
+                // pixels.
+                const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                        _mm_loadu_si128((const __m128i*)(in + 3*(c/2)))),
+                        _mm_loadu_si128((const __m128i*)(in + 3*(c/2) + 12)), 1);
+                const __m256i s = _mm256_add_epi16(
+                    _mm256_maddubs_epi16(_mm256_shuffle_epi8(v, first2), first_w2),
+                    _mm256_maddubs_epi16(_mm256_shuffle_epi8(v, last2), last_w2));
+                _mm256_storeu_si256((__m256i*)(out + c), s);
+            }
+#endif
+            for (; c + 8 <= nc && 3*(c/2) + 16 <= in_nc; c += 8)
+            {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(in + 3*(c/2)));
+                const __m128i s = _mm_add_epi16(
+                    _mm_maddubs_epi16(_mm_shuffle_epi8(v, first), first_w),
+                    _mm_maddubs_epi16(_mm_shuffle_epi8(v, last), last_w));
+                _mm_storeu_si128((__m128i*)(out + c), s);
+            }
+#endif
+            for (; c + 2 <= nc; c += 2)
+            {
+                const unsigned char* p = in + 3*(c/2);
+                out[c]   = 3*p[0] + 19*p[1] + 9*p[2] + p[3];
+                out[c+1] = p[1] + 9*p[2] + 19*p[3] + 3*p[4];
+            }
+            if (c < nc)
+            {
+                const unsigned char* p = in + 3*(c/2);
+                out[c] = 3*p[0] + 19*p[1] + 9*p[2] + p[3];
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void pyramid_down_3_2_column_u8 (
+            const uint16* const (&rows)[4],
+            const unsigned int (&w)[4],
+            unsigned char* out,
+            long nc
+        )
+        /*!
+            requires
+                - every value in rows is at most 32*255
+                - w is [3 19 9 1] or [1 9 19 3]
+            ensures
+                - out[c] == (w[0]*rows[0][c] + w[1]*rows[1][c] + w[2]*rows[2][c] +
+                  w[3]*rows[3][c])/1024 for all 0 <= c < nc
+        !*/
+        {
+            long c = 0;
+#if defined(DLIB_HAVE_NEON)
+            for (; c + 8 <= nc; c += 8)
+            {
+                uint16x8_t r[4];
+                for (int i = 0; i < 4; ++i)
+                    r[i] = vld1q_u16(rows[i] + c);
+                uint32x4_t lo = vmull_n_u16(vget_low_u16(r[0]), w[0]);
+                uint32x4_t hi = vmull_n_u16(vget_high_u16(r[0]), w[0]);
+                for (int i = 1; i < 4; ++i)
+                {
+                    lo = vmlal_n_u16(lo, vget_low_u16(r[i]), w[i]);
+                    hi = vmlal_n_u16(hi, vget_high_u16(r[i]), w[i]);
+                }
+                vst1_u8(out + c, vmovn_u16(vcombine_u16(vshrn_n_u32(lo, 10), vshrn_n_u32(hi, 10))));
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            // The values fit in an int16, so pmaddwd can multiply interleaved pairs of
+            // rows by pairs of weights and add them in 32 bits.
+            const __m128i w01 = _mm_set1_epi32(w[0] | (w[1]<<16));
+            const __m128i w23 = _mm_set1_epi32(w[2] | (w[3]<<16));
+#if defined(DLIB_HAVE_AVX2)
+            const __m256i w01_2 = _mm256_set1_epi32(w[0] | (w[1]<<16));
+            const __m256i w23_2 = _mm256_set1_epi32(w[2] | (w[3]<<16));
+            for (; c + 16 <= nc; c += 16)
+            {
+                const __m256i r0 = _mm256_loadu_si256((const __m256i*)(rows[0] + c));
+                const __m256i r1 = _mm256_loadu_si256((const __m256i*)(rows[1] + c));
+                const __m256i r2 = _mm256_loadu_si256((const __m256i*)(rows[2] + c));
+                const __m256i r3 = _mm256_loadu_si256((const __m256i*)(rows[3] + c));
+                const __m256i lo = _mm256_srli_epi32(_mm256_add_epi32(
+                    _mm256_madd_epi16(_mm256_unpacklo_epi16(r0, r1), w01_2),
+                    _mm256_madd_epi16(_mm256_unpacklo_epi16(r2, r3), w23_2)), 10);
+                const __m256i hi = _mm256_srli_epi32(_mm256_add_epi32(
+                    _mm256_madd_epi16(_mm256_unpackhi_epi16(r0, r1), w01_2),
+                    _mm256_madd_epi16(_mm256_unpackhi_epi16(r2, r3), w23_2)), 10);
+                // unpack and pack both work within 128 bit lanes, so after packs the
+                // 16 values are in order, and packus leaves them in the even quarters.
+                const __m256i p = _mm256_packus_epi16(_mm256_packs_epi32(lo, hi), _mm256_setzero_si256());
+                _mm_storeu_si128((__m128i*)(out + c),
+                    _mm256_castsi256_si128(_mm256_permute4x64_epi64(p, 0x08)));
+            }
+#endif
+            for (; c + 8 <= nc; c += 8)
+            {
+                const __m128i r0 = _mm_loadu_si128((const __m128i*)(rows[0] + c));
+                const __m128i r1 = _mm_loadu_si128((const __m128i*)(rows[1] + c));
+                const __m128i r2 = _mm_loadu_si128((const __m128i*)(rows[2] + c));
+                const __m128i r3 = _mm_loadu_si128((const __m128i*)(rows[3] + c));
+                const __m128i lo = _mm_srli_epi32(_mm_add_epi32(
+                    _mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), w01),
+                    _mm_madd_epi16(_mm_unpacklo_epi16(r2, r3), w23)), 10);
+                const __m128i hi = _mm_srli_epi32(_mm_add_epi32(
+                    _mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), w01),
+                    _mm_madd_epi16(_mm_unpackhi_epi16(r2, r3), w23)), 10);
+                const __m128i p = _mm_packs_epi32(lo, hi);
+                _mm_storel_epi64((__m128i*)(out + c), _mm_packus_epi16(p, p));
+            }
+#endif
+            for (; c < nc; ++c)
+            {
+                const unsigned int s = w[0]*rows[0][c] + w[1]*rows[1][c] + w[2]*rows[2][c] + w[3]*rows[3][c];
+                out[c] = static_cast<unsigned char>(s/1024);
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void pyramid_down_3_2_u8 (
+            const unsigned char* in,
+            long in_width_step,
+            long in_nc,
+            unsigned char* out,
+            long out_width_step,
+            long begin,
+            long end
+        )
+        /*!
+            requires
+                - in is an image with more than 8 columns and enough rows for output row
+                  end-1, i.e. 3*((end-1)/2) + (end-1)%2 + 4 rows
+                - out is an image with (2*(in_nc-2))/3 columns
+            ensures
+                - computes rows begin through end-1 of pyramid_down<3> applied to in
+        !*/
+        {
+            const long nc = (2*(in_nc-2))/3;
+            const unsigned int even_w[4] = {3, 19, 9, 1};
+            const unsigned int odd_w[4] = {1, 9, 19, 3};
+
+            // Each output row uses 4 consecutive filtered input rows, input row y is in
+            // ring row y%4.
+            array2d<uint16> ring(4, nc);
+            long next = 3*(begin/2) + (begin&1);
+            for (long r = begin; r < end; ++r)
+            {
+                const long y = 3*(r/2) + (r&1);
+                for (; next <= y+3; ++next)
+                    pyramid_down_3_2_row_u8(in + next*in_width_step, &ring[next%4][0], nc);
+
+                const uint16* const rows[4] = {
+                    &ring[y%4][0], &ring[(y+1)%4][0], &ring[(y+2)%4][0], &ring[(y+3)%4][0] };
+                pyramid_down_3_2_column_u8(rows, (r&1) ? odd_w : even_w, out + r*out_width_step, nc);
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+    }
+}
+
+#endif // DLIB_IMAGE_PYRAMID_U8_Hh_
+
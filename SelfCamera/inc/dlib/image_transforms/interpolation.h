@@ -8,6 +8,7 @@
 #include "../matrix.h"
 #include "assign_image.h"
 #include "image_pyramid.h"
+#include "resize_u8.h"
 #include "../simd.h"
 #include "../image_processing/full_object_detection.h"
 #include <limits>
@@ -905,6 +906,69 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        inline fixed_point_resizer& cached_u8_resizer (
+            long in_nr,
+            long in_nc,
+            long out_nr,
+            long out_nc
+        )
+        /*!
+            ensures
+                - returns a bilinear fixed_point_resizer of the calling thread that was
+                  last used for these sizes, if there is one, so its tables don't have to
+                  be worked out again.  A few are kept so that a caller going through
+                  several sizes, like the levels of a pyramid, keeps all of them.
+        !*/
+        {
+            const int num = 4;
+            thread_local fixed_point_resizer resizers[num];
+            thread_local long sizes[num][4] = {{-1,-1,-1,-1},{-1,-1,-1,-1},{-1,-1,-1,-1},{-1,-1,-1,-1}};
+            thread_local int next = 0;
+
+            for (int i = 0; i < num; ++i)
+            {
+                if (sizes[i][0] == in_nr && sizes[i][1] == in_nc &&
+                    sizes[i][2] == out_nr && sizes[i][3] == out_nc)
+                    return resizers[i];
+            }
+
+            const int i = next;
+            next = (next+1)%num;
+            sizes[i][0] = in_nr;
+            sizes[i][1] = in_nc;
+            sizes[i][2] = out_nr;
+            sizes[i][3] = out_nc;
+            return resizers[i];
+        }
+    }
+
+    template <
+        typename image_type1,
+        typename image_type2
+        >
+    void resize_image_fixed_point (
+        const image_type1& in_img,
+        image_type2& out_img
+    )
+    {
+        COMPILE_TIME_ASSERT((is_same_type<typename image_traits<image_type1>::pixel_type, unsigned char>::value));
+        COMPILE_TIME_ASSERT((is_same_type<typename image_traits<image_type2>::pixel_type, unsigned char>::value));
+
+        // make sure requires clause is not broken
+        DLIB_ASSERT( is_same_object(in_img, out_img) == false ,
+            "\t void resize_image_fixed_point()"
+            << "\n\t Invalid inputs were given to this function."
+            << "\n\t is_same_object(in_img, out_img):  " << is_same_object(in_img, out_img)
+            );
+
+        impl::cached_u8_resizer(num_rows(in_img), num_columns(in_img),
+                                num_rows(out_img), num_columns(out_img))(in_img, out_img);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -6,6 +6,7 @@
 #include "../pixel.h"
 #include "../image_processing/full_object_detection_abstract.h"
 #include "../image_processing/generic_image.h"
+#include "resize_u8_abstract.h"
 
 namespace dlib
 {
@@ -386,6 +387,40 @@ namespace dlib
               pixel interpolation.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type1,
+        typename image_type2
+        >
+    void resize_image_fixed_point (
+        const image_type1& in_img,
+        image_type2& out_img
+    );
+    /*!
+        requires
+            - image_type1 == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h and has unsigned char pixels
+            - image_type2 == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h and has unsigned char pixels
+            - is_same_object(in_img, out_img) == false
+        ensures
+            - Does the same as resize_image(in_img, out_img, interpolate_bilinear()), but
+              in fixed point with a fixed_point_resizer (see
+              dlib/image_transforms/resize_u8_abstract.h), which is several times faster.
+            - The interpolated values are rounded rather than truncated, so each output
+              pixel is within 0.52 of the exact bilinear value.  The floating point code
+              of resize_image() truncates, and steps through the columns in single
+              precision, so on wide enlargements of sharp edges it drifts by up to about
+              5 from the exact value.  So the output usually differs from resize_image()
+              by at most 1, but can differ by up to 5 there.  resize_image() stays the
+              floating point code, so that anything tuned on its output, like the
+              pyramid_down<N> levels the object detectors are trained and run on, is
+              not changed.
+            - Each thread keeps the resizers of the last few sizes it used, so repeated
+              calls with the same sizes reuse their tables.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 
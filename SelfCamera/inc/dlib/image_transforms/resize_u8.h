@@ -0,0 +1,643 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_RESIZE_U8_Hh_
+#define DLIB_RESIZE_U8_Hh_
+
+#include "resize_u8_abstract.h"
+#include "../algs.h"
+#include "../array2d.h"
+#include "../image_processing/generic_image.h"
+#include "../simd/simd_check.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum resize_filter_type
+    {
+        resize_filter_bilinear,
+        resize_filter_area
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+
+    /*
+        These are the pieces of fixed_point_resizer.  Resizing is separable, so each output
+        pixel is a weighted sum of taps consecutive input pixels along a row, and each
+        output row a weighted sum of taps consecutive filtered rows.  The first input
+        pixel and the weights of every output column and row are worked out once, when the
+        sizes change, and the weights are kept as 14 bit fixed point numbers that add up
+        to exactly 1<<14.
+
+        The horizontal pass gives each filtered pixel with 7 fractional bits, at most
+        255<<7, so it fits in an int16 and the vertical sums, at most 255<<21, fit in 32
+        bits.  Both passes round to nearest.  The number of taps is always even, padded
+        with zero weights if need be, so the vector code can take the taps in pairs:
+        pmaddwd on x86 multiplies and adds a pair in one go, and on NEON vld2 and vuzp
+        split the pairs into two vectors.  Neither can avoid loading the horizontal taps
+        one output pixel at a time, since where they start depends on the scale, but the
+        arithmetic and the whole vertical pass run on 8 or 16 pixels at a time.
+
+        Interleaved images with 2 channels, such as the UV plane of an NV12 frame, are
+        filtered like single channel ones, with the pair of taps for one output pixel
+        loaded as 4 bytes and shuffled into a pair per channel.
+    */
+
+        const long resize_u8_weight_bits = 14;
+
+    // ----------------------------------------------------------------------------------------
+
+        inline long resize_u8_axis (
+            long in_n,
+            long out_n,
+            resize_filter_type filter,
+            std::vector<long>& start,
+            std::vector<int16>& weights
+        )
+        /*!
+            requires
+                - in_n > 0
+                - out_n > 0
+            ensures
+                - returns the number of taps, which is even
+                - for all 0 <= i < out_n:
+                    - output i is the sum over 0 <= k < taps of weights[i*taps+k] times
+                      input start[i]+k.  Taps past in_n-1 only exist if in_n < taps and
+                      have zero weights.
+                    - the weights of output i add up to 1<<resize_u8_weight_bits
+        !*/
+        {
+            const long one = 1<<resize_u8_weight_bits;
+
+            std::vector<long> first(out_n);
+            std::vector<std::vector<double> > w(out_n);
+            for (long i = 0; i < out_n; ++i)
+            {
+                if (filter == resize_filter_area && in_n > out_n)
+                {
+                    // Each output pixel is the average of the inputs it covers, the ones
+                    // at its ends counting as much as they are covered.
+                    const double scale = in_n/(double)out_n;
+                    const double x0 = i*scale;
+                    const double x1 = x0 + scale;
+                    first[i] = static_cast<long>(std::floor(x0));
+                    const long last = std::min(static_cast<long>(std::ceil(x1))-1, in_n-1);
+                    for (long p = first[i]; p <= last; ++p)
+                        w[i].push_back(std::max(0.0, std::min<double>(p+1, x1) - std::max<double>(p, x0))/scale);
+                }
+                else
+                {
+                    // resize_image() puts the first and last outputs on the first and last
+                    // inputs, the area filter enlarges with the pixel centres lined up.
+                    double x;
+                    if (filter == resize_filter_area)
+                        x = std::min<double>(std::max(0.0, (i+0.5)*in_n/out_n - 0.5), in_n-1);
+                    else
+                        x = i*((in_n-1)/(double)std::max<long>(out_n-1,1));
+                    first[i] = std::min(static_cast<long>(std::floor(x)), in_n-1);
+                    const double frac = x - first[i];
+                    w[i].push_back(1-frac);
+                    if (first[i]+1 < in_n)
+                        w[i].push_back(frac);
+                }
+            }
+
+            long taps = 2;
+            for (long i = 0; i < out_n; ++i)
+                taps = std::max<long>(taps, w[i].size());
+            taps += taps&1;
+
+            start.assign(out_n, 0);
+            weights.assign(out_n*taps, 0);
+            for (long i = 0; i < out_n; ++i)
+            {
+                start[i] = std::max<long>(0, std::min(first[i], in_n-taps));
+
+                // Round the running sum of the weights rather than each weight, so the
+                // rounding errors do not pile up over many taps and the weights add up
+                // to exactly one.
+                double total = 0;
+                for (unsigned long k = 0; k < w[i].size(); ++k)
+                    total += w[i][k];
+                double sum = 0;
+                long prev = 0;
+                int16* const q = &weights[i*taps + first[i]-start[i]];
+                for (unsigned long k = 0; k < w[i].size(); ++k)
+                {
+                    sum += w[i][k];
+                    const long next = static_cast<long>(std::floor(sum/total*one + 0.5));
+                    q[k] = static_cast<int16>(next - prev);
+                    prev = next;
+                }
+            }
+            return taps;
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void resize_u8_masks (
+            long in_n,
+            long channels,
+            long taps,
+            const std::vector<long>& start,
+            std::vector<unsigned char>& masks
+        )
+        /*!
+            requires
+                - start and taps come from resize_u8_axis(in_n, ...)
+            ensures
+                - The vector code in resize_u8_row() gathers the pairs of taps of 8/channels
+                  output pixels at a time, 16 bytes in all.  If all of them are in the 16
+                  bytes starting at the first, and those 16 bytes are inside the row for
+                  every pair of taps, they can be loaded at once and shuffled into place.
+                  So #masks holds 16 bytes for each such block of outputs, giving where in
+                  those 16 bytes each gathered byte is, or starting with 0x80 if the block
+                  has to be gathered one output at a time.
+        !*/
+        {
+            const long per = 8/channels;
+            const long blocks = start.size()/per;
+            masks.assign(blocks*16, 0);
+            for (long b = 0; b < blocks; ++b)
+            {
+                const long first = start[b*per];
+                unsigned char* const m = &masks[b*16];
+                if ((start[b*per+per-1] - first + 2)*channels > 16 ||
+                    (first + taps-2)*channels + 16 > in_n*channels)
+                {
+                    m[0] = 0x80;
+                    continue;
+                }
+                for (long j = 0; j < per; ++j)
+                {
+                    for (long t = 0; t < 2*channels; ++t)
+                        m[j*2*channels + t] = static_cast<unsigned char>((start[b*per+j] - first)*channels + t);
+                }
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+#if defined(DLIB_HAVE_NEON)
+        template <long channels>
+        inline uint8x16_t resize_u8_gather (
+            const unsigned char* p,
+            const long* start,
+            const unsigned char* mask
+        )
+        {
+            if (mask[0] != 0x80)
+            {
+                // vtbl2 rather than vqtbl1q so this builds for ARMv7 as well.
+                uint8x8x2_t t;
+                t.val[0] = vld1_u8(p + start[0]*channels);
+                t.val[1] = vld1_u8(p + start[0]*channels + 8);
+                return vcombine_u8(vtbl2_u8(t, vld1_u8(mask)), vtbl2_u8(t, vld1_u8(mask + 8)));
+            }
+            if (channels == 1)
+            {
+                uint16x8_t v = vdupq_n_u16(0);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[0]), v, 0);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[1]), v, 1);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[2]), v, 2);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[3]), v, 3);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[4]), v, 4);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[5]), v, 5);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[6]), v, 6);
+                v = vld1q_lane_u16((const uint16_t*)(p + start[7]), v, 7);
+                return vreinterpretq_u8_u16(v);
+            }
+            else
+            {
+                uint32x4_t v = vdupq_n_u32(0);
+                v = vld1q_lane_u32((const uint32_t*)(p + 2*start[0]), v, 0);
+                v = vld1q_lane_u32((const uint32_t*)(p + 2*start[1]), v, 1);
+                v = vld1q_lane_u32((const uint32_t*)(p + 2*start[2]), v, 2);
+                v = vld1q_lane_u32((const uint32_t*)(p + 2*start[3]), v, 3);
+                return vreinterpretq_u8_u32(v);
+            }
+        }
+#elif defined(DLIB_HAVE_SSE2)
+        inline int resize_u8_load2 (const unsigned char* p) { uint16 v; std::memcpy(&v, p, 2); return v; }
+        inline int resize_u8_load4 (const unsigned char* p) { int32 v; std::memcpy(&v, p, 4); return v; }
+
+        template <long channels>
+        inline __m128i resize_u8_gather (
+            const unsigned char* p,
+            const long* start,
+            const unsigned char* mask
+        )
+        {
+#if defined(DLIB_HAVE_SSE3)
+            if (mask[0] != 0x80)
+                return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + start[0]*channels)),
+                                        _mm_loadu_si128((const __m128i*)mask));
+#else
+            (void)mask;
+#endif
+            if (channels == 1)
+            {
+                __m128i v = _mm_cvtsi32_si128(resize_u8_load2(p + start[0]));
+                v = _mm_insert_epi16(v, resize_u8_load2(p + start[1]), 1);
+                v = _mm_insert_epi16(v, resize_u8_load2(p + start[2]), 2);
+                v = _mm_insert_epi16(v, resize_u8_load2(p + start[3]), 3);
+                v = _mm_insert_epi16(v, resize_u8_load2(p + start[4]), 4);
+                v = _mm_insert_epi16(v, resize_u8_load2(p + start[5]), 5);
+                v = _mm_insert_epi16(v, resize_u8_load2(p + start[6]), 6);
+                return _mm_insert_epi16(v, resize_u8_load2(p + start[7]), 7);
+            }
+            else
+            {
+                return _mm_set_epi32(resize_u8_load4(p + 2*start[3]), resize_u8_load4(p + 2*start[2]),
+                                     resize_u8_load4(p + 2*start[1]), resize_u8_load4(p + 2*start[0]));
+            }
+        }
+#endif
+
+        template <long channels>
+        inline void resize_u8_row (
+            const unsigned char* in,
+            long taps,
+            const long* start,
+            const int16* weights,
+            const unsigned char* masks,
+            int16* out,
+            long out_n
+        )
+        /*!
+            requires
+                - channels == 1 or 2
+                - in points to a row of pixels with channels interleaved values each, at
+                  least start[i]+taps of them for every 0 <= i < out_n
+                - weights holds the weights from resize_u8_axis() arranged as
+                  [taps/2][out_n][channels][2], so the pair of weights for taps 2k and
+                  2k+1 of channel c of output i is at ((k*out_n + i)*channels + c)*2.
+                - masks comes from resize_u8_masks()
+            ensures
+                - for all 0 <= i < out_n and 0 <= c < channels:
+                    - out[i*channels+c] == the sum over k of weight k of output i times
+                      in[(start[i]+k)*channels+c], divided by 1<<7 and rounded
+        !*/
+        {
+            const long pairs = taps/2;
+            const int32 round = 1<<(resize_u8_weight_bits-8);
+            const long per = 8/channels;
+            long i = 0;
+#if defined(DLIB_HAVE_NEON)
+            for (; i + per <= out_n; i += per)
+            {
+                int32x4_t lo = vdupq_n_s32(round);
+                int32x4_t hi = vdupq_n_s32(round);
+                for (long k = 0; k < pairs; ++k)
+                {
+                    const uint8x16_t v = resize_u8_gather<channels>(in + 2*k*channels, start + i, masks + 2*channels*i);
+                    int16x8_t a, b;
+                    if (channels == 1)
+                    {
+                        const uint8x16x2_t ab = vuzpq_u8(v, v);
+                        a = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(ab.val[0])));
+                        b = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(ab.val[1])));
+                    }
+                    else
+                    {
+                        // Each output is the two channels of the first tap and then of
+                        // the second, so unzipping the 16 bit halves splits the taps.
+                        const uint16x8x2_t ab = vuzpq_u16(vreinterpretq_u16_u8(v), vreinterpretq_u16_u8(v));
+                        a = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u16(vget_low_u16(ab.val[0]))));
+                        b = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u16(vget_low_u16(ab.val[1]))));
+                    }
+                    const int16x8x2_t w = vld2q_s16(weights + (k*out_n + i)*2*channels);
+                    lo = vmlal_s16(lo, vget_low_s16(a), vget_low_s16(w.val[0]));
+                    lo = vmlal_s16(lo, vget_low_s16(b), vget_low_s16(w.val[1]));
+                    hi = vmlal_s16(hi, vget_high_s16(a), vget_high_s16(w.val[0]));
+                    hi = vmlal_s16(hi, vget_high_s16(b), vget_high_s16(w.val[1]));
+                }
+                vst1q_s16(out + i*channels, vcombine_s16(vshrn_n_s32(lo, 7), vshrn_n_s32(hi, 7)));
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + per <= out_n; i += per)
+            {
+                __m128i lo = _mm_set1_epi32(round);
+                __m128i hi = lo;
+                for (long k = 0; k < pairs; ++k)
+                {
+                    const __m128i v = resize_u8_gather<channels>(in + 2*k*channels, start + i, masks + 2*channels*i);
+                    __m128i a = _mm_unpacklo_epi8(v, zero);
+                    __m128i b = _mm_unpackhi_epi8(v, zero);
+                    if (channels == 2)
+                    {
+                        // Each output is c0 c1 of the first tap and c0 c1 of the second,
+                        // which is reordered into a pair of taps per channel.
+                        a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(3,1,2,0)), _MM_SHUFFLE(3,1,2,0));
+                        b = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b, _MM_SHUFFLE(3,1,2,0)), _MM_SHUFFLE(3,1,2,0));
+                    }
+                    const __m128i* const w = (const __m128i*)(weights + (k*out_n + i)*2*channels);
+                    lo = _mm_add_epi32(lo, _mm_madd_epi16(a, _mm_loadu_si128(w)));
+                    hi = _mm_add_epi32(hi, _mm_madd_epi16(b, _mm_loadu_si128(w+1)));
+                }
+                _mm_storeu_si128((__m128i*)(out + i*channels), _mm_packs_epi32(_mm_srai_epi32(lo, 7), _mm_srai_epi32(hi, 7)));
+            }
+#else
+            (void)masks;
+            (void)per;
+#endif
+            for (; i < out_n; ++i)
+            {
+                for (long c = 0; c < channels; ++c)
+                {
+                    int32 sum = round;
+                    for (long k = 0; k < pairs; ++k)
+                    {
+                        const unsigned char* const p = in + (start[i] + 2*k)*channels + c;
+                        const int16* const w = weights + ((k*out_n + i)*channels + c)*2;
+                        sum += p[0]*w[0] + p[channels]*w[1];
+                    }
+                    out[i*channels+c] = static_cast<int16>(sum>>7);
+                }
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void resize_u8_column (
+            const int16* const* rows,
+            const int16* weights,
+            long taps,
+            unsigned char* out,
+            long n
+        )
+        /*!
+            requires
+                - rows and weights hold taps row pointers and weights, and taps is even
+                - each row holds n values from resize_u8_row()
+            ensures
+                - for all 0 <= c < n:
+                    - out[c] == the sum over k of weights[k]*rows[k][c], divided by 1<<21
+                      and rounded
+        !*/
+        {
+            const int32 round = 1<<(resize_u8_weight_bits+6);
+            // The first pair of taps is kept in locals, which the compiler can tell the
+            // stores to out do not change, so the common 2 tap case loads nothing but
+            // the rows in its inner loop.
+            const int16* const r0 = rows[0];
+            const int16* const r1 = rows[1];
+            long c = 0;
+#if defined(DLIB_HAVE_NEON)
+            const int16 w0 = weights[0];
+            const int16 w1 = weights[1];
+            for (; c + 8 <= n; c += 8)
+            {
+                const int16x8_t a = vld1q_s16(r0 + c);
+                const int16x8_t b = vld1q_s16(r1 + c);
+                int32x4_t lo = vmlal_n_s16(vmlal_n_s16(vdupq_n_s32(round), vget_low_s16(a), w0), vget_low_s16(b), w1);
+                int32x4_t hi = vmlal_n_s16(vmlal_n_s16(vdupq_n_s32(round), vget_high_s16(a), w0), vget_high_s16(b), w1);
+                for (long k = 2; k < taps; ++k)
+                {
+                    const int16x8_t v = vld1q_s16(rows[k] + c);
+                    lo = vmlal_n_s16(lo, vget_low_s16(v), weights[k]);
+                    hi = vmlal_n_s16(hi, vget_high_s16(v), weights[k]);
+                }
+                const int16x8_t s = vcombine_s16(vmovn_s32(vshrq_n_s32(lo, 21)), vmovn_s32(vshrq_n_s32(hi, 21)));
+                vst1_u8(out + c, vqmovun_s16(s));
+            }
+#elif defined(DLIB_HAVE_AVX2)
+            const __m256i w01 = _mm256_set1_epi32((weights[1]<<16) | (uint16)weights[0]);
+            for (; c + 16 <= n; c += 16)
+            {
+                const __m256i a0 = _mm256_loadu_si256((const __m256i*)(r0 + c));
+                const __m256i b0 = _mm256_loadu_si256((const __m256i*)(r1 + c));
+                __m256i lo = _mm256_add_epi32(_mm256_set1_epi32(round), _mm256_madd_epi16(_mm256_unpacklo_epi16(a0, b0), w01));
+                __m256i hi = _mm256_add_epi32(_mm256_set1_epi32(round), _mm256_madd_epi16(_mm256_unpackhi_epi16(a0, b0), w01));
+                for (long k = 2; k < taps; k += 2)
+                {
+                    const __m256i a = _mm256_loadu_si256((const __m256i*)(rows[k] + c));
+                    const __m256i b = _mm256_loadu_si256((const __m256i*)(rows[k+1] + c));
+                    const __m256i w = _mm256_set1_epi32((weights[k+1]<<16) | (uint16)weights[k]);
+                    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+                    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+                }
+                // The unpacks and packs both work within 128 bit lanes, so the 16 bit
+                // results are in order and only packing to bytes needs a permute.
+                const __m256i s = _mm256_packs_epi32(_mm256_srai_epi32(lo, 21), _mm256_srai_epi32(hi, 21));
+                const __m256i u = _mm256_permute4x64_epi64(_mm256_packus_epi16(s, s), _MM_SHUFFLE(3,1,2,0));
+                _mm_storeu_si128((__m128i*)(out + c), _mm256_castsi256_si128(u));
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            const __m128i w01 = _mm_set1_epi32((weights[1]<<16) | (uint16)weights[0]);
+            for (; c + 8 <= n; c += 8)
+            {
+                const __m128i a0 = _mm_loadu_si128((const __m128i*)(r0 + c));
+                const __m128i b0 = _mm_loadu_si128((const __m128i*)(r1 + c));
+                __m128i lo = _mm_add_epi32(_mm_set1_epi32(round), _mm_madd_epi16(_mm_unpacklo_epi16(a0, b0), w01));
+                __m128i hi = _mm_add_epi32(_mm_set1_epi32(round), _mm_madd_epi16(_mm_unpackhi_epi16(a0, b0), w01));
+                for (long k = 2; k < taps; k += 2)
+                {
+                    const __m128i a = _mm_loadu_si128((const __m128i*)(rows[k] + c));
+                    const __m128i b = _mm_loadu_si128((const __m128i*)(rows[k+1] + c));
+                    const __m128i w = _mm_set1_epi32((weights[k+1]<<16) | (uint16)weights[k]);
+                    lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                    hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+                }
+                const __m128i s = _mm_packs_epi32(_mm_srai_epi32(lo, 21), _mm_srai_epi32(hi, 21));
+                _mm_storel_epi64((__m128i*)(out + c), _mm_packus_epi16(s, s));
+            }
+#endif
+            for (; c < n; ++c)
+            {
+                int32 sum = round + r0[c]*weights[0] + r1[c]*weights[1];
+                for (long k = 2; k < taps; ++k)
+                    sum += rows[k][c]*weights[k];
+                out[c] = static_cast<unsigned char>(sum>>21);
+            }
+        }
+
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    class fixed_point_resizer : noncopyable
+    {
+        /*!
+            CONVENTION
+                - filter() == filt
+                - channels() == ch
+
+                - The tables are for resizing an image of in_nr x in_nc pixels to one of
+                  out_nr x out_nc pixels, counting a pixel as ch values.  in_nr is -1
+                  before the first image.
+                - Output column c comes from taps_h input pixels starting at start_h[c],
+                  with the weights in weights_h laid out as resize_u8_row() wants them
+                  and masks_h from resize_u8_masks().
+                - Output row r comes from taps_v filtered input rows starting at
+                  start_v[r], with weights weights_v[r*taps_v] to
+                  weights_v[r*taps_v+taps_v-1].
+                - Input row y, filtered, is kept in ring[y%taps_v] and
+                  ring_row[y%taps_v] == y.  ring_row[k] == -1 if that row of the ring is
+                  not in use.
+                - If in_nc < taps_h then padded holds taps_h*ch values, so that a row can
+                  be copied into it and filtered with its missing taps read as zero.
+        !*/
+
+    public:
+
+        fixed_point_resizer (
+            resize_filter_type filter_ = resize_filter_bilinear,
+            long channels_ = 1
+        ) :
+            filt(filter_),
+            ch(channels_),
+            in_nr(-1), in_nc(-1), out_nr(-1), out_nc(-1),
+            taps_h(0), taps_v(0)
+        {
+            DLIB_ASSERT(channels_ == 1 || channels_ == 2,
+                "\t fixed_point_resizer::fixed_point_resizer()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t channels_: " << channels_
+                );
+        }
+
+        resize_filter_type filter (
+        ) const { return filt; }
+
+        long channels (
+        ) const { return ch; }
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& in_img,
+            out_image_type& out_img
+        )
+        {
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT((is_same_type<in_pixel_type,unsigned char>::value));
+            COMPILE_TIME_ASSERT((is_same_type<out_pixel_type,unsigned char>::value));
+
+            // make sure requires clause is not broken
+            DLIB_ASSERT(is_same_object(in_img, out_img) == false &&
+                        num_columns(in_img)%ch == 0 && num_columns(out_img)%ch == 0,
+                "\t void fixed_point_resizer::operator()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t is_same_object(in_img, out_img): " << is_same_object(in_img, out_img)
+                << "\n\t num_columns(in_img):  " << num_columns(in_img)
+                << "\n\t num_columns(out_img): " << num_columns(out_img)
+                << "\n\t channels():           " << ch
+                << "\n\t this:                 " << this
+                );
+
+            if (num_rows(in_img) == 0 || num_columns(in_img) == 0 ||
+                num_rows(out_img) == 0 || num_columns(out_img) == 0)
+                return;
+
+            setup(num_rows(in_img), num_columns(in_img)/ch, num_rows(out_img), num_columns(out_img)/ch);
+
+            const unsigned char* const in = (const unsigned char*)image_data(in_img);
+            const long in_ws = width_step(in_img);
+            unsigned char* const out = (unsigned char*)image_data(out_img);
+            const long out_ws = width_step(out_img);
+
+            std::fill(ring_row.begin(), ring_row.end(), -1);
+            for (long r = 0; r < out_nr; ++r)
+            {
+                for (long k = 0; k < taps_v; ++k)
+                {
+                    const long y = start_v[r] + k;
+                    const long slot = y%taps_v;
+                    if (ring_row[slot] != y)
+                    {
+                        const unsigned char* row = in + std::min(y, in_nr-1)*in_ws;
+                        if (padded.size() != 0)
+                        {
+                            std::memcpy(&padded[0], row, in_nc*ch);
+                            row = &padded[0];
+                        }
+                        const unsigned char* const masks = masks_h.size() ? &masks_h[0] : 0;
+                        if (ch == 1)
+                            impl::resize_u8_row<1>(row, taps_h, &start_h[0], &weights_h[0], masks, &ring[slot][0], out_nc);
+                        else
+                            impl::resize_u8_row<2>(row, taps_h, &start_h[0], &weights_h[0], masks, &ring[slot][0], out_nc);
+                        ring_row[slot] = y;
+                    }
+                    rows[k] = &ring[slot][0];
+                }
+                impl::resize_u8_column(&rows[0], &weights_v[r*taps_v], taps_v, out + r*out_ws, out_nc*ch);
+            }
+        }
+
+    private:
+
+        void setup (
+            long in_nr_,
+            long in_nc_,
+            long out_nr_,
+            long out_nc_
+        )
+        {
+            if (in_nr_ == in_nr && in_nc_ == in_nc && out_nr_ == out_nr && out_nc_ == out_nc)
+                return;
+            in_nr = -1;
+
+            std::vector<int16> w;
+            taps_h = impl::resize_u8_axis(in_nc_, out_nc_, filt, start_h, w);
+            weights_h.resize(w.size()*ch);
+            for (long k = 0; k < taps_h/2; ++k)
+            {
+                for (long i = 0; i < out_nc_; ++i)
+                {
+                    for (long c = 0; c < ch; ++c)
+                    {
+                        weights_h[((k*out_nc_ + i)*ch + c)*2]   = w[i*taps_h + 2*k];
+                        weights_h[((k*out_nc_ + i)*ch + c)*2+1] = w[i*taps_h + 2*k + 1];
+                    }
+                }
+            }
+            impl::resize_u8_masks(in_nc_, ch, taps_h, start_h, masks_h);
+            taps_v = impl::resize_u8_axis(in_nr_, out_nr_, filt, start_v, weights_v);
+
+            ring.set_size(taps_v, out_nc_*ch);
+            ring_row.resize(taps_v);
+            rows.resize(taps_v);
+            if (in_nc_ < taps_h)
+                padded.assign(taps_h*ch, 0);
+            else
+                padded.clear();
+
+            in_nr = in_nr_;
+            in_nc = in_nc_;
+            out_nr = out_nr_;
+            out_nc = out_nc_;
+        }
+
+        resize_filter_type filt;
+        long ch;
+
+        long in_nr, in_nc, out_nr, out_nc;
+        long taps_h, taps_v;
+        std::vector<long> start_h, start_v;
+        std::vector<int16> weights_h, weights_v;
+        std::vector<unsigned char> masks_h;
+
+        array2d<int16> ring;
+        std::vector<long> ring_row;
+        std::vector<const int16*> rows;
+        std::vector<unsigned char> padded;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_RESIZE_U8_Hh_
+
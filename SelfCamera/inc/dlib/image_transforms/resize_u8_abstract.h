@@ -0,0 +1,121 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_RESIZE_U8_ABSTRACT_Hh_
+#ifdef DLIB_RESIZE_U8_ABSTRACT_Hh_
+
+#include "../algs.h"
+#include "../image_processing/generic_image.h"
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum resize_filter_type
+    {
+        resize_filter_bilinear,
+        resize_filter_area
+    };
+    /*!
+        These select how fixed_point_resizer computes the output pixels:
+            - resize_filter_bilinear: the same bilinear interpolation resize_image() and
+              resize_image_fixed_point() use, which puts the first and last output rows
+              and columns on the first and last input ones.
+            - resize_filter_area: when shrinking an image along a dimension, each output
+              pixel is the average of the input pixels it covers, weighted by how much of
+              each it covers.  This does not alias the way bilinear interpolation does
+              when shrinking by more than 2.  When enlarging along a dimension it is
+              bilinear interpolation with the centres of the input and output pixels
+              lined up.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    class fixed_point_resizer : noncopyable
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object resizes images of unsigned char pixels, like resize_image(),
+                but with integer arithmetic and SSE2, AVX2 or NEON code where the build
+                enables it.  It resizes in two passes, along the rows and then down the
+                columns, with weights that are worked out when it is first given an
+                image of some size and then reused for as long as the input and output
+                sizes stay the same.  So it pays to keep one of these around for each
+                stream of same sized images, such as the frames of a camera preview.
+
+                It also resizes images whose rows hold 2 interleaved channels, such as
+                the UV plane of an NV12 frame, each channel on its own.  Such an image is
+                given as an image of unsigned char that is channels() times as wide as
+                the number of pixels in a row.
+
+                The output is within 1 of the exact result of the filter, rounded to the
+                nearest integer.
+
+            THREAD SAFETY
+                This object keeps its tables and a buffer of filtered rows between calls,
+                so it must not be used by more than one thread at a time.
+        !*/
+
+    public:
+
+        fixed_point_resizer (
+            resize_filter_type filter = resize_filter_bilinear,
+            long channels = 1
+        );
+        /*!
+            requires
+                - channels == 1 or channels == 2
+            ensures
+                - #filter() == filter
+                - #channels() == channels
+        !*/
+
+        resize_filter_type filter (
+        ) const;
+        /*!
+            ensures
+                - returns the filter this object resizes with
+        !*/
+
+        long channels (
+        ) const;
+        /*!
+            ensures
+                - returns the number of interleaved channels each pixel of the images
+                  given to this object has
+        !*/
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& in_img,
+            out_image_type& out_img
+        );
+        /*!
+            requires
+                - in_image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h and has unsigned char pixels
+                - out_image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h and has unsigned char pixels
+                - is_same_object(in_img, out_img) == false
+                - num_columns(in_img)%channels() == 0
+                - num_columns(out_img)%channels() == 0
+            ensures
+                - #out_img == A copy of in_img which has been stretched so that it
+                  fits exactly into out_img, using filter().  If channels() == 2 then every
+                  row is taken as num_columns()/2 pixels, each made of 2 consecutive
+                  values, and each channel is resized on its own.
+                - The size of out_img is not modified.  I.e.
+                    - #num_rows(out_img) == num_rows(out_img)
+                    - #num_columns(out_img) == num_columns(out_img)
+                - If either image is empty then this function does nothing.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_RESIZE_U8_ABSTRACT_Hh_
+
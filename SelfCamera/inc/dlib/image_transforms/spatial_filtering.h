@@ -13,6 +13,8 @@
 #include "../simd.h"
 #include <limits>
 #include "assign_image.h"
+#include "spatial_filtering_u8.h"
+#include "../threads/parallel_for_extension.h"
 
 namespace dlib
 {
@@ -1212,6 +1214,135 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        struct gaussian_blur_images_u8
+        {
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            const static bool value = is_same_type<in_pixel_type,unsigned char>::value &&
+                                      is_same_type<out_pixel_type,unsigned char>::value;
+        };
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        rectangle gaussian_blur_u8 (
+            const in_image_type& in_img_,
+            out_image_type& out_img_,
+            double sigma,
+            int max_size,
+            thread_pool* tp
+        )
+        {
+            DLIB_ASSERT(sigma > 0 && max_size > 0 && (max_size%2)==1 &&
+                        is_same_object(in_img_, out_img_) == false,
+                "\t void gaussian_blur_fixed_point()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t sigma: " << sigma 
+                << "\n\t max_size:  " << max_size 
+                << "\n\t is_same_object(in_img,out_img): " << is_same_object(in_img_,out_img_) 
+            );
+
+            const_image_view<in_image_type> in_img(in_img_);
+            image_view<out_image_type> out_img(out_img_);
+
+            if (in_img.size() == 0)
+            {
+                out_img.clear();
+                return rectangle();
+            }
+
+            out_img.set_size(in_img.nr(),in_img.nc());
+
+            // Turn the filter into weights that sum to exactly 1<<14.  Each one is the
+            // difference between the rounded running sums on either side of it, so the
+            // rounding errors don't add up along the filter.
+            const matrix<double,0,1> filt = create_gaussian_filter<double>(sigma, max_size);
+            const long taps = filt.size();
+            std::vector<int16> weights((taps+1)&~1, 0);
+            const double total = sum(filt);
+            double run = 0;
+            long prev = 0;
+            for (long k = 0; k < taps; ++k)
+            {
+                run += filt(k);
+                const long next = static_cast<long>(std::floor(run/total*(1<<resize_u8_weight_bits) + 0.5));
+                weights[k] = static_cast<int16>(next - prev);
+                prev = next;
+            }
+
+            const long first = taps/2;
+            const long last_row = in_img.nr() - (taps-1)/2;
+            const long last_col = in_img.nc() - (taps-1)/2;
+            const rectangle non_border = rectangle(first, first, last_col-1, last_row-1);
+            zero_border_pixels(out_img, non_border);
+            if (non_border.is_empty())
+                return non_border;
+
+            const unsigned char* in = static_cast<const unsigned char*>(image_data(in_img_));
+            const long in_width_step = width_step(in_img_);
+            const long in_nc = in_img.nc();
+            unsigned char* out = static_cast<unsigned char*>(image_data(out_img_));
+            const long out_width_step = width_step(out_img_);
+            auto rows = [&](long begin, long end)
+            {
+                separable_filter_u8(in, in_width_step, in_nc, out, out_width_step, &weights[0], taps, begin, end);
+            };
+
+            // Bands of output rows are independent, apart from each one filtering the
+            // taps-1 input rows around its edges again, so there are only a couple of
+            // bands per thread.  Small images aren't worth splitting.
+            const long nr = last_row - first;
+            if (tp && nr*in_nc >= 32*1024)
+                parallel_for_blocked(*tp, first, last_row, rows, 2);
+            else
+                rows(first, last_row);
+
+            return non_border;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur_fixed_point (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        double sigma = 1,
+        int max_size = 1001
+    )
+    {
+        COMPILE_TIME_ASSERT((impl::gaussian_blur_images_u8<in_image_type,out_image_type>::value));
+        return impl::gaussian_blur_u8(in_img, out_img, sigma, max_size, 0);
+    }
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur_fixed_point (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        thread_pool& tp,
+        double sigma = 1,
+        int max_size = 1001
+    )
+    {
+        COMPILE_TIME_ASSERT((impl::gaussian_blur_images_u8<in_image_type,out_image_type>::value));
+        return impl::gaussian_blur_u8(in_img, out_img, sigma, max_size, &tp);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
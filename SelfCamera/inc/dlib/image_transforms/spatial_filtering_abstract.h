@@ -6,6 +6,7 @@
 #include "../pixel.h"
 #include "../matrix.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -388,6 +389,55 @@ namespace dlib
               non-border pixels and therefore contain output from the filter.
     !*/
 
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur_fixed_point (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        double sigma = 1,
+        int max_size = 1001
+    );
+    /*!
+        requires
+            - in_img and out_img contain unsigned char pixels
+            - The rest is the same as for gaussian_blur(in_img, out_img, sigma, max_size).
+        ensures
+            - Does the same thing as gaussian_blur(in_img, out_img, sigma, max_size),
+              with the same border and the same returned rectangle, but much faster:
+              the filter is applied with 14 bit fixed point weights, in 16 and 32 bit
+              integer arithmetic and with SSE2, AVX2 or NEON code where the build
+              enables it.
+            - Each output pixel is within 1 of the exact result of the Gaussian filter,
+              rounded to the nearest integer.  gaussian_blur() filters unsigned char
+              images with an integer approximation of the Gaussian and truncates the
+              result, so the two differ by up to about 5.  That is why this is a
+              separate function: code tuned on gaussian_blur()'s output, such as
+              detection and HOG preprocessing, keeps getting exactly that output.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur_fixed_point (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        thread_pool& tp,
+        double sigma = 1,
+        int max_size = 1001
+    );
+    /*!
+        requires
+            - The same as gaussian_blur_fixed_point(in_img, out_img, sigma, max_size).
+        ensures
+            - Does the same thing as gaussian_blur_fixed_point(in_img, out_img, sigma,
+              max_size).  When the images are big enough to make it worthwhile, bands
+              of output rows are filtered in parallel by the threads in tp.  The output
+              is the same either way.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -0,0 +1,186 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_SPATIAL_FILTERING_U8_Hh_
+#define DLIB_SPATIAL_FILTERING_U8_Hh_
+
+#include "../algs.h"
+#include "../array2d.h"
+#include "../simd/simd_check.h"
+#include "resize_u8.h"
+#include <algorithm>
+#include <vector>
+
+namespace dlib
+{
+    namespace impl
+    {
+
+    /*
+        This is the fixed point separable filter behind gaussian_blur_fixed_point(), for
+        unsigned char images.  The filter taps are 14 bit fixed point weights that
+        sum to exactly 1<<14, the same as fixed_point_resizer's.  The row pass sums
+        pixels times weights in 32 bits and keeps the result in an int16 with 7
+        fractional bits, which holds at most 255<<7.  The column pass is
+        resize_u8_column(), which sums those times the same weights in 32 bits and
+        rounds away the 21 fractional bits.
+
+        The row pass writes into a ring of taps rows, so each input row is filtered once
+        and the column pass reads taps rows that were just written.  The image is done
+        in strips of columns narrow enough that the ring stays within 16KB, so it stays
+        in the L1 cache however wide the image is.
+    */
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void separable_filter_row_u8 (
+            const unsigned char* in,
+            long in_n,
+            const int16* weights,
+            long taps,
+            int16* out,
+            long n
+        )
+        /*!
+            requires
+                - weights holds taps weights, followed by a 0 if taps is odd
+                - in_n >= n + taps - 1, and in[0] through in[in_n-1] can be read
+            ensures
+                - for all 0 <= c < n:
+                    - out[c] == the sum over k of weights[k]*in[c+k], divided by 1<<7
+                      and rounded
+        !*/
+        {
+            const int32 round = 1<<6;
+            long c = 0;
+#if defined(DLIB_HAVE_NEON)
+            for (; c + 8 + taps - 1 <= in_n && c + 8 <= n; c += 8)
+            {
+                int32x4_t lo = vdupq_n_s32(round);
+                int32x4_t hi = vdupq_n_s32(round);
+                for (long k = 0; k < taps; ++k)
+                {
+                    const int16x8_t v = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(in + c + k)));
+                    lo = vmlal_n_s16(lo, vget_low_s16(v), weights[k]);
+                    hi = vmlal_n_s16(hi, vget_high_s16(v), weights[k]);
+                }
+                vst1q_s16(out + c, vcombine_s16(vshrn_n_s32(lo, 7), vshrn_n_s32(hi, 7)));
+            }
+#elif defined(DLIB_HAVE_AVX2)
+            // Each pair of taps is done with one madd, on the pixels under the first tap
+            // of the pair interleaved with the ones under the second.
+            const long pairs = (taps+1)/2;
+            for (; c + 16 + 2*pairs - 1 <= in_n && c + 16 <= n; c += 16)
+            {
+                __m256i lo = _mm256_set1_epi32(round);
+                __m256i hi = _mm256_set1_epi32(round);
+                for (long k = 0; k < 2*pairs; k += 2)
+                {
+                    const __m128i a = _mm_loadu_si128((const __m128i*)(in + c + k));
+                    const __m128i b = _mm_loadu_si128((const __m128i*)(in + c + k + 1));
+                    const __m256i w = _mm256_set1_epi32((weights[k+1]<<16) | (uint16)weights[k]);
+                    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(a, b)), w));
+                    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(a, b)), w));
+                }
+                const __m256i s = _mm256_packs_epi32(_mm256_srai_epi32(lo, 7), _mm256_srai_epi32(hi, 7));
+                _mm256_storeu_si256((__m256i*)(out + c), _mm256_permute4x64_epi64(s, _MM_SHUFFLE(3,1,2,0)));
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            const long pairs = (taps+1)/2;
+            const __m128i zero = _mm_setzero_si128();
+            for (; c + 16 + 2*pairs - 1 <= in_n && c + 16 <= n; c += 16)
+            {
+                __m128i s0 = _mm_set1_epi32(round);
+                __m128i s1 = s0, s2 = s0, s3 = s0;
+                for (long k = 0; k < 2*pairs; k += 2)
+                {
+                    const __m128i a = _mm_loadu_si128((const __m128i*)(in + c + k));
+                    const __m128i b = _mm_loadu_si128((const __m128i*)(in + c + k + 1));
+                    const __m128i w = _mm_set1_epi32((weights[k+1]<<16) | (uint16)weights[k]);
+                    const __m128i lo = _mm_unpacklo_epi8(a, b);
+                    const __m128i hi = _mm_unpackhi_epi8(a, b);
+                    s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+                    s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+                    s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+                    s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+                }
+                _mm_storeu_si128((__m128i*)(out + c), _mm_packs_epi32(_mm_srai_epi32(s0, 7), _mm_srai_epi32(s1, 7)));
+                _mm_storeu_si128((__m128i*)(out + c + 8), _mm_packs_epi32(_mm_srai_epi32(s2, 7), _mm_srai_epi32(s3, 7)));
+            }
+#endif
+            for (; c < n; ++c)
+            {
+                int32 sum = round;
+                for (long k = 0; k < taps; ++k)
+                    sum += in[c+k]*weights[k];
+                out[c] = static_cast<int16>(sum>>7);
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+        inline void separable_filter_u8 (
+            const unsigned char* in,
+            long in_width_step,
+            long in_nc,
+            unsigned char* out,
+            long out_width_step,
+            const int16* weights,
+            long taps,
+            long begin,
+            long end
+        )
+        /*!
+            requires
+                - weights holds taps weights, followed by a 0 if taps is odd, and they
+                  sum to 1<<14
+                - in_nc >= taps
+                - taps/2 <= begin <= end and end + taps/2 is no more than the number of
+                  rows in the input image
+            ensures
+                - filters the input image with weights, along the rows and then down the
+                  columns, and writes the output rows in the range [begin, end), over
+                  the columns in the range [taps/2, in_nc - taps/2).  Every other pixel
+                  of out is left alone.
+        !*/
+        {
+            const long half = taps/2;
+            const long taps_even = (taps+1)&~1;
+            const long first = half;
+            const long last = in_nc - half;
+            if (begin >= end)
+                return;
+
+            const long strip = std::max<long>(64, (16*1024/(2*taps))&~15);
+            array2d<int16> ring(taps, std::min(strip, last - first));
+            std::vector<const int16*> rows(taps_even);
+            for (long s = first; s < last; s += strip)
+            {
+                const long n = std::min(strip, last - s);
+                // The row pass may read past the end of the strip, as long as it stays
+                // in the row, which lets the vector loop run further.
+                const unsigned char* in_s = in + s - half;
+                const long in_n = in_nc - (s - half);
+
+                long next = begin - half;
+                for (long r = begin; r < end; ++r)
+                {
+                    for (; next <= r + half; ++next)
+                        separable_filter_row_u8(in_s + next*in_width_step, in_n, weights, taps, &ring[next%taps][0], n);
+
+                    for (long k = 0; k < taps; ++k)
+                        rows[k] = &ring[(r - half + k)%taps][0];
+                    // resize_u8_column() takes taps in pairs, so an odd filter gets a
+                    // last tap with a 0 weight on a row it has anyway.
+                    if (taps_even != taps)
+                        rows[taps] = rows[0];
+                    resize_u8_column(&rows[0], weights, taps_even, out + r*out_width_step + s, n);
+                }
+            }
+        }
+
+    // ----------------------------------------------------------------------------------------
+
+    }
+}
+
+#endif // DLIB_SPATIAL_FILTERING_U8_Hh_
+
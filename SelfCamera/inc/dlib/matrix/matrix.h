@@ -1923,6 +1923,62 @@ namespace dlib
         }
     }
 
+    template <
+        typename T,
+        long NR,
+        long NC,
+        typename mm
+        >
+    void serialize_bulk (
+        const matrix<T,NR,NC,mm,row_major_layout>& item, 
+        std::ostream& out
+    )
+    {
+        try
+        {
+            serialize(item.nr(),out);
+            serialize(item.nc(),out);
+            serialize_bulk(item.size() != 0 ? &item(0,0) : (const T*)0, item.size(), out);
+        }
+        catch (serialization_error& e)
+        {
+            throw serialization_error(e.info + "\n   while serializing dlib::matrix in bulk");
+        }
+    }
+
+    template <
+        typename T,
+        long NR,
+        long NC,
+        typename mm
+        >
+    void deserialize_bulk (
+        matrix<T,NR,NC,mm,row_major_layout>& item, 
+        std::istream& in
+    )
+    {
+        try
+        {
+            long nr, nc;
+            deserialize(nr,in); 
+            deserialize(nc,in); 
+
+            if (nr < 0 || nc < 0)
+                throw serialization_error("Error while deserializing a dlib::matrix in bulk.  Invalid size");
+            if (NR != 0 && nr != NR)
+                throw serialization_error("Error while deserializing a dlib::matrix in bulk.  Invalid rows");
+            if (NC != 0 && nc != NC)
+                throw serialization_error("Error while deserializing a dlib::matrix in bulk.  Invalid columns");
+
+            item.set_size(nr,nc);
+            deserialize_bulk(item.size() != 0 ? &item(0,0) : (T*)0, item.size(), in);
+        }
+        catch (serialization_error& e)
+        {
+            throw serialization_error(e.info + "\n   while deserializing a dlib::matrix in bulk");
+        }
+    }
+
     template <
         typename EXP
         >
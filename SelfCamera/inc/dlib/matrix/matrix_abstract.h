@@ -748,6 +748,46 @@ template <
         Provides deserialization support 
     !*/
 
+    template <
+        typename T,
+        long NR,
+        long NC,
+        typename mm
+        >
+    void serialize_bulk (
+        const matrix<T,NR,NC,mm,row_major_layout>& item, 
+        std::ostream& out
+    );   
+    /*!
+        requires
+            - T is an integral type other than bool or an IEEE floating point type
+        ensures
+            - writes the size of item followed by its elements as one bulk array (see
+              the BULK ARRAY SERIALIZATION FORMAT in dlib/serialize.h).  This is not the
+              format serialize() uses, so read it back with deserialize_bulk().
+    !*/
+
+    template <
+        typename T,
+        long NR,
+        long NC,
+        typename mm
+        >
+    void deserialize_bulk (
+        matrix<T,NR,NC,mm,row_major_layout>& item, 
+        std::istream& in
+    );   
+    /*!
+        requires
+            - T is an integral type other than bool or an IEEE floating point type
+        ensures
+            - reads a matrix written by serialize_bulk() into item
+        throws
+            - serialization_error
+                if the stored matrix has a different element type or a size that
+                doesn't fit NR and NC.
+    !*/
+
     template <
         typename EXP
         >
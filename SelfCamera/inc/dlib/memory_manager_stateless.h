@@ -5,6 +5,7 @@
 
 #include "memory_manager_stateless/memory_manager_stateless_kernel_1.h"
 #include "memory_manager_stateless/memory_manager_stateless_kernel_2.h"
+#include "memory_manager_stateless/memory_manager_stateless_kernel_3.h"
 #include "memory_manager.h"
 
 
@@ -63,6 +64,10 @@ namespace dlib
                      kernel_2_3d;
         typedef      memory_manager_stateless_kernel_2<T,memory_manager<char>::kernel_3e>
                      kernel_2_3e;
+
+        // kernel_3
+        typedef      memory_manager_stateless_kernel_3<T>
+                     kernel_3a;
       
 
     };
@@ -0,0 +1,531 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_MEMORY_MANAGER_STATELESs_3_
+#define DLIB_MEMORY_MANAGER_STATELESs_3_
+
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+
+#include "../platform.h"
+#include "memory_manager_stateless_kernel_abstract.h"
+
+#ifdef POSIX
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        class thread_caching_heap
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is the process wide heap behind memory_manager_stateless_kernel_3.
+                    It hands out blocks of memory, each starting with a header_size byte
+                    header that the caller may use, and is made of three layers:
+
+                    - Every thread has a cache with a free list per size class.  An
+                      allocation or deallocation that its cache can serve touches no
+                      lock and no memory shared with other threads.
+                    - A central pool with a free list and a mutex per size class backs
+                      the caches.  A cache that runs dry takes a batch of blocks from it
+                      in one go, and a cache that grows past its limits gives a batch
+                      back.  A thread's cache is given back when the thread ends.
+                    - The central pool gets new blocks by carving up spans of at least
+                      span_size bytes that it gets from the system, and keeps them for
+                      the life of the process.  Blocks bigger than the largest size
+                      class are not pooled: each one is mapped from and unmapped to the
+                      system directly.
+
+                CONVENTION
+                    - size classes 0 to 7 are 16, 32, ..., 128 bytes.  Above that each
+                      doubling of the size has four classes a quarter apart, e.g. 160,
+                      192, 224 and 256, up to max_class_size.  So at most a fifth of a
+                      pooled block is wasted, and untouched pages of the big classes
+                      are never paged in anyway.
+                    - batch_of(c) == the number of blocks moved between a cache and the
+                      central pool at once, about 64KB worth but between 2 and 64.
+                    - a cache holds at most 2*batch_of(c) blocks of class c and at most
+                      max_cache_bytes bytes overall.
+                    - A free block's first word links it into a free list.
+            !*/
+
+        public:
+
+            // Every block starts with this many bytes of header, so the memory after it
+            // is aligned for SSE and NEON loads.
+            const static std::size_t header_size = 16;
+
+            const static unsigned long num_classes = 8 + 4*13;
+            const static std::size_t max_class_size = 1 << 20;
+            const static unsigned long large_class = num_classes;
+
+            static unsigned long class_of (
+                std::size_t bytes
+            )
+            {
+                if (bytes <= 128)
+                    return bytes <= 16 ? 0 : static_cast<unsigned long>((bytes-1)/16);
+                if (bytes > max_class_size)
+                    return large_class;
+
+                const unsigned long p = floor_log2(bytes-1);
+                return 8 + (p-7)*4 + static_cast<unsigned long>(((bytes-1) - (std::size_t(1)<<p)) >> (p-2));
+            }
+
+            static std::size_t class_size (
+                unsigned long c
+            )
+            {
+                if (c < 8)
+                    return 16*(c+1);
+                const unsigned long p = 7 + (c-8)/4;
+                return (std::size_t(1)<<p) + ((c-8)%4 + 1)*(std::size_t(1)<<(p-2));
+            }
+
+            static void* allocate (
+                std::size_t bytes
+            )
+            {
+                const unsigned long c = class_of(bytes);
+                if (c == large_class)
+                    return map_large(bytes);
+
+                thread_cache* tc = local_cache();
+                if (tc == 0)
+                    return central().take_one(c);
+
+                free_block* b = tc->lists[c];
+                if (b == 0)
+                {
+                    b = central().take_batch(c, tc->counts[c]);
+                    tc->cached_bytes += tc->counts[c]*class_size(c);
+                }
+                tc->lists[c] = b->next;
+                --tc->counts[c];
+                tc->cached_bytes -= class_size(c);
+                return b;
+            }
+
+            static void deallocate (
+                void* block,
+                std::size_t bytes
+            )
+            {
+                const unsigned long c = class_of(bytes);
+                if (c == large_class)
+                {
+                    unmap_large(block, bytes);
+                    return;
+                }
+
+                free_block* b = static_cast<free_block*>(block);
+                thread_cache* tc = local_cache();
+                if (tc == 0)
+                {
+                    central().give(c, b, b, 1);
+                    return;
+                }
+
+                b->next = tc->lists[c];
+                tc->lists[c] = b;
+                ++tc->counts[c];
+                tc->cached_bytes += class_size(c);
+
+                if (tc->counts[c] > 2*batch_of(c) || tc->cached_bytes > max_cache_bytes)
+                    tc->release(c, batch_of(c));
+            }
+
+        private:
+
+            const static std::size_t span_size = 64*1024;
+            const static std::size_t max_cache_bytes = 4*1024*1024;
+
+            struct free_block
+            {
+                free_block* next;
+            };
+
+            static unsigned long floor_log2 (
+                std::size_t n
+            )
+            {
+#if defined(__GNUC__)
+                return static_cast<unsigned long>(8*sizeof(unsigned long) - 1 - __builtin_clzl(n));
+#else
+                unsigned long p = 0;
+                while (n >>= 1)
+                    ++p;
+                return p;
+#endif
+            }
+
+            static unsigned long batch_of (
+                unsigned long c
+            )
+            {
+                const std::size_t n = span_size/class_size(c);
+                return static_cast<unsigned long>(n < 2 ? 2 : (n > 64 ? 64 : n));
+            }
+
+        // ------------------------------------------------------------------------------------
+
+            static void* system_allocate (
+                std::size_t bytes
+            )
+            {
+#ifdef POSIX
+                void* mem = mmap(0, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+                if (mem == MAP_FAILED)
+                    throw std::bad_alloc();
+                return mem;
+#else
+                return ::operator new(bytes);
+#endif
+            }
+
+            static void system_deallocate (
+                void* mem,
+                std::size_t bytes
+            )
+            {
+#ifdef POSIX
+                munmap(mem, bytes);
+#else
+                ::operator delete(mem);
+#endif
+            }
+
+            static void* map_large (
+                std::size_t bytes
+            )
+            {
+                // mmap() and munmap() round the length up to whole pages themselves
+                return system_allocate(bytes);
+            }
+
+            static void unmap_large (
+                void* block,
+                std::size_t bytes
+            )
+            {
+                system_deallocate(block, bytes);
+            }
+
+        // ------------------------------------------------------------------------------------
+
+            class central_pool
+            {
+            public:
+                central_pool()
+                {
+                    for (unsigned long c = 0; c < num_classes; ++c)
+                    {
+                        lists[c] = 0;
+                        counts[c] = 0;
+                    }
+                }
+
+                free_block* take_batch (
+                    unsigned long c,
+                    unsigned long& count
+                )
+                /*!
+                    ensures
+                        - returns a list of #count > 0 blocks of class c
+                !*/
+                {
+                    const unsigned long want = batch_of(c);
+                    {
+                        std::lock_guard<std::mutex> lock(mutexes[c]);
+                        if (lists[c] != 0)
+                        {
+                            free_block* first = lists[c];
+                            free_block* last = first;
+                            count = 1;
+                            while (count < want && last->next != 0)
+                            {
+                                last = last->next;
+                                ++count;
+                            }
+                            lists[c] = last->next;
+                            counts[c] -= count;
+                            last->next = 0;
+                            return first;
+                        }
+                    }
+
+                    // Carve a new span outside the lock.  The blocks past the batch
+                    // go to the central list.
+                    const std::size_t size = class_size(c);
+                    // whole 4KB pages, so the tail of the last page isn't wasted
+                    const std::size_t bytes = ((size*want > span_size ? size*want : span_size) + 4095) & ~std::size_t(4095);
+                    char* span = static_cast<char*>(system_allocate(bytes));
+                    const unsigned long n = static_cast<unsigned long>(bytes/size);
+                    for (unsigned long i = 0; i+1 < n; ++i)
+                        reinterpret_cast<free_block*>(span + i*size)->next = reinterpret_cast<free_block*>(span + (i+1)*size);
+                    reinterpret_cast<free_block*>(span + (n-1)*size)->next = 0;
+
+                    free_block* first = reinterpret_cast<free_block*>(span);
+                    count = n < want ? n : want;
+                    if (n > count)
+                    {
+                        free_block* last = reinterpret_cast<free_block*>(span + (count-1)*size);
+                        give(c, last->next, reinterpret_cast<free_block*>(span + (n-1)*size), n-count);
+                        last->next = 0;
+                    }
+                    return first;
+                }
+
+                void* take_one (
+                    unsigned long c
+                )
+                {
+                    unsigned long count;
+                    free_block* b = take_batch(c, count);
+                    if (count > 1)
+                    {
+                        free_block* last = b->next;
+                        while (last->next != 0)
+                            last = last->next;
+                        give(c, b->next, last, count-1);
+                    }
+                    return b;
+                }
+
+                void give (
+                    unsigned long c,
+                    free_block* first,
+                    free_block* last,
+                    unsigned long count
+                )
+                {
+                    std::lock_guard<std::mutex> lock(mutexes[c]);
+                    last->next = lists[c];
+                    lists[c] = first;
+                    counts[c] += count;
+                }
+
+            private:
+                std::mutex mutexes[num_classes];
+                free_block* lists[num_classes];
+                unsigned long counts[num_classes];
+            };
+
+            static central_pool& central (
+            )
+            {
+                // never destroyed, so that threads still running while the process
+                // exits can keep using it
+                static central_pool* pool = new central_pool;
+                return *pool;
+            }
+
+        // ------------------------------------------------------------------------------------
+
+            struct thread_cache
+            {
+                thread_cache() : cached_bytes(0)
+                {
+                    for (unsigned long c = 0; c < num_classes; ++c)
+                    {
+                        lists[c] = 0;
+                        counts[c] = 0;
+                    }
+                }
+
+                void release (
+                    unsigned long c,
+                    unsigned long count
+                )
+                {
+                    if (count > counts[c])
+                        count = counts[c];
+                    if (count == 0)
+                        return;
+
+                    free_block* first = lists[c];
+                    free_block* last = first;
+                    for (unsigned long i = 1; i < count; ++i)
+                        last = last->next;
+                    lists[c] = last->next;
+                    counts[c] -= count;
+                    cached_bytes -= count*class_size(c);
+                    central().give(c, first, last, count);
+                }
+
+                free_block* lists[num_classes];
+                unsigned long counts[num_classes];
+                std::size_t cached_bytes;
+            };
+
+            struct cache_owner
+            {
+                ~cache_owner()
+                {
+                    for (unsigned long c = 0; c < num_classes; ++c)
+                        cache.release(c, cache.counts[c]);
+                    // anything freed by this thread from now on, e.g. by the destructors
+                    // of other thread_local objects, goes straight to the central pool
+                    cache_pointer() = 0;
+                    cache_gone() = true;
+                }
+
+                thread_cache cache;
+            };
+
+            static thread_cache*& cache_pointer (
+            )
+            {
+                static thread_local thread_cache* cache = 0;
+                return cache;
+            }
+
+            static bool& cache_gone (
+            )
+            {
+                static thread_local bool gone = false;
+                return gone;
+            }
+
+            static thread_cache* local_cache (
+            )
+            {
+                // The owner has a destructor, so it is only touched once per thread.  The
+                // pointer and flag are trivial thread_locals, which cost a plain load.
+                thread_cache*& cache = cache_pointer();
+                if (cache != 0)
+                    return cache;
+                if (cache_gone())
+                    return 0;
+
+                static thread_local cache_owner owner;
+                cache = &owner.cache;
+                return cache;
+            }
+        };
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    class memory_manager_stateless_kernel_3
+    {
+        /*!
+            CONVENTION
+                This implementation gets its memory from impl::thread_caching_heap, which
+                all instances share, so it is thread safe and each thread mostly allocates
+                and frees from its own cache without taking a lock.
+
+                Each allocation is one heap block: the heap's header followed by the
+                objects.  The header holds the number of objects, which tells
+                deallocate_array() how many destructors to call and how big the block
+                was.
+        !*/
+
+        public:
+
+            typedef T type;
+            const static bool is_stateless = true;
+
+            template <typename U>
+            struct rebind {
+                typedef memory_manager_stateless_kernel_3<U> other;
+            };
+
+            memory_manager_stateless_kernel_3(
+            )
+            {}
+
+            virtual ~memory_manager_stateless_kernel_3(
+            ) {}
+
+            T* allocate (
+            )
+            {
+                return allocate_array(1);
+            }
+
+            void deallocate (
+                T* item
+            )
+            {
+                deallocate_array(item);
+            }
+
+            T* allocate_array (
+                unsigned long size
+            )
+            {
+                if (size > (std::numeric_limits<std::size_t>::max() - heap::header_size)/sizeof(T))
+                    throw std::bad_alloc();
+
+                char* block = static_cast<char*>(heap::allocate(bytes_for(size)));
+                T* items = reinterpret_cast<T*>(block + heap::header_size);
+                unsigned long i = 0;
+                try
+                {
+                    for (; i < size; ++i)
+                        new (static_cast<void*>(items+i)) T;
+                }
+                catch (...)
+                {
+                    while (i > 0)
+                        items[--i].~T();
+                    heap::deallocate(block, bytes_for(size));
+                    throw;
+                }
+
+                *reinterpret_cast<unsigned long*>(block) = size;
+                return items;
+            }
+
+            void deallocate_array (
+                T* item
+            )
+            {
+                char* block = reinterpret_cast<char*>(item) - heap::header_size;
+                const unsigned long size = *reinterpret_cast<unsigned long*>(block);
+                for (unsigned long i = 0; i < size; ++i)
+                    item[i].~T();
+                heap::deallocate(block, bytes_for(size));
+            }
+
+            void swap (memory_manager_stateless_kernel_3&)
+            {}
+
+        private:
+
+            typedef impl::thread_caching_heap heap;
+
+            static std::size_t bytes_for (
+                unsigned long size
+            ) { return heap::header_size + size*sizeof(T); }
+
+            // restricted functions
+            memory_manager_stateless_kernel_3(memory_manager_stateless_kernel_3&);        // copy constructor
+            memory_manager_stateless_kernel_3& operator=(memory_manager_stateless_kernel_3&);    // assignment operator
+    };
+
+    template <
+        typename T
+        >
+    inline void swap (
+        memory_manager_stateless_kernel_3<T>& a,
+        memory_manager_stateless_kernel_3<T>& b
+    ) { a.swap(b); }
+
+}
+
+#endif // DLIB_MEMORY_MANAGER_STATELESs_3_
+
@@ -23,6 +23,15 @@ namespace dlib
                 implementations are allowed to have some shared global state such as a 
                 global memory pool.
 
+                kernel_1 just calls new and delete, and is what default_memory_manager
+                is.  kernel_3 keeps a cache of freed blocks per thread on top of a
+                central pool, which makes allocating and freeing many small or
+                medium blocks (up to 1MB) from several threads much cheaper.  The
+                price is memory: every block it ever pooled stays in the process, in
+                some thread's cache or the central pool, until the process ends, so
+                its footprint is the peak of what was in use rather than what is in
+                use now.  Use it only where measurements show the allocations matter.
+
             THREAD SAFETY
                 This object is thread safe.  You may access it from any thread at any time
                 without synchronizing access.
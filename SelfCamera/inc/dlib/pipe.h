@@ -4,6 +4,7 @@
 #define DLIB_PIPe_ 
 
 #include "pipe/pipe_kernel_1.h"
+#include "pipe/ring_pipe.h"
 
 
 #endif // DLIB_PIPe_
@@ -0,0 +1,926 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_RING_PIPe_
+#define DLIB_RING_PIPe_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../algs.h"
+#include "../assert.h"
+#include "../uintn.h"
+#include "ring_pipe_abstract.h"
+
+namespace dlib
+{
+
+    template <
+        typename T
+        >
+    class ring_pipe
+    {
+        /*!
+            INITIAL VALUE
+                - pipe_max_size == defined by constructor
+                - ring == a pointer to an array of pipe_max_size slots
+                - ring[i].seq == 2*i
+                - enqueue_pos == 0
+                - dequeue_pos == 0
+                - enabled == true
+                - enqueue_enabled == true
+                - dequeue_enabled == true
+                - not_empty.sleepers == not_full.sleepers == unblock.sleepers == 0
+
+            CONVENTION
+                - max_size() == pipe_max_size
+                - is_enabled() == enabled
+
+                - The ring is the bounded queue of D. Vyukov.  Every position in the
+                  stream of items, counting from 0, maps to ring[position % pipe_max_size].
+                  enqueue_pos is the next position to write and dequeue_pos the next one
+                  to read.  A thread claims a run of positions by moving one of these
+                  counters forward with a compare and swap (or a plain store if
+                  one_thread_per_side, since then only one thread moves each
+                  counter), and then owns those slots until it updates their seq:
+                    - ring[i].seq == 2*p means the slot is free for the enqueue of
+                      position p.
+                    - ring[i].seq == 2*p+1 means ring[i].item holds the item of
+                      position p, ready to be dequeued.
+                    - A dequeue of position p sets seq to 2*(p+pipe_max_size), freeing
+                      the slot for the enqueue one lap later.
+                  (Vyukov uses p and p+1 for the two states, which can't tell them
+                  apart when pipe_max_size == 1.)  The counters are 64 bits wide so
+                  they never wrap.
+                - size() == enqueue_pos - dequeue_pos
+
+                - Waiting is done through three events:
+                    - not_empty: dequeues wait on it, enqueues signal it.
+                    - not_full: enqueues and wait_until_empty() wait on it, dequeues
+                      signal it.
+                    - unblock: wait_for_num_blocked_dequeues() waits on it.  A dequeue
+                      signals it when it starts to block and when it takes an item.
+                  A thread that has to wait adds itself to the event's sleepers for
+                  the rest of its call, spins for a while and then sleeps on the
+                  event's condition variable, checking what it waits for with the
+                  event's mutex locked.  A thread that changes the ring issues a
+                  full fence and only touches the mutex and condition variable if
+                  the event has sleepers.  Since a waiter registers, fences and
+                  only then checks, either the waiter sees the change or the
+                  signaler sees the waiter, so no wakeup is lost and the common
+                  case makes no system call.
+                - not_empty.sleepers == the number of threads blocked in a dequeue
+                  function.
+                - The destructor disables the pipe and waits for the sleepers of
+                  every event to drop to 0.
+        !*/
+
+    public:
+
+        typedef T type;
+
+        explicit ring_pipe (
+            unsigned long maximum_size,
+            bool single_producer_consumer = false
+        );
+
+        virtual ~ring_pipe (
+        );
+
+        void empty (
+        );
+
+        void wait_until_empty (
+        ) const;
+
+        void wait_for_num_blocked_dequeues (
+            unsigned long num
+        )const;
+
+        void enable (
+        );
+
+        void disable (
+        );
+
+        bool is_enqueue_enabled (
+        ) const;
+
+        void disable_enqueue (
+        );
+
+        void enable_enqueue (
+        );
+
+        bool is_dequeue_enabled (
+        ) const;
+
+        void disable_dequeue (
+        );
+
+        void enable_dequeue (
+        );
+
+        bool is_enabled (
+        ) const;
+
+        unsigned long max_size (
+        ) const;
+
+        unsigned long size (
+        ) const;
+
+        bool enqueue (
+            T& item
+        ) { return enqueue_batch_internal(&item, 1, false, 0) == 1; }
+
+        bool enqueue (
+            T&& item
+        ) { return enqueue(item); }
+
+        bool dequeue (
+            T& item
+        ) { return dequeue_batch_internal(&item, 1, false, 0) == 1; }
+
+        bool enqueue_or_timeout (
+            T& item,
+            unsigned long timeout
+        ) { return enqueue_batch_internal(&item, 1, true, timeout) == 1; }
+
+        bool enqueue_or_timeout (
+            T&& item,
+            unsigned long timeout
+        ) { return enqueue_or_timeout(item,timeout); }
+
+        bool dequeue_or_timeout (
+            T& item,
+            unsigned long timeout
+        ) { return dequeue_batch_internal(&item, 1, true, timeout) == 1; }
+
+        unsigned long enqueue_batch (
+            T* items,
+            unsigned long num
+        ) { return enqueue_batch_internal(items, num, false, 0); }
+
+        unsigned long enqueue_batch_or_timeout (
+            T* items,
+            unsigned long num,
+            unsigned long timeout
+        ) { return enqueue_batch_internal(items, num, true, timeout); }
+
+        unsigned long dequeue_batch (
+            T* items,
+            unsigned long num
+        ) { return dequeue_batch_internal(items, num, false, 0); }
+
+        unsigned long dequeue_batch_or_timeout (
+            T* items,
+            unsigned long num,
+            unsigned long timeout
+        ) { return dequeue_batch_internal(items, num, true, timeout); }
+
+    private:
+
+        struct slot
+        {
+            std::atomic<uint64> seq;
+            T item;
+        };
+
+        struct event
+        {
+            event() : sleepers(0) {}
+
+            std::atomic<unsigned long> sleepers;
+            std::mutex m;
+            std::condition_variable cv;
+        };
+
+        typedef std::chrono::steady_clock::time_point time_point;
+
+        // how many times a waiting thread yields before it goes to sleep
+        const static int spin_rounds = 64;
+
+        slot& slot_of (
+            uint64 pos
+        ) const { return ring[pos_is_mask ? (pos & pos_mask) : (pos % pipe_max_size)]; }
+
+        bool can_enqueue (
+        ) const { return enabled.load(std::memory_order_relaxed) && enqueue_enabled.load(std::memory_order_relaxed); }
+
+        bool can_dequeue (
+        ) const { return enabled.load(std::memory_order_relaxed) && dequeue_enabled.load(std::memory_order_relaxed); }
+
+        bool has_room (
+        ) const;
+
+        bool has_items (
+        ) const;
+
+        unsigned long try_enqueue (
+            T* items,
+            unsigned long num
+        );
+
+        unsigned long try_dequeue (
+            T* items,
+            unsigned long num
+        );
+
+        unsigned long enqueue_batch_internal (
+            T* items,
+            unsigned long num,
+            bool timed,
+            unsigned long timeout
+        );
+
+        unsigned long dequeue_batch_internal (
+            T* items,
+            unsigned long num,
+            bool timed,
+            unsigned long timeout
+        );
+
+        void signal (
+            event& e
+        ) const;
+
+        void signal_dequeued (
+        ) const;
+
+        void broadcast (
+            event& e
+        ) const;
+
+        void start_waiting (
+            event& e
+        ) const;
+
+        void stop_waiting (
+            event& e
+        ) const;
+
+        template <typename condition>
+        bool wait (
+            event& e,
+            const condition& ready,
+            bool timed,
+            const time_point& deadline
+        ) const;
+
+        static time_point deadline_after (
+            unsigned long timeout
+        );
+
+        static unsigned long checked_max_size (
+            unsigned long maximum_size
+        );
+
+        const unsigned long pipe_max_size;
+        const bool one_thread_per_side;
+        const bool pos_is_mask;
+        const uint64 pos_mask;
+        slot* const ring;
+
+        // keep the two counters off each other's cache line and off the members
+        // above, which every call reads
+        char pad0[64];
+        std::atomic<uint64> enqueue_pos;
+        char pad1[64];
+        std::atomic<uint64> dequeue_pos;
+        char pad2[64];
+
+        std::atomic<bool> enabled;
+        std::atomic<bool> enqueue_enabled;
+        std::atomic<bool> dequeue_enabled;
+
+        mutable event not_empty;
+        mutable event not_full;
+        mutable event unblock;
+
+        // restricted functions
+        ring_pipe(const ring_pipe&);        // copy constructor
+        ring_pipe& operator=(const ring_pipe&);    // assignment operator
+
+    };
+
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+//                      member function definitions
+// ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    ring_pipe<T>::
+    ring_pipe (
+        unsigned long maximum_size,
+        bool single_producer_consumer
+    ) :
+        pipe_max_size(checked_max_size(maximum_size)),
+        one_thread_per_side(single_producer_consumer),
+        pos_is_mask((maximum_size & (maximum_size-1)) == 0),
+        pos_mask(maximum_size-1),
+        ring(new slot[maximum_size]),
+        enqueue_pos(0),
+        dequeue_pos(0),
+        enabled(true),
+        enqueue_enabled(true),
+        dequeue_enabled(true)
+    {
+        for (unsigned long i = 0; i < pipe_max_size; ++i)
+            ring[i].seq.store(2*i, std::memory_order_relaxed);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    unsigned long ring_pipe<T>::
+    checked_max_size (
+        unsigned long maximum_size
+    )
+    {
+        // Checked in release builds too, since a size of 0 would make slot_of() divide
+        // by zero.  This runs before the ring is allocated so nothing leaks.
+        DLIB_CASSERT(maximum_size > 0,
+            "\tring_pipe::ring_pipe(maximum_size)"
+            << "\n\tA ring_pipe must be able to hold at least one item."
+            );
+        return maximum_size;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    ring_pipe<T>::
+    ~ring_pipe (
+    )
+    {
+        disable();
+
+        // wait for all the threads blocked on this pipe to leave it
+        event* const events[] = { &not_empty, &not_full, &unblock };
+        for (unsigned long i = 0; i < 3; ++i)
+        {
+            std::unique_lock<std::mutex> lock(events[i]->m);
+            while (events[i]->sleepers.load() > 0)
+                events[i]->cv.wait(lock);
+        }
+
+        delete [] ring;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    empty (
+    )
+    {
+        T temp;
+        bool took_any = false;
+        while (try_dequeue(&temp, 1) == 1)
+            took_any = true;
+
+        if (took_any)
+            signal_dequeued();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    wait_until_empty (
+    ) const
+    {
+        if (size() == 0 || !can_dequeue())
+            return;
+
+        start_waiting(not_full);
+        wait(not_full, [this]() { return size() == 0 || !can_dequeue(); }, false, time_point());
+        stop_waiting(not_full);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    wait_for_num_blocked_dequeues (
+        unsigned long num
+    ) const
+    {
+        auto done = [this,num]() {
+            return (not_empty.sleepers.load() >= num && size() == 0) || !can_dequeue();
+        };
+        if (done())
+            return;
+
+        start_waiting(unblock);
+        wait(unblock, done, false, time_point());
+        stop_waiting(unblock);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    enable (
+    )
+    {
+        enabled = true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    disable (
+    )
+    {
+        enabled = false;
+        broadcast(not_empty);
+        broadcast(not_full);
+        broadcast(unblock);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    bool ring_pipe<T>::
+    is_enabled (
+    ) const
+    {
+        return enabled;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    unsigned long ring_pipe<T>::
+    max_size (
+    ) const
+    {
+        return pipe_max_size;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    unsigned long ring_pipe<T>::
+    size (
+    ) const
+    {
+        // read dequeue_pos first so that, with both only moving forward, the
+        // difference can't come out negative
+        const uint64 first = dequeue_pos.load(std::memory_order_acquire);
+        const uint64 last = enqueue_pos.load(std::memory_order_acquire);
+        const uint64 count = last - first;
+        return static_cast<unsigned long>(count < pipe_max_size ? count : pipe_max_size);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    bool ring_pipe<T>::
+    is_enqueue_enabled (
+    ) const
+    {
+        return enqueue_enabled;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    disable_enqueue (
+    )
+    {
+        enqueue_enabled = false;
+        broadcast(not_full);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    enable_enqueue (
+    )
+    {
+        enqueue_enabled = true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    bool ring_pipe<T>::
+    is_dequeue_enabled (
+    ) const
+    {
+        return dequeue_enabled;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    disable_dequeue (
+    )
+    {
+        dequeue_enabled = false;
+        broadcast(not_empty);
+        broadcast(not_full);
+        broadcast(unblock);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    enable_dequeue (
+    )
+    {
+        dequeue_enabled = true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    bool ring_pipe<T>::
+    has_room (
+    ) const
+    {
+        const uint64 pos = enqueue_pos.load(std::memory_order_relaxed);
+        return static_cast<int64>(slot_of(pos).seq.load(std::memory_order_acquire) - 2*pos) >= 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    bool ring_pipe<T>::
+    has_items (
+    ) const
+    {
+        const uint64 pos = dequeue_pos.load(std::memory_order_relaxed);
+        return static_cast<int64>(slot_of(pos).seq.load(std::memory_order_acquire) - (2*pos+1)) >= 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    unsigned long ring_pipe<T>::
+    try_enqueue (
+        T* items,
+        unsigned long num
+    )
+    {
+        uint64 pos = enqueue_pos.load(std::memory_order_relaxed);
+        unsigned long count;
+        for (;;)
+        {
+            const int64 dif = static_cast<int64>(slot_of(pos).seq.load(std::memory_order_acquire) - 2*pos);
+            if (dif < 0)
+                return 0;   // full
+            if (dif > 0)
+            {
+                // another thread took this position, catch up
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            // the free slots after the first one are only ours if they are free
+            // now, since nobody can take them until enqueue_pos moves past pos
+            count = 1;
+            while (count < num && slot_of(pos+count).seq.load(std::memory_order_acquire) == 2*(pos+count))
+                ++count;
+
+            if (one_thread_per_side)
+            {
+                enqueue_pos.store(pos+count, std::memory_order_relaxed);
+                break;
+            }
+            if (enqueue_pos.compare_exchange_weak(pos, pos+count, std::memory_order_relaxed))
+                break;
+        }
+
+        for (unsigned long i = 0; i < count; ++i)
+        {
+            slot& s = slot_of(pos+i);
+            exchange(items[i], s.item);
+            s.seq.store(2*(pos+i)+1, std::memory_order_release);
+        }
+        return count;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    unsigned long ring_pipe<T>::
+    try_dequeue (
+        T* items,
+        unsigned long num
+    )
+    {
+        uint64 pos = dequeue_pos.load(std::memory_order_relaxed);
+        unsigned long count;
+        for (;;)
+        {
+            const int64 dif = static_cast<int64>(slot_of(pos).seq.load(std::memory_order_acquire) - (2*pos+1));
+            if (dif < 0)
+                return 0;   // empty, or the next item isn't written yet
+            if (dif > 0)
+            {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            count = 1;
+            while (count < num && slot_of(pos+count).seq.load(std::memory_order_acquire) == 2*(pos+count)+1)
+                ++count;
+
+            if (one_thread_per_side)
+            {
+                dequeue_pos.store(pos+count, std::memory_order_relaxed);
+                break;
+            }
+            if (dequeue_pos.compare_exchange_weak(pos, pos+count, std::memory_order_relaxed))
+                break;
+        }
+
+        for (unsigned long i = 0; i < count; ++i)
+        {
+            slot& s = slot_of(pos+i);
+            exchange(items[i], s.item);
+            s.seq.store(2*(pos+i+pipe_max_size), std::memory_order_release);
+        }
+        return count;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    unsigned long ring_pipe<T>::
+    enqueue_batch_internal (
+        T* items,
+        unsigned long num,
+        bool timed,
+        unsigned long timeout
+    )
+    {
+        if (!can_enqueue() || num == 0)
+            return 0;
+
+        unsigned long count = try_enqueue(items, num);
+        if (count > 0)
+            signal(not_empty);
+        if (count == num || (timed && timeout == 0))
+            return count;
+
+        // the pipe is full, so wait for room
+        const time_point deadline = timed ? deadline_after(timeout) : time_point();
+        start_waiting(not_full);
+        for (;;)
+        {
+            if (!wait(not_full, [this]() { return has_room() || !can_enqueue(); }, timed, deadline) ||
+                !can_enqueue())
+                break;
+
+            const unsigned long added = try_enqueue(items+count, num-count);
+            if (added > 0)
+            {
+                count += added;
+                signal(not_empty);
+                if (count == num)
+                    break;
+            }
+        }
+        stop_waiting(not_full);
+        return count;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    unsigned long ring_pipe<T>::
+    dequeue_batch_internal (
+        T* items,
+        unsigned long num,
+        bool timed,
+        unsigned long timeout
+    )
+    {
+        if (!can_dequeue() || num == 0)
+            return 0;
+
+        unsigned long count = try_dequeue(items, num);
+        if (count > 0)
+        {
+            signal_dequeued();
+            return count;
+        }
+        if (timed && timeout == 0)
+            return 0;
+
+        // the pipe is empty, so wait for an item
+        const time_point deadline = timed ? deadline_after(timeout) : time_point();
+        start_waiting(not_empty);
+        signal(unblock);
+        for (;;)
+        {
+            if (!wait(not_empty, [this]() { return has_items() || !can_dequeue(); }, timed, deadline) ||
+                !can_dequeue())
+                break;
+
+            count = try_dequeue(items, num);
+            if (count > 0)
+            {
+                signal_dequeued();
+                break;
+            }
+        }
+        stop_waiting(not_empty);
+        return count;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    signal (
+        event& e
+    ) const
+    {
+        // pairs with the fence in start_waiting()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (e.sleepers.load(std::memory_order_relaxed) > 0)
+            broadcast(e);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    signal_dequeued (
+    ) const
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (not_full.sleepers.load(std::memory_order_relaxed) > 0)
+            broadcast(not_full);
+        if (unblock.sleepers.load(std::memory_order_relaxed) > 0)
+            broadcast(unblock);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    broadcast (
+        event& e
+    ) const
+    {
+        // Taking the mutex orders this with a waiter that has checked its condition
+        // but not gone to sleep yet.
+        std::lock_guard<std::mutex> lock(e.m);
+        e.cv.notify_all();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    start_waiting (
+        event& e
+    ) const
+    {
+        e.sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    void ring_pipe<T>::
+    stop_waiting (
+        event& e
+    ) const
+    {
+        // Leave under the mutex, so that once the destructor sees no sleepers it
+        // can't pull the pipe out from under a thread still on its way out.
+        std::lock_guard<std::mutex> lock(e.m);
+        e.sleepers.fetch_sub(1);
+        // let the destructor know we are leaving if it is waiting for us
+        if (!enabled.load())
+            e.cv.notify_all();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    template <
+        typename condition
+        >
+    bool ring_pipe<T>::
+    wait (
+        event& e,
+        const condition& ready,
+        bool timed,
+        const time_point& deadline
+    ) const
+    {
+        for (int i = 0; i < spin_rounds; ++i)
+        {
+            if (ready())
+                return true;
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(e.m);
+        while (!ready())
+        {
+            if (!timed)
+                e.cv.wait(lock);
+            else if (e.cv.wait_until(lock, deadline) == std::cv_status::timeout)
+                return ready();
+        }
+        return true;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename T
+        >
+    typename ring_pipe<T>::time_point ring_pipe<T>::
+    deadline_after (
+        unsigned long timeout
+    )
+    {
+        // cap the timeout at about a hundred years so the deadline can't overflow
+        const uint64 max_timeout = 100ULL*365*24*60*60*1000;
+        return std::chrono::steady_clock::now() + std::chrono::milliseconds(
+            static_cast<long long>(timeout < max_timeout ? timeout : max_timeout));
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_RING_PIPe_
+
@@ -0,0 +1,401 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_RING_PIPe_ABSTRACT_
+#ifdef DLIB_RING_PIPe_ABSTRACT_
+
+#include "pipe_kernel_abstract.h"
+
+namespace dlib
+{
+
+    template <
+        typename T
+        >
+    class ring_pipe
+    {
+        /*!
+            REQUIREMENTS ON T
+                T must be swappable by a global swap()
+                T must have a default constructor
+
+            INITIAL VALUE
+                size() == 0
+                is_enabled() == true
+                is_enqueue_enabled() == true
+                is_dequeue_enabled() == true
+
+            WHAT THIS OBJECT REPRESENTS
+                This is a first in first out queue with a fixed maximum size containing
+                items of type T.  It has the same interface and blocking, timeout and
+                disable semantics as dlib::pipe, so the two can be swapped for each
+                other, except that max_size() must be at least 1.
+
+                The difference is in how it is implemented.  dlib::pipe serializes
+                every call on a mutex.  This object is a lock-free ring buffer instead,
+                so enqueue and dequeue calls that don't have to wait touch nothing
+                but the ring and two counters and never make a system call, whether
+                there is one producer and one consumer or many of each.  A thread
+                only sleeps, on a condition variable, when the pipe is full (for
+                enqueues) or empty (for dequeues), and it spins for a moment first
+                since the wait is usually short.
+
+                It also has enqueue_batch() and dequeue_batch(), which move many items
+                for the cost of one.
+
+            THREAD SAFETY
+                All methods of this class are thread safe.  You may call them from any
+                thread and any number of threads my call them at once.
+        !*/
+
+    public:
+
+        typedef T type;
+
+        explicit ring_pipe (
+            unsigned long maximum_size,
+            bool single_producer_consumer = false
+        );
+        /*!
+            requires
+                - maximum_size > 0
+                - if (single_producer_consumer) then
+                    - no two threads ever call the enqueue functions at the same
+                      time, and no two threads ever call the dequeue functions or
+                      empty() at the same time.  This lets the pipe claim places
+                      in the ring with plain stores instead of compare and swaps.
+            ensures
+                - #*this is properly initialized
+                - #max_size() == maximum_size
+            throws
+                - std::bad_alloc
+                - dlib::fatal_error
+                    if maximum_size == 0.  This is checked even when asserts are
+                    disabled.  Unlike pipe, a ring_pipe has no zero size handoff mode,
+                    since every item has to sit in a slot of the ring.
+        !*/
+
+        virtual ~ring_pipe (
+        );
+        /*!
+            ensures
+                - any resources associated with *this have been released
+                - disables (i.e. sets is_enabled() == false) this object so that
+                  all calls currently blocking on it will return immediately.
+        !*/
+
+        void enable (
+        );
+        /*!
+            ensures
+                - #is_enabled() == true
+        !*/
+
+        void disable (
+        );
+        /*!
+            ensures
+                - #is_enabled() == false
+                - causes all current and future calls to enqueue(), dequeue(),
+                  enqueue_or_timeout(), dequeue_or_timeout() and the batch
+                  versions of these functions to not block but to return
+                  immediately until enable() is called.
+                - causes all current and future calls to wait_until_empty() and
+                  wait_for_num_blocked_dequeues() to not block but return
+                  immediately until enable() is called.
+        !*/
+
+        bool is_enabled (
+        ) const;
+        /*!
+            ensures
+                - returns true if this pipe is currently enabled, false otherwise.
+        !*/
+
+        void empty (
+        );
+        /*!
+            ensures
+                - #size() == 0
+        !*/
+
+        void wait_until_empty (
+        ) const;
+        /*!
+            ensures
+                - blocks until one of the following is the case:
+                    - size() == 0
+                    - is_enabled() == false
+                    - is_dequeue_enabled() == false
+        !*/
+
+        void wait_for_num_blocked_dequeues (
+           unsigned long num
+        ) const;
+        /*!
+            ensures
+                - blocks until one of the following is the case:
+                    - size() == 0 and the number of threads blocked on calls
+                      to dequeue(), dequeue_or_timeout(), dequeue_batch() and
+                      dequeue_batch_or_timeout() is greater than or equal to num.
+                    - is_enabled() == false
+                    - is_dequeue_enabled() == false
+        !*/
+
+        bool is_enqueue_enabled (
+        ) const;
+        /*!
+            ensures
+                - returns true if the enqueue functions are currently enabled, returns
+                  false otherwise.  (note that the higher level is_enabled() function
+                  can overrule this one, just as it does for dlib::pipe)
+        !*/
+
+        void disable_enqueue (
+        );
+        /*!
+            ensures
+                - #is_enqueue_enabled() == false
+                - causes all current and future calls to the enqueue functions to not
+                  block but to return immediately until enable_enqueue() is called.
+        !*/
+
+        void enable_enqueue (
+        );
+        /*!
+            ensures
+                - #is_enqueue_enabled() == true
+        !*/
+
+        bool is_dequeue_enabled (
+        ) const;
+        /*!
+            ensures
+                - returns true if the dequeue functions are currently enabled, returns
+                  false otherwise.  (note that the higher level is_enabled() function
+                  can overrule this one, just as it does for dlib::pipe)
+        !*/
+
+        void disable_dequeue (
+        );
+        /*!
+            ensures
+                - #is_dequeue_enabled() == false
+                - causes all current and future calls to the dequeue functions to not
+                  block but to return immediately until enable_dequeue() is called.
+        !*/
+
+        void enable_dequeue (
+        );
+        /*!
+            ensures
+                - #is_dequeue_enabled() == true
+        !*/
+
+        unsigned long max_size (
+        ) const;
+        /*!
+            ensures
+                - returns the maximum number of objects of type T that this
+                  pipe can contain.
+        !*/
+
+        unsigned long size (
+        ) const;
+        /*!
+            ensures
+                - returns the number of objects of type T that this
+                  object currently contains.  While other threads are in the
+                  middle of enqueueing or dequeueing this counts the items they
+                  have claimed a place for, so it can be slightly ahead of what a
+                  dequeue would find.
+        !*/
+
+        bool enqueue (
+            T& item
+        );
+        /*!
+            ensures
+                - if (size() == max_size()) then
+                    - this call to enqueue() blocks until one of the following is the case:
+                        - there is room in the pipe for another item
+                        - someone calls disable()
+                        - someone calls disable_enqueue()
+                - else
+                    - this call does not block.
+                - if (this call to enqueue() returns true) then
+                    - #is_enabled() == true
+                    - #is_enqueue_enabled() == true
+                    - using global swap, item was added into this pipe.
+                    - #item is in an undefined but valid state for its type
+                - else
+                    - item was NOT added into the pipe
+                    - #item == item (i.e. the value of item is unchanged)
+        !*/
+
+        bool enqueue (T&& item) { return enqueue(item); }
+        /*!
+            enable enqueueing from rvalues
+        !*/
+
+        bool enqueue_or_timeout (
+            T& item,
+            unsigned long timeout
+        );
+        /*!
+            ensures
+                - if (size() == max_size() && timeout > 0) then
+                    - this call to enqueue_or_timeout() blocks until one of the following is the case:
+                        - there is room in the pipe to add another item
+                        - someone calls disable()
+                        - someone calls disable_enqueue()
+                        - timeout milliseconds passes
+                - else
+                    - this call does not block.
+                - if (this call to enqueue() returns true) then
+                    - #is_enabled() == true
+                    - #is_enqueue_enabled() == true
+                    - using global swap, item was added into this pipe.
+                    - #item is in an undefined but valid state for its type
+                - else
+                    - item was NOT added into the pipe
+                    - #item == item (i.e. the value of item is unchanged)
+        !*/
+
+        bool enqueue_or_timeout (T&& item, unsigned long timeout) { return enqueue_or_timeout(item,timeout); }
+        /*!
+            enable enqueueing from rvalues
+        !*/
+
+        bool dequeue (
+            T& item
+        );
+        /*!
+            ensures
+                - if (size() == 0) then
+                    - this call to dequeue() blocks until one of the following is the case:
+                        - there is something in the pipe we can dequeue
+                        - someone calls disable()
+                        - someone calls disable_dequeue()
+                - else
+                    - this call does not block.
+                - if (this call to dequeue() returns true) then
+                    - #is_enabled() == true
+                    - #is_dequeue_enabled() == true
+                    - the oldest item that was enqueued into this pipe has been
+                      swapped into #item.
+                - else
+                    - nothing was dequeued from this pipe.
+                    - #item == item (i.e. the value of item is unchanged)
+        !*/
+
+        bool dequeue_or_timeout (
+            T& item,
+            unsigned long timeout
+        );
+        /*!
+            ensures
+                - if (size() == 0 && timeout > 0) then
+                    - this call to dequeue_or_timeout() blocks until one of the following is the case:
+                        - there is something in the pipe we can dequeue
+                        - someone calls disable()
+                        - someone calls disable_dequeue()
+                        - timeout milliseconds passes
+                - else
+                    - this call does not block.
+                - if (this call to dequeue_or_timeout() returns true) then
+                    - #is_enabled() == true
+                    - #is_dequeue_enabled() == true
+                    - the oldest item that was enqueued into this pipe has been
+                      swapped into #item.
+                - else
+                    - nothing was dequeued from this pipe.
+                    - #item == item (i.e. the value of item is unchanged)
+        !*/
+
+        unsigned long enqueue_batch (
+            T* items,
+            unsigned long num
+        );
+        /*!
+            requires
+                - items == a pointer to an array of at least num T objects
+            ensures
+                - adds items[0], items[1], ..., items[num-1] into this pipe, in that
+                  order, taking as many places at once as the pipe has free.  Blocks
+                  whenever the pipe is full until one of the following is the case:
+                    - all num items have been added
+                    - someone calls disable()
+                    - someone calls disable_enqueue()
+                - returns the number of items added.  That is, items[0] through
+                  items[#returned value-1] were swapped into the pipe, as if by
+                  enqueue(), and are in an undefined but valid state for their type,
+                  while the remaining items are unchanged.
+                - if (#returned value < num) then
+                    - the pipe was disabled for enqueueing before all the items
+                      could be added.
+        !*/
+
+        unsigned long enqueue_batch_or_timeout (
+            T* items,
+            unsigned long num,
+            unsigned long timeout
+        );
+        /*!
+            requires
+                - items == a pointer to an array of at least num T objects
+            ensures
+                - does the same thing as enqueue_batch() except that it blocks for
+                  at most timeout milliseconds in total.  If timeout == 0 it adds
+                  only what fits without blocking.
+                - returns the number of items added.  That is, items[0] through
+                  items[#returned value-1] were swapped into the pipe and the
+                  remaining items are unchanged.
+        !*/
+
+        unsigned long dequeue_batch (
+            T* items,
+            unsigned long num
+        );
+        /*!
+            requires
+                - items == a pointer to an array of at least num T objects
+            ensures
+                - if (size() == 0 && num > 0) then
+                    - this call to dequeue_batch() blocks until one of the following is the case:
+                        - there is something in the pipe we can dequeue
+                        - someone calls disable()
+                        - someone calls disable_dequeue()
+                - takes up to num of the oldest items in the pipe, as many as are
+                  in it, and swaps them into items[0], items[1], ... in the order
+                  they were enqueued.  It doesn't block again to fill the array.
+                - returns the number of items dequeued.  The items past
+                  items[#returned value-1] are unchanged.
+                - if (#returned value == 0 && num > 0) then
+                    - the pipe was disabled for dequeueing.
+        !*/
+
+        unsigned long dequeue_batch_or_timeout (
+            T* items,
+            unsigned long num,
+            unsigned long timeout
+        );
+        /*!
+            requires
+                - items == a pointer to an array of at least num T objects
+            ensures
+                - does the same thing as dequeue_batch() except that it blocks for
+                  at most timeout milliseconds.  If timeout == 0 it doesn't block.
+                - returns the number of items dequeued.  The items past
+                  items[#returned value-1] are unchanged.
+        !*/
+
+    private:
+
+        // restricted functions
+        ring_pipe(const ring_pipe&);        // copy constructor
+        ring_pipe& operator=(const ring_pipe&);    // assignment operator
+
+    };
+
+}
+
+#endif // DLIB_RING_PIPe_ABSTRACT_
@@ -136,6 +136,27 @@
         then serialize the exponent and mantissa values using dlib's integral serialization
         format.  Therefore, the output is first the exponent and then the mantissa.  Note that
         the mantissa is a signed integer (i.e. there is not a separate sign bit).
+
+    BULK ARRAY SERIALIZATION FORMAT
+        The format above costs a stream call and some bit twiddling per number, which
+        dominates the load time of large arrays such as model parameters.  So arrays of
+        integers (other than bool) and IEEE floats can also be written with the opt-in
+        functions:
+            serialize_bulk(const T* data, unsigned long size, std::ostream& out);
+            serialize_bulk(const std::vector<T>& item, std::ostream& out);
+        and read back with the matching deserialize_bulk() overloads.  The pointer
+        version of deserialize_bulk() requires the stored array to have exactly size
+        elements.  A bulk array is the byte 1 (the format version), a byte saying what
+        kind of number follows ('i' for signed, 'u' for unsigned, 'f' for floating
+        point), a byte holding sizeof of that number, the element count in the integral
+        format, and then the elements themselves as raw little endian bytes.  The
+        element type must match when deserializing: unlike the integral format a bulk
+        array of 32 bit integers can not be read into 64 bit integers.  Use fixed size
+        types such as dlib::uint32 for data that has to move between platforms.
+
+        The bulk format is not what serialize() writes, so objects that want it must
+        say so in their own versioned format.  That keeps files written before it
+        existed readable.
 !*/
 
 
@@ -1053,6 +1074,151 @@ namespace dlib
         { throw serialization_error(e.info + "\n   while deserializing object of type std::vector"); }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace ser_helper
+    {
+        template <typename T>
+        struct bulk_kind
+        {
+            // Only plain numbers whose bytes mean the same thing on every platform can
+            // be moved in bulk: integers other than bool, and IEEE floats.
+            const static char value = 
+                (is_same_type<T,bool>::value) ? 0 :
+                (std::numeric_limits<T>::is_integer) ? (std::numeric_limits<T>::is_signed ? 'i' : 'u') :
+                (std::numeric_limits<T>::is_iec559) ? 'f' : 0;
+        };
+
+        const unsigned char bulk_format_version = 1;
+    }
+
+    template <typename T>
+    void serialize_bulk (
+        const T* data,
+        unsigned long size,
+        std::ostream& out
+    )
+    {
+        COMPILE_TIME_ASSERT(ser_helper::bulk_kind<T>::value != 0);
+        try
+        {
+            out.put(ser_helper::bulk_format_version);
+            out.put(ser_helper::bulk_kind<T>::value);
+            out.put(static_cast<char>(sizeof(T)));
+            serialize(size,out);
+
+            const byte_orderer bo;
+            if (bo.host_is_little_endian())
+            {
+                if (size != 0)
+                    out.write(reinterpret_cast<const char*>(data), sizeof(T)*size);
+            }
+            else
+            {
+                // swap a block at a time so big endian hosts still write in large pieces
+                T buf[1024];
+                for (unsigned long i = 0; i < size; i += 1024)
+                {
+                    const unsigned long n = std::min<unsigned long>(1024, size-i);
+                    for (unsigned long j = 0; j < n; ++j)
+                    {
+                        buf[j] = data[i+j];
+                        bo.host_to_little(buf[j]);
+                    }
+                    out.write(reinterpret_cast<const char*>(buf), sizeof(T)*n);
+                }
+            }
+            if (!out)
+                throw serialization_error("Error serializing bulk array");
+        }
+        catch (serialization_error& e)
+        { throw serialization_error(e.info + "\n   while serializing a bulk array"); }
+    }
+
+    template <typename T>
+    unsigned long deserialize_bulk_header (
+        std::istream& in
+    )
+    {
+        COMPILE_TIME_ASSERT(ser_helper::bulk_kind<T>::value != 0);
+        const int version = in.get();
+        const int kind = in.get();
+        const int bytes = in.get();
+        if (!in)
+            throw serialization_error("Error deserializing bulk array header");
+        if (version != ser_helper::bulk_format_version)
+            throw serialization_error("Unexpected bulk array format version");
+        if (kind != ser_helper::bulk_kind<T>::value || bytes != sizeof(T))
+            throw serialization_error("The bulk array holds a different element type than the one requested");
+        unsigned long size;
+        deserialize(size,in);
+        return size;
+    }
+
+    template <typename T>
+    void deserialize_bulk_data (
+        T* data,
+        unsigned long size,
+        std::istream& in
+    )
+    {
+        if (size != 0)
+            in.read(reinterpret_cast<char*>(data), sizeof(T)*size);
+        if (!in)
+            throw serialization_error("Error deserializing bulk array data");
+
+        const byte_orderer bo;
+        if (bo.host_is_big_endian())
+        {
+            for (unsigned long i = 0; i < size; ++i)
+                bo.little_to_host(data[i]);
+        }
+    }
+
+    template <typename T>
+    void deserialize_bulk (
+        T* data,
+        unsigned long size,
+        std::istream& in
+    )
+    {
+        try
+        {
+            if (deserialize_bulk_header<T>(in) != size)
+                throw serialization_error("The bulk array has the wrong number of elements");
+            deserialize_bulk_data(data, size, in);
+        }
+        catch (serialization_error& e)
+        { throw serialization_error(e.info + "\n   while deserializing a bulk array"); }
+    }
+
+    template <typename T, typename alloc>
+    void serialize_bulk (
+        const std::vector<T,alloc>& item,
+        std::ostream& out
+    )
+    {
+        serialize_bulk(item.size() != 0 ? &item[0] : (const T*)0, item.size(), out);
+    }
+
+    template <typename T, typename alloc>
+    void deserialize_bulk (
+        std::vector<T,alloc>& item,
+        std::istream& in
+    )
+    {
+        try
+        {
+            item.resize(deserialize_bulk_header<T>(in));
+            deserialize_bulk_data(item.size() != 0 ? &item[0] : (T*)0, item.size(), in);
+        }
+        catch (serialization_error& e)
+        { 
+            item.clear();
+            throw serialization_error(e.info + "\n   while deserializing a bulk std::vector"); 
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <typename T, typename alloc>
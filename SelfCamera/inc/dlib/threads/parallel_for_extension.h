@@ -93,7 +93,9 @@ namespace dlib
             << "\n\t chunks_per_thread: " << chunks_per_thread
             );
 
-        if (tp.num_threads_in_pool() != 0)
+        // Inside a task of tp the other workers are already busy with the rest of the
+        // outer loop, so splitting this one up would only add scheduling overhead.
+        if (!tp.is_task_thread())
         {
             const long num = end-begin;
             const long num_workers = static_cast<long>(tp.num_threads_in_pool());
@@ -107,9 +109,9 @@ namespace dlib
         }
         else
         {
-            // Since there aren't any threads in the pool we might as well just invoke
-            // the function directly since that's all the thread_pool object would do.
-            // But doing it ourselves skips a mutex lock.
+            // Either there aren't any threads in the pool or this is a nested
+            // parallel_for running on one of them.  Both ways the calling thread is the
+            // one to do the work, so call the function directly.
             (obj.*funct)(begin, end);
         }
     }
@@ -41,6 +41,10 @@ namespace dlib
               processing such that (obj.*funct)(begin[i], end[i]) is invoked for all valid
               values of i.  Moreover, the subranges are non-overlapping and completely
               cover the total range of [begin, end).
+            - if (tp.is_task_thread() == true) then
+                - (obj.*funct)(begin, end) is called directly in the calling thread.  In
+                  particular, a parallel_for nested inside a task of tp runs inline
+                  rather than splitting up work the other workers have no time for.
             - This function will not perform any memory allocations or create any system
               resources such as mutex objects.
     !*/
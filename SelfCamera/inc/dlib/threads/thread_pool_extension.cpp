@@ -1,7 +1,7 @@
 // Copyright (C) 2008  Davis E. King (davis@dlib.net)
 // License: Boost Software License   See LICENSE.txt for the full license.
 #ifndef DLIB_THREAD_POOl_CPPh_
-#define DLIB_THREAD_POOl_CPPh_ 
+#define DLIB_THREAD_POOl_CPPh_
 
 #include "thread_pool_extension.h"
 #include <memory>
@@ -9,21 +9,217 @@
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <typename T>
+        class work_stealing_deque
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is the deque of Chase and Lev ("Dynamic Circular Work-Stealing
+                    Deque", SPAA 2005) with the memory orderings of Le et al. ("Correct
+                    and Efficient Work-Stealing for Weak Memory Models", PPoPP 2013).
+                    The thread that owns it calls push() and pop(), which work on the
+                    bottom end.  Any other thread can call steal(), which takes from the
+                    top end.  Only the steals that race for the very last item contend.
+
+                    The fences of the paper are folded into sequentially consistent
+                    loads and stores, which gives the same guarantees.  When the ring
+                    fills up it is replaced by one twice as large.  The old rings are
+                    kept until the deque is destroyed since a thief may still be reading
+                    from one.
+            !*/
+        public:
+            work_stealing_deque (
+            ) : top(0), bottom(0)
+            {
+                rings.push_back(std::unique_ptr<ring>(new ring(256)));
+                items.store(rings.back().get(), std::memory_order_relaxed);
+            }
+
+            void push (
+                T* item
+            )
+            {
+                const long b = bottom.load(std::memory_order_relaxed);
+                const long t = top.load(std::memory_order_acquire);
+                ring* r = items.load(std::memory_order_relaxed);
+                if (b - t > r->capacity() - 1)
+                    r = grow(r, t, b);
+                r->put(b, item);
+                bottom.store(b+1, std::memory_order_release);
+            }
+
+            T* pop (
+            )
+            {
+                const long b = bottom.load(std::memory_order_relaxed) - 1;
+                ring* r = items.load(std::memory_order_relaxed);
+                bottom.store(b, std::memory_order_seq_cst);
+                long t = top.load(std::memory_order_seq_cst);
+                if (t > b)
+                {
+                    // empty
+                    bottom.store(b+1, std::memory_order_relaxed);
+                    return 0;
+                }
+
+                T* item = r->get(b);
+                if (t == b)
+                {
+                    // this is the last item so race the thieves for it
+                    if (!top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                        item = 0;
+                    bottom.store(b+1, std::memory_order_relaxed);
+                }
+                return item;
+            }
+
+            T* steal (
+            )
+            {
+                long t = top.load(std::memory_order_seq_cst);
+                const long b = bottom.load(std::memory_order_seq_cst);
+                if (t >= b)
+                    return 0;
+
+                ring* r = items.load(std::memory_order_acquire);
+                T* item = r->get(t);
+                if (!top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    return 0; // lost the race to another thief or the owner
+                return item;
+            }
+
+            bool empty (
+            ) const
+            {
+                return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+            }
+
+        private:
+
+            struct ring
+            {
+                explicit ring(long size) : mask(size-1), slots(new std::atomic<T*>[size]) {}
+
+                long capacity() const { return mask+1; }
+                T* get(long i) const { return slots[i&mask].load(std::memory_order_relaxed); }
+                void put(long i, T* item) { slots[i&mask].store(item, std::memory_order_relaxed); }
+
+                const long mask;
+                std::unique_ptr<std::atomic<T*>[]> slots;
+            };
+
+            ring* grow (
+                ring* r,
+                long t,
+                long b
+            )
+            {
+                ring* bigger = new ring(2*r->capacity());
+                for (long i = t; i < b; ++i)
+                    bigger->put(i, r->get(i));
+                rings.push_back(std::unique_ptr<ring>(bigger));
+                items.store(bigger, std::memory_order_release);
+                return bigger;
+            }
+
+            std::atomic<long> top;
+            std::atomic<long> bottom;
+            std::atomic<ring*> items;
+            std::vector<std::unique_ptr<ring> > rings; // only touched by the owner
+        };
+
+        inline uint64 next_thread_pool_serial (
+        )
+        {
+            static std::atomic<uint64> serial(1);
+            return serial.fetch_add(1);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    struct thread_pool_implementation::task_group
+    {
+        explicit task_group(thread_id_type id) : thread_id(id), pending(0) {}
+
+        const thread_id_type thread_id;
+        std::atomic<long> pending; // tasks submitted by thread_id that haven't finished
+    };
+
+    struct thread_pool_implementation::worker_state
+    {
+        worker_state(
+            thread_pool_implementation* pool_,
+            unsigned long index
+        ) : pool(pool_), free_records(0), num_free(0), rand_state(2463534242UL + index*7919) {}
+
+        thread_pool_implementation* const pool;
+        impl::work_stealing_deque<task_record> deque;
+        task_record* free_records; // only touched by this worker
+        unsigned long num_free;
+        uint32 rand_state;
+
+        unsigned long next_random (
+        )
+        {
+            // xorshift32, only used to pick whom to steal from
+            rand_state ^= rand_state << 13;
+            rand_state ^= rand_state >> 17;
+            rand_state ^= rand_state << 5;
+            return rand_state;
+        }
+    };
+
+    thread_local thread_pool_implementation::worker_state* thread_pool_implementation::this_worker = 0;
+    thread_local uint64 thread_pool_implementation::cached_group_serial = 0;
+    thread_local thread_pool_implementation::task_group* thread_pool_implementation::cached_group = 0;
+
 // ----------------------------------------------------------------------------------------
 
     thread_pool_implementation::
     thread_pool_implementation (
         unsigned long num_threads
-    ) : 
-        task_done_signaler(m),
-        task_ready_signaler(m),
+    ) :
+        serial(impl::next_thread_pool_serial()),
+        inject_head(0),
+        inject_tail(0),
+        inject_size(0),
+        free_records(0),
+        record_blocks(new std::atomic<task_record*>[max_record_blocks]),
+        num_record_blocks(0),
+        num_record_waiters(0),
+        outstanding(0),
+        work_epoch(0),
+        num_sleeping(0),
+        num_waiters(0),
+        num_parked(0),
+        has_exception(false),
         we_are_destructing(false)
     {
-        tasks.resize(num_threads);
+        for (unsigned long i = 0; i < max_record_blocks; ++i)
+            record_blocks[i].store(0, std::memory_order_relaxed);
+
+        if (num_threads != 0)
+        {
+            // Enough records for the usual number of tasks in flight, so normal use
+            // doesn't allocate after this point.
+            std::lock_guard<std::mutex> lock(inject_m);
+            add_record_block();
+        }
+
+        workers.resize(num_threads);
+        for (unsigned long i = 0; i < num_threads; ++i)
+            workers[i].reset(new worker_state(this, i));
+
         threads.resize(num_threads);
         for (unsigned long i = 0; i < num_threads; ++i)
         {
-            threads[i] = std::thread([&](){this->thread();});
+            worker_state* w = workers[i].get();
+            threads[i] = std::thread([this,w](){this->thread(w);});
         }
     }
 
@@ -33,31 +229,14 @@ namespace dlib
     shutdown_pool (
     )
     {
-        {
-            auto_mutex M(m);
-            
-            // first wait for all pending tasks to finish
-            bool found_task = true;
-            while (found_task)
-            {
-                found_task = false;
-                for (unsigned long i = 0; i < tasks.size(); ++i)
-                {
-                    // If task bucket i has a task that is currently supposed to be processed
-                    if (tasks[i].is_empty() == false)
-                    {
-                        found_task = true;
-                        break;
-                    }
-                }
-
-                if (found_task)
-                    task_done_signaler.wait();
-            }
+        // first wait for all pending tasks to finish
+        wait_until([this](){ return outstanding.load() == 0; });
 
-            // now tell the threads to kill themselves
-            we_are_destructing = true;
-            task_ready_signaler.broadcast();
+        // now tell the threads to kill themselves
+        we_are_destructing = true;
+        {
+            std::lock_guard<std::mutex> lock(sleep_m);
+            sleep_cv.notify_all();
         }
 
         // wait for all threads to terminate
@@ -67,8 +246,7 @@ namespace dlib
 
         // Throw any unhandled exceptions.  Since shutdown_pool() is only called in the
         // destructor this will kill the program.
-        for (auto&& task : tasks)
-            task.propagate_exception();
+        propagate_exception();
     }
 
 // ----------------------------------------------------------------------------------------
@@ -77,6 +255,8 @@ namespace dlib
     ~thread_pool_implementation()
     {
         shutdown_pool();
+        for (unsigned long i = 0; i < num_record_blocks; ++i)
+            delete [] record_blocks[i].load();
     }
 
 // ----------------------------------------------------------------------------------------
@@ -85,8 +265,7 @@ namespace dlib
     num_threads_in_pool (
     ) const
     {
-        auto_mutex M(m);
-        return tasks.size();
+        return workers.size();
     }
 
 // ----------------------------------------------------------------------------------------
@@ -96,16 +275,15 @@ namespace dlib
         uint64 task_id
     ) const
     {
-        auto_mutex M(m);
-        if (tasks.size() != 0)
+        const uint64 slot = task_id & task_slot_mask;
+        if (workers.size() != 0 && slot/records_per_block < max_record_blocks &&
+            record_blocks[slot/records_per_block].load(std::memory_order_acquire) != 0)
         {
-            const unsigned long idx = task_id_to_index(task_id);
-            while (tasks[idx].task_id == task_id)
-                task_done_signaler.wait();
-
-            for (auto&& task : tasks)
-                task.propagate_exception();
+            const task_record* task = record(slot);
+            wait_until([task,task_id](){ return task->id.load() != task_id; });
         }
+
+        propagate_exception();
     }
 
 // ----------------------------------------------------------------------------------------
@@ -114,228 +292,480 @@ namespace dlib
     wait_for_all_tasks (
     ) const
     {
-        const thread_id_type thread_id = get_thread_id();
-
-        auto_mutex M(m);
-        bool found_task = true;
-        while (found_task)
-        {
-            found_task = false;
-            for (unsigned long i = 0; i < tasks.size(); ++i)
-            {
-                // If task bucket i has a task that is currently supposed to be processed
-                // and it originated from the calling thread
-                if (tasks[i].is_empty() == false && tasks[i].thread_id == thread_id)
-                {
-                    found_task = true;
-                    break;
-                }
-            }
-
-            if (found_task)
-                task_done_signaler.wait();
-        }
+        const task_group* group = group_of_calling_thread();
+        wait_until([group](){ return group->pending.load() == 0; });
 
         // throw any exceptions generated by the tasks
-        for (auto&& task : tasks)
-            task.propagate_exception();
+        propagate_exception();
     }
 
 // ----------------------------------------------------------------------------------------
 
     bool thread_pool_implementation::
-    is_worker_thread (
-        const thread_id_type id
+    is_task_thread (
     ) const
     {
-        for (unsigned long i = 0; i < worker_thread_ids.size(); ++i)
-        {
-            if (worker_thread_ids[i] == id)
-                return true;
-        }
-
         // if there aren't any threads in the pool then we consider all threads
         // to be worker threads
-        if (tasks.size() == 0)
-            return true;
-        else
-            return false;
+        return workers.size() == 0 || (this_worker != 0 && this_worker->pool == this);
     }
 
 // ----------------------------------------------------------------------------------------
 
     void thread_pool_implementation::
-    thread (
+    add_record_block (
     )
     {
+        task_record* block = new task_record[records_per_block];
+        for (unsigned long i = 0; i < records_per_block; ++i)
         {
-            // save the id of this worker thread into worker_thread_ids
-            auto_mutex M(m);
-            thread_id_type id = get_thread_id();
-            worker_thread_ids.push_back(id);
+            block[i].slot = num_record_blocks*records_per_block + i;
+            block[i].next = (i+1 < records_per_block) ? &block[i+1] : free_records;
         }
+        free_records = block;
+        record_blocks[num_record_blocks++].store(block, std::memory_order_release);
+    }
 
-        task_state_type task;
-        while (we_are_destructing == false)
-        {
-            long idx = 0;
+// ----------------------------------------------------------------------------------------
 
-            // wait for a task to do 
-            { auto_mutex M(m);
-                while ( (idx = find_ready_task()) == -1 && we_are_destructing == false)
-                    task_ready_signaler.wait();
+    thread_pool_implementation::task_record* thread_pool_implementation::
+    new_task (
+    )
+    {
+        propagate_exception();
 
-                if (we_are_destructing)
-                    break;
+        worker_state* self = this_worker;
+        if (self != 0 && self->pool == this && self->free_records != 0)
+        {
+            task_record* task = self->free_records;
+            self->free_records = task->next;
+            --self->num_free;
+            return task;
+        }
 
-                tasks[idx].is_being_processed = true;
-                task = tasks[idx];
+        std::unique_lock<std::mutex> lock(inject_m);
+        while (free_records == 0)
+        {
+            if (num_record_blocks < max_record_blocks)
+            {
+                add_record_block();
+                break;
             }
 
-            std::exception_ptr eptr = nullptr;
-            try
+            // Every task id is taken, so wait for a task to finish.  A worker can't just
+            // block since the tasks it waits on may be queued behind it, so it runs them.
+            if (self != 0 && self->pool == this)
             {
-                // now do the task
-                if (task.bfp)
-                    task.bfp();
-                else if (task.mfp0)
-                    task.mfp0();
-                else if (task.mfp1)
-                    task.mfp1(task.arg1);
-                else if (task.mfp2)
-                    task.mfp2(task.arg1, task.arg2);
+                lock.unlock();
+                task_record* other = find_task(self);
+                if (other)
+                    run_task(self, other);
+                else
+                    std::this_thread::yield();
+
+                if (self->free_records != 0)
+                {
+                    task_record* task = self->free_records;
+                    self->free_records = task->next;
+                    --self->num_free;
+                    return task;
+                }
+                lock.lock();
             }
-            catch(...)
+            else
             {
-                eptr = std::current_exception();
+                num_record_waiters.fetch_add(1);
+                records_cv.wait(lock);
+                num_record_waiters.fetch_sub(1);
             }
+        }
+        task_record* task = free_records;
+        free_records = task->next;
+        return task;
+    }
 
-            // Now let others know that we finished the task.  We do this
-            // by clearing out the state of this task
-            { auto_mutex M(m);
-                tasks[idx].is_being_processed = false;
-                tasks[idx].task_id = 0;
-                tasks[idx].bfp.clear();
-                tasks[idx].mfp0.clear();
-                tasks[idx].mfp1.clear();
-                tasks[idx].mfp2.clear();
-                tasks[idx].arg1 = 0;
-                tasks[idx].arg2 = 0;
-                tasks[idx].eptr = eptr;
-                task_done_signaler.broadcast();
-            }
+// ----------------------------------------------------------------------------------------
 
+    uint64 thread_pool_implementation::
+    submit (
+        task_record* task
+    )
+    {
+        task_group* group = group_of_calling_thread();
+        const uint64 id = (task->generation++ << task_slot_bits) | task->slot;
+        task->group = group;
+        task->next = 0;
+        task->id.store(id, std::memory_order_relaxed);
+        group->pending.fetch_add(1, std::memory_order_relaxed);
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+
+        worker_state* self = this_worker;
+        if (self != 0 && self->pool == this)
+        {
+            self->deque.push(task);
         }
+        else
+        {
+            std::lock_guard<std::mutex> lock(inject_m);
+            if (inject_tail)
+                inject_tail->next = task;
+            else
+                inject_head = task;
+            inject_tail = task;
+            inject_size.fetch_add(1, std::memory_order_release);
+        }
+
+        wake_worker();
+        return id;
     }
 
 // ----------------------------------------------------------------------------------------
 
-    long thread_pool_implementation::
-    find_empty_task_slot (
-    ) const
+    uint64 thread_pool_implementation::
+    add_task_internal (
+        const bfp_type& bfp,
+        std::shared_ptr<function_object_copy>& item
+    )
     {
-        for (auto&& task : tasks)
-            task.propagate_exception();
-
-        for (unsigned long i = 0; i < tasks.size(); ++i)
+        if (workers.size() == 0)
         {
-            if (tasks[i].is_empty())
-                return i;
+            // There aren't any threads so the caller is the only one who can do the
+            // task.  Return an id that wait_for_task() never blocks on.
+            propagate_exception();
+            bfp();
+            return 1;
         }
 
-        return -1;
+        task_record* task = new_task();
+        task->bfp = bfp;
+        task->function_copy.swap(item);
+        return submit(task);
     }
 
 // ----------------------------------------------------------------------------------------
 
-    long thread_pool_implementation::
-    find_ready_task (
+    void thread_pool_implementation::
+    wake_worker (
+    )
+    {
+        work_epoch.fetch_add(1);
+        if (num_sleeping.load() != 0)
+        {
+            std::lock_guard<std::mutex> lock(sleep_m);
+            sleep_cv.notify_one();
+        }
+        if (num_parked.load() != 0)
+        {
+            std::lock_guard<std::mutex> lock(done_m);
+            done_cv.notify_all();
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    bool thread_pool_implementation::
+    has_visible_work (
     ) const
     {
-        for (unsigned long i = 0; i < tasks.size(); ++i)
+        if (inject_size.load() != 0)
+            return true;
+        for (unsigned long i = 0; i < workers.size(); ++i)
         {
-            if (tasks[i].is_ready())
-                return i;
+            if (!workers[i]->deque.empty())
+                return true;
         }
+        return false;
+    }
+
+// ----------------------------------------------------------------------------------------
 
-        return -1;
+    thread_pool_implementation::task_record* thread_pool_implementation::
+    find_task (
+        worker_state* self
+    )
+    {
+        task_record* task = self->deque.pop();
+        if (task)
+            return task;
+
+        // steal from the others, starting at a random one so that the thieves spread out
+        const unsigned long n = workers.size();
+        const unsigned long start = self->next_random()%n;
+        for (unsigned long i = 0; i < n; ++i)
+        {
+            worker_state* victim = workers[(start+i)%n].get();
+            if (victim != self && (task = victim->deque.steal()) != 0)
+                return task;
+        }
+
+        if (inject_size.load(std::memory_order_acquire) == 0)
+            return 0;
+
+        // Take a fair share of the injection queue.  What we don't run now goes on our
+        // own deque where the other workers can steal it without touching inject_m.
+        unsigned long num_taken = 0;
+        {
+            std::lock_guard<std::mutex> lock(inject_m);
+            const unsigned long size = inject_size.load(std::memory_order_relaxed);
+            const unsigned long share = size/n + 1;
+            for (; num_taken < share && inject_head != 0; ++num_taken)
+            {
+                task_record* next = inject_head;
+                inject_head = next->next;
+                if (task)
+                    self->deque.push(next);
+                else
+                    task = next;
+            }
+            if (inject_head == 0)
+                inject_tail = 0;
+            inject_size.fetch_sub(num_taken, std::memory_order_relaxed);
+        }
+        if (num_taken > 1)
+            wake_worker();
+        return task;
     }
 
 // ----------------------------------------------------------------------------------------
 
-    uint64 thread_pool_implementation::
-    make_next_task_id (
-        long idx
+    void thread_pool_implementation::
+    run_task (
+        worker_state* self,
+        task_record* task
     )
     {
-        uint64 id = tasks[idx].next_task_id * tasks.size() + idx;
-        tasks[idx].next_task_id += 1;
-        return id;
+        try
+        {
+            // now do the task
+            if (task->bfp)
+                task->bfp();
+            else if (task->mfp0)
+                task->mfp0();
+            else if (task->mfp1)
+                task->mfp1(task->arg1);
+            else if (task->mfp2)
+                task->mfp2(task->arg1, task->arg2);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(exception_m);
+            if (!eptr)
+                eptr = std::current_exception();
+            has_exception = true;
+        }
+
+        // Now let others know that we finished the task.  We do this by clearing out
+        // the record, which then goes back on our free list.
+        task_group* group = task->group;
+        task->bfp.clear();
+        task->mfp0.clear();
+        task->mfp1.clear();
+        task->mfp2.clear();
+        task->arg1 = 0;
+        task->arg2 = 0;
+        task->function_copy.reset();
+        task->group = 0;
+        task->id.store(0);
+
+        task->next = self->free_records;
+        self->free_records = task;
+        const bool record_wanted = num_record_waiters.load() != 0;
+        if (++self->num_free >= max_free_per_worker || record_wanted)
+        {
+            // Give half back so threads outside the pool can reuse them, or all of them
+            // if a thread is waiting in new_task() for a record.
+            const unsigned long num = record_wanted ? self->num_free : max_free_per_worker/2;
+            task_record* first = self->free_records;
+            task_record* last = first;
+            for (unsigned long i = 1; i < num; ++i)
+                last = last->next;
+            self->free_records = last->next;
+            self->num_free -= num;
+
+            std::lock_guard<std::mutex> lock(inject_m);
+            last->next = free_records;
+            free_records = first;
+            if (record_wanted)
+                records_cv.notify_all();
+        }
+
+        // outstanding goes last since shutdown_pool() waits on it before the pool is
+        // torn down
+        group->pending.fetch_sub(1);
+        outstanding.fetch_sub(1);
+        if (num_waiters.load() != 0)
+        {
+            std::lock_guard<std::mutex> lock(done_m);
+            done_cv.notify_all();
+        }
     }
 
 // ----------------------------------------------------------------------------------------
 
-    unsigned long thread_pool_implementation::
-    task_id_to_index (
-        uint64 id
-    ) const
+    void thread_pool_implementation::
+    sleep_until_work (
+        worker_state*
+    )
     {
-        return static_cast<unsigned long>(id%tasks.size());
+        // Anything submitted after this load changes work_epoch, and anything submitted
+        // before it is seen by has_visible_work(), so no wake up can be missed.
+        const uint64 epoch = work_epoch.load();
+        num_sleeping.fetch_add(1);
+        if (!has_visible_work())
+        {
+            std::unique_lock<std::mutex> lock(sleep_m);
+            while (work_epoch.load() == epoch && !we_are_destructing)
+                sleep_cv.wait(lock);
+        }
+        num_sleeping.fetch_sub(1);
     }
 
 // ----------------------------------------------------------------------------------------
 
-    uint64 thread_pool_implementation::
-    add_task_internal (
-        const bfp_type& bfp,
-        std::shared_ptr<function_object_copy>& item
+    void thread_pool_implementation::
+    thread (
+        worker_state* self
     )
     {
-        auto_mutex M(m);
-        const thread_id_type my_thread_id = get_thread_id();
+        this_worker = self;
+
+        // How many times an idle worker looks for work before it goes to sleep.  The
+        // yields keep this short and let other threads run on a busy core.
+        const int spin_rounds = 64;
 
-        // find a thread that isn't doing anything
-        long idx = find_empty_task_slot();
-        if (idx == -1 && is_worker_thread(my_thread_id))
+        while (true)
         {
-            // this function is being called from within a worker thread and there
-            // aren't any other worker threads free so just perform the task right
-            // here
+            task_record* task = find_task(self);
+            for (int i = 0; i < spin_rounds && task == 0; ++i)
+            {
+                std::this_thread::yield();
+                task = find_task(self);
+            }
 
-            M.unlock();
-            bfp();
+            if (task)
+            {
+                run_task(self, task);
+                continue;
+            }
 
-            // return a task id that is both non-zero and also one
-            // that is never normally returned.  This way calls
-            // to wait_for_task() will never block given this id.
-            return 1;
+            if (we_are_destructing)
+                break;
+            sleep_until_work(self);
         }
 
-        // wait until there is a thread that isn't doing anything
-        while (idx == -1)
+        this_worker = 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename done_type>
+    void thread_pool_implementation::
+    wait_until (
+        const done_type& done
+    ) const
+    {
+        worker_state* self = this_worker;
+        if (self != 0 && self->pool == this)
         {
-            task_done_signaler.wait();
-            idx = find_empty_task_slot();
+            // We are inside a task.  Blocking here could leave no thread to run the
+            // tasks we are waiting on, so run whatever there is in the meantime.  When
+            // there is nothing to run for a while, sleep on done_cv until either a task
+            // finishes or new work is submitted, the same way sleep_until_work() does.
+            thread_pool_implementation* me = const_cast<thread_pool_implementation*>(this);
+            int idle_rounds = 0;
+            while (!done())
+            {
+                task_record* task = me->find_task(self);
+                if (task)
+                {
+                    me->run_task(self, task);
+                    idle_rounds = 0;
+                }
+                else if (++idle_rounds < 64)
+                {
+                    std::this_thread::yield();
+                }
+                else
+                {
+                    num_waiters.fetch_add(1);
+                    num_parked.fetch_add(1);
+                    const uint64 epoch = work_epoch.load();
+                    if (!has_visible_work())
+                    {
+                        std::unique_lock<std::mutex> lock(done_m);
+                        while (!done() && work_epoch.load() == epoch)
+                            done_cv.wait(lock);
+                    }
+                    num_parked.fetch_sub(1);
+                    num_waiters.fetch_sub(1);
+                    idle_rounds = 0;
+                }
+            }
+            return;
         }
 
-        tasks[idx].thread_id = my_thread_id;
-        tasks[idx].task_id = make_next_task_id(idx);
-        tasks[idx].bfp = bfp;
-        tasks[idx].function_copy.swap(item);
+        for (int i = 0; i < 64; ++i)
+        {
+            if (done())
+                return;
+            std::this_thread::yield();
+        }
+
+        num_waiters.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(done_m);
+            while (!done())
+                done_cv.wait(lock);
+        }
+        num_waiters.fetch_sub(1);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    thread_pool_implementation::task_group* thread_pool_implementation::
+    group_of_calling_thread (
+    ) const
+    {
+        if (cached_group_serial == serial)
+            return cached_group;
 
-        task_ready_signaler.signal();
+        const thread_id_type id = get_thread_id();
+        std::lock_guard<std::mutex> lock(groups_m);
+        task_group* group = 0;
+        for (unsigned long i = 0; i < groups.size() && group == 0; ++i)
+        {
+            if (groups[i]->thread_id == id)
+                group = groups[i].get();
+        }
+        if (group == 0)
+        {
+            groups.push_back(std::unique_ptr<task_group>(new task_group(id)));
+            group = groups.back().get();
+        }
 
-        return tasks[idx].task_id;
+        cached_group_serial = serial;
+        cached_group = group;
+        return group;
     }
 
 // ----------------------------------------------------------------------------------------
 
-    bool thread_pool_implementation::
-    is_task_thread (
+    void thread_pool_implementation::
+    propagate_exception (
     ) const
     {
-        auto_mutex M(m);
-        return is_worker_thread(get_thread_id());
+        if (!has_exception.load())
+            return;
+
+        std::exception_ptr tmp;
+        {
+            std::lock_guard<std::mutex> lock(exception_m);
+            tmp = eptr;
+            eptr = nullptr;
+            has_exception = false;
+        }
+        if (tmp)
+            std::rethrow_exception(tmp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -3,9 +3,13 @@
 #ifndef DLIB_THREAD_POOl_Hh_
 #define DLIB_THREAD_POOl_Hh_ 
 
+#include <atomic>
+#include <condition_variable>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "thread_pool_extension_abstract.h"
 #include "multithreaded_object_extension.h"
@@ -131,17 +135,42 @@ namespace dlib
     {
         /*!
             CONVENTION
-                - num_threads_in_pool() == tasks.size()
-                - if (the destructor has been called) then
+                - num_threads_in_pool() == workers.size()
+                - if (shutdown_pool() has started stopping the threads) then
                     - we_are_destructing == true
                 - else
                     - we_are_destructing == false
 
-                - is_task_thread() == is_worker_thread(get_thread_id())
-
-                - m == the mutex used to protect everything in this object
-                - worker_thread_ids == an array that contains the thread ids for
-                  all the threads in the thread pool
+                - is_task_thread() == (the calling thread is one of workers or
+                  num_threads_in_pool() == 0)
+
+                - Every worker owns a Chase-Lev work stealing deque.  A worker pushes the
+                  tasks it submits onto the bottom of its own deque and pops them back
+                  from there, while idle workers steal from the top of the others.  Tasks
+                  submitted by threads outside the pool go into the injection queue
+                  (inject_head/inject_tail, protected by inject_m), which workers drain a
+                  batch at a time into their own deques.
+                - Task records are recycled through per worker free lists and the shared
+                  free list (also protected by inject_m), so once the pool has warmed up
+                  submitting a task doesn't allocate memory.
+                - A task id holds the index of its record in the low task_slot_bits bits
+                  and a number that is never reused for that record above them.
+                  record(i)->id == the id of the task it currently holds, or 0 if it is
+                  free.  So a task with id ID is finished exactly when
+                  record(ID & task_slot_mask)->id != ID.
+                - Each thread that submits tasks gets a task_group counting its pending
+                  tasks, which is what wait_for_all_tasks() waits on.
+                - outstanding == the number of submitted tasks that haven't finished.
+                - Idle workers spin for a while looking for work and then sleep on
+                  sleep_cv.  work_epoch changes whenever work is submitted and threads
+                  that submit work only touch sleep_m when num_sleeping != 0.
+                - Threads that wait for tasks sleep on done_cv, which is only signaled
+                  while num_waiters != 0.  num_parked of them are workers waiting inside
+                  a task, which also have to wake up when work is submitted.
+                - There are at most max_record_blocks*records_per_block records.  When
+                  they are all in use new_task() waits on records_cv for one to be freed,
+                  and while num_record_waiters != 0 workers hand every record they free
+                  back to the shared free list.
         !*/
         typedef bound_function_pointer::kernel_1a_c bfp_type;
 
@@ -173,40 +202,18 @@ namespace dlib
             void (T::*funct)()
         )
         {
-            auto_mutex M(m);
-            const thread_id_type my_thread_id = get_thread_id();
-
-            // find a thread that isn't doing anything
-            long idx = find_empty_task_slot();
-            if (idx == -1 && is_worker_thread(my_thread_id))
+            if (workers.size() == 0)
             {
-                // this function is being called from within a worker thread and there
-                // aren't any other worker threads free so just perform the task right
-                // here
-
-                M.unlock();
+                // There aren't any threads so the caller is the only one who can do the
+                // task.  Return an id that wait_for_task() never blocks on.
+                propagate_exception();
                 (obj.*funct)();
-
-                // return a task id that is both non-zero and also one
-                // that is never normally returned.  This way calls
-                // to wait_for_task() will never block given this id.
                 return 1;
             }
 
-            // wait until there is a thread that isn't doing anything
-            while (idx == -1)
-            {
-                task_done_signaler.wait();
-                idx = find_empty_task_slot();
-            }
-
-            tasks[idx].thread_id = my_thread_id;
-            tasks[idx].task_id = make_next_task_id(idx);
-            tasks[idx].mfp0.set(obj,funct);
-
-            task_ready_signaler.signal();
-
-            return tasks[idx].task_id;
+            task_record* task = new_task();
+            task->mfp0.set(obj,funct);
+            return submit(task);
         }
 
         template <typename T>
@@ -216,41 +223,17 @@ namespace dlib
             long arg1
         )
         {
-            auto_mutex M(m);
-            const thread_id_type my_thread_id = get_thread_id();
-
-            // find a thread that isn't doing anything
-            long idx = find_empty_task_slot();
-            if (idx == -1 && is_worker_thread(my_thread_id))
+            if (workers.size() == 0)
             {
-                // this function is being called from within a worker thread and there
-                // aren't any other worker threads free so just perform the task right
-                // here
-
-                M.unlock();
+                propagate_exception();
                 (obj.*funct)(arg1);
-
-                // return a task id that is both non-zero and also one
-                // that is never normally returned.  This way calls
-                // to wait_for_task() will never block given this id.
                 return 1;
             }
 
-            // wait until there is a thread that isn't doing anything
-            while (idx == -1)
-            {
-                task_done_signaler.wait();
-                idx = find_empty_task_slot();
-            }
-
-            tasks[idx].thread_id = my_thread_id;
-            tasks[idx].task_id = make_next_task_id(idx);
-            tasks[idx].mfp1.set(obj,funct);
-            tasks[idx].arg1 = arg1;
-
-            task_ready_signaler.signal();
-
-            return tasks[idx].task_id;
+            task_record* task = new_task();
+            task->mfp1.set(obj,funct);
+            task->arg1 = arg1;
+            return submit(task);
         }
 
         template <typename T>
@@ -261,42 +244,18 @@ namespace dlib
             long arg2
         )
         {
-            auto_mutex M(m);
-            const thread_id_type my_thread_id = get_thread_id();
-
-            // find a thread that isn't doing anything
-            long idx = find_empty_task_slot();
-            if (idx == -1 && is_worker_thread(my_thread_id))
+            if (workers.size() == 0)
             {
-                // this function is being called from within a worker thread and there
-                // aren't any other worker threads free so just perform the task right
-                // here
-
-                M.unlock();
+                propagate_exception();
                 (obj.*funct)(arg1, arg2);
-
-                // return a task id that is both non-zero and also one
-                // that is never normally returned.  This way calls
-                // to wait_for_task() will never block given this id.
                 return 1;
             }
 
-            // wait until there is a thread that isn't doing anything
-            while (idx == -1)
-            {
-                task_done_signaler.wait();
-                idx = find_empty_task_slot();
-            }
-
-            tasks[idx].thread_id = my_thread_id;
-            tasks[idx].task_id = make_next_task_id(idx);
-            tasks[idx].mfp2.set(obj,funct);
-            tasks[idx].arg1 = arg1;
-            tasks[idx].arg2 = arg2;
-
-            task_ready_signaler.signal();
-
-            return tasks[idx].task_id;
+            task_record* task = new_task();
+            task->mfp2.set(obj,funct);
+            task->arg1 = arg1;
+            task->arg2 = arg2;
+            return submit(task);
         }
 
         struct function_object_copy 
@@ -343,137 +302,176 @@ namespace dlib
 
     private:
 
-        bool is_worker_thread (
-            const thread_id_type id
-        ) const;
+        struct task_group;
+        struct worker_state;
+
+        struct task_record
+        {
+            task_record() : id(0), generation(1), slot(0), group(0), next(0), arg1(0), arg2(0) {}
+
+            std::atomic<uint64> id; // the id of the task in this record, 0 when free
+            uint64 generation;      // the number the next id of this record is made from
+            uint64 slot;            // the index of this record
+            task_group* group;      // the group of the thread that submitted the task
+            task_record* next;      // link in the injection queue and the free lists
+
+            long arg1;
+            long arg2;
+
+            member_function_pointer<> mfp0;
+            member_function_pointer<long> mfp1;
+            member_function_pointer<long,long> mfp2;
+            bfp_type bfp;
+
+            std::shared_ptr<function_object_copy> function_copy;
+        };
+
+        const static unsigned long task_slot_bits = 20;
+        const static uint64 task_slot_mask = (1ULL<<task_slot_bits)-1;
+        const static unsigned long records_per_block = 256;
+        const static unsigned long max_record_blocks = (1UL<<task_slot_bits)/records_per_block;
+        const static unsigned long max_free_per_worker = 64;
+
+        void add_record_block (
+        );
         /*!
             requires
-                - m is locked
+                - inject_m is locked
+                - num_record_blocks < max_record_blocks
             ensures
-                - if (thread with given id is one of the thread pool's worker threads or num_threads_in_pool() == 0) then
-                    - returns true
-                - else
-                    - returns false
+                - puts records_per_block new records on the shared free list
         !*/
 
-        void thread (
+        task_record* new_task (
         );
         /*!
-            this is the function that executes the threads in the thread pool
+            ensures
+                - rethrows the exception of a failed task if there is one.
+                - returns an empty task record that belongs to the caller until it is
+                  given to submit().  If all the records are in use this waits for a task
+                  to finish, running tasks meanwhile when called from a worker.
         !*/
 
-        long find_empty_task_slot (
-        ) const;
+        uint64 submit (
+            task_record* task
+        );
         /*!
             requires
-                - m is locked
+                - task came from new_task() and holds the function to call
             ensures
-                - if (there is currently a empty task slot) then
-                    - returns the index of that task slot in tasks
-                    - there is a task slot
-                - else
-                    - returns -1
+                - queues task and wakes a sleeping worker if there is one
+                - returns the id of the task
         !*/
 
-        long find_ready_task (
-        ) const;
+        void thread (
+            worker_state* self
+        );
         /*!
-            requires
-                - m is locked
-            ensures
-                - if (there is currently a task to do) then
-                    - returns the index of that task in tasks
-                - else
-                    - returns -1
+            this is the function that executes the threads in the thread pool
         !*/
 
-        uint64 make_next_task_id (
-            long idx
+        task_record* find_task (
+            worker_state* self
         );
         /*!
-            requires
-                - m is locked
-                - 0 <= idx < tasks.size()
             ensures
-                - returns the next index to be used for tasks that are placed in
-                  tasks[idx]
+                - returns a task taken from the deque of self, stolen from another worker
+                  or taken from the injection queue, or 0 if none could be found.
         !*/
 
-        unsigned long task_id_to_index (
-            uint64 id
-        ) const;
+        void run_task (
+            worker_state* self,
+            task_record* task
+        );
         /*!
-            requires
-                - m is locked
-                - num_threads_in_pool() != 0
             ensures
-                - returns the index in tasks corresponding to the given id
+                - calls the function in task, records any exception it throws, marks
+                  the task finished and recycles its record into the free list of self.
         !*/
 
-        struct task_state_type
-        {
-            task_state_type() : is_being_processed(false), task_id(0), next_task_id(2), arg1(0), arg2(0), eptr(nullptr) {}
-
-            bool is_ready () const 
-            /*!
-                ensures
-                    - if (is_empty() == false && no thread is currently processing this task) then
-                        - returns true
-                    - else
-                        - returns false
-            !*/
-            {
-                return !is_being_processed && !is_empty();
-            }
-
-            bool is_empty () const
-            /*!
-                ensures
-                    - if (this task state is empty.  i.e. it doesn't contain a task to be processed) then
-                        - returns true
-                    - else 
-                        - returns false
-            !*/
-            {
-                return task_id == 0;
-            }
-
-            bool is_being_processed;  // true when a thread is working on this task 
-            uint64 task_id; // the id of this task.  0 means this task is empty
-            thread_id_type thread_id; // the id of the thread that requested this task 
-
-            uint64 next_task_id;
+        void sleep_until_work (
+            worker_state* self
+        );
+        /*!
+            ensures
+                - returns when there might be new work or the pool is shutting down
+        !*/
 
-            long arg1;
-            long arg2;
+        bool has_visible_work (
+        ) const;
 
-            member_function_pointer<> mfp0;
-            member_function_pointer<long> mfp1;
-            member_function_pointer<long,long> mfp2;
-            bfp_type bfp;
+        void wake_worker (
+        );
 
-            std::shared_ptr<function_object_copy> function_copy;
-            mutable std::exception_ptr eptr; // non-null if the task threw an exception
+        template <typename done_type>
+        void wait_until (
+            const done_type& done
+        ) const;
+        /*!
+            ensures
+                - returns once done() is true.  Workers run other tasks while they wait
+                  so that waiting inside a task can't deadlock the pool, and sleep on
+                  done_cv once there has been nothing to run for a while.  Other threads
+                  spin for a moment and then sleep on done_cv.
+        !*/
 
-            void propagate_exception() const
-            {
-                if (eptr)
-                {
-                    auto tmp = eptr;
-                    eptr = nullptr;
-                    std::rethrow_exception(tmp);
-                }
-            }
+        task_group* group_of_calling_thread (
+        ) const;
 
-        };
+        void propagate_exception (
+        ) const;
+        /*!
+            ensures
+                - if (a task threw an exception that hasn't been rethrown yet) then
+                    - rethrows it
+        !*/
 
-        array<task_state_type> tasks;
-        array<thread_id_type> worker_thread_ids;
+        task_record* record (
+            uint64 slot
+        ) const
+        {
+            return record_blocks[slot/records_per_block].load(std::memory_order_acquire) + slot%records_per_block;
+        }
 
-        mutex m;
-        signaler task_done_signaler;
-        signaler task_ready_signaler;
-        bool we_are_destructing;
+        // the worker the calling thread is, if any, and the task_group it last used
+        static thread_local worker_state* this_worker;
+        static thread_local uint64 cached_group_serial;
+        static thread_local task_group* cached_group;
+
+        std::vector<std::unique_ptr<worker_state> > workers;
+        const uint64 serial; // tells apart pools that reuse the same address
+
+        // the injection queue and the shared free list
+        mutable std::mutex inject_m;
+        task_record* inject_head;
+        task_record* inject_tail;
+        std::atomic<unsigned long> inject_size;
+        task_record* free_records;
+        std::unique_ptr<std::atomic<task_record*>[]> record_blocks;
+        unsigned long num_record_blocks;
+        std::condition_variable records_cv;
+        std::atomic<long> num_record_waiters;
+
+        mutable std::mutex groups_m;
+        mutable std::vector<std::unique_ptr<task_group> > groups;
+
+        std::atomic<long> outstanding;
+
+        std::mutex sleep_m;
+        std::condition_variable sleep_cv;
+        std::atomic<uint64> work_epoch;
+        std::atomic<long> num_sleeping;
+
+        mutable std::mutex done_m;
+        mutable std::condition_variable done_cv;
+        mutable std::atomic<long> num_waiters;
+        mutable std::atomic<long> num_parked;
+
+        mutable std::mutex exception_m;
+        mutable std::exception_ptr eptr; // the first unhandled exception of a task
+        mutable std::atomic<bool> has_exception;
+
+        std::atomic<bool> we_are_destructing;
 
         std::vector<std::thread> threads;
 
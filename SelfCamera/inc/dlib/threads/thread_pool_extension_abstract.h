@@ -218,11 +218,25 @@ namespace dlib
                 mode any thread that calls add_task() is considered to be
                 a thread_pool thread capable of executing tasks.
 
+                Each thread in the pool keeps its own queue of tasks.  Tasks submitted by
+                a pool thread go on its queue, tasks from other threads go on a shared
+                queue, and threads that run out of work take tasks from the others.  So
+                submitting a task never waits for a thread to become free.  A pool thread
+                that waits for tasks (e.g. in wait_for_all_tasks()) runs other queued
+                tasks in the meantime, which lets tasks submit and wait for tasks of their
+                own without deadlocking the pool.
+
                 This object is also implemented such that no memory allocations occur 
-                after the thread_pool has been constructed so long as the user doesn't 
-                call any of the add_task_by_value() routines.  The future object also 
-                doesn't perform any memory allocations or contain any system resources 
-                such as mutex objects. 
+                after the thread_pool has warmed up to the number of tasks it has in
+                flight at once, so long as the user doesn't call any of the
+                add_task_by_value() routines.  The future object also doesn't perform
+                any memory allocations or contain any system resources such as mutex
+                objects. 
+
+                At most 2^20 tasks can be in flight at once.  When that many are queued
+                or running, the add_task() routines block until one of them finishes
+                rather than fail.  A task thread that blocks there runs queued tasks in
+                the meantime.
 
             EXCEPTIONS
                 Note that if an exception is thrown inside a task thread and is not caught
@@ -285,12 +299,11 @@ namespace dlib
                 - function_object() is a valid expression 
             ensures
                 - makes a copy of function_object, call it FCOPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
+                - if (num_threads_in_pool() == 0) then
                     - calls FCOPY() within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls FCOPY().
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call FCOPY().
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -307,13 +320,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)() within the calling thread and returns
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)() within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)()
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (obj.*funct)().
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -328,13 +339,11 @@ namespace dlib
                 - funct == a valid member function pointer for class T
             ensures
                 - makes a copy of obj, call it OBJ_COPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (OBJ_COPY.*funct)() within the calling thread and returns 
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (OBJ_COPY.*funct)() within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (OBJ_COPY.*funct)().
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (OBJ_COPY.*funct)().
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -352,13 +361,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1)
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (obj.*funct)(arg1).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -377,13 +384,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1,arg2) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1,arg2) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1,arg2)
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (obj.*funct)(arg1,arg2).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -406,6 +411,8 @@ namespace dlib
                 - the call to this function blocks until all tasks which were submitted
                   to the thread pool by the thread that is calling this function have 
                   finished.
+                - if (is_task_thread() == true) then
+                    - the calling thread runs other tasks of the pool while it waits.
         !*/
 
         // --------------------
@@ -423,13 +430,11 @@ namespace dlib
                   this function passes function_object to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls function_object(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls function_object(arg1.get()) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls function_object(arg1.get()).
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call function_object(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -446,12 +451,11 @@ namespace dlib
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function object)
             ensures
                 - makes a copy of function_object, call it FCOPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
+                - if (num_threads_in_pool() == 0) then
                     - calls FCOPY(arg1.get()) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls FCOPY(arg1.get()).
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call FCOPY(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -472,13 +476,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1.get()).
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (obj.*funct)(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -497,13 +499,11 @@ namespace dlib
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function)
             ensures
                 - makes a copy of obj, call it OBJ_COPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns 
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (OBJ_COPY.*funct)(arg1.get()).
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (OBJ_COPY.*funct)(arg1.get()).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -523,13 +523,11 @@ namespace dlib
                   this function passes obj to the task by reference.  If you want to avoid
                   this restriction then use add_task_by_value())
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls (obj.*funct)(arg1.get()) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (obj.*funct)(arg1.get()).
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (obj.*funct)(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
@@ -548,13 +546,11 @@ namespace dlib
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function)
             ensures
                 - makes a copy of obj, call it OBJ_COPY.
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns 
-                      when it finishes.
+                - if (num_threads_in_pool() == 0) then
+                    - calls (OBJ_COPY.*funct)(arg1.get()) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls (OBJ_COPY.*funct)(arg1.get()).
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call (OBJ_COPY.*funct)(arg1.get()).
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
         !*/
@@ -570,13 +566,11 @@ namespace dlib
                 - (funct)(arg1.get()) must be a valid expression.
                   (i.e. The A1 type stored in the future must be a type that can be passed into the given function)
             ensures
-                - if (is_task_thread() == true and there aren't any free threads available) then
-                    - calls funct(arg1.get()) within the calling thread and returns
-                      when it finishes
+                - if (num_threads_in_pool() == 0) then
+                    - calls funct(arg1.get()) within the calling thread and returns when it finishes
                 - else
-                    - the call to this function blocks until there is a free thread in the pool
-                      to process this new task.  Once a free thread is available the task
-                      is handed off to that thread which then calls funct(arg1.get()).
+                    - queues the task and returns without waiting for it.  One of the
+                      threads in the pool will call funct(arg1.get()).
                 - #arg1.is_ready() == false 
                 - returns a task id that can be used by this->wait_for_task() to wait
                   for the submitted task to finish.
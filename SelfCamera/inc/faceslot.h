@@ -0,0 +1,50 @@
+/*
+ * faceslot.h
+ *
+ * Hands the faces found by the camera's face detection thread to the preview
+ * thread. The slot is a triple buffer: the writer fills a buffer of its own
+ * and swaps it with the published one, the reader swaps the published one
+ * with its own when it is newer. Neither side waits for or allocates
+ * anything, and a reader never sees a result that is still being written.
+ *
+ * Exactly one thread may write (face_slot_begin/face_slot_publish) and one
+ * thread may read (face_slot_read) at a time. There is no way to empty the
+ * slot from a third thread; the reader judges results by their timestamp.
+ */
+
+#ifndef FACESLOT_H_
+#define FACESLOT_H_
+
+#include <atomic>
+#include <dlib/geometry/rectangle.h>
+
+#define FACE_SLOT_CAPACITY 10	/* more faces than this are dropped */
+
+typedef struct _face_result{
+	double timestamp;	/* when the faces were detected */
+	int count;
+	dlib::rectangle faces[FACE_SLOT_CAPACITY];	/* in the rotated preview */
+}face_result;
+
+typedef struct _face_slot{
+	face_result buffers[3];
+	std::atomic<int> latest;	/* published buffer, FACE_SLOT_FRESH while unread */
+	int back;	/* buffer being written */
+	int front;	/* buffer being read */
+}face_slot;
+
+face_slot* face_slot_create(void);
+
+void face_slot_destroy(face_slot* slot);
+
+/* Returns the writer's buffer with count reset to 0. */
+face_result* face_slot_begin(face_slot* slot);
+
+/* Makes the buffer returned by face_slot_begin() the latest result. */
+void face_slot_publish(face_slot* slot, double timestamp);
+
+/* Latest published result. It stays valid and unchanged until the next
+ * call on the reading thread. */
+const face_result* face_slot_read(face_slot* slot);
+
+#endif /* FACESLOT_H_ */
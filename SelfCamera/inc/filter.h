@@ -0,0 +1,31 @@
+/*
+ * filter.h
+ *
+ * The colour filters done in software: each one scales the two chroma
+ * channels of the preview by a fixed gain. Filters 1 to 3 are camera
+ * effects and 13 and 14 are the beauty and portrait modes, so they have no
+ * gains here.
+ */
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#define FILTER_SOFTWARE_FIRST 4
+
+/**
+ * @brief Gets the chroma gains of the software filters.
+ * @param[in] filter Filter index
+ * @param[out] cb Cb gain
+ * @param[out] cr Cr gain
+ * @return false if the filter is not applied in software
+ */
+bool filter_gains(int filter, double *cb, double *cr);
+
+/**
+ * @brief Finds a software filter by name: red1 to red3, blue1 to blue3 or
+ * green1 to green3, from mildest to strongest.
+ * @return the filter index, or -1 for an unknown name
+ */
+int filter_from_name(const char *name);
+
+#endif /* FILTER_H_ */
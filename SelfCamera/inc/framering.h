@@ -0,0 +1,54 @@
+/*
+ * framering.h
+ *
+ * Ring of the most recently processed preview frames. Slots are allocated
+ * once and recycled, so keeping the history costs one memcpy per frame.
+ * A capture pins the slots it needs; pinned slots are skipped by the writer
+ * until the encoder releases them.
+ *
+ * frame_ring_push() and the acquire functions must be called from the same
+ * thread (the camera preview thread); frame_ring_release() may be called
+ * from any thread.
+ */
+
+#ifndef FRAMERING_H_
+#define FRAMERING_H_
+
+#include "view.h"
+
+#include <atomic>
+
+typedef struct _frame_slot{
+	unsigned char* data;	/* Y plane followed by UV, preview chroma order */
+	int width;
+	int height;
+	int size;
+	double timestamp;
+	std::atomic<int> pins;
+}frame_slot;
+
+typedef struct _frame_ring{
+	frame_slot* slots;
+	unsigned char* buffer;
+	int capacity;
+	int head;	/* next slot to write */
+}frame_ring;
+
+frame_ring* frame_ring_create(int capacity);
+
+void frame_ring_destroy(frame_ring* ring);
+
+/* Copies the frame into the oldest unpinned slot. Returns false if every
+ * slot is pinned or the frame is not NV12. */
+bool frame_ring_push(frame_ring* ring, const camera_preview_data_s* frame, double timestamp);
+
+/* Pins the frame closest to timestamp, NULL if the ring is empty. */
+frame_slot* frame_ring_acquire_nearest(frame_ring* ring, double timestamp);
+
+/* Pins up to max frames taken at or before timestamp, oldest first.
+ * Returns how many were stored in slots. */
+int frame_ring_acquire_latest(frame_ring* ring, double timestamp, frame_slot** slots, int max);
+
+void frame_ring_release(frame_slot* slot);
+
+#endif /* FRAMERING_H_ */
@@ -10,27 +10,17 @@
 
 #include <image_util.h>
 #include "view.h"
-
-#define STICKER_NUM 17
-
-typedef struct _imageinfo{
-	unsigned char* data;
-	int size;
-	int width;
-	int height;
-	int error;
-}imageinfo;
-
-void _image_util_yuvcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q);
-
-void _image_util_imgcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q);
+#include "sticker.h"
 
 void _image_util_read_stickers(imageinfo* imgarr);
 
 void _image_util_read_jpeg(imageinfo* imginfo, int id);
 
-const char *_map_colorspace(image_util_colorspace_e color_space);
+/* Downscales an NV12 image (U first) to an ARGB8888 thumbnail whose longer
+ * side is at most max_size. The caller frees *argb. */
+int _image_util_thumbnail(unsigned int** argb, int* tw, int* th, const unsigned char* nv12,
+		int width, int height, int max_size);
 
-void _image_util_santacpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q);
+const char *_map_colorspace(image_util_colorspace_e color_space);
 
 #endif /* IMAGEUTILS_H_ */
@@ -0,0 +1,80 @@
+/*
+ * kernels.h
+ *
+ * Registry of the per-frame pixel kernels. Every kernel has a scalar
+ * reference and, where the instruction set helps, SSE4/AVX2/NEON variants.
+ * The best variant supported by the running CPU is picked once by
+ * kernels_init(), so the same binary runs on the emulator, on Linux test
+ * boxes and on ARM devices.
+ *
+ * The kernels of the bundled libraries are not in this table. JPEG colour
+ * conversion picks its variant at run time inside libjpeg (jcsimd.cpp,
+ * jdsimd.cpp). The FHOG gradient has no caller, as faces are detected by
+ * the camera. The shape predictor's feature gather reads a few hundred
+ * scattered pixels per level, so it has nothing to vectorise.
+ */
+
+#ifndef KERNELS_H_
+#define KERNELS_H_
+
+typedef enum {
+	KERNEL_ISA_SCALAR = 0,
+	KERNEL_ISA_SSE4,
+	KERNEL_ISA_AVX2,
+	KERNEL_ISA_NEON,
+	KERNEL_ISA_NUM
+} kernel_isa_e;
+
+/* Scales the interleaved UV plane: even bytes by cb_q8/256, odd bytes by
+ * cr_q8/256, saturated to 255. Coefficients must be below 32768. */
+typedef void (*nv12_filter_fn)(unsigned char* uv, int size, int cb_q8, int cr_q8);
+
+/* Copies the n sticker luma bytes whose value lies in [lo, hi]. */
+typedef void (*blit_y_fn)(unsigned char* dst, const unsigned char* src, int n,
+		unsigned char lo, unsigned char hi);
+
+/* Copies n UV pairs with U and V swapped, keyed on the luma byte at the top
+ * left of each pair (key[2*k]). */
+typedef void (*blit_uv_fn)(unsigned char* dst, const unsigned char* src,
+		const unsigned char* key, int n, unsigned char lo, unsigned char hi);
+
+/* Rotates a width x height luma plane into a height-wide, width-tall image
+ * the way the shape predictor expects it: dst[x][height - 1 - y] = src[y][x]. */
+typedef void (*luma_rotate_fn)(unsigned char* dst, long dst_stride,
+		const unsigned char* src, long src_stride, int width, int height);
+
+/* Halves a luma plane two rows at a time: dst[i] is the rounded mean of
+ * row0[2i], row0[2i+1], row1[2i] and row1[2i+1], for i < n. */
+typedef void (*luma_downscale_fn)(unsigned char* dst, const unsigned char* row0,
+		const unsigned char* row1, int n);
+
+/* Slides n running column sums down one row: sum[i] += add[i] - sub[i] and
+ * sum_sq[i] += add[i]^2 - sub[i]^2, wrapping modulo 2^32. */
+typedef void (*box_column_fn)(unsigned int* sum, unsigned int* sum_sq,
+		const unsigned char* add, const unsigned char* sub, int n);
+
+typedef struct _kernel_table{
+	nv12_filter_fn nv12_filter;
+	blit_y_fn blit_y;
+	blit_uv_fn blit_uv;
+	luma_rotate_fn luma_rotate;
+	luma_downscale_fn luma_downscale;
+	box_column_fn box_column;
+}kernel_table;
+
+/* Probes the CPU, fills the active table and, when verify is set, drops any
+ * variant whose output differs from the scalar reference. Returns the number
+ * of dropped variants. */
+int kernels_init(int verify);
+
+const kernel_table* kernels_get(void);
+
+const kernel_table* kernels_get_variant(kernel_isa_e isa);
+
+kernel_isa_e kernels_best_isa(void);
+
+const char* kernels_isa_name(kernel_isa_e isa);
+
+int kernels_self_test(kernel_isa_e isa);
+
+#endif /* KERNELS_H_ */
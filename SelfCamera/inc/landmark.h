@@ -1,7 +1,8 @@
 #if !defined(_LANDMARK_H)
 #define _LANDMARK_H
 
-#include "imageutils.h"
+#include "sticker.h"
+#include "warp.h"
 
 #include <iostream>
 #include <dlib/image_processing.h>
@@ -14,5 +15,6 @@ void draw_santa(camera_preview_data_s* frame, const dlib::full_object_detection
 void draw_nyan(camera_preview_data_s* frame, const dlib::full_object_detection shape, imageinfo* imgarr);
 void draw_rudolph(camera_preview_data_s* frame, const dlib::full_object_detection shape, imageinfo* imgarr);
 void draw_landmark(camera_preview_data_s* frame, const dlib::full_object_detection shape);
+void draw_sticker(camera_preview_data_s* frame, const dlib::full_object_detection& shape, imageinfo* imgarr, int sticker, warp_ctx* warp);
 
 #endif
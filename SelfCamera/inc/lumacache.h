@@ -0,0 +1,37 @@
+/*
+ * lumacache.h
+ *
+ * The luma of the current preview frame, rotated to portrait like
+ * everything the landmarks work on. It is only rotated the first time it is
+ * asked for in a frame, and the buffer is kept from frame to frame, so
+ * nothing is allocated while the preview size stays the same.
+ *
+ * The landmarks are the only consumer. Face detection runs in the camera
+ * and the portrait blur works unrotated at chroma resolution.
+ *
+ * All calls must come from the thread that delivers the frames.
+ */
+
+#ifndef LUMACACHE_H_
+#define LUMACACHE_H_
+
+#include "view.h"
+
+#include <dlib/array2d.h>
+
+typedef struct _luma_cache luma_cache;
+
+luma_cache* luma_cache_create(void);
+
+void luma_cache_destroy(luma_cache* cache);
+
+/* Starts a new frame. The frame must stay valid until the next call, as the
+ * luma is rotated from it on demand. */
+void luma_cache_set_frame(luma_cache* cache, const camera_preview_data_s* frame);
+
+/* The rotated luma. Every row starts on a 32 byte boundary, so the vector
+ * kernels can use aligned loads on it. Returns NULL before the first frame
+ * or for a frame without a full luma plane. Valid until the next frame. */
+const dlib::aligned_array2d<unsigned char>* luma_cache_luma(luma_cache* cache);
+
+#endif /* LUMACACHE_H_ */
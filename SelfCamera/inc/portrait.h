@@ -0,0 +1,32 @@
+/*
+ * portrait.h
+ *
+ * Background blur for the portrait mode. A soft head-and-shoulders mask is
+ * built from each face's landmarks, and everything outside it is blended with
+ * a blurred copy of the frame. The blur is three box passes at chroma
+ * resolution made of running sums, so its cost does not depend on the radius.
+ */
+
+#ifndef PORTRAIT_H_
+#define PORTRAIT_H_
+
+#include <camera.h>
+
+#include <vector>
+#include <dlib/image_processing.h>
+
+/* Scratch buffers of one caller. Contexts are not shared between threads. */
+typedef struct _portrait_ctx portrait_ctx;
+
+portrait_ctx* portrait_create(void);
+
+void portrait_destroy(portrait_ctx* ctx);
+
+/* Blurs the background around the given faces (landmarks in the rotated
+ * preview coordinates face_landmark() uses). Does nothing without faces.
+ * The blur radius follows the frame width, so a full resolution capture
+ * looks like the preview it was taken from. */
+void portrait_apply(portrait_ctx* ctx, camera_preview_data_s* frame,
+		const std::vector<dlib::full_object_detection>& shapes);
+
+#endif /* PORTRAIT_H_ */
@@ -0,0 +1,53 @@
+/*
+ * sticker.h
+ *
+ * The sticker images and the NV12 routines that resample them and paste
+ * them into a frame. Nothing here needs the Tizen image API, so the Linux
+ * tools draw stickers with the same code as the app; reading the images
+ * from the package stays in imageutils.
+ */
+
+#ifndef STICKER_H_
+#define STICKER_H_
+
+#include <camera.h>
+
+#define STICKER_NUM 17
+#define STICKER_PREVIEW_WIDTH 176	/* preview width the images are drawn for */
+
+/* A decoded NV12 image (U first). error is an image_util error code, 0 once
+ * the image is usable. */
+typedef struct _imageinfo{
+	unsigned char* data;
+	int size;
+	int width;
+	int height;
+	int error;
+}imageinfo;
+
+/* File name of sticker idx in the resource folder, NULL out of range. */
+const char* sticker_filename(int idx);
+
+/* Paste a sticker centred on (p, q), leaving out its white (yuvcpy) or black
+ * (santacpy) background. The frame is in the preview's chroma order. */
+void _image_util_yuvcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q);
+
+void _image_util_santacpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q);
+
+void _image_util_imgcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q);
+
+/* Resamples an NV12 sticker to width x height (rounded down to even). */
+int _image_util_resize(imageinfo* dst, const imageinfo* src, int width, int height);
+
+/* Resamples every sticker in src by scale into dst, which must hold
+ * STICKER_NUM images, for a frame scale times STICKER_PREVIEW_WIDTH wide.
+ * Stickers that are missing or cannot be resampled get a non-zero error. */
+void sticker_scale_all(imageinfo* dst, const imageinfo* src, double scale);
+
+/* Frees the images sticker_scale_all() made. */
+void sticker_release_all(imageinfo* dst);
+
+/* Converts an interleaved chroma plane between NV12 and NV21 order. */
+void _image_util_swap_uv(unsigned char* uv, int size);
+
+#endif /* STICKER_H_ */
@@ -0,0 +1,62 @@
+/*
+ * still.h
+ *
+ * Full resolution still capture. The preview callback only snapshots what is
+ * needed to redo the effect (landmarks, sticker, filter); the sensor image is
+ * composited and encoded later on a worker thread, so the preview never pays
+ * for the capture resolution.
+ */
+
+#ifndef STILL_H_
+#define STILL_H_
+
+#include "imageutils.h"
+
+#include <limits.h>
+#include <vector>
+#include <dlib/image_processing.h>
+
+#define STILL_THUMBNAIL_SIZE 128
+
+typedef struct _still_job{
+	/* sensor image, NV12 once still_job_set_image() succeeded */
+	unsigned char* data;
+	int size;
+	int width;
+	int height;
+	int error;
+
+	/* state of the preview frame the shutter fired on */
+	int preview_width;
+	int preview_height;
+	std::vector<dlib::full_object_detection> shapes;
+	int sticker;
+	int filter_cb_q8;	/* 0 when no software filter is active */
+	int filter_cr_q8;
+	int beauty;	/* skin smoothing strength out of 256, 0 for none */
+	int portrait;	/* background blur on/off */
+
+	char filename[PATH_MAX];
+
+	/* ARGB8888 preview of the saved picture, made once it is encoded */
+	unsigned int* thumbnail;
+	int thumbnail_width;
+	int thumbnail_height;
+}still_job;
+
+still_job* still_job_create(int preview_width, int preview_height);
+
+/* Copies the captured image, decoding it first if the camera handed a JPEG. */
+int still_job_set_image(still_job* job, const camera_image_data_s* image);
+
+/* Copies an already processed preview frame (preview chroma order), for
+ * captures that need no re-compositing. */
+int still_job_set_frame(still_job* job, const unsigned char* data, int width, int height);
+
+/* Re-applies the beauty filter, background blur, filter and sticker at
+ * capture size, encodes the JPEG and renders the thumbnail. */
+int still_job_process(still_job* job, imageinfo* stickers);
+
+void still_job_destroy(still_job* job);
+
+#endif /* STILL_H_ */
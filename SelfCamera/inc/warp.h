@@ -0,0 +1,50 @@
+/*
+ * warp.h
+ *
+ * Piecewise affine mesh warp of an NV12 frame. Every triangle of the mesh is
+ * rasterized scanline by scanline at its destination position and filled
+ * with fixed-point bilinear samples from where the triangle was, so only the
+ * pixels the mesh covers are touched. The outer vertices of a mesh should
+ * stay in place or the warped area will show a seam.
+ */
+
+#ifndef WARP_H_
+#define WARP_H_
+
+#include <camera.h>
+#include <dlib/image_processing/full_object_detection.h>
+
+typedef struct _warp_point{
+	float x;	/* frame coordinates */
+	float y;
+}warp_point;
+
+typedef struct _warp_triangle{
+	unsigned char a;	/* vertex indices */
+	unsigned char b;
+	unsigned char c;
+}warp_triangle;
+
+/* Copy of the source area of one caller. Contexts are not shared between
+ * threads. */
+typedef struct _warp_ctx warp_ctx;
+
+warp_ctx* warp_create(void);
+
+void warp_destroy(warp_ctx* ctx);
+
+/* Moves src[i] to dst[i] for the num_points vertices and warps the
+ * triangles in between. Luma and chroma are both resampled. */
+void warp_mesh(warp_ctx* ctx, camera_preview_data_s* frame,
+		const warp_point* src, const warp_point* dst, int num_points,
+		const warp_triangle* tris, int num_tris);
+
+/* Landmark effects built on warp_mesh(). The landmarks are in the rotated
+ * preview coordinates face_landmark() uses. */
+void warp_big_eyes(warp_ctx* ctx, camera_preview_data_s* frame,
+		const dlib::full_object_detection& shape);
+
+void warp_slim_face(warp_ctx* ctx, camera_preview_data_s* frame,
+		const dlib::full_object_detection& shape);
+
+#endif /* WARP_H_ */
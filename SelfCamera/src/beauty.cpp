@@ -0,0 +1,286 @@
+#include "beauty.h"
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BEAUTY_EPS 400	/* variance (in gray levels^2) the filter treats as noise */
+#define BEAUTY_VAR_MAX 16384	/* 8-bit data never varies by more than 127.5^2 */
+#define BEAUTY_FOREHEAD 0.25	/* how far the brow line is pushed up, in face heights */
+#define BEAUTY_POINTS 27
+
+using namespace dlib;
+
+struct _beauty_ctx{
+	unsigned int* col;	/* running column sums */
+	unsigned int* col_sq;
+	unsigned int* prefix;	/* horizontal prefix sums of the column sums */
+	unsigned int* prefix_sq;
+	unsigned char* zero;	/* a row of zeros, the subtrahend of the first rows */
+	int row_capacity;
+	unsigned short* a;	/* Q8 guided filter coefficients over the dilated box */
+	unsigned short* b;
+	int area_capacity;
+	unsigned short lut[BEAUTY_VAR_MAX];	/* var -> Q8 var/(var+eps) */
+};
+
+static inline int _clamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+beauty_ctx* beauty_create(void)
+{
+	beauty_ctx* ctx = (beauty_ctx*)calloc(1, sizeof(beauty_ctx));
+	if(ctx == NULL)
+		return NULL;
+	for(int v=0;v<BEAUTY_VAR_MAX;v++)
+		ctx->lut[v] = (unsigned short)((256*v + (v + BEAUTY_EPS)/2) / (v + BEAUTY_EPS));
+	return ctx;
+}
+
+void beauty_destroy(beauty_ctx* ctx)
+{
+	if(ctx == NULL)
+		return;
+	free(ctx->col);
+	free(ctx->col_sq);
+	free(ctx->prefix);
+	free(ctx->prefix_sq);
+	free(ctx->zero);
+	free(ctx->a);
+	free(ctx->b);
+	free(ctx);
+}
+
+static bool _beauty_reserve(beauty_ctx* ctx, int row, int area)
+{
+	if(row > ctx->row_capacity)
+	{
+		free(ctx->col);
+		free(ctx->col_sq);
+		free(ctx->prefix);
+		free(ctx->prefix_sq);
+		free(ctx->zero);
+		ctx->col = (unsigned int*)malloc(row*sizeof(unsigned int));
+		ctx->col_sq = (unsigned int*)malloc(row*sizeof(unsigned int));
+		ctx->prefix = (unsigned int*)malloc(row*sizeof(unsigned int));
+		ctx->prefix_sq = (unsigned int*)malloc(row*sizeof(unsigned int));
+		ctx->zero = (unsigned char*)calloc(row, 1);
+		ctx->row_capacity = row;
+		if(!ctx->col || !ctx->col_sq || !ctx->prefix || !ctx->prefix_sq || !ctx->zero)
+		{
+			ctx->row_capacity = 0;
+			return false;
+		}
+	}
+	if(area > ctx->area_capacity)
+	{
+		free(ctx->a);
+		free(ctx->b);
+		ctx->a = (unsigned short*)malloc(area*sizeof(unsigned short));
+		ctx->b = (unsigned short*)malloc(area*sizeof(unsigned short));
+		ctx->area_capacity = area;
+		if(!ctx->a || !ctx->b)
+		{
+			ctx->area_capacity = 0;
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Face outline in frame coordinates: the jaw line, then the brows lifted
+ * towards the hairline so the forehead is smoothed too. */
+static void _beauty_outline(const full_object_detection& shape, int frame_height,
+		double* px, double* py)
+{
+	double chin_x = shape.part(8).y();
+	double chin_y = frame_height - shape.part(8).x();
+	int n = 0;
+	for(int k=0;k<=16;k++,n++)
+	{
+		px[n] = shape.part(k).y();
+		py[n] = frame_height - shape.part(k).x();
+	}
+	for(int k=26;k>=17;k--,n++)
+	{
+		double x = shape.part(k).y();
+		double y = frame_height - shape.part(k).x();
+		px[n] = x + (x - chin_x)*BEAUTY_FOREHEAD;
+		py[n] = y + (y - chin_y)*BEAUTY_FOREHEAD;
+	}
+}
+
+/* Leftmost and rightmost crossing of the outline with the middle of row y. */
+static bool _beauty_span(const double* px, const double* py, int y, int* xl, int* xr)
+{
+	double yc = y + 0.5;
+	double lo = 1e9, hi = -1e9;
+	for(int i=0,j=BEAUTY_POINTS-1;i<BEAUTY_POINTS;j=i++)
+	{
+		if((py[i] <= yc) == (py[j] <= yc))
+			continue;
+		double x = px[i] + (yc - py[i]) * (px[j] - px[i]) / (py[j] - py[i]);
+		if(x < lo) lo = x;
+		if(x > hi) hi = x;
+	}
+	if(lo > hi)
+		return false;
+	*xl = (int)lo;
+	*xr = (int)hi;
+	return true;
+}
+
+void beauty_apply(beauty_ctx* ctx, camera_preview_data_s* frame,
+		const full_object_detection& shape, int strength)
+{
+	if(ctx == NULL || strength <= 0 || shape.num_parts() < 68)
+		return;
+
+	const int W = frame->width;
+	const int H = frame->height;
+	unsigned char* Y = frame->data.double_plane.y;
+
+	double px[BEAUTY_POINTS], py[BEAUTY_POINTS];
+	_beauty_outline(shape, H, px, py);
+
+	double min_x = px[0], max_x = px[0], min_y = py[0], max_y = py[0];
+	for(int i=1;i<BEAUTY_POINTS;i++)
+	{
+		if(px[i] < min_x) min_x = px[i];
+		if(px[i] > max_x) max_x = px[i];
+		if(py[i] < min_y) min_y = py[i];
+		if(py[i] > max_y) max_y = py[i];
+	}
+
+	/* R: pixels that may change, A: where the coefficients are needed */
+	const int x0 = _clamp((int)min_x, 0, W), x1 = _clamp((int)max_x + 1, 0, W);
+	const int y0 = _clamp((int)min_y, 0, H), y1 = _clamp((int)max_y + 1, 0, H);
+	if(x1 - x0 < 4 || y1 - y0 < 4)
+		return;
+
+	int face = (max_x - min_x) < (max_y - min_y) ? (int)(max_x - min_x) : (int)(max_y - min_y);
+	const int r = _clamp(face/20, 2, 12);
+	const int feather = _clamp(face/10, 2, 32);
+	const int ax0 = _clamp(x0 - r, 0, W), ax1 = _clamp(x1 + r, 0, W);
+	const int ay0 = _clamp(y0 - r, 0, H), ay1 = _clamp(y1 + r, 0, H);
+	const int aw = ax1 - ax0, ah = ay1 - ay0;
+	const int ex0 = _clamp(ax0 - r, 0, W), ex1 = _clamp(ax1 + r, 0, W);
+	const int ew = ex1 - ex0;
+
+	if(!_beauty_reserve(ctx, aw + 2*r + 1 > ew ? aw + 2*r + 1 : ew, aw*ah))
+		return;
+
+	const unsigned int N = (2*r + 1)*(2*r + 1);
+	const unsigned long long inv_n = ((1ull << 24) + N/2) / N;
+	const unsigned long long inv_n2 = ((1ull << 32) + N*N/2) / (N*N);
+	box_column_fn box_column = kernels_get()->box_column;
+	unsigned int* col = ctx->col;
+	unsigned int* col_sq = ctx->col_sq;
+	unsigned int* pre = ctx->prefix;
+	unsigned int* pre_sq = ctx->prefix_sq;
+
+	/* Stage 1: mean and variance of every (2r+1)^2 window centred in A, with
+	 * the frame border replicated, give a = var/(var+eps), b = (1-a)*mean. */
+	memset(col, 0, ew*sizeof(unsigned int));
+	memset(col_sq, 0, ew*sizeof(unsigned int));
+	for(int k=-r;k<=r;k++)
+		box_column(col, col_sq, Y + _clamp(ay0 + k, 0, H - 1)*W + ex0, ctx->zero, ew);
+
+	for(int y=ay0;y<ay1;y++)
+	{
+		if(y > ay0)
+			box_column(col, col_sq, Y + _clamp(y + r, 0, H - 1)*W + ex0,
+					Y + _clamp(y - r - 1, 0, H - 1)*W + ex0, ew);
+
+		pre[0] = pre_sq[0] = 0;
+		for(int i=0;i<aw + 2*r;i++)
+		{
+			int c = _clamp(ax0 - r + i, 0, W - 1) - ex0;
+			pre[i+1] = pre[i] + col[c];
+			pre_sq[i+1] = pre_sq[i] + col_sq[c];
+		}
+
+		unsigned short* a = ctx->a + (y - ay0)*aw;
+		unsigned short* b = ctx->b + (y - ay0)*aw;
+		for(int i=0;i<aw;i++)
+		{
+			unsigned long long s1 = pre[i + 2*r + 1] - pre[i];
+			unsigned long long s2 = pre_sq[i + 2*r + 1] - pre_sq[i];
+			unsigned long long var = ((N*s2 - s1*s1) * inv_n2) >> 32;
+			unsigned int ai = ctx->lut[var < BEAUTY_VAR_MAX ? var : BEAUTY_VAR_MAX - 1];
+			unsigned int mean_q8 = (unsigned int)((s1*inv_n + (1 << 15)) >> 16);
+			a[i] = (unsigned short)ai;
+			b[i] = (unsigned short)(((256 - ai)*mean_q8) >> 8);
+		}
+	}
+
+	/* Stage 2: q = mean(a)*I + mean(b) over R, blended through the mask. The
+	 * windows never leave A, so clamping to A replicates the frame border. */
+	memset(col, 0, aw*sizeof(unsigned int));
+	memset(col_sq, 0, aw*sizeof(unsigned int));
+	for(int k=-r;k<=r;k++)
+	{
+		const unsigned short* a = ctx->a + (_clamp(y0 + k, ay0, ay1 - 1) - ay0)*aw;
+		const unsigned short* b = ctx->b + (_clamp(y0 + k, ay0, ay1 - 1) - ay0)*aw;
+		for(int i=0;i<aw;i++)
+		{
+			col[i] += a[i];
+			col_sq[i] += b[i];
+		}
+	}
+
+	for(int y=y0;y<y1;y++)
+	{
+		if(y > y0)
+		{
+			int add = _clamp(y + r, ay0, ay1 - 1) - ay0;
+			int sub = _clamp(y - r - 1, ay0, ay1 - 1) - ay0;
+			const unsigned short* aa = ctx->a + add*aw;
+			const unsigned short* as = ctx->a + sub*aw;
+			const unsigned short* ba = ctx->b + add*aw;
+			const unsigned short* bs = ctx->b + sub*aw;
+			for(int i=0;i<aw;i++)
+			{
+				col[i] += aa[i] - as[i];
+				col_sq[i] += ba[i] - bs[i];
+			}
+		}
+
+		int xl, xr;
+		if(!_beauty_span(px, py, y, &xl, &xr))
+			continue;
+		int vy = y - (int)min_y < (int)max_y - y ? y - (int)min_y : (int)max_y - y;
+		int sx0 = xl > x0 ? xl : x0;
+		int sx1 = xr + 1 < x1 ? xr + 1 : x1;
+		if(sx0 >= sx1)
+			continue;
+
+		/* prefix sums over [sx0 - r, sx1 + r) */
+		pre[0] = pre_sq[0] = 0;
+		for(int i=0;i<sx1 - sx0 + 2*r;i++)
+		{
+			int c = _clamp(sx0 - r + i, ax0, ax1 - 1) - ax0;
+			pre[i+1] = pre[i] + col[c];
+			pre_sq[i+1] = pre_sq[i] + col_sq[c];
+		}
+
+		unsigned char* row = Y + y*W;
+		for(int x=sx0;x<sx1;x++)
+		{
+			int i = x - sx0;
+			unsigned long long sa = pre[i + 2*r + 1] - pre[i];
+			unsigned long long sb = pre_sq[i + 2*r + 1] - pre_sq[i];
+			int I = row[x];
+			int q = (int)(((sa*I + sb)*inv_n + (1ull << 31)) >> 32);
+			if(q > 255)
+				q = 255;
+
+			int d = x - xl < xr - x ? x - xl : xr - x;
+			if(vy < d)
+				d = vy;
+			int w = d >= feather ? strength : d*strength/feather;
+			row[x] = (unsigned char)(I + (q - I)*w/256);
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#include "catalog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+
+#define CATALOG_TAIL 4096
+
+static char s_index_path[PATH_MAX];
+static char s_folder[PATH_MAX];
+static char s_prefix[NAME_MAX];
+static char s_last[PATH_MAX];
+
+static int _catalog_file_filter(const struct dirent *dir)
+{
+	return strncmp(dir->d_name, s_prefix, strlen(s_prefix)) == 0;
+}
+
+/* Looks for the newest entry that still exists in the tail of the index. */
+static bool _catalog_read_last(void)
+{
+	char buf[CATALOG_TAIL + 1];
+	FILE* f = fopen(s_index_path, "r");
+	if(f == NULL)
+		return false;
+
+	long off = 0;
+	if(fseek(f, 0, SEEK_END) == 0)
+	{
+		long len = ftell(f);
+		off = len > CATALOG_TAIL ? len - CATALOG_TAIL : 0;
+	}
+	fseek(f, off, SEEK_SET);
+	size_t n = fread(buf, 1, CATALOG_TAIL, f);
+	fclose(f);
+	buf[n] = '\0';
+
+	/* walk the lines backwards; the first one may be cut when off > 0 */
+	char* end = buf + n;
+	while(end > buf)
+	{
+		char* line = end - 1;
+		while(line > buf && line[-1] != '\n')
+			line--;
+		if(line == buf && off > 0)
+			break;
+
+		size_t len = end - line;
+		if(len > 0 && line[len-1] == '\n')
+			len--;
+		if(len > 0 && len < sizeof(s_last))
+		{
+			memcpy(s_last, line, len);
+			s_last[len] = '\0';
+			if(access(s_last, F_OK) == 0)
+				return true;
+		}
+		end = line;
+	}
+
+	s_last[0] = '\0';
+	return false;
+}
+
+/* Rewrites the index from a scan of the folder, oldest entry first. */
+static void _catalog_rebuild(void)
+{
+	struct dirent **namelist = NULL;
+	int n = scandir(s_folder, &namelist, _catalog_file_filter, alphasort);
+
+	s_last[0] = '\0';
+	FILE* f = fopen(s_index_path, "w");
+	for(int i=0;i<n;i++)
+	{
+		if(f)
+			fprintf(f, "%s/%s\n", s_folder, namelist[i]->d_name);
+		if(i == n-1)
+			snprintf(s_last, sizeof(s_last), "%s/%s", s_folder, namelist[i]->d_name);
+		free(namelist[i]);
+	}
+	if(f)
+		fclose(f);
+	free(namelist);
+}
+
+void catalog_init(const char* index_path, const char* folder, const char* prefix)
+{
+	snprintf(s_index_path, sizeof(s_index_path), "%s", index_path);
+	snprintf(s_folder, sizeof(s_folder), "%s", folder);
+	snprintf(s_prefix, sizeof(s_prefix), "%s", prefix);
+
+	if(!_catalog_read_last())
+		_catalog_rebuild();
+}
+
+void catalog_add(const char* file_path)
+{
+	FILE* f = fopen(s_index_path, "a");
+	if(f)
+	{
+		fprintf(f, "%s\n", file_path);
+		fclose(f);
+	}
+	snprintf(s_last, sizeof(s_last), "%s", file_path);
+}
+
+size_t catalog_last(char* file_path, size_t size)
+{
+	if(s_last[0] != '\0' && access(s_last, F_OK) != 0)
+	{
+		/* deleted from the gallery since we last looked */
+		if(!_catalog_read_last())
+			_catalog_rebuild();
+	}
+	if(s_last[0] == '\0')
+		return 0;
+	return snprintf(file_path, size, "%s", s_last);
+}
@@ -0,0 +1,50 @@
+#include "faceslot.h"
+
+#define FACE_SLOT_FRESH 4	/* set in latest by the writer, cleared by the reader */
+
+face_slot* face_slot_create(void)
+{
+	face_slot* slot = new face_slot();
+	for(int i=0;i<3;i++)
+	{
+		slot->buffers[i].timestamp = 0;
+		slot->buffers[i].count = 0;
+	}
+	slot->front = 0;
+	slot->back = 1;
+	slot->latest = 2;
+	return slot;
+}
+
+void face_slot_destroy(face_slot* slot)
+{
+	delete slot;
+}
+
+face_result* face_slot_begin(face_slot* slot)
+{
+	face_result* result = &slot->buffers[slot->back];
+	result->count = 0;
+	return result;
+}
+
+void face_slot_publish(face_slot* slot, double timestamp)
+{
+	face_result* result = &slot->buffers[slot->back];
+	result->timestamp = timestamp;
+
+	/* release: the buffer is complete before the reader can take it */
+	int prev = slot->latest.exchange(slot->back | FACE_SLOT_FRESH, std::memory_order_acq_rel);
+	slot->back = prev & ~FACE_SLOT_FRESH;
+}
+
+const face_result* face_slot_read(face_slot* slot)
+{
+	if(slot->latest.load(std::memory_order_relaxed) & FACE_SLOT_FRESH)
+	{
+		/* acquire: pairs with the release in face_slot_publish() */
+		int prev = slot->latest.exchange(slot->front, std::memory_order_acq_rel);
+		slot->front = prev & ~FACE_SLOT_FRESH;
+	}
+	return &slot->buffers[slot->front];
+}
@@ -0,0 +1,52 @@
+#include "filter.h"
+#include <string.h>
+
+/* names of the software filters, starting at FILTER_SOFTWARE_FIRST */
+static const char *s_filter_names[] = {
+	"red1", "red2", "red3",
+	"blue1", "blue2", "blue3",
+	"green1", "green2", "green3"
+};
+
+bool filter_gains(int filter, double *cb, double *cr) {
+	switch (filter) {
+	case 4: // red1
+		*cb = 0.95; *cr = 1.05;
+		return true;
+	case 5:
+		*cb = 0.9; *cr = 1.07;
+		return true;
+	case 6:
+		*cb = 0.85; *cr = 1.1;
+		return true;
+	case 7: // blue
+		*cb = 1.05; *cr = 0.95;
+		return true;
+	case 8:
+		*cb = 1.07; *cr = 0.9;
+		return true;
+	case 9:
+		*cb = 1.1; *cr = 0.85;
+		return true;
+	case 10: // green
+		*cb = 0.97; *cr = 0.96;
+		return true;
+	case 11:
+		*cb = 0.95; *cr = 0.95;
+		return true;
+	case 12:
+		*cb = 0.93; *cr = 0.93;
+		return true;
+	default:
+		*cb = 0; *cr = 0;
+		return false;
+	}
+}
+
+int filter_from_name(const char *name) {
+	for (unsigned int i = 0; i < sizeof(s_filter_names) / sizeof(s_filter_names[0]); i++) {
+		if (strcmp(name, s_filter_names[i]) == 0)
+			return FILTER_SOFTWARE_FIRST + i;
+	}
+	return -1;
+}
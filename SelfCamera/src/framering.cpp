@@ -0,0 +1,156 @@
+#include "framering.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+frame_ring* frame_ring_create(int capacity)
+{
+	frame_ring* ring = new frame_ring();
+	ring->slots = new frame_slot[capacity];
+	ring->buffer = NULL;
+	ring->capacity = capacity;
+	ring->head = 0;
+	for(int i=0;i<capacity;i++)
+	{
+		ring->slots[i].data = NULL;
+		ring->slots[i].width = 0;
+		ring->slots[i].height = 0;
+		ring->slots[i].size = 0;
+		ring->slots[i].timestamp = 0;
+		ring->slots[i].pins = 0;
+	}
+	return ring;
+}
+
+void frame_ring_destroy(frame_ring* ring)
+{
+	if(ring == NULL)
+		return;
+	free(ring->buffer);
+	delete[] ring->slots;
+	delete ring;
+}
+
+/* (Re)allocates every slot in one block. Only done for the first frame or
+ * when the preview resolution changes, and never while a slot is pinned. */
+static bool _frame_ring_alloc(frame_ring* ring, int width, int height)
+{
+	int size = width*height*3/2;
+	for(int i=0;i<ring->capacity;i++)
+	{
+		if(ring->slots[i].pins.load(std::memory_order_acquire) != 0)
+			return false;
+	}
+
+	unsigned char* buffer = (unsigned char*)realloc(ring->buffer, (size_t)size*ring->capacity);
+	if(buffer == NULL)
+		return false;
+
+	ring->buffer = buffer;
+	for(int i=0;i<ring->capacity;i++)
+	{
+		ring->slots[i].data = buffer + (size_t)size*i;
+		ring->slots[i].width = width;
+		ring->slots[i].height = height;
+		ring->slots[i].size = size;
+		ring->slots[i].timestamp = 0;
+	}
+	ring->head = 0;
+	return true;
+}
+
+bool frame_ring_push(frame_ring* ring, const camera_preview_data_s* frame, double timestamp)
+{
+	if(frame->format != CAMERA_PIXEL_FORMAT_NV12 || frame->num_of_planes != 2)
+		return false;
+
+	int y_size = frame->width*frame->height;
+	if(frame->data.double_plane.y_size < y_size || frame->data.double_plane.uv_size < y_size/2)
+		return false;
+
+	if(ring->buffer == NULL || ring->slots[0].width != frame->width
+			|| ring->slots[0].height != frame->height)
+	{
+		if(!_frame_ring_alloc(ring, frame->width, frame->height))
+			return false;
+	}
+
+	for(int n=0;n<ring->capacity;n++)
+	{
+		frame_slot* slot = &ring->slots[ring->head];
+		ring->head = (ring->head + 1) % ring->capacity;
+		if(slot->pins.load(std::memory_order_acquire) != 0)
+			continue;
+
+		memcpy(slot->data, frame->data.double_plane.y, y_size);
+		memcpy(slot->data + y_size, frame->data.double_plane.uv, y_size/2);
+		slot->timestamp = timestamp;
+		return true;
+	}
+	return false;
+}
+
+static bool _frame_ring_valid(const frame_ring* ring, const frame_slot* slot)
+{
+	return ring->buffer != NULL && slot->timestamp > 0;
+}
+
+frame_slot* frame_ring_acquire_nearest(frame_ring* ring, double timestamp)
+{
+	frame_slot* best = NULL;
+	for(int i=0;i<ring->capacity;i++)
+	{
+		frame_slot* slot = &ring->slots[i];
+		if(!_frame_ring_valid(ring, slot))
+			continue;
+		if(best == NULL || fabs(slot->timestamp - timestamp) < fabs(best->timestamp - timestamp))
+			best = slot;
+	}
+	if(best)
+		best->pins.fetch_add(1, std::memory_order_acq_rel);
+	return best;
+}
+
+int frame_ring_acquire_latest(frame_ring* ring, double timestamp, frame_slot** slots, int max)
+{
+	int n = 0;
+	if(max <= 0)
+		return 0;
+
+	/* slots are not in time order once pinned ones have been skipped, so keep
+	 * the newest max candidates sorted by insertion */
+	for(int i=0;i<ring->capacity;i++)
+	{
+		frame_slot* slot = &ring->slots[i];
+		if(!_frame_ring_valid(ring, slot) || slot->timestamp > timestamp)
+			continue;
+
+		int k;
+		if(n < max)
+			k = n++;
+		else if(slot->timestamp > slots[0]->timestamp)
+		{
+			for(k=0;k+1<n;k++)
+				slots[k] = slots[k+1];
+		}
+		else
+			continue;
+
+		while(k > 0 && slots[k-1]->timestamp > slot->timestamp)
+		{
+			slots[k] = slots[k-1];
+			k--;
+		}
+		slots[k] = slot;
+	}
+
+	for(int i=0;i<n;i++)
+		slots[i]->pins.fetch_add(1, std::memory_order_acq_rel);
+	return n;
+}
+
+void frame_ring_release(frame_slot* slot)
+{
+	if(slot)
+		slot->pins.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -5,162 +5,6 @@
 #define BUFLEN 256
 
 static char sample_file_path[BUFLEN];
-static const char *image_util_stickers_filename[STICKER_NUM] = {
-"deer_left_big.jpg","deer_right_big.jpg","deer_nose_big.jpg",
-"deer_left_small.jpg", "deer_right_small.jpg", "deer_nose_small.jpg",
-"hat0.jpg","hat1.jpg","hat2.jpg",
-"beard_rot.jpg", "deer_nose_s.jpg",
-"glasses_rot.jpg", "santa_rot.jpg",
-"deer_left_mid.jpg", "deer_right_mid.jpg",
-"cat_left.jpg", "cat_right.jpg"
-};
-
-void _image_util_yuvcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q)
-{
-	int sh = imginfo->height;
-	int sw = imginfo->width;
-	int sy_size = sh*sw;
-
-	int fh = frame->height;
-	int fw = frame->width;
-
-	p -= sw/2;
-	q -= sh/2;
-	if(p%2 != 0) p++;
-	if(q%2 != 0) q++;
-
-	int pp = 0;
-	int qq = 0;
-	int pt = 0;
-	int ptpt = 0;
-	int pti = 0;
-	int ptipti = 0;
-	int ii = 0;
-	int jj = 0;
-
-	unsigned char y,u,v;
-
-	for(int j=0;j<sh;j++){
-		for(int i=0;i<sw;i++){
-			pp = p+i;
-			qq = q+j;
-			if(pp < 0 || qq < 0) continue;
-			pt = pp + qq*fw;
-			pti = i + j*sw;
-
-			pp /= 2;
-			qq /= 2;
-			ptpt = (pp + qq*fw/2)*2;
-			ii = i / 2;
-			jj = j / 2;
-			ptipti = (ii + jj*sw/2)*2 + sy_size;
-			y = imginfo->data[pti];
-			if(ptipti < imginfo->size){
-				u = imginfo->data[ptipti];
-				v = imginfo->data[ptipti+1];
-			} else
-			{
-				continue;
-			}
-
-			if(y > 230 && (u > 124 || u < 132) && (v > 124 || v < 132))
-			{
-				continue;
-			} else
-			{
-				if(pt < frame->data.double_plane.y_size && ptpt < frame->data.double_plane.uv_size)
-				{
-					frame->data.double_plane.y[pt] = imginfo->data[pti];
-					frame->data.double_plane.uv[ptpt] = v;
-					frame->data.double_plane.uv[ptpt+1] = u;
-				}
-			}
-		}
-	}
-}
-
-void _image_util_imgcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q)
-{
-	int sh = imginfo->height;
-	int sw = imginfo->width;
-	int sy_size = sh*sw;
-
-	int fh = frame->height;
-	int fw = frame->width;
-
-	p -= sw/2;
-	q -= sh/2;
-
-	int pt = p + q*fw;
-	int pti = 0;
-
-#ifdef ALPHA
-	// copy Y plane
-	for(int i=0;i<sw;i++)
-	{
-		if(pt > frame->data.double_plane.y_size || pti > sy_size)
-			break;
-		memcpy(frame->data.double_plane.y + pt, imginfo->data + pti, sizeof(unsigned char)*sh);
-		pt += fw;
-		pti += sh;
-	}
-
-	// copy UV plane
-	p /=2;
-	q /=2;
-	pt = (p + q*fw/2)*2;
-	pti = sy_size;
-
-	for(int i=0;i<sw/2;i++)
-	{
-		if(pt > frame->data.double_plane.uv_size || pti > imginfo->size)
-			break;
-		memcpy(frame->data.double_plane.uv + pt, imginfo->data + pti, sizeof(unsigned char)*sh);
-		pt += fw;
-		pti += sh;
-	}
-#else
-	for(int i=0;i<sw;i++)
-	{
-		//if(pt >= frame->data.double_plane.y_size || pti >= sy_size)
-		//	break;
-		for(int j=0;j<sh;j++)
-		{
-			if(pt+j < frame->data.double_plane.y_size && pti+j < sy_size)
-				if(imginfo->data[pti+j] <= 220)
-					frame->data.double_plane.y[pt+j] = imginfo->data[pti+j];
-		}
-		pt += fw;
-		pti += sh;
-	}
-
-
-	// copy UV plane
-	p /=2;
-	q /=2;
-	pt = (p + q*fw/2)*2+1;
-	pti = sy_size;
-
-	for(int i=0;i<sw/2;i++)
-	{
-		//if(pt >= frame->data.double_plane.uv_size || pti >= imginfo->size)
-		//	break;
-		for(int j=0;j<sh;j++)
-		{
-			if(pt+j < frame->data.double_plane.uv_size && pti+j < imginfo->size)
-			{
-				unsigned char tmp = imginfo->data[pti+j];
-				if(tmp != 128)
-					frame->data.double_plane.uv[pt+j] = tmp;
-				if(i == sw/4)
-					tmp =0;
-			}
-		}
-		pt += fw;
-		pti += sh;
-	}
-#endif
-}
 
 void _image_util_read_stickers(imageinfo* imgarr)
 {
@@ -178,7 +22,7 @@ void _image_util_read_jpeg(imageinfo* imginfo, int idx)
     unsigned int size_decode;
 
     char *resource_path = app_get_resource_path();
-    snprintf(sample_file_path, BUFLEN, "%s%s", resource_path, image_util_stickers_filename[idx]);
+    snprintf(sample_file_path, BUFLEN, "%s%s", resource_path, sticker_filename(idx));
 
     int error_code = image_util_decode_jpeg(sample_file_path, IMAGE_UTIL_COLORSPACE_NV12, &img_source, &width, &height, &size_decode);
     if (error_code != IMAGE_UTIL_ERROR_NONE) {
@@ -199,6 +43,57 @@ void _image_util_read_jpeg(imageinfo* imginfo, int idx)
     /* no need to transform RGB->NV12, just decode into NV12 */
 }
 
+static inline unsigned char _image_util_clamp(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+int _image_util_thumbnail(unsigned int** argb, int* tw, int* th, const unsigned char* nv12,
+		int width, int height, int max_size)
+{
+	if(nv12 == NULL || width <= 0 || height <= 0 || max_size <= 0)
+		return -1;
+
+	if(width >= height)
+	{
+		*tw = width < max_size ? width : max_size;
+		*th = (int)((long)height * *tw / width);
+	}
+	else
+	{
+		*th = height < max_size ? height : max_size;
+		*tw = (int)((long)width * *th / height);
+	}
+	if(*tw <= 0) *tw = 1;
+	if(*th <= 0) *th = 1;
+
+	*argb = (unsigned int*)malloc(sizeof(unsigned int) * *tw * *th);
+	if(*argb == NULL)
+		return -1;
+
+	/* point sampling is plenty for a thumbnail and touches only tw*th pixels */
+	const unsigned char* uv = nv12 + width*height;
+	for(int j=0;j<*th;j++)
+	{
+		int y = (int)((long)j * height / *th);
+		const unsigned char* yrow = nv12 + y*width;
+		const unsigned char* uvrow = uv + (y/2)*width;
+		unsigned int* out = *argb + j * *tw;
+		for(int i=0;i<*tw;i++)
+		{
+			int x = (int)((long)i * width / *tw);
+			int c = (yrow[x] - 16) * 298;
+			int d = uvrow[x & ~1] - 128;
+			int e = uvrow[(x & ~1) + 1] - 128;
+			unsigned char r = _image_util_clamp((c + 409*e + 128) >> 8);
+			unsigned char g = _image_util_clamp((c - 100*d - 208*e + 128) >> 8);
+			unsigned char b = _image_util_clamp((c + 516*d + 128) >> 8);
+			out[i] = 0xff000000u | (r << 16) | (g << 8) | b;
+		}
+	}
+	return 0;
+}
+
 const char *_map_colorspace(image_util_colorspace_e color_space)
 {
     switch (color_space) {
@@ -248,67 +143,3 @@ const char *_map_colorspace(image_util_colorspace_e color_space)
         return "IMAGE_UTIL_COLORSPACE_NV61";
     }
 }
-
-void _image_util_santacpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q)
-{
-	int sh = imginfo->height;
-	int sw = imginfo->width;
-	int sy_size = sh*sw;
-
-	int fh = frame->height;
-	int fw = frame->width;
-
-	p -= sw/2;
-	q -= sh/2;
-	if(p%2 != 0) p++;
-	if(q%2 != 0) q++;
-
-	int pp = 0;
-	int qq = 0;
-	int pt = 0;
-	int ptpt = 0;
-	int pti = 0;
-	int ptipti = 0;
-	int ii = 0;
-	int jj = 0;
-
-	unsigned char y,u,v;
-
-	for(int j=0;j<sh;j++){
-		for(int i=0;i<sw;i++){
-			pp = p+i;
-			qq = q+j;
-			if(pp < 0 || qq < 0) continue;
-			pt = pp + qq*fw;
-			pti = i + j*sw;
-
-			pp /= 2;
-			qq /= 2;
-			ptpt = (pp + qq*fw/2)*2;
-			ii = i / 2;
-			jj = j / 2;
-			ptipti = (ii + jj*sw/2)*2 + sy_size;
-			y = imginfo->data[pti];
-			if(ptipti < imginfo->size){
-				u = imginfo->data[ptipti];
-				v = imginfo->data[ptipti+1];
-			} else
-			{
-				continue;
-			}
-
-			if(y < 30 && (u > 124 || u < 132) && (v > 124 || v < 132))
-			{
-				continue;
-			} else
-			{
-				if(pt < frame->data.double_plane.y_size && ptpt < frame->data.double_plane.uv_size)
-				{
-					frame->data.double_plane.y[pt] = imginfo->data[pti];
-					frame->data.double_plane.uv[ptpt] = v;
-					frame->data.double_plane.uv[ptpt+1] = u;
-				}
-			}
-		}
-	}
-}
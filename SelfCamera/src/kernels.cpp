@@ -0,0 +1,772 @@
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define KERNELS_X86
+#include <immintrin.h>
+#define KERNELS_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KERNELS_NEON
+#include <arm_neon.h>
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+static kernel_table s_variants[KERNEL_ISA_NUM];
+static kernel_table s_active;
+static kernel_isa_e s_best_isa = KERNEL_ISA_SCALAR;
+static int s_initialized = 0;
+
+// ----------------------------------------------------------------------------------------
+// scalar reference
+
+static void _nv12_filter_scalar(unsigned char* uv, int size, int cb_q8, int cr_q8)
+{
+	for(int i=0;i+1<size;i+=2)
+	{
+		int cb = (uv[i] * cb_q8) >> 8;
+		int cr = (uv[i+1] * cr_q8) >> 8;
+		uv[i] = cb > 255 ? 255 : cb;
+		uv[i+1] = cr > 255 ? 255 : cr;
+	}
+	if(size & 1)
+	{
+		int cb = (uv[size-1] * cb_q8) >> 8;
+		uv[size-1] = cb > 255 ? 255 : cb;
+	}
+}
+
+static void _blit_y_scalar(unsigned char* dst, const unsigned char* src, int n,
+		unsigned char lo, unsigned char hi)
+{
+	for(int i=0;i<n;i++)
+	{
+		if(src[i] >= lo && src[i] <= hi)
+			dst[i] = src[i];
+	}
+}
+
+static void _blit_uv_scalar(unsigned char* dst, const unsigned char* src,
+		const unsigned char* key, int n, unsigned char lo, unsigned char hi)
+{
+	for(int k=0;k<n;k++)
+	{
+		unsigned char y = key[2*k];
+		if(y >= lo && y <= hi)
+		{
+			dst[2*k] = src[2*k+1];
+			dst[2*k+1] = src[2*k];
+		}
+	}
+}
+
+static void _luma_rotate_block_scalar(unsigned char* dst, long dst_stride,
+		const unsigned char* src, long src_stride, int height,
+		int x0, int x1, int y0, int y1)
+{
+	for(int y=y0;y<y1;y++)
+	{
+		const unsigned char* s = src + y*src_stride;
+		unsigned char* d = dst + (height - 1 - y);
+		for(int x=x0;x<x1;x++)
+			d[x*dst_stride] = s[x];
+	}
+}
+
+static void _luma_rotate_scalar(unsigned char* dst, long dst_stride,
+		const unsigned char* src, long src_stride, int width, int height)
+{
+	_luma_rotate_block_scalar(dst, dst_stride, src, src_stride, height, 0, width, 0, height);
+}
+
+static void _luma_downscale_scalar(unsigned char* dst, const unsigned char* row0,
+		const unsigned char* row1, int n)
+{
+	for(int i=0;i<n;i++)
+		dst[i] = (unsigned char)((row0[2*i] + row0[2*i+1] + row1[2*i] + row1[2*i+1] + 2) >> 2);
+}
+
+static void _box_column_scalar(unsigned int* sum, unsigned int* sum_sq,
+		const unsigned char* add, const unsigned char* sub, int n)
+{
+	for(int i=0;i<n;i++)
+	{
+		unsigned int a = add[i];
+		unsigned int s = sub[i];
+		sum[i] += a - s;
+		sum_sq[i] += a*a - s*s;
+	}
+}
+
+/* Handles the right and bottom strips the 8x8 block variants leave over. */
+static void _luma_rotate_edges(unsigned char* dst, long dst_stride,
+		const unsigned char* src, long src_stride, int width, int height)
+{
+	int bw = width & ~7;
+	int bh = height & ~7;
+	_luma_rotate_block_scalar(dst, dst_stride, src, src_stride, height, bw, width, 0, height);
+	_luma_rotate_block_scalar(dst, dst_stride, src, src_stride, height, 0, bw, bh, height);
+}
+
+// ----------------------------------------------------------------------------------------
+// x86
+
+#ifdef KERNELS_X86
+
+KERNELS_TARGET("sse4.1")
+static void _nv12_filter_sse4(unsigned char* uv, int size, int cb_q8, int cr_q8)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i coef = _mm_set1_epi32((cr_q8 << 16) | cb_q8);
+	int i = 0;
+	for(;i+16<=size;i+=16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(uv + i));
+		/* (v << 8) * c >> 16 == v * c >> 8 */
+		__m128i lo = _mm_mulhi_epu16(_mm_unpacklo_epi8(zero, x), coef);
+		__m128i hi = _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, x), coef);
+		_mm_storeu_si128((__m128i*)(uv + i), _mm_packus_epi16(lo, hi));
+	}
+	_nv12_filter_scalar(uv + i, size - i, cb_q8, cr_q8);
+}
+
+KERNELS_TARGET("avx2")
+static void _nv12_filter_avx2(unsigned char* uv, int size, int cb_q8, int cr_q8)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i coef = _mm256_set1_epi32((cr_q8 << 16) | cb_q8);
+	int i = 0;
+	for(;i+32<=size;i+=32)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*)(uv + i));
+		__m256i lo = _mm256_mulhi_epu16(_mm256_unpacklo_epi8(zero, x), coef);
+		__m256i hi = _mm256_mulhi_epu16(_mm256_unpackhi_epi8(zero, x), coef);
+		_mm256_storeu_si256((__m256i*)(uv + i), _mm256_packus_epi16(lo, hi));
+	}
+	_nv12_filter_scalar(uv + i, size - i, cb_q8, cr_q8);
+}
+
+KERNELS_TARGET("sse4.1")
+static inline __m128i _in_range_sse4(__m128i x, __m128i lo, __m128i hi)
+{
+	return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(x, lo), x),
+			_mm_cmpeq_epi8(_mm_min_epu8(x, hi), x));
+}
+
+KERNELS_TARGET("sse4.1")
+static void _blit_y_sse4(unsigned char* dst, const unsigned char* src, int n,
+		unsigned char lo, unsigned char hi)
+{
+	const __m128i vlo = _mm_set1_epi8((char)lo);
+	const __m128i vhi = _mm_set1_epi8((char)hi);
+	int i = 0;
+	for(;i+16<=n;i+=16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i m = _in_range_sse4(s, vlo, vhi);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_blendv_epi8(d, s, m));
+	}
+	_blit_y_scalar(dst + i, src + i, n - i, lo, hi);
+}
+
+KERNELS_TARGET("sse4.1")
+static void _blit_uv_sse4(unsigned char* dst, const unsigned char* src,
+		const unsigned char* key, int n, unsigned char lo, unsigned char hi)
+{
+	const __m128i vlo = _mm_set1_epi8((char)lo);
+	const __m128i vhi = _mm_set1_epi8((char)hi);
+	const __m128i dup_even = _mm_setr_epi8(0,0,2,2,4,4,6,6,8,8,10,10,12,12,14,14);
+	const __m128i swap = _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+	int k = 0;
+	for(;k+8<=n;k+=8)
+	{
+		__m128i y = _mm_loadu_si128((const __m128i*)(key + 2*k));
+		__m128i s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2*k)), swap);
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + 2*k));
+		__m128i m = _mm_shuffle_epi8(_in_range_sse4(y, vlo, vhi), dup_even);
+		_mm_storeu_si128((__m128i*)(dst + 2*k), _mm_blendv_epi8(d, s, m));
+	}
+	_blit_uv_scalar(dst + 2*k, src + 2*k, key + 2*k, n - k, lo, hi);
+}
+
+KERNELS_TARGET("avx2")
+static inline __m256i _in_range_avx2(__m256i x, __m256i lo, __m256i hi)
+{
+	return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(x, lo), x),
+			_mm256_cmpeq_epi8(_mm256_min_epu8(x, hi), x));
+}
+
+KERNELS_TARGET("avx2")
+static void _blit_y_avx2(unsigned char* dst, const unsigned char* src, int n,
+		unsigned char lo, unsigned char hi)
+{
+	const __m256i vlo = _mm256_set1_epi8((char)lo);
+	const __m256i vhi = _mm256_set1_epi8((char)hi);
+	int i = 0;
+	for(;i+32<=n;i+=32)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		__m256i m = _in_range_avx2(s, vlo, vhi);
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_blendv_epi8(d, s, m));
+	}
+	_blit_y_sse4(dst + i, src + i, n - i, lo, hi);
+}
+
+KERNELS_TARGET("avx2")
+static void _blit_uv_avx2(unsigned char* dst, const unsigned char* src,
+		const unsigned char* key, int n, unsigned char lo, unsigned char hi)
+{
+	const __m256i vlo = _mm256_set1_epi8((char)lo);
+	const __m256i vhi = _mm256_set1_epi8((char)hi);
+	/* pshufb works per 128-bit lane, which is what we want here since the
+	 * key byte of every pair sits at the same offset as the pair itself */
+	const __m256i dup_even = _mm256_setr_epi8(0,0,2,2,4,4,6,6,8,8,10,10,12,12,14,14,
+			0,0,2,2,4,4,6,6,8,8,10,10,12,12,14,14);
+	const __m256i swap = _mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+			1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+	int k = 0;
+	for(;k+16<=n;k+=16)
+	{
+		__m256i y = _mm256_loadu_si256((const __m256i*)(key + 2*k));
+		__m256i s = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + 2*k)), swap);
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + 2*k));
+		__m256i m = _mm256_shuffle_epi8(_in_range_avx2(y, vlo, vhi), dup_even);
+		_mm256_storeu_si256((__m256i*)(dst + 2*k), _mm256_blendv_epi8(d, s, m));
+	}
+	_blit_uv_sse4(dst + 2*k, src + 2*k, key + 2*k, n - k, lo, hi);
+}
+
+/* The 8x8 byte transpose only needs SSE2 and AVX2 has nothing to add to it,
+ * so this variant is registered for both. */
+KERNELS_TARGET("sse4.1")
+static void _luma_rotate_sse4(unsigned char* dst, long dst_stride,
+		const unsigned char* src, long src_stride, int width, int height)
+{
+	for(int by=0;by+8<=height;by+=8)
+	{
+		/* reversed row order turns the transpose into the rotation */
+		const unsigned char* s = src + (by + 7)*src_stride;
+		unsigned char* d = dst + (height - 8 - by);
+		for(int bx=0;bx+8<=width;bx+=8)
+		{
+			__m128i r0 = _mm_loadl_epi64((const __m128i*)(s + bx));
+			__m128i r1 = _mm_loadl_epi64((const __m128i*)(s + bx - src_stride));
+			__m128i r2 = _mm_loadl_epi64((const __m128i*)(s + bx - 2*src_stride));
+			__m128i r3 = _mm_loadl_epi64((const __m128i*)(s + bx - 3*src_stride));
+			__m128i r4 = _mm_loadl_epi64((const __m128i*)(s + bx - 4*src_stride));
+			__m128i r5 = _mm_loadl_epi64((const __m128i*)(s + bx - 5*src_stride));
+			__m128i r6 = _mm_loadl_epi64((const __m128i*)(s + bx - 6*src_stride));
+			__m128i r7 = _mm_loadl_epi64((const __m128i*)(s + bx - 7*src_stride));
+
+			__m128i a = _mm_unpacklo_epi8(r0, r1);
+			__m128i b = _mm_unpacklo_epi8(r2, r3);
+			__m128i c = _mm_unpacklo_epi8(r4, r5);
+			__m128i e = _mm_unpacklo_epi8(r6, r7);
+			__m128i ab_lo = _mm_unpacklo_epi16(a, b);
+			__m128i ab_hi = _mm_unpackhi_epi16(a, b);
+			__m128i ce_lo = _mm_unpacklo_epi16(c, e);
+			__m128i ce_hi = _mm_unpackhi_epi16(c, e);
+			__m128i x01 = _mm_unpacklo_epi32(ab_lo, ce_lo);
+			__m128i x23 = _mm_unpackhi_epi32(ab_lo, ce_lo);
+			__m128i x45 = _mm_unpacklo_epi32(ab_hi, ce_hi);
+			__m128i x67 = _mm_unpackhi_epi32(ab_hi, ce_hi);
+
+			unsigned char* o = d + bx*dst_stride;
+			_mm_storel_epi64((__m128i*)(o), x01);
+			_mm_storel_epi64((__m128i*)(o + dst_stride), _mm_srli_si128(x01, 8));
+			_mm_storel_epi64((__m128i*)(o + 2*dst_stride), x23);
+			_mm_storel_epi64((__m128i*)(o + 3*dst_stride), _mm_srli_si128(x23, 8));
+			_mm_storel_epi64((__m128i*)(o + 4*dst_stride), x45);
+			_mm_storel_epi64((__m128i*)(o + 5*dst_stride), _mm_srli_si128(x45, 8));
+			_mm_storel_epi64((__m128i*)(o + 6*dst_stride), x67);
+			_mm_storel_epi64((__m128i*)(o + 7*dst_stride), _mm_srli_si128(x67, 8));
+		}
+	}
+	_luma_rotate_edges(dst, dst_stride, src, src_stride, width, height);
+}
+
+KERNELS_TARGET("sse4.1")
+static void _luma_downscale_sse4(unsigned char* dst, const unsigned char* row0,
+		const unsigned char* row1, int n)
+{
+	const __m128i ones = _mm_set1_epi8(1);
+	const __m128i two = _mm_set1_epi16(2);
+	int i = 0;
+	for(;i+16<=n;i+=16)
+	{
+		/* maddubs with ones adds each horizontal pair into a 16-bit lane */
+		__m128i lo = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row0 + 2*i)), ones),
+				_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row1 + 2*i)), ones));
+		__m128i hi = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row0 + 2*i + 16)), ones),
+				_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(row1 + 2*i + 16)), ones));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	_luma_downscale_scalar(dst + i, row0 + 2*i, row1 + 2*i, n - i);
+}
+
+KERNELS_TARGET("avx2")
+static void _luma_downscale_avx2(unsigned char* dst, const unsigned char* row0,
+		const unsigned char* row1, int n)
+{
+	const __m256i ones = _mm256_set1_epi8(1);
+	const __m256i two = _mm256_set1_epi16(2);
+	int i = 0;
+	for(;i+32<=n;i+=32)
+	{
+		__m256i lo = _mm256_add_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row0 + 2*i)), ones),
+				_mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row1 + 2*i)), ones));
+		__m256i hi = _mm256_add_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row0 + 2*i + 32)), ones),
+				_mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row1 + 2*i + 32)), ones));
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, two), 2);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, two), 2);
+		/* packus interleaves the 128-bit lanes, put them back in order */
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+		_mm256_storeu_si256((__m256i*)(dst + i), packed);
+	}
+	_luma_downscale_sse4(dst + i, row0 + 2*i, row1 + 2*i, n - i);
+}
+
+KERNELS_TARGET("sse4.1")
+static void _box_column_sse4(unsigned int* sum, unsigned int* sum_sq,
+		const unsigned char* add, const unsigned char* sub, int n)
+{
+	int i = 0;
+	for(;i+4<=n;i+=4)
+	{
+		__m128i a = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)(add + i)));
+		__m128i s = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)(sub + i)));
+		__m128i v = _mm_loadu_si128((const __m128i*)(sum + i));
+		__m128i q = _mm_loadu_si128((const __m128i*)(sum_sq + i));
+		v = _mm_add_epi32(v, _mm_sub_epi32(a, s));
+		q = _mm_add_epi32(q, _mm_sub_epi32(_mm_mullo_epi32(a, a), _mm_mullo_epi32(s, s)));
+		_mm_storeu_si128((__m128i*)(sum + i), v);
+		_mm_storeu_si128((__m128i*)(sum_sq + i), q);
+	}
+	_box_column_scalar(sum + i, sum_sq + i, add + i, sub + i, n - i);
+}
+
+KERNELS_TARGET("avx2")
+static void _box_column_avx2(unsigned int* sum, unsigned int* sum_sq,
+		const unsigned char* add, const unsigned char* sub, int n)
+{
+	int i = 0;
+	for(;i+8<=n;i+=8)
+	{
+		__m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(add + i)));
+		__m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(sub + i)));
+		__m256i v = _mm256_loadu_si256((const __m256i*)(sum + i));
+		__m256i q = _mm256_loadu_si256((const __m256i*)(sum_sq + i));
+		v = _mm256_add_epi32(v, _mm256_sub_epi32(a, s));
+		q = _mm256_add_epi32(q, _mm256_sub_epi32(_mm256_mullo_epi32(a, a), _mm256_mullo_epi32(s, s)));
+		_mm256_storeu_si256((__m256i*)(sum + i), v);
+		_mm256_storeu_si256((__m256i*)(sum_sq + i), q);
+	}
+	_box_column_sse4(sum + i, sum_sq + i, add + i, sub + i, n - i);
+}
+
+#endif /* KERNELS_X86 */
+
+// ----------------------------------------------------------------------------------------
+// ARM
+
+#ifdef KERNELS_NEON
+
+static void _nv12_filter_neon(unsigned char* uv, int size, int cb_q8, int cr_q8)
+{
+	const uint16_t c[8] = { (uint16_t)cb_q8, (uint16_t)cr_q8, (uint16_t)cb_q8, (uint16_t)cr_q8,
+			(uint16_t)cb_q8, (uint16_t)cr_q8, (uint16_t)cb_q8, (uint16_t)cr_q8 };
+	const uint16x4_t coef = vld1_u16(c);
+	int i = 0;
+	for(;i+16<=size;i+=16)
+	{
+		uint8x16_t x = vld1q_u8(uv + i);
+		uint16x8_t lo = vmovl_u8(vget_low_u8(x));
+		uint16x8_t hi = vmovl_u8(vget_high_u8(x));
+		uint16x8_t rlo = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(lo), coef), 8),
+				vshrn_n_u32(vmull_u16(vget_high_u16(lo), coef), 8));
+		uint16x8_t rhi = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(hi), coef), 8),
+				vshrn_n_u32(vmull_u16(vget_high_u16(hi), coef), 8));
+		vst1q_u8(uv + i, vcombine_u8(vqmovn_u16(rlo), vqmovn_u16(rhi)));
+	}
+	_nv12_filter_scalar(uv + i, size - i, cb_q8, cr_q8);
+}
+
+static void _blit_y_neon(unsigned char* dst, const unsigned char* src, int n,
+		unsigned char lo, unsigned char hi)
+{
+	const uint8x16_t vlo = vdupq_n_u8(lo);
+	const uint8x16_t vhi = vdupq_n_u8(hi);
+	int i = 0;
+	for(;i+16<=n;i+=16)
+	{
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t m = vandq_u8(vcgeq_u8(s, vlo), vcleq_u8(s, vhi));
+		vst1q_u8(dst + i, vbslq_u8(m, s, vld1q_u8(dst + i)));
+	}
+	_blit_y_scalar(dst + i, src + i, n - i, lo, hi);
+}
+
+static void _blit_uv_neon(unsigned char* dst, const unsigned char* src,
+		const unsigned char* key, int n, unsigned char lo, unsigned char hi)
+{
+	const uint8x16_t vlo = vdupq_n_u8(lo);
+	const uint8x16_t vhi = vdupq_n_u8(hi);
+	int k = 0;
+	for(;k+8<=n;k+=8)
+	{
+		uint8x16_t y = vld1q_u8(key + 2*k);
+		uint16x8_t m = vreinterpretq_u16_u8(vandq_u8(vcgeq_u8(y, vlo), vcleq_u8(y, vhi)));
+		/* copy the even (key) byte of each pair over the odd one */
+		m = vsliq_n_u16(m, m, 8);
+		uint8x16_t s = vrev16q_u8(vld1q_u8(src + 2*k));
+		vst1q_u8(dst + 2*k, vbslq_u8(vreinterpretq_u8_u16(m), s, vld1q_u8(dst + 2*k)));
+	}
+	_blit_uv_scalar(dst + 2*k, src + 2*k, key + 2*k, n - k, lo, hi);
+}
+
+static void _luma_rotate_neon(unsigned char* dst, long dst_stride,
+		const unsigned char* src, long src_stride, int width, int height)
+{
+	for(int by=0;by+8<=height;by+=8)
+	{
+		const unsigned char* s = src + (by + 7)*src_stride;
+		unsigned char* d = dst + (height - 8 - by);
+		for(int bx=0;bx+8<=width;bx+=8)
+		{
+			uint8x8x2_t t01 = vtrn_u8(vld1_u8(s + bx), vld1_u8(s + bx - src_stride));
+			uint8x8x2_t t23 = vtrn_u8(vld1_u8(s + bx - 2*src_stride), vld1_u8(s + bx - 3*src_stride));
+			uint8x8x2_t t45 = vtrn_u8(vld1_u8(s + bx - 4*src_stride), vld1_u8(s + bx - 5*src_stride));
+			uint8x8x2_t t67 = vtrn_u8(vld1_u8(s + bx - 6*src_stride), vld1_u8(s + bx - 7*src_stride));
+
+			uint16x4x2_t u02 = vtrn_u16(vreinterpret_u16_u8(t01.val[0]), vreinterpret_u16_u8(t23.val[0]));
+			uint16x4x2_t u13 = vtrn_u16(vreinterpret_u16_u8(t01.val[1]), vreinterpret_u16_u8(t23.val[1]));
+			uint16x4x2_t u46 = vtrn_u16(vreinterpret_u16_u8(t45.val[0]), vreinterpret_u16_u8(t67.val[0]));
+			uint16x4x2_t u57 = vtrn_u16(vreinterpret_u16_u8(t45.val[1]), vreinterpret_u16_u8(t67.val[1]));
+
+			uint32x2x2_t v04 = vtrn_u32(vreinterpret_u32_u16(u02.val[0]), vreinterpret_u32_u16(u46.val[0]));
+			uint32x2x2_t v15 = vtrn_u32(vreinterpret_u32_u16(u13.val[0]), vreinterpret_u32_u16(u57.val[0]));
+			uint32x2x2_t v26 = vtrn_u32(vreinterpret_u32_u16(u02.val[1]), vreinterpret_u32_u16(u46.val[1]));
+			uint32x2x2_t v37 = vtrn_u32(vreinterpret_u32_u16(u13.val[1]), vreinterpret_u32_u16(u57.val[1]));
+
+			unsigned char* o = d + bx*dst_stride;
+			vst1_u8(o, vreinterpret_u8_u32(v04.val[0]));
+			vst1_u8(o + dst_stride, vreinterpret_u8_u32(v15.val[0]));
+			vst1_u8(o + 2*dst_stride, vreinterpret_u8_u32(v26.val[0]));
+			vst1_u8(o + 3*dst_stride, vreinterpret_u8_u32(v37.val[0]));
+			vst1_u8(o + 4*dst_stride, vreinterpret_u8_u32(v04.val[1]));
+			vst1_u8(o + 5*dst_stride, vreinterpret_u8_u32(v15.val[1]));
+			vst1_u8(o + 6*dst_stride, vreinterpret_u8_u32(v26.val[1]));
+			vst1_u8(o + 7*dst_stride, vreinterpret_u8_u32(v37.val[1]));
+		}
+	}
+	_luma_rotate_edges(dst, dst_stride, src, src_stride, width, height);
+}
+
+static void _luma_downscale_neon(unsigned char* dst, const unsigned char* row0,
+		const unsigned char* row1, int n)
+{
+	int i = 0;
+	for(;i+8<=n;i+=8)
+	{
+		uint16x8_t sum = vpaddlq_u8(vld1q_u8(row0 + 2*i));
+		sum = vpadalq_u8(sum, vld1q_u8(row1 + 2*i));
+		vst1_u8(dst + i, vrshrn_n_u16(sum, 2));
+	}
+	_luma_downscale_scalar(dst + i, row0 + 2*i, row1 + 2*i, n - i);
+}
+
+static void _box_column_neon(unsigned int* sum, unsigned int* sum_sq,
+		const unsigned char* add, const unsigned char* sub, int n)
+{
+	int i = 0;
+	for(;i+8<=n;i+=8)
+	{
+		uint16x8_t a = vmovl_u8(vld1_u8(add + i));
+		uint16x8_t s = vmovl_u8(vld1_u8(sub + i));
+		uint32x4_t v0 = vsubw_u16(vaddw_u16(vld1q_u32(sum + i), vget_low_u16(a)), vget_low_u16(s));
+		uint32x4_t v1 = vsubw_u16(vaddw_u16(vld1q_u32(sum + i + 4), vget_high_u16(a)), vget_high_u16(s));
+		uint32x4_t q0 = vmlsl_u16(vmlal_u16(vld1q_u32(sum_sq + i), vget_low_u16(a), vget_low_u16(a)),
+				vget_low_u16(s), vget_low_u16(s));
+		uint32x4_t q1 = vmlsl_u16(vmlal_u16(vld1q_u32(sum_sq + i + 4), vget_high_u16(a), vget_high_u16(a)),
+				vget_high_u16(s), vget_high_u16(s));
+		vst1q_u32(sum + i, v0);
+		vst1q_u32(sum + i + 4, v1);
+		vst1q_u32(sum_sq + i, q0);
+		vst1q_u32(sum_sq + i + 4, q1);
+	}
+	_box_column_scalar(sum + i, sum_sq + i, add + i, sub + i, n - i);
+}
+
+#endif /* KERNELS_NEON */
+
+// ----------------------------------------------------------------------------------------
+
+static int _kernels_cpu_supports(kernel_isa_e isa)
+{
+	switch(isa)
+	{
+	case KERNEL_ISA_SCALAR:
+		return 1;
+#ifdef KERNELS_X86
+	case KERNEL_ISA_SSE4:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse4.1");
+	case KERNEL_ISA_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+#ifdef KERNELS_NEON
+	case KERNEL_ISA_NEON:
+#if defined(__aarch64__) || !defined(__linux__)
+		return 1;
+#else
+		return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+#endif
+	default:
+		return 0;
+	}
+}
+
+static void _kernels_register(void)
+{
+	memset(s_variants, 0, sizeof(s_variants));
+
+	s_variants[KERNEL_ISA_SCALAR].nv12_filter = _nv12_filter_scalar;
+	s_variants[KERNEL_ISA_SCALAR].blit_y = _blit_y_scalar;
+	s_variants[KERNEL_ISA_SCALAR].blit_uv = _blit_uv_scalar;
+	s_variants[KERNEL_ISA_SCALAR].luma_rotate = _luma_rotate_scalar;
+	s_variants[KERNEL_ISA_SCALAR].luma_downscale = _luma_downscale_scalar;
+	s_variants[KERNEL_ISA_SCALAR].box_column = _box_column_scalar;
+
+#ifdef KERNELS_X86
+	s_variants[KERNEL_ISA_SSE4].nv12_filter = _nv12_filter_sse4;
+	s_variants[KERNEL_ISA_SSE4].blit_y = _blit_y_sse4;
+	s_variants[KERNEL_ISA_SSE4].blit_uv = _blit_uv_sse4;
+	s_variants[KERNEL_ISA_SSE4].luma_rotate = _luma_rotate_sse4;
+	s_variants[KERNEL_ISA_SSE4].luma_downscale = _luma_downscale_sse4;
+	s_variants[KERNEL_ISA_SSE4].box_column = _box_column_sse4;
+
+	s_variants[KERNEL_ISA_AVX2].nv12_filter = _nv12_filter_avx2;
+	s_variants[KERNEL_ISA_AVX2].blit_y = _blit_y_avx2;
+	s_variants[KERNEL_ISA_AVX2].blit_uv = _blit_uv_avx2;
+	s_variants[KERNEL_ISA_AVX2].luma_rotate = _luma_rotate_sse4;
+	s_variants[KERNEL_ISA_AVX2].luma_downscale = _luma_downscale_avx2;
+	s_variants[KERNEL_ISA_AVX2].box_column = _box_column_avx2;
+#endif
+
+#ifdef KERNELS_NEON
+	s_variants[KERNEL_ISA_NEON].nv12_filter = _nv12_filter_neon;
+	s_variants[KERNEL_ISA_NEON].blit_y = _blit_y_neon;
+	s_variants[KERNEL_ISA_NEON].blit_uv = _blit_uv_neon;
+	s_variants[KERNEL_ISA_NEON].luma_rotate = _luma_rotate_neon;
+	s_variants[KERNEL_ISA_NEON].luma_downscale = _luma_downscale_neon;
+	s_variants[KERNEL_ISA_NEON].box_column = _box_column_neon;
+#endif
+}
+
+#define SELF_TEST_W 72
+#define SELF_TEST_H 40
+
+static void _fill_random(unsigned char* buf, int n, unsigned int* seed)
+{
+	for(int i=0;i<n;i++)
+	{
+		*seed = *seed * 1103515245u + 12345u;
+		buf[i] = (unsigned char)(*seed >> 16);
+	}
+}
+
+/* Returns a bit mask of the kernel_table slots whose output differs from the
+ * scalar reference. Odd sizes make sure the scalar tails are exercised too. */
+static unsigned int _kernels_compare(const kernel_table* ref, const kernel_table* t)
+{
+	const int n = SELF_TEST_W*SELF_TEST_H;
+	unsigned char src[n], key[n], a[n], b[n];
+	unsigned int seed = 0x5eed;
+	unsigned int bad = 0;
+
+	_fill_random(src, n, &seed);
+	_fill_random(key, n, &seed);
+	_fill_random(a, n, &seed);
+
+	if(t->nv12_filter)
+	{
+		static const int coefs[][2] = { { 243, 269 }, { 282, 218 }, { 256, 256 }, { 0, 32767 } };
+		for(unsigned int c=0;c<sizeof(coefs)/sizeof(coefs[0]);c++)
+		{
+			memcpy(b, a, n);
+			unsigned char expect[n];
+			memcpy(expect, a, n);
+			ref->nv12_filter(expect, n - 3, coefs[c][0], coefs[c][1]);
+			t->nv12_filter(b, n - 3, coefs[c][0], coefs[c][1]);
+			if(memcmp(expect, b, n))
+				bad |= 1u << 0;
+		}
+	}
+	if(t->blit_y)
+	{
+		unsigned char expect[n];
+		memcpy(expect, a, n);
+		memcpy(b, a, n);
+		ref->blit_y(expect, src, n - 5, 30, 230);
+		t->blit_y(b, src, n - 5, 30, 230);
+		if(memcmp(expect, b, n))
+			bad |= 1u << 1;
+	}
+	if(t->blit_uv)
+	{
+		unsigned char expect[n];
+		memcpy(expect, a, n);
+		memcpy(b, a, n);
+		ref->blit_uv(expect, src, key, n/2 - 3, 0, 230);
+		t->blit_uv(b, src, key, n/2 - 3, 0, 230);
+		if(memcmp(expect, b, n))
+			bad |= 1u << 2;
+	}
+	if(t->luma_rotate)
+	{
+		static const int dims[][2] = { { SELF_TEST_W, SELF_TEST_H }, { SELF_TEST_W - 3, SELF_TEST_H - 5 } };
+		for(unsigned int c=0;c<sizeof(dims)/sizeof(dims[0]);c++)
+		{
+			unsigned char expect[n];
+			memset(expect, 0, n);
+			memset(b, 0, n);
+			ref->luma_rotate(expect, dims[c][1], src, dims[c][0], dims[c][0], dims[c][1]);
+			t->luma_rotate(b, dims[c][1], src, dims[c][0], dims[c][0], dims[c][1]);
+			if(memcmp(expect, b, n))
+				bad |= 1u << 3;
+		}
+	}
+	if(t->luma_downscale)
+	{
+		/* two rows of SELF_TEST_W pixels, and an odd width for the tails */
+		static const int widths[] = { SELF_TEST_W/2, SELF_TEST_W/2 - 3 };
+		for(unsigned int c=0;c<sizeof(widths)/sizeof(widths[0]);c++)
+		{
+			unsigned char expect[n];
+			memset(expect, 0, n);
+			memset(b, 0, n);
+			for(int y=0;y+1<SELF_TEST_H;y+=2)
+			{
+				ref->luma_downscale(expect + (y/2)*SELF_TEST_W, src + y*SELF_TEST_W,
+						src + (y + 1)*SELF_TEST_W, widths[c]);
+				t->luma_downscale(b + (y/2)*SELF_TEST_W, src + y*SELF_TEST_W,
+						src + (y + 1)*SELF_TEST_W, widths[c]);
+			}
+			if(memcmp(expect, b, n))
+				bad |= 1u << 5;
+		}
+	}
+	if(t->box_column)
+	{
+		const int m = n/4 - 3;
+		unsigned int expect[2][n/4], got[2][n/4];
+		for(int i=0;i<n/4;i++)
+		{
+			/* start from large sums so the wrap-around is covered as well */
+			expect[0][i] = got[0][i] = 0xfffff000u + src[i];
+			expect[1][i] = got[1][i] = 0xffff0000u + key[i]*251u;
+		}
+		ref->box_column(expect[0], expect[1], a, src, m);
+		t->box_column(got[0], got[1], a, src, m);
+		if(memcmp(expect, got, sizeof(expect)))
+			bad |= 1u << 4;
+	}
+	return bad;
+}
+
+int kernels_self_test(kernel_isa_e isa)
+{
+	if(!s_initialized)
+		_kernels_register();
+	if(isa == KERNEL_ISA_SCALAR || !_kernels_cpu_supports(isa))
+		return 0;
+	return _kernels_compare(&s_variants[KERNEL_ISA_SCALAR], &s_variants[isa]) != 0;
+}
+
+int kernels_init(int verify)
+{
+	int dropped = 0;
+
+	_kernels_register();
+	s_active = s_variants[KERNEL_ISA_SCALAR];
+	s_best_isa = KERNEL_ISA_SCALAR;
+
+	for(int isa=KERNEL_ISA_SCALAR+1;isa<KERNEL_ISA_NUM;isa++)
+	{
+		if(!_kernels_cpu_supports((kernel_isa_e)isa))
+			continue;
+
+		kernel_table* t = &s_variants[isa];
+		if(verify)
+		{
+			unsigned int bad = _kernels_compare(&s_variants[KERNEL_ISA_SCALAR], t);
+			if(bad & (1u << 0)) { t->nv12_filter = NULL; dropped++; }
+			if(bad & (1u << 1)) { t->blit_y = NULL; dropped++; }
+			if(bad & (1u << 2)) { t->blit_uv = NULL; dropped++; }
+			if(bad & (1u << 3)) { t->luma_rotate = NULL; dropped++; }
+			if(bad & (1u << 4)) { t->box_column = NULL; dropped++; }
+			if(bad & (1u << 5)) { t->luma_downscale = NULL; dropped++; }
+		}
+
+		/* later entries of the enum are the faster ones on their platform */
+		if(t->nv12_filter) s_active.nv12_filter = t->nv12_filter;
+		if(t->blit_y) s_active.blit_y = t->blit_y;
+		if(t->blit_uv) s_active.blit_uv = t->blit_uv;
+		if(t->luma_rotate) s_active.luma_rotate = t->luma_rotate;
+		if(t->box_column) s_active.box_column = t->box_column;
+		if(t->luma_downscale) s_active.luma_downscale = t->luma_downscale;
+		s_best_isa = (kernel_isa_e)isa;
+	}
+
+	s_initialized = 1;
+	return dropped;
+}
+
+const kernel_table* kernels_get(void)
+{
+	if(!s_initialized)
+		kernels_init(0);
+	return &s_active;
+}
+
+const kernel_table* kernels_get_variant(kernel_isa_e isa)
+{
+	if(!s_initialized)
+		kernels_init(0);
+	if(isa < 0 || isa >= KERNEL_ISA_NUM || !_kernels_cpu_supports(isa))
+		return NULL;
+	return &s_variants[isa];
+}
+
+kernel_isa_e kernels_best_isa(void)
+{
+	return s_best_isa;
+}
+
+const char* kernels_isa_name(kernel_isa_e isa)
+{
+	switch(isa)
+	{
+	case KERNEL_ISA_SCALAR:
+		return "scalar";
+	case KERNEL_ISA_SSE4:
+		return "sse4";
+	case KERNEL_ISA_AVX2:
+		return "avx2";
+	case KERNEL_ISA_NEON:
+		return "neon";
+	default:
+		return "unknown";
+	}
+}
@@ -21,6 +21,9 @@
        Image and Vision Computing (IMAVIS), Special Issue on Facial Landmark Localisation "In-The-Wild". 2016.
     You can get the trained model file from:
     http://dlib.net/files/shape_predictor_68_face_landmarks.dat.bz2.
+    Run it through tools/convert_model.cpp before packaging it: the converted
+    file holds the same model, loads about ten times faster and can be used
+    level by level while it loads.
     Note that the license for the iBUG 300-W dataset excludes commercial use.
     So you should contact Imperial College London to find out if it's OK for
     you to use this model file in a commercial product.
@@ -47,9 +50,7 @@
     2011.  SSE4 is the next fastest and is supported by most current machines.  
 */
 
-#include "view.h"
 #include "landmark.h"
-#include "imageutils.h"
 
 #include <ctime>
 
@@ -139,6 +140,32 @@ void draw_landmark(camera_preview_data_s* frame, const full_object_detection sha
 	}
 }
 
+void draw_sticker(camera_preview_data_s* frame, const full_object_detection& shape, imageinfo* imgarr, int sticker, warp_ctx* warp)
+{
+	switch (sticker) {
+	case 2:
+		draw_nyan(frame, shape, imgarr);
+		break;
+	case 4:
+		draw_rudolph(frame, shape, imgarr);
+		break;
+	case 6:
+		draw_santa(frame, shape, imgarr);
+		break;
+	case 8:
+		draw_landmark(frame, shape);
+		break;
+	case 10:
+		warp_big_eyes(warp, frame, shape);
+		break;
+	case 12:
+		warp_slim_face(warp, frame, shape);
+		break;
+	default:
+		break;
+	}
+}
+
 
 /*
 void sticker_mustache(const full_object_detection shape){
@@ -0,0 +1,47 @@
+#include "lumacache.h"
+#include "kernels.h"
+
+struct _luma_cache{
+	const camera_preview_data_s* frame;
+	dlib::aligned_array2d<unsigned char> luma;
+	bool built;	/* luma belongs to the current frame */
+};
+
+luma_cache* luma_cache_create(void)
+{
+	luma_cache* cache = new luma_cache();
+	cache->frame = NULL;
+	cache->built = false;
+	return cache;
+}
+
+void luma_cache_destroy(luma_cache* cache)
+{
+	delete cache;
+}
+
+void luma_cache_set_frame(luma_cache* cache, const camera_preview_data_s* frame)
+{
+	cache->frame = frame;
+	cache->built = false;
+}
+
+const dlib::aligned_array2d<unsigned char>* luma_cache_luma(luma_cache* cache)
+{
+	const camera_preview_data_s* frame = cache->frame;
+	if(frame == NULL)
+		return NULL;
+	if(frame->data.double_plane.y_size != frame->width*frame->height)
+		return NULL;
+
+	if(!cache->built)
+	{
+		dlib::aligned_array2d<unsigned char>& img = cache->luma;
+		img.set_size(frame->width, frame->height);
+		kernels_get()->luma_rotate((unsigned char*)dlib::image_data(img),
+				dlib::width_step(img), frame->data.double_plane.y, frame->width,
+				frame->width, frame->height);
+		cache->built = true;
+	}
+	return &cache->luma;
+}
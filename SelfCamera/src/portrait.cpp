@@ -0,0 +1,361 @@
+#include "portrait.h"
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PORTRAIT_PASSES 3	/* three box passes are close to a gaussian */
+#define PORTRAIT_RADIUS_DIV 80	/* box radius at chroma resolution = width / this */
+#define PORTRAIT_GRID 4	/* chroma pixels between mask samples */
+
+using namespace dlib;
+
+typedef struct _portrait_head{
+	double cx, cy;	/* chin */
+	double ux, uy;	/* unit vector from the chin to the brows */
+	double hx, hy;	/* centre of the head ellipse */
+	double len;	/* chin to brows */
+	double width;	/* jaw width */
+}portrait_head;
+
+struct _portrait_ctx{
+	unsigned char* y;	/* half resolution luma, then its blur */
+	unsigned char* uv;	/* copy of the chroma plane, then its blur */
+	unsigned char* tmp;	/* ping-pong plane for the passes */
+	unsigned char* mask;	/* blur weight out of 256 at chroma resolution */
+	int capacity;	/* bytes of y and mask; uv and tmp are twice that */
+	unsigned int* acc;	/* running column sums */
+	int acc_capacity;
+	float* grid;	/* coarse samples of the mask */
+	int grid_capacity;
+	portrait_head* heads;	/* one per face */
+	int head_capacity;
+};
+
+static inline int _clamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+portrait_ctx* portrait_create(void)
+{
+	return (portrait_ctx*)calloc(1, sizeof(portrait_ctx));
+}
+
+void portrait_destroy(portrait_ctx* ctx)
+{
+	if(ctx == NULL)
+		return;
+	free(ctx->y);
+	free(ctx->uv);
+	free(ctx->tmp);
+	free(ctx->mask);
+	free(ctx->acc);
+	free(ctx->grid);
+	free(ctx->heads);
+	free(ctx);
+}
+
+static bool _portrait_reserve(portrait_ctx* ctx, int width, int height)
+{
+	if(width*height > ctx->capacity)
+	{
+		free(ctx->y);
+		free(ctx->uv);
+		free(ctx->tmp);
+		free(ctx->mask);
+		ctx->y = (unsigned char*)malloc(width*height);
+		ctx->uv = (unsigned char*)malloc(2*width*height);
+		ctx->tmp = (unsigned char*)malloc(2*width*height);
+		ctx->mask = (unsigned char*)malloc(width*height);
+		ctx->capacity = 0;
+		if(!ctx->y || !ctx->uv || !ctx->tmp || !ctx->mask)
+			return false;
+		ctx->capacity = width*height;
+	}
+	if(2*width > ctx->acc_capacity)
+	{
+		free(ctx->acc);
+		ctx->acc = (unsigned int*)malloc(2*width*sizeof(unsigned int));
+		ctx->acc_capacity = 0;
+		if(ctx->acc == NULL)
+			return false;
+		ctx->acc_capacity = 2*width;
+	}
+	return true;
+}
+
+static bool _portrait_reserve_grid(portrait_ctx* ctx, int cells, int heads)
+{
+	if(cells > ctx->grid_capacity)
+	{
+		free(ctx->grid);
+		ctx->grid = (float*)malloc(cells*sizeof(float));
+		ctx->grid_capacity = 0;
+		if(ctx->grid == NULL)
+			return false;
+		ctx->grid_capacity = cells;
+	}
+	if(heads > ctx->head_capacity)
+	{
+		free(ctx->heads);
+		ctx->heads = (portrait_head*)malloc(heads*sizeof(portrait_head));
+		ctx->head_capacity = 0;
+		if(ctx->heads == NULL)
+			return false;
+		ctx->head_capacity = heads;
+	}
+	return true;
+}
+
+/* One horizontal box pass of radius r over rows of n pixels with ch
+ * interleaved channels, src -> dst, border replicated. */
+static void _portrait_box_h(unsigned char* dst, const unsigned char* src, int n, int rows,
+		int ch, int r, unsigned int inv)
+{
+	/* columns whose window stays inside the row need no clamping */
+	int lo = r < n ? r : n;
+	int hi = n - r - 1 > lo ? n - r - 1 : lo;
+	for(int y=0;y<rows;y++)
+	{
+		const unsigned char* s = src + y*n*ch;
+		unsigned char* d = dst + y*n*ch;
+		for(int c=0;c<ch;c++)
+		{
+			unsigned int sum = (r + 1)*s[c];
+			for(int k=1;k<=r;k++)
+				sum += s[_clamp(k, 0, n - 1)*ch + c];
+			int x = 0;
+			for(;x<lo;x++)
+			{
+				d[x*ch + c] = (unsigned char)((sum*inv + 32768) >> 16);
+				sum += s[_clamp(x + r + 1, 0, n - 1)*ch + c];
+				sum -= s[_clamp(x - r, 0, n - 1)*ch + c];
+			}
+			for(;x<hi;x++)
+			{
+				d[x*ch + c] = (unsigned char)((sum*inv + 32768) >> 16);
+				sum += s[(x + r + 1)*ch + c];
+				sum -= s[(x - r)*ch + c];
+			}
+			for(;x<n;x++)
+			{
+				d[x*ch + c] = (unsigned char)((sum*inv + 32768) >> 16);
+				sum += s[_clamp(x + r + 1, 0, n - 1)*ch + c];
+				sum -= s[_clamp(x - r, 0, n - 1)*ch + c];
+			}
+		}
+	}
+}
+
+/* One vertical box pass over rows of n bytes, src -> dst. The running sums
+ * run along the rows, so the inner loop is a plain vector add. */
+static void _portrait_box_v(unsigned char* dst, const unsigned char* src, unsigned int* acc,
+		int n, int rows, int r, unsigned int inv)
+{
+	for(int i=0;i<n;i++)
+		acc[i] = (r + 1)*src[i];
+	for(int k=1;k<=r;k++)
+	{
+		const unsigned char* s = src + _clamp(k, 0, rows - 1)*n;
+		for(int i=0;i<n;i++)
+			acc[i] += s[i];
+	}
+	for(int y=0;y<rows;y++)
+	{
+		unsigned char* d = dst + y*n;
+		const unsigned char* add = src + _clamp(y + r + 1, 0, rows - 1)*n;
+		const unsigned char* sub = src + _clamp(y - r, 0, rows - 1)*n;
+		for(int i=0;i<n;i++)
+		{
+			d[i] = (unsigned char)((acc[i]*inv + 32768) >> 16);
+			acc[i] += add[i] - sub[i];
+		}
+	}
+}
+
+static void _portrait_blur(portrait_ctx* ctx, unsigned char* plane, int n, int rows, int ch, int r)
+{
+	unsigned int inv = 65536/(2*r + 1);
+	for(int p=0;p<PORTRAIT_PASSES;p++)
+	{
+		_portrait_box_h(ctx->tmp, plane, n, rows, ch, r, inv);
+		_portrait_box_v(plane, ctx->tmp, ctx->acc, n*ch, rows, r, inv);
+	}
+}
+
+static void _portrait_head(const full_object_detection& shape, int frame_height, portrait_head* head)
+{
+	double cx = shape.part(8).y();
+	double cy = frame_height - shape.part(8).x();
+	double bx = (shape.part(19).y() + shape.part(24).y())*0.5;
+	double by = frame_height - (shape.part(19).x() + shape.part(24).x())*0.5;
+	double jx = shape.part(16).y() - shape.part(0).y();
+	double jy = shape.part(0).x() - shape.part(16).x();
+
+	head->len = sqrt((bx - cx)*(bx - cx) + (by - cy)*(by - cy));
+	if(head->len < 1)
+		head->len = 1;
+	head->ux = (bx - cx)/head->len;
+	head->uy = (by - cy)/head->len;
+	head->cx = cx;
+	head->cy = cy;
+	head->hx = cx + head->ux*head->len*0.75;
+	head->hy = cy + head->uy*head->len*0.75;
+	head->width = sqrt(jx*jx + jy*jy);
+}
+
+/* Signed distance-like margin of (x, y) inside the head and shoulders; it is
+ * positive inside, negative outside and roughly in pixels near the edge. */
+static double _portrait_margin(const portrait_head* head, double x, double y)
+{
+	/* head: an ellipse from a bit under the chin to the top of the head */
+	double du = (x - head->hx)*head->ux + (y - head->hy)*head->uy;
+	double dv = (x - head->hx)*head->uy - (y - head->hy)*head->ux;
+	double au = head->len;
+	double av = head->width*0.65;
+	double e = sqrt((du/au)*(du/au) + (dv/av)*(dv/av));
+	double margin = (1 - e)*(au < av ? au : av);
+
+	/* neck and shoulders: widening below the chin down to the frame edge */
+	double t = -((x - head->cx)*head->ux + (y - head->cy)*head->uy);
+	double half = head->width*0.35;
+	if(t > head->len*0.5)
+		half += (t - head->len*0.5)*2.0;
+	if(half > head->width*1.6)
+		half = head->width*1.6;
+	double body = half - fabs(dv);
+	if(t + head->len*0.1 < body)
+		body = t + head->len*0.1;
+
+	return margin > body ? margin : body;
+}
+
+void portrait_apply(portrait_ctx* ctx, camera_preview_data_s* frame,
+		const std::vector<full_object_detection>& shapes)
+{
+	if(ctx == NULL || shapes.empty())
+		return;
+
+	const int W = frame->width;
+	const int H = frame->height;
+	const int hw = W/2, hh = H/2;
+	if(hw < 2 || hh < 2)
+		return;
+	/* the mask is evaluated on a coarse grid and interpolated, see below */
+	const int gw = (hw + PORTRAIT_GRID - 1)/PORTRAIT_GRID + 1;
+	const int gh = (hh + PORTRAIT_GRID - 1)/PORTRAIT_GRID + 1;
+	if(!_portrait_reserve(ctx, hw, hh) || !_portrait_reserve_grid(ctx, gw*gh, shapes.size()))
+		return;
+
+	portrait_head* heads = ctx->heads;
+	int num_heads = 0;
+	double feather = 0;
+	for(unsigned long i=0;i<shapes.size();i++)
+	{
+		if(shapes[i].num_parts() < 68)
+			continue;
+		portrait_head* head = &heads[num_heads++];
+		_portrait_head(shapes[i], H, head);
+		if(head->width*0.25 > feather)
+			feather = head->width*0.25;
+	}
+	if(num_heads == 0)
+		return;
+	if(feather < 2)
+		feather = 2;
+
+	/* The margin is smooth, so it is evaluated on a coarse grid and
+	 * interpolated to chroma resolution. */
+	float* grid = ctx->grid;
+	for(int gy=0;gy<gh;gy++)
+	{
+		for(int gx=0;gx<gw;gx++)
+		{
+			double margin = -1e9;
+			for(int k=0;k<num_heads;k++)
+			{
+				double d = _portrait_margin(&heads[k], 2*gx*PORTRAIT_GRID + 1, 2*gy*PORTRAIT_GRID + 1);
+				if(d > margin)
+					margin = d;
+			}
+			/* blur weight out of 256, unclamped so it interpolates linearly */
+			grid[gy*gw + gx] = (float)((0.5 - margin/feather)*256);
+		}
+	}
+
+	bool any = false;
+	for(int j=0;j<hh;j++)
+	{
+		const float* g0 = grid + (j/PORTRAIT_GRID)*gw;
+		const float* g1 = g0 + gw;
+		float fy = (float)(j % PORTRAIT_GRID)/PORTRAIT_GRID;
+		unsigned char* m = ctx->mask + j*hw;
+		for(int i=0;i<hw;i++)
+		{
+			int gx = i/PORTRAIT_GRID;
+			float fx = (float)(i % PORTRAIT_GRID)/PORTRAIT_GRID;
+			float top = g0[gx] + (g0[gx+1] - g0[gx])*fx;
+			float bottom = g1[gx] + (g1[gx+1] - g1[gx])*fx;
+			int w = (int)(top + (bottom - top)*fy);
+			w = _clamp(w, 0, 255);
+			m[i] = (unsigned char)w;
+			any |= w != 0;
+		}
+	}
+	if(!any)
+		return;
+
+	/* luma is blurred at chroma resolution too, it is all out of focus */
+	const unsigned char* Y = frame->data.double_plane.y;
+	luma_downscale_fn downscale = kernels_get()->luma_downscale;
+	for(int j=0;j<hh;j++)
+		downscale(ctx->y + j*hw, Y + 2*j*W, Y + (2*j + 1)*W, hw);
+	memcpy(ctx->uv, frame->data.double_plane.uv, 2*hw*hh);
+
+	const int r = W/PORTRAIT_RADIUS_DIV > 1 ? W/PORTRAIT_RADIUS_DIV : 1;
+	_portrait_blur(ctx, ctx->y, hw, hh, 1, r);
+	_portrait_blur(ctx, ctx->uv, hw, hh, 2, r);
+
+	/* blend: bilinear 2x upsampling of the blurred luma, chroma as is */
+	unsigned char* uv = frame->data.double_plane.uv;
+	for(int j=0;j<hh;j++)
+	{
+		const unsigned char* m = ctx->mask + j*hw;
+		const unsigned char* b = ctx->uv + j*2*hw;
+		unsigned char* o = uv + j*2*hw;
+		for(int i=0;i<hw;i++)
+		{
+			int w = m[i];
+			if(w == 0)
+				continue;
+			o[2*i] = (unsigned char)(o[2*i] + ((b[2*i] - o[2*i])*w)/256);
+			o[2*i+1] = (unsigned char)(o[2*i+1] + ((b[2*i+1] - o[2*i+1])*w)/256);
+		}
+	}
+
+	unsigned char* Yw = frame->data.double_plane.y;
+	for(int y=0;y<H;y++)
+	{
+		int j = y >> 1;
+		if(j >= hh)
+			j = hh - 1;
+		int jn = _clamp((y & 1) ? j + 1 : j - 1, 0, hh - 1);
+		const unsigned char* m = ctx->mask + j*hw;
+		const unsigned char* b0 = ctx->y + j*hw;
+		const unsigned char* b1 = ctx->y + jn*hw;
+		unsigned char* o = Yw + y*W;
+		for(int x=0;x<W;x++)
+		{
+			int i = x >> 1;
+			if(i >= hw)
+				i = hw - 1;
+			int w = m[i];
+			if(w == 0)
+				continue;
+			int in = _clamp((x & 1) ? i + 1 : i - 1, 0, hw - 1);
+			int blur = (9*b0[i] + 3*b0[in] + 3*b1[i] + b1[in] + 8) >> 4;
+			o[x] = (unsigned char)(o[x] + ((blur - o[x])*w)/256);
+		}
+	}
+}
@@ -0,0 +1,252 @@
+#include "sticker.h"
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *s_sticker_filenames[STICKER_NUM] = {
+"deer_left_big.jpg","deer_right_big.jpg","deer_nose_big.jpg",
+"deer_left_small.jpg", "deer_right_small.jpg", "deer_nose_small.jpg",
+"hat0.jpg","hat1.jpg","hat2.jpg",
+"beard_rot.jpg", "deer_nose_s.jpg",
+"glasses_rot.jpg", "santa_rot.jpg",
+"deer_left_mid.jpg", "deer_right_mid.jpg",
+"cat_left.jpg", "cat_right.jpg"
+};
+
+const char* sticker_filename(int idx)
+{
+	if(idx < 0 || idx >= STICKER_NUM)
+		return NULL;
+	return s_sticker_filenames[idx];
+}
+
+/*
+ * Pastes a decoded NV12 sticker centred on (p, q). Sticker pixels whose luma
+ * lies outside [lo, hi] are the transparent key and leave the frame alone.
+ */
+static void _image_util_blit(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q,
+		unsigned char lo, unsigned char hi)
+{
+	const kernel_table* k = kernels_get();
+	int sh = imginfo->height;
+	int sw = imginfo->width;
+	int sy_size = sh*sw;
+
+	int fh = frame->height;
+	int fw = frame->width;
+
+	if(imginfo->data == NULL || frame->data.double_plane.y_size < fw*fh
+			|| frame->data.double_plane.uv_size < fw*fh/2)
+		return;
+
+	p -= sw/2;
+	q -= sh/2;
+	if(p%2 != 0) p++;
+	if(q%2 != 0) q++;
+
+	/* clip the sticker to the frame, p and q are even so x0 and y0 are too */
+	int x0 = p < 0 ? 0 : p;
+	int y0 = q < 0 ? 0 : q;
+	int x1 = p+sw > fw ? fw : p+sw;
+	int y1 = q+sh > fh ? fh : q+sh;
+	if(x0 >= x1 || y0 >= y1)
+		return;
+
+	unsigned char* sy = imginfo->data;
+	for(int j=y0;j<y1;j++)
+	{
+		k->blit_y(frame->data.double_plane.y + j*fw + x0, sy + (j-q)*sw + (x0-p), x1-x0, lo, hi);
+	}
+
+	int pairs = (x1-x0)/2;
+	for(int j=y0/2;j<=(y1-1)/2;j++)
+	{
+		int pti = sy_size + (j-q/2)*sw + (x0-p);
+		if(pti + pairs*2 > imginfo->size)
+			break;
+		k->blit_uv(frame->data.double_plane.uv + j*fw + x0, imginfo->data + pti,
+				sy + (2*j-q)*sw + (x0-p), pairs, lo, hi);
+	}
+}
+
+void _image_util_yuvcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q)
+{
+	/* white background is transparent */
+	_image_util_blit(frame, imginfo, p, q, 0, 230);
+}
+
+void _image_util_imgcpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q)
+{
+	int sh = imginfo->height;
+	int sw = imginfo->width;
+	int sy_size = sh*sw;
+
+	int fh = frame->height;
+	int fw = frame->width;
+
+	p -= sw/2;
+	q -= sh/2;
+
+	int pt = p + q*fw;
+	int pti = 0;
+
+#ifdef ALPHA
+	// copy Y plane
+	for(int i=0;i<sw;i++)
+	{
+		if(pt > frame->data.double_plane.y_size || pti > sy_size)
+			break;
+		memcpy(frame->data.double_plane.y + pt, imginfo->data + pti, sizeof(unsigned char)*sh);
+		pt += fw;
+		pti += sh;
+	}
+
+	// copy UV plane
+	p /=2;
+	q /=2;
+	pt = (p + q*fw/2)*2;
+	pti = sy_size;
+
+	for(int i=0;i<sw/2;i++)
+	{
+		if(pt > frame->data.double_plane.uv_size || pti > imginfo->size)
+			break;
+		memcpy(frame->data.double_plane.uv + pt, imginfo->data + pti, sizeof(unsigned char)*sh);
+		pt += fw;
+		pti += sh;
+	}
+#else
+	for(int i=0;i<sw;i++)
+	{
+		//if(pt >= frame->data.double_plane.y_size || pti >= sy_size)
+		//	break;
+		for(int j=0;j<sh;j++)
+		{
+			if(pt+j < frame->data.double_plane.y_size && pti+j < sy_size)
+				if(imginfo->data[pti+j] <= 220)
+					frame->data.double_plane.y[pt+j] = imginfo->data[pti+j];
+		}
+		pt += fw;
+		pti += sh;
+	}
+
+
+	// copy UV plane
+	p /=2;
+	q /=2;
+	pt = (p + q*fw/2)*2+1;
+	pti = sy_size;
+
+	for(int i=0;i<sw/2;i++)
+	{
+		//if(pt >= frame->data.double_plane.uv_size || pti >= imginfo->size)
+		//	break;
+		for(int j=0;j<sh;j++)
+		{
+			if(pt+j < frame->data.double_plane.uv_size && pti+j < imginfo->size)
+			{
+				unsigned char tmp = imginfo->data[pti+j];
+				if(tmp != 128)
+					frame->data.double_plane.uv[pt+j] = tmp;
+				if(i == sw/4)
+					tmp =0;
+			}
+		}
+		pt += fw;
+		pti += sh;
+	}
+#endif
+}
+
+void _image_util_santacpy(camera_preview_data_s* frame, imageinfo* imginfo, int p, int q)
+{
+	/* black background is transparent */
+	_image_util_blit(frame, imginfo, p, q, 30, 255);
+}
+
+/*
+ * Bilinear resample of one plane in Q8 fixed point. channels is 1 for luma
+ * and 2 for interleaved UV, where each channel is filtered on its own.
+ */
+static void _image_util_resize_plane(unsigned char* dst, int dw, int dh,
+		const unsigned char* src, int sw, int sh, int channels)
+{
+	for(int j=0;j<dh;j++)
+	{
+		int fy = dh > 1 ? (j*(sh-1)*256)/(dh-1) : 0;
+		int y0 = fy >> 8;
+		int wy = fy & 255;
+		int y1 = y0+1 < sh ? y0+1 : y0;
+		const unsigned char* r0 = src + y0*sw*channels;
+		const unsigned char* r1 = src + y1*sw*channels;
+		unsigned char* d = dst + j*dw*channels;
+		for(int i=0;i<dw;i++)
+		{
+			int fx = dw > 1 ? (i*(sw-1)*256)/(dw-1) : 0;
+			int x0 = fx >> 8;
+			int wx = fx & 255;
+			int x1 = x0+1 < sw ? x0+1 : x0;
+			for(int c=0;c<channels;c++)
+			{
+				int top = r0[x0*channels+c]*(256-wx) + r0[x1*channels+c]*wx;
+				int bot = r1[x0*channels+c]*(256-wx) + r1[x1*channels+c]*wx;
+				d[i*channels+c] = (top*(256-wy) + bot*wy + (1 << 15)) >> 16;
+			}
+		}
+	}
+}
+
+int _image_util_resize(imageinfo* dst, const imageinfo* src, int width, int height)
+{
+	width &= ~1;
+	height &= ~1;
+	if(src->data == NULL || src->error != 0 || width <= 0 || height <= 0
+			|| src->size < src->width*src->height + (src->width/2)*(src->height/2)*2)
+		return -1;
+
+	dst->width = width;
+	dst->height = height;
+	dst->size = width*height*3/2;
+	dst->error = 0;
+	dst->data = (unsigned char*)malloc(sizeof(unsigned char)*dst->size);
+	if(dst->data == NULL)
+		return -1;
+
+	_image_util_resize_plane(dst->data, width, height, src->data, src->width, src->height, 1);
+	_image_util_resize_plane(dst->data + width*height, width/2, height/2,
+			src->data + src->width*src->height, src->width/2, src->height/2, 2);
+	return 0;
+}
+
+void sticker_scale_all(imageinfo* dst, const imageinfo* src, double scale)
+{
+	for(int i=0;i<STICKER_NUM;i++)
+	{
+		dst[i].data = NULL;
+		dst[i].error = -1;
+		if(src[i].error != 0 || src[i].data == NULL)
+			continue;
+		if(_image_util_resize(&dst[i], &src[i],
+				(int)(src[i].width*scale + 0.5), (int)(src[i].height*scale + 0.5)) != 0)
+			dst[i].error = -1;
+	}
+}
+
+void sticker_release_all(imageinfo* dst)
+{
+	for(int i=0;i<STICKER_NUM;i++)
+	{
+		free(dst[i].data);
+		dst[i].data = NULL;
+	}
+}
+
+void _image_util_swap_uv(unsigned char* uv, int size)
+{
+	for(int i=0;i+1<size;i+=2)
+	{
+		unsigned char tmp = uv[i];
+		uv[i] = uv[i+1];
+		uv[i+1] = tmp;
+	}
+}
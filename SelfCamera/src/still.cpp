@@ -0,0 +1,219 @@
+#include "still.h"
+#include "landmark.h"
+#include "kernels.h"
+#include "beauty.h"
+#include "portrait.h"
+#include <image_util.h>
+
+using namespace dlib;
+
+/* stickers resampled for the capture size, rebuilt only when it changes */
+static imageinfo s_scaled[STICKER_NUM];
+static int s_scaled_width = 0;
+static int s_scaled_height = 0;
+
+/* Scale from the preview to the capture. Both are centred on the sensor, and
+ * when their aspect ratios differ the capture is taken to show all of the
+ * preview and more on one side, so both axes get the smaller of the two
+ * ratios and *ox, *oy centre the preview in the capture. ox is along the
+ * frame height and oy along its width, like the landmarks' x and y. */
+static double _still_scale(const still_job* job, double* ox, double* oy)
+{
+	double sx = (double)job->height / job->preview_height;
+	double sy = (double)job->width / job->preview_width;
+	double s = sx < sy ? sx : sy;
+	if(ox)
+		*ox = (job->height - job->preview_height*s)*0.5;
+	if(oy)
+		*oy = (job->width - job->preview_width*s)*0.5;
+	return s;
+}
+
+static imageinfo* _still_scaled_stickers(imageinfo* stickers, const still_job* job)
+{
+	if(s_scaled_width == job->width && s_scaled_height == job->height)
+		return s_scaled;
+
+	sticker_release_all(s_scaled);
+	sticker_scale_all(s_scaled, stickers, _still_scale(job, NULL, NULL));
+	s_scaled_width = job->width;
+	s_scaled_height = job->height;
+	return s_scaled;
+}
+
+still_job* still_job_create(int preview_width, int preview_height)
+{
+	still_job* job = new still_job();
+	job->data = NULL;
+	job->size = 0;
+	job->width = 0;
+	job->height = 0;
+	job->error = -1;
+	job->preview_width = preview_width;
+	job->preview_height = preview_height;
+	job->sticker = 0;
+	job->filter_cb_q8 = 0;
+	job->filter_cr_q8 = 0;
+	job->beauty = 0;
+	job->portrait = 0;
+	job->filename[0] = '\0';
+	job->thumbnail = NULL;
+	job->thumbnail_width = 0;
+	job->thumbnail_height = 0;
+	return job;
+}
+
+int still_job_set_image(still_job* job, const camera_image_data_s* image)
+{
+	free(job->data);
+	job->data = NULL;
+
+	if(image->format == CAMERA_PIXEL_FORMAT_NV12)
+	{
+		job->size = image->width*image->height*3/2;
+		if(image->data_len < (unsigned int)job->size)
+			return job->error = IMAGE_UTIL_ERROR_INVALID_PARAMETER;
+		job->data = (unsigned char*)malloc(job->size);
+		if(job->data == NULL)
+			return job->error = IMAGE_UTIL_ERROR_OUT_OF_MEMORY;
+		memcpy(job->data, image->data, job->size);
+		job->width = image->width;
+		job->height = image->height;
+		return job->error = IMAGE_UTIL_ERROR_NONE;
+	}
+
+	if(image->format == CAMERA_PIXEL_FORMAT_JPEG)
+	{
+		unsigned char* decoded = NULL;
+		int width, height;
+		unsigned int size;
+		int error_code = image_util_decode_jpeg_from_memory(image->data, image->data_len,
+				IMAGE_UTIL_COLORSPACE_NV12, &decoded, &width, &height, &size);
+		if(error_code != IMAGE_UTIL_ERROR_NONE)
+			return job->error = error_code;
+		job->data = decoded;
+		job->size = size;
+		job->width = width;
+		job->height = height;
+		return job->error = IMAGE_UTIL_ERROR_NONE;
+	}
+
+	return job->error = IMAGE_UTIL_ERROR_NOT_SUPPORTED_FORMAT;
+}
+
+int still_job_set_frame(still_job* job, const unsigned char* data, int width, int height)
+{
+	free(job->data);
+	job->size = width*height*3/2;
+	job->data = (unsigned char*)malloc(job->size);
+	if(job->data == NULL)
+		return job->error = IMAGE_UTIL_ERROR_OUT_OF_MEMORY;
+
+	/* preview frames are kept in the preview's chroma order */
+	memcpy(job->data, data, width*height);
+	const unsigned char* uv = data + width*height;
+	unsigned char* out = job->data + width*height;
+	for(int i=0;i+1<width*height/2;i+=2)
+	{
+		out[i] = uv[i+1];
+		out[i+1] = uv[i];
+	}
+	job->width = width;
+	job->height = height;
+	job->preview_width = width;
+	job->preview_height = height;
+	return job->error = IMAGE_UTIL_ERROR_NONE;
+}
+
+int still_job_process(still_job* job, imageinfo* stickers)
+{
+	if(job->error != IMAGE_UTIL_ERROR_NONE)
+		return job->error;
+
+	camera_preview_data_s frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.format = CAMERA_PIXEL_FORMAT_NV12;
+	frame.width = job->width;
+	frame.height = job->height;
+	frame.num_of_planes = 2;
+	frame.data.double_plane.y = job->data;
+	frame.data.double_plane.y_size = job->width*job->height;
+	frame.data.double_plane.uv = job->data + job->width*job->height;
+	frame.data.double_plane.uv_size = job->width*job->height/2;
+
+	bool draw = job->sticker != 0 && !job->shapes.empty();
+	bool smooth = job->beauty != 0 && !job->shapes.empty();
+	bool blur = job->portrait != 0 && !job->shapes.empty();
+	bool filter = job->filter_cb_q8 != 0;
+
+	/* landmarks live in the rotated preview: x runs along the frame height */
+	std::vector<full_object_detection> shapes;
+	if(draw || smooth || blur)
+	{
+		double ox, oy;
+		double s = _still_scale(job, &ox, &oy);
+		for(unsigned long i=0;i<job->shapes.size();i++)
+		{
+			const full_object_detection& shape = job->shapes[i];
+			std::vector<point> parts(shape.num_parts());
+			for(unsigned long k=0;k<shape.num_parts();k++)
+				parts[k] = point(shape.part(k).x()*s + ox, shape.part(k).y()*s + oy);
+			rectangle rect(shape.get_rect().left()*s + ox, shape.get_rect().top()*s + oy,
+					shape.get_rect().right()*s + ox, shape.get_rect().bottom()*s + oy);
+			shapes.push_back(full_object_detection(rect, parts));
+		}
+	}
+
+	/* luma only, so it does not care about the chroma order */
+	if(smooth)
+	{
+		beauty_ctx* ctx = beauty_create();
+		for(unsigned long i=0;i<shapes.size();i++)
+			beauty_apply(ctx, &frame, shapes[i], job->beauty);
+		beauty_destroy(ctx);
+	}
+
+	/* blurs U and V alike, so the chroma order does not matter either */
+	if(blur)
+	{
+		portrait_ctx* ctx = portrait_create();
+		portrait_apply(ctx, &frame, shapes);
+		portrait_destroy(ctx);
+	}
+
+	/* the effects are written for the preview's chroma order */
+	if(draw || filter)
+		_image_util_swap_uv(frame.data.double_plane.uv, frame.data.double_plane.uv_size);
+
+	if(filter)
+		kernels_get()->nv12_filter(frame.data.double_plane.uv, frame.data.double_plane.uv_size,
+				job->filter_cb_q8, job->filter_cr_q8);
+
+	if(draw)
+	{
+		imageinfo* scaled = _still_scaled_stickers(stickers, job);
+		warp_ctx* warp = warp_create();
+		for(unsigned long i=0;i<shapes.size();i++)
+			draw_sticker(&frame, shapes[i], scaled, job->sticker, warp);
+		warp_destroy(warp);
+	}
+
+	if(draw || filter)
+		_image_util_swap_uv(frame.data.double_plane.uv, frame.data.double_plane.uv_size);
+
+	job->error = image_util_encode_jpeg(job->data, job->width, job->height,
+			IMAGE_UTIL_COLORSPACE_NV12, 100, job->filename);
+	if(job->error == IMAGE_UTIL_ERROR_NONE)
+		_image_util_thumbnail(&job->thumbnail, &job->thumbnail_width, &job->thumbnail_height,
+				job->data, job->width, job->height, STILL_THUMBNAIL_SIZE);
+	return job->error;
+}
+
+void still_job_destroy(still_job* job)
+{
+	if(job == NULL)
+		return;
+	free(job->data);
+	free(job->thumbnail);
+	delete job;
+}
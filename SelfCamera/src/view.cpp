@@ -19,15 +19,40 @@
 #include "view_defines.h"
 #include "landmark.h"
 #include "imageutils.h"
+#include "kernels.h"
+#include "still.h"
+#include "framering.h"
+#include "catalog.h"
+#include "beauty.h"
+#include "portrait.h"
+#include "faceslot.h"
+#include "lumacache.h"
+#include "filter.h"
+
+#include <fstream>
+#include <sys/time.h>
 
 #define COUNTER_STR_LEN 3
 #define FILE_PREFIX "IMAGE"
 #define STR_ERROR "Error"
 #define STR_OK "OK"
 #define STR_FILE_PROTOCOL "file://"
-#define MAX_FILTER 14
-#define MAX_STICKER 10
+#define MAX_FILTER 15
+#define FILTER_BEAUTY 13 /* skin smoothing, needs the landmarks */
+#define FILTER_PORTRAIT 14 /* background blur, needs the landmarks */
+#define MAX_STICKER 14
 #define BUFLEN 256
+#define CATALOG_FILE "captures.idx"
+#define RING_FRAMES 8 /* processed frames kept for zero shutter lag */
+#define BURST_FRAMES 8
+#define BURST_PRESS_TIME 0.6 /* seconds the shutter is held for a burst */
+#define FACE_MAX_AGE 1.0 /* seconds a face detection result is trusted */
+
+typedef enum {
+	CAPTURE_MODE_STILL = 0, /* full resolution capture of the next frame */
+	CAPTURE_MODE_NEAREST, /* ring frame closest to capture_time */
+	CAPTURE_MODE_BURST, /* last BURST_FRAMES ring frames up to capture_time */
+} capture_mode_e;
 
 static struct view_info {
 	Evas_Object *win;
@@ -41,7 +66,7 @@ static struct view_info {
 
 	camera_h camera;
 	Eina_Bool camera_enabled;
-	std::vector<dlib::rectangle> faces; /* detected faces */
+	face_slot *faces; /* written by face detection, read by the preview */
 	char *media_content_folder;
 	int selected_mode_btn;
 	int height;
@@ -54,6 +79,21 @@ static struct view_info {
 	int timer;
 	Eina_Bool flag_capturing;
 	Eina_Bool flag_facerunning;
+	std::vector<dlib::full_object_detection> shapes; /* landmarks of the last frame */
+	dlib::shape_predictor_workspace sp_workspace; /* preview thread scratch for sp */
+	int capture_width; /* 0 when only preview-sized capture is available */
+	int capture_height;
+	Eina_Bool flag_still_pending;
+	frame_ring *ring; /* recently processed frames */
+	capture_mode_e capture_mode;
+	double capture_time; /* trigger time for ring captures */
+	double gesture_time; /* last gesture sample before the mouth opened */
+	Ecore_Timer *burst_timer;
+	Eina_Bool flag_burst_fired;
+	beauty_ctx *beauty; /* owned by the preview thread */
+	portrait_ctx *portrait; /* owned by the preview thread */
+	warp_ctx *warp; /* owned by the preview thread */
+	luma_cache *luma; /* rotated luma of the current preview frame */
 }s_info =
 {	.win = NULL,
 	.conform = NULL,
@@ -64,6 +104,7 @@ static struct view_info {
 	.preview_canvas = NULL,
 	.camera = NULL,
 	.camera_enabled = false,
+	.faces = NULL,
 	.media_content_folder = NULL,
 	.selected_mode_btn = 0,
 	.sticker = 0,
@@ -76,6 +117,19 @@ static struct view_info {
 	.flag_facerunning = false,
 	.nose[0] = 0,
 	.nose[1] = 0,
+	.capture_width = 0,
+	.capture_height = 0,
+	.flag_still_pending = false,
+	.ring = NULL,
+	.capture_mode = CAPTURE_MODE_STILL,
+	.capture_time = 0,
+	.gesture_time = 0,
+	.burst_timer = NULL,
+	.flag_burst_fired = false,
+	.beauty = NULL,
+	.portrait = NULL,
+	.warp = NULL,
+	.luma = NULL,
 };
 
 static Evas_Object *_app_navi_add(void);
@@ -91,6 +145,20 @@ static void* enable_sticker(void* unused) {
 	return NULL;
 }
 
+/* Runs on the loader thread each time a cascade level of sp is usable. The
+ * stickers are enabled with the first level and the landmarks get finer as
+ * the remaining levels arrive. */
+static void _shape_predictor_level_loaded(unsigned long levels) {
+	dlog_print(DLOG_INFO, LOG_TAG, "shape predictor: %lu of %lu levels loaded",
+			levels, sp.num_levels());
+	/* a version 1 file reports all of its levels at once, at the end */
+	if (s_info.fin != 1 && levels > 1 && levels == sp.num_levels())
+		dlog_print(DLOG_WARN, LOG_TAG,
+				"shape predictor: model is not converted, stickers waited for the whole file");
+	if (s_info.fin != 1)
+		ecore_main_loop_thread_safe_call_sync(enable_sticker, NULL);
+}
+
 static void load_shape_predictor(void* unused1, Ecore_Thread *unused2) {
 	/* Load shape predictor */
 	const char* resource_path = app_get_resource_path();
@@ -100,8 +168,21 @@ static void load_shape_predictor(void* unused1, Ecore_Thread *unused2) {
 	snprintf(file_path, BUFLEN, "%s%s", resource_path,
 			"shape_predictor_68_face_landmarks.dat");
 
-	dlib::deserialize(file_path) >> sp;
-	ecore_main_loop_thread_safe_call_sync(enable_sticker, NULL);
+	/* The build converts the model in res/ with tools/convert_model.cpp
+	 * (Build/build_model.mk), which makes it usable after its first level.
+	 * The file from dlib.net, version 1, still loads if it was packaged
+	 * some other way, but only once it is fully read.
+	 *
+	 * The stickers are enabled by the first level, so any failure before
+	 * that leaves them disabled. A failure after it keeps the levels that
+	 * were read completely, which sp already limits itself to. */
+	std::ifstream in(file_path, std::ios::binary);
+	try {
+		dlib::deserialize_progressively(sp, in, _shape_predictor_level_loaded);
+	} catch (std::exception& e) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "shape predictor: %s (%lu levels usable)",
+				e.what(), sp.num_levels_loaded());
+	}
 	free(file_path);
 }
 
@@ -144,6 +225,14 @@ Eina_Bool view_create(void *user_data) {
 		return EINA_FALSE;
 	}
 
+	/* Pick the pixel kernels before the first preview frame arrives */
+	int dropped = kernels_init(1);
+	if (dropped)
+		dlog_print(DLOG_ERROR, LOG_TAG, "%d pixel kernels failed self test",
+				dropped);
+	dlog_print(DLOG_INFO, LOG_TAG, "pixel kernels: %s",
+			kernels_isa_name(kernels_best_isa()));
+
 	/* Add main view to naviframe */
 	Evas_Object *view = _main_view_add();
 	if (!view)
@@ -226,9 +315,11 @@ void view_pause(void) {
 		return;
 	}
 	if (cur_state == CAMERA_STATE_PREVIEW) {
+		/* The faces stay in the slot, which only the camera's detection
+		 * thread may write. The preview ignores them once they are older
+		 * than FACE_MAX_AGE, as after any other stop of the detection. */
 		camera_stop_face_detection(s_info.camera);
 		camera_stop_preview(s_info.camera);
-		s_info.faces.clear();
 	}
 }
 
@@ -278,15 +369,16 @@ bool view_resume(void) {
 
 		if (s_info.flag_facerunning == true) {
 			camera_start_face_detection(s_info.camera, _camera_face_detected_cb,
-					&s_info.faces);
+					s_info.faces);
 		}
 
-		if (s_info.sticker != 0) {
+		if (s_info.sticker != 0 || s_info.filter == FILTER_BEAUTY
+				|| s_info.filter == FILTER_PORTRAIT) {
 			camera_set_preview_cb(s_info.camera, _sticker_preview_callback,
-					&s_info.faces);
+					s_info.faces);
 		} else {
 			camera_set_preview_cb(s_info.camera, _filter_preview_callback,
-					&s_info.faces);
+					s_info.faces);
 		}
 	}
 	return true;
@@ -430,6 +522,63 @@ static void _main_view_set_image_rotation_exif(camera_h camera,
 	camera_attr_set_tag_orientation(camera, orientation);
 }
 
+/**
+ * @brief Callback called for every supported capture resolution.
+ * @param[in] width Capture width
+ * @param[in] height Capture height
+ * @param[in] user_data Largest resolution overall and largest one with the
+ * preview aspect ratio
+ * @return true to continue with the next resolution
+ */
+static bool _main_view_capture_resolution_cb(int width, int height,
+		void *user_data) {
+	int *best = (int *) user_data;
+
+	if (width * height > best[0] * best[1]) {
+		best[0] = width;
+		best[1] = height;
+	}
+	if (width * resolution[1] == height * resolution[0]
+			&& width * height > best[2] * best[3]) {
+		best[2] = width;
+		best[3] = height;
+	}
+	return true;
+}
+
+/**
+ * @brief Sets up full resolution still capture. Preferring the preview
+ * aspect ratio lets the landmarks be scaled straight to capture coordinates;
+ * with any other ratio they are scaled uniformly and centred, see still.cpp.
+ */
+static void _main_view_init_still_capture(void) {
+	int best[4] = { 0, };
+	int result = camera_foreach_supported_capture_resolution(s_info.camera,
+			_main_view_capture_resolution_cb, best);
+	if (CAMERA_ERROR_NONE != result) {
+		DLOG_PRINT_ERROR("camera_foreach_supported_capture_resolution", result);
+		return;
+	}
+
+	int width = best[2] ? best[2] : best[0];
+	int height = best[2] ? best[3] : best[1];
+	if (width == 0)
+		return;
+
+	result = camera_set_capture_resolution(s_info.camera, width, height);
+	if (CAMERA_ERROR_NONE != result) {
+		DLOG_PRINT_ERROR("camera_set_capture_resolution", result);
+		return;
+	}
+
+	/* NV12 saves a JPEG round trip, still_job_set_image() copes either way */
+	result = camera_set_capture_format(s_info.camera, CAMERA_PIXEL_FORMAT_NV12);
+	CHECK_ERROR("camera_set_capture_format", result);
+
+	s_info.capture_width = width;
+	s_info.capture_height = height;
+}
+
 /**
  * @brief Initialises camera device.
  * @return EINA_TRUE on success, EINA_FALSE on error
@@ -440,6 +589,9 @@ static Eina_Bool _main_view_init_camera(void) {
 	if (result != CAMERA_ERROR_NONE || !s_info.preview_canvas)
 		return false;
 
+	if (!s_info.faces)
+		s_info.faces = face_slot_create();
+
 	result = camera_set_display(s_info.camera, CAMERA_DISPLAY_TYPE_EVAS,
 			GET_DISPLAY(s_info.preview_canvas));
 	if (result != CAMERA_ERROR_NONE || !s_info.preview_canvas)
@@ -468,51 +620,10 @@ static Eina_Bool _main_view_init_camera(void) {
 	if (CAMERA_ERROR_NONE != result) {
 		DLOG_PRINT_ERROR("camera_set_preview_resolution", result);
 	}
+	_main_view_init_still_capture();
 	return view_resume();
 }
 
-/**
- * @brief Check if dir->d_name has IMAGE prefix.
- * @param[in] dir "dirent" structure with d_name to check
- * @return strncmp String compare result (0 on equal)
- */
-static int _main_view_image_file_filter(const struct dirent *dir) {
-	return strncmp(dir->d_name, FILE_PREFIX, sizeof(FILE_PREFIX) - 1) == 0;
-
-}
-
-/**
- * @brief Gets the last file with IMAGE prefix on given path.
- * @param[out] file_path Full image path output
- * @param[in] size Maximum path string length
- * @return Returned file_path length
- */
-static size_t _main_view_get_last_file_path(char *file_path, size_t size) {
-	int n = -1;
-	struct dirent **namelist = NULL;
-	int ret_size = 0;
-
-	n = scandir(s_info.media_content_folder, &namelist,
-			_main_view_image_file_filter, alphasort);
-
-	if (n > 0) {
-		ret_size = snprintf(file_path, size, "%s/%s",
-				s_info.media_content_folder, namelist[n - 1]->d_name);
-
-		/* Need to go through array to clear it */
-		int i;
-		for (i = 0; i < n; ++i) {
-			/* The last file in sorted array will be taken */
-			free(namelist[i]);
-		}
-	} else {
-		dlog_print(DLOG_ERROR, LOG_TAG, "No files or failed to make scandir");
-	}
-
-	free(namelist);
-	return ret_size;
-}
-
 /**
  * @brief Smart callback on popup close.
  * @param[in] data User data
@@ -575,7 +686,7 @@ static void _main_view_thumbnail_click_cb(void *data, Evas_Object *obj,
 	char file_path[PATH_MAX] = { '\0' };
 	char file_path_prepared[PATH_MAX + sizeof(STR_FILE_PROTOCOL)] = { '\0' };
 
-	if (_main_view_get_last_file_path(file_path, sizeof(file_path)) == 0)
+	if (catalog_last(file_path, sizeof(file_path)) == 0)
 		return;
 
 	ret = app_control_create(&app_control);
@@ -627,27 +738,102 @@ static void _main_view_thumbnail_click_cb(void *data, Evas_Object *obj,
 }
 
 /**
- * @brief Set the thumbnail content to specified file.
- * @param[in] file_path Path to the file to set
+ * @brief Mouse up callback on the thumbnail image.
+ * @param[in] data User data
+ * @param[in] e Evas
+ * @param[in] obj Target object
+ * @param[in] event_info Event information
  */
-static void _main_view_thumbnail_set(const char *file_path) {
+static void _main_view_thumbnail_mouse_up_cb(void *data, Evas *e,
+		Evas_Object *obj, void *event_info) {
+	_main_view_thumbnail_click_cb(data, obj, event_info);
+}
+
+/**
+ * @brief Gets the thumbnail image object, creating it on first use.
+ * @return Thumbnail image object
+ */
+static Evas_Object *_main_view_thumbnail_get(void) {
 	Evas_Object *img = elm_object_part_content_get(s_info.layout, "thumbnail");
 	if (!img) {
-		img = elm_image_add(s_info.layout);
+		img = evas_object_image_filled_add(evas_object_evas_get(s_info.layout));
+		evas_object_image_alpha_set(img, EINA_FALSE);
 		elm_object_part_content_set(s_info.layout, "thumbnail", img);
-		evas_object_smart_callback_add(img, "clicked",
-				_main_view_thumbnail_click_cb, NULL);
+		evas_object_event_callback_add(img, EVAS_CALLBACK_MOUSE_UP,
+				_main_view_thumbnail_mouse_up_cb, NULL);
 	}
-	elm_image_file_set(img, file_path, NULL);
+	return img;
+}
+
+/**
+ * @brief Set the thumbnail content to specified file.
+ * Only a thumbnail-sized image is decoded.
+ * @param[in] file_path Path to the file to set
+ */
+static void _main_view_thumbnail_set(const char *file_path) {
+	Evas_Object *img = _main_view_thumbnail_get();
+	evas_object_image_load_size_set(img, STILL_THUMBNAIL_SIZE,
+			STILL_THUMBNAIL_SIZE);
+	evas_object_image_file_set(img, file_path, NULL);
+	elm_object_signal_emit(s_info.layout, "default", "thumbnail_background");
+}
+
+/**
+ * @brief Set the thumbnail content to pixels rendered from a capture.
+ * @param[in] argb ARGB8888 pixels
+ * @param[in] width Thumbnail width
+ * @param[in] height Thumbnail height
+ */
+static void _main_view_thumbnail_set_pixels(unsigned int *argb, int width,
+		int height) {
+	Evas_Object *img = _main_view_thumbnail_get();
+	evas_object_image_file_set(img, NULL, NULL);
+	evas_object_image_size_set(img, width, height);
+	evas_object_image_data_copy_set(img, argb);
+	evas_object_image_data_update_add(img, 0, 0, width, height);
 	elm_object_signal_emit(s_info.layout, "default", "thumbnail_background");
 }
 
+/**
+ * @brief Records a saved picture and shows it as the thumbnail.
+ * @param[in] job The finished capture
+ */
+static void _main_view_capture_saved(still_job *job) {
+	catalog_add(job->filename);
+	if (job->thumbnail)
+		_main_view_thumbnail_set_pixels(job->thumbnail, job->thumbnail_width,
+				job->thumbnail_height);
+	else
+		_main_view_thumbnail_set(job->filename);
+}
+
+/**
+ * @brief Records a picture saved off the main loop.
+ * @param[in] data Path of the picture, freed here
+ */
+static void _main_view_file_saved(void *data) {
+	char *file_path = (char *) data;
+	catalog_add(file_path);
+	_main_view_thumbnail_set(file_path);
+	free(file_path);
+}
+
 /**
  * @brief Load last file thumbnail.
  */
 static void _main_view_thumbnail_load(void) {
 	char file_path[PATH_MAX] = { '\0' };
-	if (_main_view_get_last_file_path(file_path, sizeof(file_path)))
+	char *data_path = app_get_data_path();
+
+	if (s_info.media_content_folder && data_path) {
+		char index_path[PATH_MAX] = { '\0' };
+		snprintf(index_path, sizeof(index_path), "%s%s", data_path,
+				CATALOG_FILE);
+		catalog_init(index_path, s_info.media_content_folder, FILE_PREFIX);
+	}
+	free(data_path);
+
+	if (catalog_last(file_path, sizeof(file_path)))
 		_main_view_thumbnail_set(file_path);
 	else
 		elm_object_signal_emit(s_info.layout, "no_image",
@@ -655,28 +841,41 @@ static void _main_view_thumbnail_load(void) {
 }
 /**
  * @brief Generate image file name with full path and IMAGE prefix from current
- * date and time.
+ * date and time. The milliseconds keep two shots within a second apart.
  * @param[out] file_path Output c-string array
  * @param[in] size Maximum file_path length
+ * @param[in] index Position within a burst, 0 for single shots
  * @return Generated file_path length
  */
-static size_t _main_view_get_file_path(char *file_path, size_t size) {
+static size_t _main_view_get_file_path(char *file_path, size_t size,
+		int index) {
 	int chars = 0;
 	struct tm localtime = { 0 };
-	time_t rawtime = time(NULL);
+	struct timeval now = { 0 };
 
 	if (!file_path) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "file_path is NULL");
 		return 0;
 	}
 
-	if (localtime_r(&rawtime, &localtime) == NULL)
+	if (gettimeofday(&now, NULL) != 0
+			|| localtime_r(&now.tv_sec, &localtime) == NULL)
 		return 0;
 
-	chars = snprintf(file_path, size, "%s/%s_%04i-%02i-%02i_%02i:%02i:%02i.jpg",
-			s_info.media_content_folder, FILE_PREFIX, localtime.tm_year + 1900,
-			localtime.tm_mon + 1, localtime.tm_mday, localtime.tm_hour,
-			localtime.tm_min, localtime.tm_sec);
+	if (index > 0)
+		chars = snprintf(file_path, size,
+				"%s/%s_%04i-%02i-%02i_%02i:%02i:%02i.%03i_%02i.jpg",
+				s_info.media_content_folder, FILE_PREFIX,
+				localtime.tm_year + 1900, localtime.tm_mon + 1,
+				localtime.tm_mday, localtime.tm_hour, localtime.tm_min,
+				localtime.tm_sec, (int) (now.tv_usec / 1000), index);
+	else
+		chars = snprintf(file_path, size,
+				"%s/%s_%04i-%02i-%02i_%02i:%02i:%02i.%03i.jpg",
+				s_info.media_content_folder, FILE_PREFIX,
+				localtime.tm_year + 1900, localtime.tm_mon + 1,
+				localtime.tm_mday, localtime.tm_hour, localtime.tm_min,
+				localtime.tm_sec, (int) (now.tv_usec / 1000));
 
 	return chars;
 }
@@ -691,16 +890,12 @@ static void _main_view_mycapture_cb(camera_preview_data_s *frame) {
 		return;
 	}
 
-	for (int i = 0; i < frame->data.double_plane.uv_size; i += 2) {
-		unsigned char tmp = 0;
-		tmp = frame->data.double_plane.uv[i];
-		frame->data.double_plane.uv[i] = frame->data.double_plane.uv[i + 1];
-		frame->data.double_plane.uv[i + 1] = tmp;
-	}
+	_image_util_swap_uv(frame->data.double_plane.uv,
+			frame->data.double_plane.uv_size);
 
 	view_pause();
 	if (frame->format == CAMERA_PIXEL_FORMAT_NV12) {
-		size = _main_view_get_file_path(filename, sizeof(filename));
+		size = _main_view_get_file_path(filename, sizeof(filename), 0);
 		if (size == 0) {
 			dlog_print(DLOG_ERROR, LOG_TAG, "_main_view_get_filename() failed");
 			return;
@@ -714,11 +909,299 @@ static void _main_view_mycapture_cb(camera_preview_data_s *frame) {
 			return;
 		}
 
-		_main_view_thumbnail_set(filename);
+		ecore_main_loop_thread_safe_call_async(_main_view_file_saved,
+				strdup(filename));
 	}
 	view_resume();
 }
 
+/**
+ * @brief Camera callback delivering the full resolution image.
+ * @param[in] image The captured image
+ * @param[in] postview Postview image, unused
+ * @param[in] thumbnail Thumbnail image, unused
+ * @param[in] user_data The still_job of this capture
+ */
+static void _main_view_still_capturing_cb(camera_image_data_s *image,
+		camera_image_data_s *postview, camera_image_data_s *thumbnail,
+		void *user_data) {
+	int error_code = still_job_set_image((still_job *) user_data, image);
+	if (error_code != IMAGE_UTIL_ERROR_NONE)
+		DLOG_PRINT_ERROR("still_job_set_image", error_code);
+}
+
+/**
+ * @brief Composites and encodes the capture on an ecore worker thread.
+ */
+static void _main_view_still_process_cb(void *data, Ecore_Thread *thread) {
+	int error_code = still_job_process((still_job *) data, imgarr);
+	if (error_code != IMAGE_UTIL_ERROR_NONE)
+		DLOG_PRINT_ERROR("still_job_process", error_code);
+}
+
+/**
+ * @brief Called on the main loop once the worker finished or was cancelled.
+ */
+static void _main_view_still_end_cb(void *data, Ecore_Thread *thread) {
+	still_job *job = (still_job *) data;
+
+	if (job->error == IMAGE_UTIL_ERROR_NONE)
+		_main_view_capture_saved(job);
+	still_job_destroy(job);
+	s_info.flag_still_pending = false;
+}
+
+/**
+ * @brief Restarts the preview and hands the capture to a worker thread.
+ */
+static void _main_view_still_completed(void *data) {
+	view_resume();
+	if (!ecore_thread_run(_main_view_still_process_cb, _main_view_still_end_cb,
+			_main_view_still_end_cb, data)) {
+		still_job_destroy((still_job *) data);
+		s_info.flag_still_pending = false;
+	}
+}
+
+/**
+ * @brief Camera callback called when capturing is finished.
+ * @param[in] user_data The still_job of this capture
+ */
+static void _main_view_still_completed_cb(void *user_data) {
+	ecore_main_loop_thread_safe_call_async(_main_view_still_completed,
+			user_data);
+}
+
+/**
+ * @brief Starts the full resolution capture on the main loop.
+ */
+static void _main_view_still_start(void *data) {
+	still_job *job = (still_job *) data;
+
+	if (_main_view_get_file_path(job->filename, sizeof(job->filename), 0)
+			== 0) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "_main_view_get_file_path() failed");
+		still_job_destroy(job);
+		s_info.flag_still_pending = false;
+		return;
+	}
+
+	int error_code = camera_start_capture(s_info.camera,
+			_main_view_still_capturing_cb, _main_view_still_completed_cb, job);
+	if (error_code != CAMERA_ERROR_NONE) {
+		DLOG_PRINT_ERROR("camera_start_capture", error_code);
+		still_job_destroy(job);
+		s_info.flag_still_pending = false;
+	}
+}
+
+/**
+ * @brief Snapshots the effect state of the current preview frame and
+ * requests a full resolution capture. Called from the preview callback.
+ * @param[in] frame Preview frame the shutter fired on
+ * @param[in] cb Cb gain of the software filter, 0 for none
+ * @param[in] cr Cr gain of the software filter
+ * @return false when full resolution capture is not available
+ */
+static bool _main_view_still_capture(camera_preview_data_s *frame, double cb,
+		double cr) {
+	if (!s_info.camera_enabled || s_info.capture_width == 0)
+		return false;
+
+	if (s_info.flag_still_pending) {
+		dlog_print(DLOG_WARN, LOG_TAG, "Previous capture still in progress");
+		return true;
+	}
+
+	still_job *job = still_job_create(frame->width, frame->height);
+	if (s_info.flag_facerunning) {
+		job->sticker = s_info.sticker;
+		job->shapes = s_info.shapes;
+	}
+	if (s_info.flag_facerunning && s_info.filter == FILTER_BEAUTY) {
+		job->beauty = BEAUTY_STRENGTH;
+		job->shapes = s_info.shapes;
+	}
+	if (s_info.flag_facerunning && s_info.filter == FILTER_PORTRAIT) {
+		job->portrait = 1;
+		job->shapes = s_info.shapes;
+	}
+	job->filter_cb_q8 = (int) (cb * 256 + 0.5);
+	job->filter_cr_q8 = (int) (cr * 256 + 0.5);
+
+	s_info.flag_still_pending = true;
+	ecore_main_loop_thread_safe_call_async(_main_view_still_start, job);
+	return true;
+}
+
+typedef struct _ring_capture {
+	frame_slot *slot;
+	still_job *job;
+} ring_capture;
+
+/**
+ * @brief Encodes one ring frame on an ecore worker thread. Burst frames are
+ * queued together so the thread pool spreads them over the cores.
+ */
+static void _main_view_ring_process_cb(void *data, Ecore_Thread *thread) {
+	ring_capture *capture = (ring_capture *) data;
+	int error_code = still_job_set_frame(capture->job, capture->slot->data,
+			capture->slot->width, capture->slot->height);
+	frame_ring_release(capture->slot);
+	capture->slot = NULL;
+
+	if (error_code == IMAGE_UTIL_ERROR_NONE)
+		error_code = still_job_process(capture->job, imgarr);
+	if (error_code != IMAGE_UTIL_ERROR_NONE)
+		DLOG_PRINT_ERROR("still_job_process", error_code);
+}
+
+/**
+ * @brief Called on the main loop once a ring frame is encoded or cancelled.
+ */
+static void _main_view_ring_end_cb(void *data, Ecore_Thread *thread) {
+	ring_capture *capture = (ring_capture *) data;
+
+	frame_ring_release(capture->slot);
+	if (capture->job->error == IMAGE_UTIL_ERROR_NONE)
+		_main_view_capture_saved(capture->job);
+	still_job_destroy(capture->job);
+	delete capture;
+}
+
+/**
+ * @brief Queues the encoding of pinned ring frames. Runs on the main loop.
+ */
+static void _main_view_ring_start(void *data) {
+	ring_capture *capture = (ring_capture *) data;
+
+	if (!ecore_thread_run(_main_view_ring_process_cb, _main_view_ring_end_cb,
+			_main_view_ring_end_cb, capture)) {
+		frame_ring_release(capture->slot);
+		still_job_destroy(capture->job);
+		delete capture;
+	}
+}
+
+/**
+ * @brief Saves already processed frames from the ring without touching the
+ * camera. Called from the preview callback.
+ * @param[in] count 1 for the frame nearest capture_time, otherwise the
+ * number of burst frames ending at capture_time
+ * @return false if the ring holds no suitable frame
+ */
+static bool _main_view_ring_capture(int count) {
+	frame_slot *slots[BURST_FRAMES];
+	int n = 0;
+
+	if (!s_info.ring)
+		return false;
+
+	if (count == 1) {
+		slots[0] = frame_ring_acquire_nearest(s_info.ring, s_info.capture_time);
+		n = slots[0] ? 1 : 0;
+	} else {
+		n = frame_ring_acquire_latest(s_info.ring, s_info.capture_time, slots,
+				count < BURST_FRAMES ? count : BURST_FRAMES);
+	}
+
+	for (int i = 0; i < n; i++) {
+		ring_capture *capture = new ring_capture;
+		capture->slot = slots[i];
+		capture->job = still_job_create(slots[i]->width, slots[i]->height);
+		if (_main_view_get_file_path(capture->job->filename,
+				sizeof(capture->job->filename), n > 1 ? i + 1 : 0) == 0) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "_main_view_get_file_path() failed");
+			frame_ring_release(capture->slot);
+			still_job_destroy(capture->job);
+			delete capture;
+			continue;
+		}
+		ecore_main_loop_thread_safe_call_async(_main_view_ring_start, capture);
+	}
+	return n > 0;
+}
+
+/**
+ * @brief Handles a pending capture request for the current preview frame.
+ * @param[in] frame Preview frame, already processed and pushed to the ring
+ * @param[in] cb Cb gain of the software filter, 0 for none
+ * @param[in] cr Cr gain of the software filter
+ */
+static void _main_view_capture(camera_preview_data_s *frame, double cb,
+		double cr) {
+	switch (s_info.capture_mode) {
+	case CAPTURE_MODE_NEAREST:
+		if (_main_view_ring_capture(1))
+			return;
+		break;
+	case CAPTURE_MODE_BURST:
+		if (_main_view_ring_capture(BURST_FRAMES))
+			return;
+		break;
+	default:
+		break;
+	}
+
+	if (!_main_view_still_capture(frame, cb, cr))
+		_main_view_mycapture_cb(frame);
+}
+
+/**
+ * @brief Records the processed frame in the ring and serves capture requests.
+ * @param[in] frame Processed preview frame
+ * @param[in] timestamp Arrival time of the frame
+ * @param[in] cb Cb gain of the software filter, 0 for none
+ * @param[in] cr Cr gain of the software filter
+ */
+static void _main_view_frame_done(camera_preview_data_s *frame,
+		double timestamp, double cb, double cr) {
+	if (!s_info.ring)
+		s_info.ring = frame_ring_create(RING_FRAMES);
+	frame_ring_push(s_info.ring, frame, timestamp);
+
+	if (s_info.flag_capturing) {
+		s_info.flag_capturing = false;
+		_main_view_capture(frame, cb, cr);
+		s_info.capture_mode = CAPTURE_MODE_STILL;
+	}
+}
+
+/**
+ * @brief Fires a burst once the shutter has been held long enough.
+ * @param[in] data User data
+ * @return ECORE_CALLBACK_CANCEL to stop the timer
+ */
+static Eina_Bool _main_view_burst_timer_cb(void *data) {
+	s_info.burst_timer = NULL;
+	s_info.flag_burst_fired = true;
+	s_info.capture_time = ecore_time_get();
+	s_info.capture_mode = CAPTURE_MODE_BURST;
+	s_info.flag_capturing = true;
+	return ECORE_CALLBACK_CANCEL;
+}
+
+/**
+ * @brief Callback called on shutter button press and release.
+ * @param[in] data User data pointer
+ * @param[in] obj Pointer to the Edje object where the signal comes from
+ * @param[in] emission Signal's emission string
+ * @param[in] source The signal's source
+ */
+static void _main_view_shutter_press_cb(void *data, Evas_Object *obj,
+		const char *emission, const char *source) {
+	if (s_info.burst_timer) {
+		ecore_timer_del(s_info.burst_timer);
+		s_info.burst_timer = NULL;
+	}
+	if (!strncmp(emission, "mouse,down", sizeof("mouse,down") - 1)) {
+		s_info.flag_burst_fired = false;
+		if (s_info.camera_enabled)
+			s_info.burst_timer = ecore_timer_add(BURST_PRESS_TIME,
+					_main_view_burst_timer_cb, NULL);
+	}
+}
+
 /**
  * @brief Callback called on shutter button clicked event.
  * @param[in] data User data pointer
@@ -728,7 +1211,13 @@ static void _main_view_mycapture_cb(camera_preview_data_s *frame) {
  */
 static void _main_view_shutter_button_cb(void *data, Evas_Object *obj,
 		const char *emission, const char *source) {
+	if (s_info.flag_burst_fired) {
+		/* the press already produced a burst */
+		s_info.flag_burst_fired = false;
+		return;
+	}
 	if (s_info.camera_enabled) {
+		s_info.capture_mode = CAPTURE_MODE_STILL;
 		s_info.flag_capturing = true;
 	} else {
 		dlog_print(DLOG_ERROR, LOG_TAG, "Camera hasn't been initialized.");
@@ -811,41 +1300,43 @@ static bool _list_media_folders(void) {
 
 static void _camera_face_detected_cb(camera_detected_face_s* faces, int count,
 		void* user_data) {
-	if (!s_info.faces.empty())
-		s_info.faces.clear();
+	face_slot *slot = (face_slot *) user_data;
+	face_result *result = face_slot_begin(slot);
 
-	/* convert camera_detected_face_s faces to std::vector<rectangle> faces */
-	for (int i = 0; i < count; i++) {
-		dlib::rectangle face;
+	/* convert camera_detected_face_s faces to rectangles in the rotated preview */
+	for (int i = 0; i < count && i < FACE_SLOT_CAPACITY; i++) {
+		dlib::rectangle &face = result->faces[result->count++];
 		face.set_top(faces[i].x);
 		face.set_bottom(faces[i].x + faces[i].height);
 		face.set_right(resolution[1] - faces[i].y);
 		face.set_left(resolution[1] - faces[i].y - faces[i].width);
-		s_info.faces.push_back(face);
 	}
 
+	face_slot_publish(slot, ecore_time_get());
 }
 
-void face_landmark(camera_preview_data_s *frame, int count) {
-	dlib::array2d<u_int64_t> img;
-	img.set_size(frame->width, frame->height);
-	if (frame->data.double_plane.y_size != frame->width * frame->height) {
+void face_landmark(luma_cache *luma, const face_result *result,
+		double timestamp) {
+	/* the predictor works on the preview rotated to portrait */
+	const dlib::aligned_array2d<unsigned char> *rotated = luma_cache_luma(luma);
+	if (rotated == NULL) {
+		s_info.shapes.clear();
 		return;
 	}
+	const dlib::aligned_array2d<unsigned char> &img = *rotated;
 
-	for (int i = 0; i < frame->data.double_plane.y_size; i++) {
-		// img[i % frame->width][ i / frame->width] = (frame->data.double_plane.y)[i];
-		img[i % frame->width][frame->height - i / frame->width - 1] =
-				(frame->data.double_plane.y)[i];
-	}
+	/* the shapes are predicted in place, so the same number of faces as in
+	 * the last frame costs no allocations */
+	s_info.shapes.resize(result->count);
 
 	s_info.timer--;
 	if (s_info.timer < 0)
 		s_info.timer = 8;
 	// Now we will go ask the shape_predictor to tell us the pose of
 	// each face we detected.
-	for (unsigned long i = 0; i < count; ++i) {
-		dlib::full_object_detection shape = sp(img, s_info.faces[i]);
+	for (int i = 0; i < result->count; ++i) {
+		dlib::full_object_detection &shape = s_info.shapes[i];
+		sp(img, result->faces[i], s_info.sp_workspace, shape);
 
 		if (s_info.motion && i == 0) {
 			if (s_info.timer == 8) {
@@ -854,10 +1345,10 @@ void face_landmark(camera_preview_data_s *frame, int count) {
 
 					if (Vx < 0)
 						Vx *= -1;
-					int val = s_info.faces[i].width();
+					int val = result->faces[i].width();
 					if (Vx > val / 12) {
 						s_info.sticker = (s_info.sticker + 2);
-						if(s_info.sticker > MAX_STICKER)
+						if(s_info.sticker >= MAX_STICKER)
 						{
 							s_info.sticker = 0;
 							camera_stop_face_detection(s_info.camera);
@@ -868,51 +1359,70 @@ void face_landmark(camera_preview_data_s *frame, int count) {
 				int H = shape.part(51)(1) - shape.part(57)(1);
 				if(H < 0)
 					H *= -1;
-				if(H > s_info.faces[i].height()/6)
+				if(H > result->faces[i].height()/6) {
+					/* save the face as it was before the mouth opened */
+					s_info.capture_time = s_info.gesture_time;
+					s_info.capture_mode = CAPTURE_MODE_NEAREST;
 					s_info.flag_capturing = true;
+				} else {
+					s_info.gesture_time = timestamp;
+				}
 			}
 			s_info.nose[0] = shape.part(33)(0);
 			s_info.nose[1] = shape.part(33)(1);
 		}
+	}
+}
 
-		switch (s_info.sticker) {
-		case 2:
-			draw_nyan(frame, shape, imgarr);
-			break;
-		case 4:
-			draw_rudolph(frame, shape, imgarr);
-			break;
-		case 6:
-			draw_santa(frame, shape, imgarr);
-			break;
-		case 8:
-			draw_landmark(frame, shape);
-			break;
-		default:
-			break;
-		}
+/**
+ * @brief Renders the landmark based effects of the current frame. The
+ * background is blurred before the stickers go on, so they stay sharp.
+ * @param[in] frame Preview frame
+ */
+static void _main_view_draw_effects(camera_preview_data_s *frame) {
+	if (s_info.shapes.empty())
+		return;
+
+	if (s_info.filter == FILTER_BEAUTY) {
+		if (s_info.beauty == NULL)
+			s_info.beauty = beauty_create();
+		for (unsigned long i = 0; i < s_info.shapes.size(); ++i)
+			beauty_apply(s_info.beauty, frame, s_info.shapes[i], BEAUTY_STRENGTH);
+	} else if (s_info.filter == FILTER_PORTRAIT) {
+		if (s_info.portrait == NULL)
+			s_info.portrait = portrait_create();
+		portrait_apply(s_info.portrait, frame, s_info.shapes);
 	}
+
+	if (s_info.warp == NULL)
+		s_info.warp = warp_create();
+	for (unsigned long i = 0; i < s_info.shapes.size(); ++i)
+		draw_sticker(frame, s_info.shapes[i], imgarr, s_info.sticker, s_info.warp);
 }
 
 void _sticker_preview_callback(camera_preview_data_s *frame, void *user_data) {
 	if (frame->format == CAMERA_PIXEL_FORMAT_NV12
 			&& frame->num_of_planes == 2) {
+		double timestamp = ecore_time_get();
 
-		if (s_info.flag_facerunning) {
-			std::vector<dlib::rectangle> buf =
-					*((std::vector<dlib::rectangle>*) user_data);
-			size_t count = buf.size();
+		if (s_info.luma == NULL)
+			s_info.luma = luma_cache_create();
+		luma_cache_set_frame(s_info.luma, frame);
 
-			/* get face landmark */
-			if (count > 0) {
-				face_landmark(frame, count);
-			}
-		}
+		const face_result *result = NULL;
+		if (s_info.flag_facerunning)
+			result = face_slot_read((face_slot *) user_data);
 
-		if (s_info.flag_capturing) {
-			s_info.flag_capturing = false;
-			_main_view_mycapture_cb(frame);
+		/* get face landmark, unless the detector has gone quiet */
+		if (result && result->count > 0
+				&& timestamp - result->timestamp < FACE_MAX_AGE) {
+			face_landmark(s_info.luma, result, timestamp);
+		} else {
+			s_info.shapes.clear();
 		}
+		_main_view_draw_effects(frame);
+
+		_main_view_frame_done(frame, timestamp, 0, 0);
 	} else {
 		dlog_print(DLOG_ERROR, LOG_TAG,
 				"This preview frame format is not supported!");
@@ -947,65 +1457,22 @@ void _sticker_preview_callback(camera_preview_data_s *frame, void *user_data) {
 
 void apply_filter(camera_preview_data_s* frame, double Cb, double Cr) {
 	camera_attr_set_effect(s_info.camera, CAMERA_ATTR_EFFECT_NONE);
-	for (int i = 0; i < frame->data.double_plane.uv_size; i++) {
-		int val = frame->data.double_plane.uv[i];
-		if (i % 2) { // Cr
-			val = val * Cr;
-			if (val > 255)
-				val = 255;
-			if (val < 0)
-				val = 0;
-			frame->data.double_plane.uv[i] = val;
-		} else { //Cb
-			val = val * Cb;
-			if (val > 255)
-				val = 255;
-			if (val < 0)
-				val = 0;
-			frame->data.double_plane.uv[i] = val;
-		}
-	}
-
+	/* even bytes are Cb, odd bytes are Cr; gains go to the kernel in Q8 */
+	kernels_get()->nv12_filter(frame->data.double_plane.uv,
+			frame->data.double_plane.uv_size, (int) (Cb * 256 + 0.5),
+			(int) (Cr * 256 + 0.5));
 }
 
 void _filter_preview_callback(camera_preview_data_s *frame, void* user_data) {
 	if (frame->format == CAMERA_PIXEL_FORMAT_NV12
 			&& frame->num_of_planes == 2) {
+		double timestamp = ecore_time_get();
+		double cb, cr;
 
-		switch (s_info.filter) {
-		case 4: // red1
-			apply_filter(frame, 0.95, 1.05);
-			break;
-		case 5:
-			apply_filter(frame, 0.9, 1.07);
-			break;
-		case 6:
-			apply_filter(frame, 0.85, 1.1);
-			break;
-		case 7: // blue
-			apply_filter(frame, 1.05, 0.95);
-			break;
-		case 8:
-			apply_filter(frame, 1.07, 0.9);
-			break;
-		case 9:
-			apply_filter(frame, 1.1, 0.85);
-			break;
-		case 10: // green
-			apply_filter(frame, 0.97, 0.96);
-			break;
-		case 11:
-			apply_filter(frame, 0.95, 0.95);
-			break;
-		case 12:
-			apply_filter(frame, 0.93, 0.93);
-			break;
-		}
+		if (filter_gains(s_info.filter, &cb, &cr))
+			apply_filter(frame, cb, cr);
 
-		if (s_info.flag_capturing) {
-			s_info.flag_capturing = false;
-			_main_view_mycapture_cb(frame);
-		}
+		_main_view_frame_done(frame, timestamp, cb, cr);
 
 	} else {
 		dlog_print(DLOG_ERROR, LOG_TAG,
@@ -1013,23 +1480,53 @@ void _filter_preview_callback(camera_preview_data_s *frame, void* user_data) {
 	}
 }
 
+/**
+ * @brief Runs face detection and the landmark preview callback, which the
+ * stickers and the beauty filter both need.
+ */
+static void _main_view_landmarks_start(void) {
+	camera_unset_preview_cb(s_info.camera);
+	int error_code = camera_set_preview_cb(s_info.camera,
+			_sticker_preview_callback, s_info.faces);
+	if (CAMERA_ERROR_NONE != error_code) {
+		DLOG_PRINT_ERROR("camera_set_preview_cb", error_code);
+	}
+
+	if (s_info.flag_facerunning == false) {
+		error_code = camera_start_face_detection(s_info.camera,
+				_camera_face_detected_cb, s_info.faces);
+		if (CAMERA_ERROR_NONE != error_code) {
+			DLOG_PRINT_ERROR("camera_start_face_detection error", error_code);
+			return;
+		}
+		s_info.flag_facerunning = true;
+	}
+}
+
 static void _main_view_effect_button_cb(void) {
 	s_info.filter = (++s_info.filter) % MAX_FILTER;
 
+	//sp is not loaded yet, the landmark filters can't find the face
+	if (s_info.fin != 1 && (s_info.filter == FILTER_BEAUTY
+			|| s_info.filter == FILTER_PORTRAIT))
+		s_info.filter = 0;
+
 	camera_state_e state;
 	camera_get_state(s_info.camera, &state);
 	if (CAMERA_STATE_PREVIEW == state) {
-		if (s_info.flag_facerunning == true) {
+		if (s_info.filter == FILTER_BEAUTY
+				|| s_info.filter == FILTER_PORTRAIT) {
+			_main_view_landmarks_start();
+		} else if (s_info.flag_facerunning == true) {
 			camera_stop_face_detection(s_info.camera);
 			s_info.flag_facerunning = false;
 
-			if (s_info.sticker != 0) {
-				camera_unset_preview_cb(s_info.camera);
-				int error_code = camera_set_preview_cb(s_info.camera,
-						_filter_preview_callback, &s_info.faces);
-				if (CAMERA_ERROR_NONE != error_code) {
-					DLOG_PRINT_ERROR("camera_set_preview_cb", error_code);
-				}
+			/* the landmark callback is installed for stickers and beauty */
+			camera_unset_preview_cb(s_info.camera);
+			int error_code = camera_set_preview_cb(s_info.camera,
+					_filter_preview_callback, s_info.faces);
+			if (CAMERA_ERROR_NONE != error_code) {
+				DLOG_PRINT_ERROR("camera_set_preview_cb", error_code);
 			}
 		}
 	}
@@ -1065,18 +1562,21 @@ static void _main_view_sticker_button_cb(void) {
 	if (s_info.sticker != 0) {
 		camera_unset_preview_cb(s_info.camera);
 		int error_code = camera_set_preview_cb(s_info.camera,
-				_sticker_preview_callback, &s_info.faces);
+				_sticker_preview_callback, s_info.faces);
 		if (CAMERA_ERROR_NONE != error_code) {
 			DLOG_PRINT_ERROR("camera_set_preview_cb", error_code);
 		}
 	}
 
 	if (s_info.sticker == 0 && s_info.flag_facerunning == true) {
+		if (s_info.filter == FILTER_BEAUTY
+				|| s_info.filter == FILTER_PORTRAIT)
+			return;
 		camera_stop_face_detection(s_info.camera);
 		s_info.flag_facerunning = false;
 	} else if (s_info.flag_facerunning == false) {
 		error_code = camera_start_face_detection(s_info.camera,
-				_camera_face_detected_cb, &s_info.faces);
+				_camera_face_detected_cb, s_info.faces);
 		if (CAMERA_ERROR_NONE != error_code) {
 			DLOG_PRINT_ERROR("camera_start_face_detection error", error_code);
 			return;
@@ -1102,6 +1602,10 @@ static void _main_view_motion_button_cb() {
 static void _main_view_register_cbs(void) {
 	elm_object_signal_callback_add(s_info.layout, EVENT_SHUTTER_CLICKED, "*",
 			_main_view_shutter_button_cb, NULL);
+	elm_object_signal_callback_add(s_info.layout, "mouse,down,1",
+			"shutter_button", _main_view_shutter_press_cb, NULL);
+	elm_object_signal_callback_add(s_info.layout, "mouse,up,1",
+			"shutter_button", _main_view_shutter_press_cb, NULL);
 
 	elm_object_signal_callback_add(s_info.layout, "camera_effect_clicked", "*",
 			(Edje_Signal_Cb) _main_view_effect_button_cb, NULL);
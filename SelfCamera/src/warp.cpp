@@ -0,0 +1,294 @@
+#include "warp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+using namespace dlib;
+
+#define EYE_RING 8	/* vertices per ring around an eye */
+#define EYE_INNER 0.55f	/* inner ring radius, in eye widths */
+#define EYE_OUTER 1.15f	/* outer ring radius, stays in place */
+#define EYE_SCALE 1.3f	/* magnification inside the inner ring */
+#define JAW_POINTS 15	/* jaw line without the two points at the ears */
+#define JAW_SLIM 0.12f	/* how far the jaw moves towards the face axis */
+
+struct _warp_ctx{
+	unsigned char* y;	/* source area of the luma plane */
+	unsigned char* uv;	/* source area of the chroma plane */
+	int capacity;	/* bytes of each */
+};
+
+/* where the source of one plane was copied to */
+typedef struct _warp_source{
+	const unsigned char* data;
+	int stride;	/* bytes */
+	int x0;	/* position in the plane, in pixels */
+	int y0;
+	int width;
+	int height;
+}warp_source;
+
+static inline int _clamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+warp_ctx* warp_create(void)
+{
+	return (warp_ctx*)calloc(1, sizeof(warp_ctx));
+}
+
+void warp_destroy(warp_ctx* ctx)
+{
+	if(ctx == NULL)
+		return;
+	free(ctx->y);
+	free(ctx->uv);
+	free(ctx);
+}
+
+static bool _warp_reserve(warp_ctx* ctx, int size)
+{
+	if(size <= ctx->capacity)
+		return true;
+	free(ctx->y);
+	free(ctx->uv);
+	ctx->y = (unsigned char*)malloc(size);
+	ctx->uv = (unsigned char*)malloc(size);
+	ctx->capacity = 0;
+	if(!ctx->y || !ctx->uv)
+		return false;
+	ctx->capacity = size;
+	return true;
+}
+
+/* Fills one destination triangle of a plane with ch interleaved channels.
+ * The points are scaled into plane coordinates by scale. */
+static void _warp_triangle(unsigned char* plane, int stride, int width, int height, int ch,
+		const warp_source* s, const warp_point* sp, const warp_point* dp, float scale)
+{
+	float dx0 = dp[0].x*scale, dy0 = dp[0].y*scale;
+	float e1x = dp[1].x*scale - dx0, e1y = dp[1].y*scale - dy0;
+	float e2x = dp[2].x*scale - dx0, e2y = dp[2].y*scale - dy0;
+	float det = e1x*e2y - e1y*e2x;
+	if(fabsf(det) < 1e-3f)
+		return;
+
+	/* src = s0 + M*(dst - d0), evaluated at pixel centres and shifted so the
+	 * result indexes the copied source area */
+	float sx0 = sp[0].x*scale, sy0 = sp[0].y*scale;
+	float f1x = sp[1].x*scale - sx0, f1y = sp[1].y*scale - sy0;
+	float f2x = sp[2].x*scale - sx0, f2y = sp[2].y*scale - sy0;
+	float m00 = (f1x*e2y - f2x*e1y)/det;
+	float m01 = (f2x*e1x - f1x*e2x)/det;
+	float m10 = (f1y*e2y - f2y*e1y)/det;
+	float m11 = (f2y*e1x - f1y*e2x)/det;
+	float c0 = sx0 + m00*(0.5f - dx0) + m01*(0.5f - dy0) - 0.5f - s->x0;
+	float c1 = sy0 + m10*(0.5f - dx0) + m11*(0.5f - dy0) - 0.5f - s->y0;
+	const int A = (int)lrintf(m00*65536), B = (int)lrintf(m01*65536), C = (int)lrintf(c0*65536);
+	const int D = (int)lrintf(m10*65536), E = (int)lrintf(m11*65536), F = (int)lrintf(c1*65536);
+
+	float px[3] = { dx0, dx0 + e1x, dx0 + e2x };
+	float py[3] = { dy0, dy0 + e1y, dy0 + e2y };
+	float ymin = py[0] < py[1] ? (py[0] < py[2] ? py[0] : py[2]) : (py[1] < py[2] ? py[1] : py[2]);
+	float ymax = py[0] > py[1] ? (py[0] > py[2] ? py[0] : py[2]) : (py[1] > py[2] ? py[1] : py[2]);
+	int ys = _clamp((int)ceilf(ymin - 0.5f), 0, height);
+	int ye = _clamp((int)ceilf(ymax - 0.5f), 0, height);
+
+	for(int y=ys;y<ye;y++)
+	{
+		/* span of the triangle through the centre of the row */
+		float yc = y + 0.5f;
+		float xl = 1e9f, xr = -1e9f;
+		for(int i=0,j=2;i<3;j=i++)
+		{
+			if((py[i] <= yc) == (py[j] <= yc))
+				continue;
+			float x = px[i] + (yc - py[i])*(px[j] - px[i])/(py[j] - py[i]);
+			if(x < xl) xl = x;
+			if(x > xr) xr = x;
+		}
+		int xs = _clamp((int)ceilf(xl - 0.5f), 0, width);
+		int xe = _clamp((int)ceilf(xr - 0.5f), 0, width);
+		if(xs >= xe)
+			continue;
+
+		int u = A*xs + B*y + C;
+		int v = D*xs + E*y + F;
+		unsigned char* out = plane + y*stride + xs*ch;
+		for(int x=xs;x<xe;x++,u+=A,v+=D,out+=ch)
+		{
+			int xi = u >> 16, fx = (u >> 8) & 255;
+			int yi = v >> 16, fy = (v >> 8) & 255;
+			if(xi < 0) { xi = 0; fx = 0; }
+			else if(xi >= s->width - 1) { xi = s->width - 2; fx = 256; }
+			if(yi < 0) { yi = 0; fy = 0; }
+			else if(yi >= s->height - 1) { yi = s->height - 2; fy = 256; }
+
+			const unsigned char* p = s->data + yi*s->stride + xi*ch;
+			for(int c=0;c<ch;c++)
+			{
+				int top = p[c]*(256 - fx) + p[c + ch]*fx;
+				int bottom = p[c + s->stride]*(256 - fx) + p[c + s->stride + ch]*fx;
+				out[c] = (unsigned char)((top*(256 - fy) + bottom*fy + 32768) >> 16);
+			}
+		}
+	}
+}
+
+void warp_mesh(warp_ctx* ctx, camera_preview_data_s* frame,
+		const warp_point* src, const warp_point* dst, int num_points,
+		const warp_triangle* tris, int num_tris)
+{
+	if(ctx == NULL || num_points <= 0)
+		return;
+
+	const int W = frame->width;
+	const int H = frame->height;
+
+	/* everything the mesh reads from or writes to */
+	float min_x = src[0].x, max_x = src[0].x, min_y = src[0].y, max_y = src[0].y;
+	for(int i=0;i<num_points;i++)
+	{
+		const warp_point* p[2] = { &src[i], &dst[i] };
+		for(int k=0;k<2;k++)
+		{
+			if(p[k]->x < min_x) min_x = p[k]->x;
+			if(p[k]->x > max_x) max_x = p[k]->x;
+			if(p[k]->y < min_y) min_y = p[k]->y;
+			if(p[k]->y > max_y) max_y = p[k]->y;
+		}
+	}
+	int x0 = _clamp(((int)min_x - 2) & ~1, 0, W);
+	int x1 = _clamp(((int)max_x + 4) & ~1, 0, W);
+	int y0 = _clamp(((int)min_y - 2) & ~1, 0, H);
+	int y1 = _clamp(((int)max_y + 4) & ~1, 0, H);
+	int w = x1 - x0, h = y1 - y0;
+	if(w < 4 || h < 4)
+		return;
+	if(!_warp_reserve(ctx, w*h))
+		return;
+
+	for(int y=y0;y<y1;y++)
+		memcpy(ctx->y + (y - y0)*w, frame->data.double_plane.y + y*W + x0, w);
+	for(int y=y0/2;y<y1/2;y++)
+		memcpy(ctx->uv + (y - y0/2)*w, frame->data.double_plane.uv + y*W + x0, w);
+
+	warp_source ys = { ctx->y, w, x0, y0, w, h };
+	warp_source uvs = { ctx->uv, w, x0/2, y0/2, w/2, h/2 };
+	for(int t=0;t<num_tris;t++)
+	{
+		if(tris[t].a >= num_points || tris[t].b >= num_points || tris[t].c >= num_points)
+			continue;
+		warp_point sp[3] = { src[tris[t].a], src[tris[t].b], src[tris[t].c] };
+		warp_point dp[3] = { dst[tris[t].a], dst[tris[t].b], dst[tris[t].c] };
+		_warp_triangle(frame->data.double_plane.y, W, W, H, 1, &ys, sp, dp, 1.0f);
+		_warp_triangle(frame->data.double_plane.uv, W, W/2, H/2, 2, &uvs, sp, dp, 0.5f);
+	}
+}
+
+static inline warp_point _warp_frame_point(camera_preview_data_s* frame, const point& p)
+{
+	warp_point w = { (float)p.y(), (float)(frame->height - p.x()) };
+	return w;
+}
+
+/* Each eye gets a fan of triangles around its centre inside a ring that is
+ * pushed outwards, and a band out to a fixed ring that absorbs the change. */
+void warp_big_eyes(warp_ctx* ctx, camera_preview_data_s* frame, const full_object_detection& shape)
+{
+	warp_point src[2*(2*EYE_RING + 1)], dst[2*(2*EYE_RING + 1)];
+	warp_triangle tris[2*3*EYE_RING];
+	int n = 0, t = 0;
+
+	for(int eye = 36; eye <= 42; eye += 6)
+	{
+		warp_point c = { 0, 0 };
+		for(int k=0;k<6;k++)
+		{
+			warp_point p = _warp_frame_point(frame, shape.part(eye + k));
+			c.x += p.x / 6;
+			c.y += p.y / 6;
+		}
+		warp_point l = _warp_frame_point(frame, shape.part(eye));
+		warp_point r = _warp_frame_point(frame, shape.part(eye + 3));
+		float size = sqrtf((r.x - l.x)*(r.x - l.x) + (r.y - l.y)*(r.y - l.y));
+
+		int base = n;
+		src[n] = dst[n] = c;
+		n++;
+		for(int k=0;k<EYE_RING;k++,n++)
+		{
+			float a = 2*M_PI*k/EYE_RING;
+			float dx = cosf(a)*size, dy = sinf(a)*size;
+			src[n].x = c.x + dx*EYE_INNER;
+			src[n].y = c.y + dy*EYE_INNER;
+			dst[n].x = c.x + dx*EYE_INNER*EYE_SCALE;
+			dst[n].y = c.y + dy*EYE_INNER*EYE_SCALE;
+			src[n + EYE_RING].x = dst[n + EYE_RING].x = c.x + dx*EYE_OUTER;
+			src[n + EYE_RING].y = dst[n + EYE_RING].y = c.y + dy*EYE_OUTER;
+		}
+		n += EYE_RING;
+
+		for(int k=0;k<EYE_RING;k++)
+		{
+			int i0 = base + 1 + k, i1 = base + 1 + (k + 1) % EYE_RING;
+			int o0 = i0 + EYE_RING, o1 = i1 + EYE_RING;
+			warp_triangle fan = { (unsigned char)base, (unsigned char)i0, (unsigned char)i1 };
+			warp_triangle q0 = { (unsigned char)i0, (unsigned char)o0, (unsigned char)o1 };
+			warp_triangle q1 = { (unsigned char)i0, (unsigned char)o1, (unsigned char)i1 };
+			tris[t++] = fan;
+			tris[t++] = q0;
+			tris[t++] = q1;
+		}
+	}
+
+	warp_mesh(ctx, frame, src, dst, n, tris, t);
+}
+
+/* The jaw line (points 1-15) is pulled towards the vertical axis of the face
+ * between a fixed band outside the face and a fixed band over the cheeks. */
+void warp_slim_face(warp_ctx* ctx, camera_preview_data_s* frame, const full_object_detection& shape)
+{
+	warp_point src[3*JAW_POINTS], dst[3*JAW_POINTS];
+	warp_triangle tris[4*(JAW_POINTS - 1)];
+
+	warp_point nose = _warp_frame_point(frame, shape.part(30));
+	warp_point chin = _warp_frame_point(frame, shape.part(8));
+	warp_point brow = _warp_frame_point(frame, (shape.part(21) + shape.part(22))/2);
+	float ux = brow.x - chin.x, uy = brow.y - chin.y;
+	float len = sqrtf(ux*ux + uy*uy);
+	if(len < 1)
+		return;
+	/* unit vector across the face */
+	float vx = uy/len, vy = -ux/len;
+
+	for(int k=0;k<JAW_POINTS;k++)
+	{
+		warp_point p = _warp_frame_point(frame, shape.part(k + 1));
+		float ox = p.x - nose.x, oy = p.y - nose.y;
+		float across = ox*vx + oy*vy;
+		float w = JAW_SLIM*sinf(M_PI*k/(JAW_POINTS - 1));
+
+		warp_point outside = { p.x + ox*0.35f, p.y + oy*0.35f };
+		warp_point moved = { p.x - across*w*vx, p.y - across*w*vy };
+		warp_point cheek = { p.x - ox*0.5f, p.y - oy*0.5f };
+		src[k] = dst[k] = outside;
+		src[JAW_POINTS + k] = p;
+		dst[JAW_POINTS + k] = moved;
+		src[2*JAW_POINTS + k] = dst[2*JAW_POINTS + k] = cheek;
+	}
+
+	int t = 0;
+	for(int k=0;k+1<JAW_POINTS;k++)
+	{
+		unsigned char a0 = k, a1 = k + 1;
+		unsigned char b0 = JAW_POINTS + k, b1 = JAW_POINTS + k + 1;
+		unsigned char c0 = 2*JAW_POINTS + k, c1 = 2*JAW_POINTS + k + 1;
+		warp_triangle strip[4] = { { a0, a1, b1 }, { a0, b1, b0 }, { b0, b1, c1 }, { b0, c1, c0 } };
+		for(int i=0;i<4;i++)
+			tris[t++] = strip[i];
+	}
+
+	warp_mesh(ctx, frame, src, dst, 3*JAW_POINTS, tris, t);
+}
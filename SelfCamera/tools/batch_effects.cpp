@@ -0,0 +1,563 @@
+/*
+ * batch_effects.cpp
+ *
+ * Re-applies the landmark effects of the app to a folder of JPEGs on a Linux
+ * box, with the same beauty, portrait, warp, sticker and colour filter code
+ * the camera runs. Faces are found with dlib's HOG detector instead of the
+ * camera's. The filters the camera applies itself (mono, negative and so
+ * on) are not available here.
+ *
+ * Every file goes through three stages that run side by side: decode to
+ * NV12, detection + landmarks + effects, and encode. Each stage has its own
+ * threads and the queues between them are bounded, so memory stays at a few
+ * frames per thread however many files there are.
+ *
+ * Captures stored by the app are in sensor orientation, i.e. the faces lie
+ * on their side, and are analysed rotated exactly like the preview. Pass
+ * --upright for ordinary photos: they are turned to sensor orientation when
+ * decoded and back when encoded, so the sticker images, which are drawn for
+ * the sensor, come out the right way up. Stickers are scaled from the
+ * preview size by the width of the photo, as for a capture.
+ *
+ * The effects work on whole 2x2 chroma blocks, so a photo with an odd width
+ * or height is padded by repeating its last column or row, and the padding
+ * is cut off again when it is written.
+ *
+ * Usage:
+ *   batch_effects --model shape_predictor_68_face_landmarks.dat \
+ *       --effect beauty --effect bigeyes --out processed photos/
+ *   batch_effects --model shape_predictor_68_face_landmarks.dat --upright \
+ *       --sticker santa --filter red1 --stickers res --out christmas photos/
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -DDLIB_JPEG_SUPPORT -DDLIB_JPEG_STATIC -Itools/host -Iinc
+//       tools/batch_effects.cpp src/beauty.cpp src/portrait.cpp src/warp.cpp
+//       src/sticker.cpp src/landmark.cpp src/filter.cpp src/kernels.cpp
+//       inc/dlib/threads/*.cpp inc/dlib/dir_nav/*.cpp
+//       inc/dlib/misc_api/*.cpp inc/dlib/base64/*.cpp inc/dlib/entropy_decoder/*.cpp
+//       inc/dlib/image_loader/jpeg_loader.cpp inc/dlib/image_saver/save_jpeg.cpp
+//       inc/dlib/external/libjpeg/*.cpp -lpthread -o batch_effects
+
+#include "beauty.h"
+#include "portrait.h"
+#include "warp.h"
+#include "landmark.h"
+#include "filter.h"
+#include "kernels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dlib/cmd_line_parser.h>
+#include <dlib/dir_nav.h>
+#include <dlib/image_io.h>
+#include <dlib/image_processing.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/pipe.h>
+
+using namespace dlib;
+
+#define BATCH_QUEUE_PER_THREAD 2	/* frames waiting between two stages, per thread */
+
+typedef enum {
+	BATCH_EFFECT_BEAUTY = 1,
+	BATCH_EFFECT_PORTRAIT = 2,
+	BATCH_EFFECT_BIG_EYES = 4,
+	BATCH_EFFECT_SLIM_FACE = 8,
+} batch_effect_e;
+
+/* draw_sticker() numbers of the stickers */
+typedef enum {
+	BATCH_STICKER_NONE = 0,
+	BATCH_STICKER_NYAN = 2,
+	BATCH_STICKER_RUDOLPH = 4,
+	BATCH_STICKER_SANTA = 6,
+} batch_sticker_e;
+
+typedef struct _batch_options{
+	std::vector<std::string> inputs;
+	std::string out_dir;
+	int effects;	/* batch_effect_e bits */
+	int sticker;	/* batch_sticker_e */
+	int filter_cb_q8;	/* 0 when no filter is applied */
+	int filter_cr_q8;
+	imageinfo stickers[STICKER_NUM];	/* at preview size */
+	int strength;	/* beauty strength out of 256 */
+	int quality;
+	bool upright;
+}batch_options;
+
+typedef struct _batch_job{
+	std::string input;
+	std::string output;
+	std::vector<unsigned char> nv12;	/* Y plane, then UV with U first */
+	int width;	/* of the frame: sensor orientation, even */
+	int height;
+	int file_width;	/* of the picture in it, before padding */
+	int file_height;
+	int faces;
+	std::string error;
+}batch_job;
+
+typedef dlib::ring_pipe<batch_job*> batch_queue;
+
+static std::atomic<int> s_failed(0);
+
+/* Turns an upright plane the way the sensor would have seen it, the inverse
+ * of the rotation the analysis does. */
+static void _batch_to_sensor(array2d<unsigned char>& plane)
+{
+	array2d<unsigned char> s(plane.nc(), plane.nr());
+	for(long y=0;y<s.nr();y++)
+		for(long x=0;x<s.nc();x++)
+			s[y][x] = plane[x][plane.nc() - 1 - y];
+	swap(plane, s);
+}
+
+/* Decodes into an NV12 frame padded to even dimensions by repeating the last
+ * row and column. The chroma planes are sampled at the centre of every 2x2
+ * block whatever the file's subsampling. */
+static void _batch_read_nv12(const std::string& name, bool upright, std::vector<unsigned char>& nv12,
+		int* width, int* height, int* file_width, int* file_height)
+{
+	jpeg_loader loader(name, 1, jpeg_loader::output_ycbcr_planar);
+	array2d<unsigned char> plane[3];
+	for(unsigned long p=0;p<loader.num_planes();p++)
+	{
+		loader.get_plane(p, plane[p]);
+		if(upright)
+			_batch_to_sensor(plane[p]);
+	}
+
+	const int fw = plane[0].nc();
+	const int fh = plane[0].nr();
+	if(fw < 1 || fh < 1)
+		throw image_load_error("empty image");
+	const int W = (fw + 1) & ~1;
+	const int H = (fh + 1) & ~1;
+
+	*width = W;
+	*height = H;
+	*file_width = fw;
+	*file_height = fh;
+	nv12.resize((size_t)W*H*3/2);
+	unsigned char* y = &nv12[0];
+	unsigned char* uv = y + (size_t)W*H;
+	for(int r=0;r<H;r++)
+	{
+		unsigned char* row = y + (size_t)r*W;
+		memcpy(row, &plane[0][r < fh ? r : fh - 1][0], fw);
+		if(W > fw)
+			row[fw] = row[fw - 1];
+	}
+
+	for(int r=0;r<H/2;r++)
+	{
+		for(int c=0;c<W/2;c++)
+		{
+			for(int k=0;k<2;k++)
+			{
+				if(loader.num_planes() < 3)
+				{
+					uv[(size_t)r*W + 2*c + k] = 128;
+					continue;
+				}
+				/* (2r+1, 2c+1) is the centre of the block in luma
+				 * pixels, past the edge for the padding */
+				const array2d<unsigned char>& p = plane[1 + k];
+				long pr = std::min(((2*r + 1)*p.nr())/fh, p.nr() - 1);
+				long pc = std::min(((2*c + 1)*p.nc())/fw, p.nc() - 1);
+				uv[(size_t)r*W + 2*c + k] = p[pr][pc];
+			}
+		}
+	}
+}
+
+static void _batch_decode(batch_job* job, bool upright)
+{
+	_batch_read_nv12(job->input, upright, job->nv12, &job->width, &job->height,
+			&job->file_width, &job->file_height);
+}
+
+/* Loads the sticker images as the app does, NV12 at preview size. A missing
+ * image only leaves out the part of a sticker that uses it. */
+static void _batch_read_stickers(const std::string& folder, imageinfo* stickers)
+{
+	for(int i=0;i<STICKER_NUM;i++)
+	{
+		imageinfo* info = &stickers[i];
+		memset(info, 0, sizeof(*info));
+		info->error = -1;
+		try
+		{
+			std::vector<unsigned char> nv12;
+			int fw, fh;
+			_batch_read_nv12(folder + directory::get_separator() + sticker_filename(i), false,
+					nv12, &info->width, &info->height, &fw, &fh);
+			info->data = (unsigned char*)malloc(nv12.size());
+			if(info->data == NULL)
+				continue;
+			memcpy(info->data, &nv12[0], nv12.size());
+			info->size = nv12.size();
+			info->error = 0;
+		}
+		catch(std::exception& e)
+		{
+			fprintf(stderr, "sticker %s: %s\n", sticker_filename(i), e.what());
+		}
+	}
+}
+
+static inline unsigned char _batch_clamp(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/* Full range BT.601, like the JPEG files the frames came from. Only the
+ * picture is written, without the padding, turned back upright if it was
+ * turned when decoded. */
+static void _batch_encode(batch_job* job, bool upright, int quality)
+{
+	const int W = job->width;
+	const int fw = job->file_width;
+	const int fh = job->file_height;
+	const unsigned char* y = &job->nv12[0];
+	const unsigned char* uv = y + (size_t)W*job->height;
+	array2d<rgb_pixel> img;
+	if(upright)
+		img.set_size(fw, fh);
+	else
+		img.set_size(fh, fw);
+	for(long r=0;r<img.nr();r++)
+	{
+		for(long c=0;c<img.nc();c++)
+		{
+			/* (fr, fc) is the same pixel in the frame */
+			const long fr = upright ? fh - 1 - c : r;
+			const long fc = upright ? r : c;
+			int Y = y[(size_t)fr*W + fc];
+			int U = uv[(size_t)(fr/2)*W + (fc & ~1)] - 128;
+			int V = uv[(size_t)(fr/2)*W + (fc & ~1) + 1] - 128;
+			img[r][c].red = _batch_clamp(Y + ((91881*V + 32768) >> 16));
+			img[r][c].green = _batch_clamp(Y - ((22554*U + 46802*V + 32768) >> 16));
+			img[r][c].blue = _batch_clamp(Y + ((116130*U + 32768) >> 16));
+		}
+	}
+	save_jpeg(img, job->output, quality);
+}
+
+/* One analysis thread: its own detector, workspace, effect contexts and
+ * stickers scaled for the last frame width. */
+static void _batch_analyse(const batch_options* opt, const shape_predictor* sp,
+		batch_queue* in, batch_queue* out)
+{
+	frontal_face_detector detector = get_frontal_face_detector();
+	shape_predictor_workspace ws;
+	beauty_ctx* beauty = beauty_create();
+	portrait_ctx* portrait = portrait_create();
+	warp_ctx* warp = warp_create();
+	const kernel_table* k = kernels_get();
+	array2d<unsigned char> img;
+	std::vector<full_object_detection> shapes;
+	imageinfo scaled[STICKER_NUM];
+	int scaled_width = 0;
+	memset(scaled, 0, sizeof(scaled));
+
+	batch_job* job;
+	while(in->dequeue(job))
+	{
+		if(job->error.empty())
+		{
+			const int W = job->width;
+			const int H = job->height;
+			camera_preview_data_s frame;
+			memset(&frame, 0, sizeof(frame));
+			frame.format = CAMERA_PIXEL_FORMAT_NV12;
+			frame.width = W;
+			frame.height = H;
+			frame.num_of_planes = 2;
+			frame.data.double_plane.y = &job->nv12[0];
+			frame.data.double_plane.y_size = W*H;
+			frame.data.double_plane.uv = &job->nv12[0] + (size_t)W*H;
+			frame.data.double_plane.uv_size = W*H/2;
+
+			/* the landmarks come out in the rotated preview layout the
+			 * effects take, where frame x is part.y() and frame y is
+			 * height - 1 - part.x() */
+			img.set_size(W, H);
+			k->luma_rotate((unsigned char*)image_data(img), width_step(img),
+					frame.data.double_plane.y, W, W, H);
+
+			std::vector<rectangle> faces = detector(img);
+			shapes.resize(faces.size());
+			for(unsigned long i=0;i<faces.size();i++)
+				(*sp)(img, faces[i], ws, shapes[i]);
+			job->faces = faces.size();
+
+			/* same order as a still capture */
+			if(opt->effects & BATCH_EFFECT_BEAUTY)
+			{
+				for(unsigned long i=0;i<shapes.size();i++)
+					beauty_apply(beauty, &frame, shapes[i], opt->strength);
+			}
+			if(opt->effects & BATCH_EFFECT_PORTRAIT)
+				portrait_apply(portrait, &frame, shapes);
+			for(unsigned long i=0;i<shapes.size();i++)
+			{
+				if(opt->effects & BATCH_EFFECT_BIG_EYES)
+					warp_big_eyes(warp, &frame, shapes[i]);
+				if(opt->effects & BATCH_EFFECT_SLIM_FACE)
+					warp_slim_face(warp, &frame, shapes[i]);
+			}
+
+			/* the filter and stickers are written for the preview's chroma order */
+			const bool draw = opt->sticker != BATCH_STICKER_NONE && !shapes.empty();
+			const bool filter = opt->filter_cb_q8 != 0;
+			if(draw || filter)
+				_image_util_swap_uv(frame.data.double_plane.uv, frame.data.double_plane.uv_size);
+			if(filter)
+				k->nv12_filter(frame.data.double_plane.uv, frame.data.double_plane.uv_size,
+						opt->filter_cb_q8, opt->filter_cr_q8);
+			if(draw)
+			{
+				if(scaled_width != W)
+				{
+					sticker_release_all(scaled);
+					sticker_scale_all(scaled, opt->stickers, (double)W/STICKER_PREVIEW_WIDTH);
+					scaled_width = W;
+				}
+				for(unsigned long i=0;i<shapes.size();i++)
+					draw_sticker(&frame, shapes[i], scaled, opt->sticker, warp);
+			}
+			if(draw || filter)
+				_image_util_swap_uv(frame.data.double_plane.uv, frame.data.double_plane.uv_size);
+		}
+		out->enqueue(job);
+	}
+
+	sticker_release_all(scaled);
+	warp_destroy(warp);
+	portrait_destroy(portrait);
+	beauty_destroy(beauty);
+}
+
+static void _batch_decoder(const batch_options* opt, std::atomic<unsigned long>* next,
+		batch_queue* out)
+{
+	for(;;)
+	{
+		unsigned long idx = (*next)++;
+		if(idx >= opt->inputs.size())
+			return;
+
+		batch_job* job = new batch_job();
+		job->input = opt->inputs[idx];
+		job->output = opt->out_dir + directory::get_separator() + file(job->input).name();
+		job->width = job->height = job->faces = 0;
+		job->file_width = job->file_height = 0;
+		try
+		{
+			_batch_decode(job, opt->upright);
+		}
+		catch(std::exception& e)
+		{
+			job->error = e.what();
+		}
+		out->enqueue(job);
+	}
+}
+
+static void _batch_encoder(const batch_options* opt, batch_queue* in)
+{
+	batch_job* job;
+	while(in->dequeue(job))
+	{
+		if(job->error.empty())
+		{
+			try
+			{
+				_batch_encode(job, opt->upright, opt->quality);
+			}
+			catch(std::exception& e)
+			{
+				job->error = e.what();
+			}
+		}
+
+		if(job->error.empty())
+			printf("%s: %d face(s)\n", job->input.c_str(), job->faces);
+		else
+		{
+			fprintf(stderr, "%s: %s\n", job->input.c_str(), job->error.c_str());
+			s_failed++;
+		}
+		delete job;
+	}
+}
+
+static int _batch_parse_effects(const command_line_parser& parser, int* effects)
+{
+	*effects = 0;
+	for(unsigned long i=0;i<parser.option("effect").count();i++)
+	{
+		const std::string name = parser.option("effect").argument(0, i);
+		if(name == "beauty")
+			*effects |= BATCH_EFFECT_BEAUTY;
+		else if(name == "portrait")
+			*effects |= BATCH_EFFECT_PORTRAIT;
+		else if(name == "bigeyes")
+			*effects |= BATCH_EFFECT_BIG_EYES;
+		else if(name == "slimface")
+			*effects |= BATCH_EFFECT_SLIM_FACE;
+		else
+		{
+			fprintf(stderr, "unknown effect '%s'\n", name.c_str());
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int _batch_parse_sticker(const command_line_parser& parser, int* sticker)
+{
+	*sticker = BATCH_STICKER_NONE;
+	if(!parser.option("sticker"))
+		return 0;
+	const std::string name = parser.option("sticker").argument();
+	if(name == "nyan")
+		*sticker = BATCH_STICKER_NYAN;
+	else if(name == "rudolph")
+		*sticker = BATCH_STICKER_RUDOLPH;
+	else if(name == "santa")
+		*sticker = BATCH_STICKER_SANTA;
+	else
+	{
+		fprintf(stderr, "unknown sticker '%s'\n", name.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+static int _batch_parse_filter(const command_line_parser& parser, int* cb_q8, int* cr_q8)
+{
+	*cb_q8 = *cr_q8 = 0;
+	if(!parser.option("filter"))
+		return 0;
+	const std::string name = parser.option("filter").argument();
+	double cb, cr;
+	if(!filter_gains(filter_from_name(name.c_str()), &cb, &cr))
+	{
+		fprintf(stderr, "unknown filter '%s'\n", name.c_str());
+		return -1;
+	}
+	/* the same rounding as a capture */
+	*cb_q8 = (int)(cb*256 + 0.5);
+	*cr_q8 = (int)(cr*256 + 0.5);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		command_line_parser parser;
+		parser.add_option("model", "Landmark model (shape_predictor_68_face_landmarks.dat).", 1);
+		parser.add_option("effect", "beauty, portrait, bigeyes or slimface. Can be repeated.", 1);
+		parser.add_option("sticker", "nyan, rudolph or santa.", 1);
+		parser.add_option("stickers", "Folder with the sticker images (default: res).", 1);
+		parser.add_option("filter", "red1, red2, red3, blue1, blue2, blue3, green1, green2 or green3.", 1);
+		parser.add_option("out", "Folder the processed files are written to.", 1);
+		parser.add_option("threads", "Threads per stage (default: number of cores).", 1);
+		parser.add_option("strength", "Beauty strength out of 256 (default 200).", 1);
+		parser.add_option("quality", "JPEG quality (default 95).", 1);
+		parser.add_option("upright", "The photos are upright, not in sensor orientation.");
+		parser.add_option("h", "Display this help message.");
+		parser.parse(argc, argv);
+
+		parser.check_option_arg_range("threads", 1, 256);
+		parser.check_option_arg_range("strength", 0, 256);
+		parser.check_option_arg_range("quality", 1, 100);
+
+		if(parser.option("h") || !parser.option("model") || !parser.option("out")
+				|| parser.number_of_arguments() == 0)
+		{
+			printf("Usage: batch_effects --model <file> --out <folder> [options] <folder or jpeg>...\n");
+			parser.print_options();
+			return parser.option("h") ? 0 : 1;
+		}
+
+		batch_options opt;
+		if(_batch_parse_effects(parser, &opt.effects) != 0
+				|| _batch_parse_sticker(parser, &opt.sticker) != 0
+				|| _batch_parse_filter(parser, &opt.filter_cb_q8, &opt.filter_cr_q8) != 0)
+			return 1;
+		opt.out_dir = parser.option("out").argument();
+		opt.strength = get_option(parser, "strength", BEAUTY_STRENGTH);
+		opt.quality = get_option(parser, "quality", 95);
+		opt.upright = parser.option("upright");
+		int threads = get_option(parser, "threads", (int)std::thread::hardware_concurrency());
+		if(threads < 1)
+			threads = 1;
+
+		memset(opt.stickers, 0, sizeof(opt.stickers));
+		if(opt.sticker != BATCH_STICKER_NONE)
+			_batch_read_stickers(get_option(parser, "stickers", std::string("res")), opt.stickers);
+
+		for(unsigned long i=0;i<parser.number_of_arguments();i++)
+		{
+			const std::string arg = parser[i];
+			if(file_exists(arg))
+			{
+				opt.inputs.push_back(arg);
+				continue;
+			}
+			std::vector<file> files = get_files_in_directory_tree(directory(arg),
+					match_endings(".jpg .jpeg .JPG .JPEG"));
+			for(unsigned long j=0;j<files.size();j++)
+				opt.inputs.push_back(files[j].full_name());
+		}
+		create_directory(opt.out_dir);
+
+		shape_predictor sp;
+		deserialize(parser.option("model").argument()) >> sp;
+		kernels_init(1);
+
+		batch_queue decoded(BATCH_QUEUE_PER_THREAD*threads);
+		batch_queue analysed(BATCH_QUEUE_PER_THREAD*threads);
+		std::atomic<unsigned long> next(0);
+		std::vector<std::thread> decoders, analysers, encoders;
+		for(int i=0;i<threads;i++)
+		{
+			decoders.push_back(std::thread(_batch_decoder, &opt, &next, &decoded));
+			analysers.push_back(std::thread(_batch_analyse, &opt, &sp, &decoded, &analysed));
+			encoders.push_back(std::thread(_batch_encoder, &opt, &analysed));
+		}
+
+		/* drain the stages front to back */
+		for(int i=0;i<threads;i++)
+			decoders[i].join();
+		decoded.wait_until_empty();
+		decoded.disable();
+		for(int i=0;i<threads;i++)
+			analysers[i].join();
+		analysed.wait_until_empty();
+		analysed.disable();
+		for(int i=0;i<threads;i++)
+			encoders[i].join();
+
+		sticker_release_all(opt.stickers);
+		printf("%lu file(s), %d failed\n", (unsigned long)opt.inputs.size(), (int)s_failed);
+		return s_failed ? 1 : 0;
+	}
+	catch(std::exception& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,81 @@
+/*
+ * bench_blur.cpp
+ *
+ * Times blurring grey planes of the sizes the analysis works on, for a few
+ * sigmas. Each line is the best of a few runs, per call:
+ *
+ *   generic  gaussian_blur(), the integer code every pixel type goes through
+ *   fixed    gaussian_blur_fixed_point()
+ *   threads  the same with a thread_pool of 4 threads
+ *
+ * and the largest difference between the generic and fixed point outputs.
+ */
+// Build (from SelfCamera/), with -mavx2 or the target's NEON flags to see
+// the vector code, as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/bench_blur.cpp inc/dlib/threads/*.cpp
+//       -lpthread -o bench_blur
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+#include <dlib/image_transforms.h>
+#include <dlib/rand.h>
+#include <dlib/threads.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 7
+
+static double _bench_now_us(void)
+{
+	return std::chrono::duration<double, std::micro>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename F>
+static double _bench_best_us(const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		const double start = _bench_now_us();
+		f();
+		best = std::min(best, _bench_now_us() - start);
+	}
+	return best;
+}
+
+static void _bench_grey(thread_pool& tp, long nr, long nc, double sigma)
+{
+	dlib::rand rnd;
+	array2d<unsigned char> in(nr, nc), out, gout;
+	for(long r=0;r<nr;r++)
+		for(long c=0;c<nc;c++)
+			in[r][c] = rnd.get_random_8bit_number();
+
+	const double generic_us = _bench_best_us([&](){ gaussian_blur(in, gout, sigma); });
+	const double fixed_us = _bench_best_us([&](){ gaussian_blur_fixed_point(in, out, sigma); });
+	const double threads_us = _bench_best_us([&](){ gaussian_blur_fixed_point(in, out, tp, sigma); });
+
+	int diff = 0;
+	for(long r=0;r<nr;r++)
+		for(long c=0;c<nc;c++)
+			diff = std::max(diff, std::abs(out[r][c] - gout[r][c]));
+
+	printf("  %4ldx%-4ld sigma %4.1f  generic %7.0f us  fixed %6.0f us  threads %6.0f us  (%.1fx)  max diff %d\n",
+			nc, nr, sigma, generic_us, fixed_us, threads_us, generic_us/fixed_us, diff);
+}
+
+int main(void)
+{
+	thread_pool tp(4);
+	const double sigmas[] = { 1, 2, 4 };
+	for(double sigma : sigmas)
+	{
+		_bench_grey(tp, 720, 1280, sigma);
+		_bench_grey(tp, 480, 640, sigma);
+		_bench_grey(tp, 240, 320, sigma);
+	}
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * bench_jpeg_decode.cpp
+ *
+ * Times load_jpeg() on frames of the sizes the camera hands over, saved by
+ * save_jpeg() at a few qualities. Each line is the best of a few runs, per
+ * decode, for:
+ *
+ *   rgb     a full decode to an rgb_pixel image
+ *   planar  a decode to Y, Cb and Cr planes, which skips the upsampling and
+ *           colour conversion
+ *
+ * The bundled libjpeg picks its SIMD code when it starts, so compare runs
+ * of the same binary as it is, with JSIMD_FORCESSE2=1 and with
+ * JSIMD_FORCENONE=1 in the environment.
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc -DDLIB_JPEG_SUPPORT -DDLIB_JPEG_STATIC
+//       tools/bench_jpeg_decode.cpp inc/dlib/image_loader/jpeg_loader.cpp
+//       inc/dlib/image_saver/save_jpeg.cpp inc/dlib/external/libjpeg/*.cpp
+//       -o bench_jpeg_decode
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+#include <dlib/image_io.h>
+#include <dlib/rand.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 7
+
+static double _bench_now_us(void)
+{
+	return std::chrono::duration<double, std::micro>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename F>
+static double _bench_best_us(const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		const double start = _bench_now_us();
+		f();
+		best = std::min(best, _bench_now_us() - start);
+	}
+	return best;
+}
+
+static void _bench_frame(long nr, long nc, int quality)
+{
+	/* Smooth shading with a little noise, closer to a photo than noise alone. */
+	dlib::rand rnd;
+	array2d<rgb_pixel> img(nr, nc);
+	for(long r=0;r<nr;r++)
+		for(long c=0;c<nc;c++)
+		{
+			const int n = rnd.get_random_8bit_number()%16;
+			img[r][c] = rgb_pixel((c*255/nc + n)&0xFF, (r*255/nr + n)&0xFF, ((r+c)/4 + n)&0xFF);
+		}
+	const std::string file = "/tmp/bench_jpeg_decode.jpg";
+	save_jpeg(img, file, quality);
+
+	array2d<rgb_pixel> out;
+	array2d<unsigned char> plane;
+	const double rgb_us = _bench_best_us([&](){ load_jpeg(out, file); });
+	const double planar_us = _bench_best_us([&](){
+		jpeg_loader loader(file, 1, jpeg_loader::output_ycbcr_planar);
+		for(unsigned long i=0;i<loader.num_planes();i++)
+			loader.get_plane(i, plane);
+	});
+
+	printf("  %4ldx%-4ld quality %3d  rgb %6.0f us  planar %6.0f us\n",
+			nc, nr, quality, rgb_us, planar_us);
+	remove(file.c_str());
+}
+
+int main(void)
+{
+	const char* none = getenv("JSIMD_FORCENONE");
+	const char* sse2 = getenv("JSIMD_FORCESSE2");
+	printf("JSIMD_FORCENONE=%s JSIMD_FORCESSE2=%s\n", none ? none : "", sse2 ? sse2 : "");
+	const int qualities[] = { 75, 95 };
+	for(int quality : qualities)
+	{
+		_bench_frame(720, 1280, quality);
+		_bench_frame(480, 640, quality);
+	}
+	return 0;
+}
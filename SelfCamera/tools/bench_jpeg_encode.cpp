@@ -0,0 +1,106 @@
+/*
+ * bench_jpeg_encode.cpp
+ *
+ * Times save_jpeg() on frames of the sizes the camera hands over, at a few
+ * qualities. Each line is the best of a few runs, per encode, with the size
+ * of the file it wrote, for:
+ *
+ *   1 thread   the plain save_jpeg()
+ *   N threads  save_jpeg() with a thread_pool of one thread per core, which
+ *              compresses one band of the frame per thread
+ *
+ * The bundled libjpeg picks its SIMD code when it starts, so compare runs
+ * of the same binary as it is, with JSIMD_FORCESSE2=1 and with
+ * JSIMD_FORCENONE=1 in the environment. The files are the same in all
+ * three.
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc -DDLIB_JPEG_SUPPORT -DDLIB_JPEG_STATIC
+//       tools/bench_jpeg_encode.cpp inc/dlib/image_loader/jpeg_loader.cpp
+//       inc/dlib/image_saver/save_jpeg.cpp inc/dlib/threads/*.cpp
+//       inc/dlib/external/libjpeg/*.cpp -lpthread -o bench_jpeg_encode
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <dlib/image_io.h>
+#include <dlib/rand.h>
+#include <dlib/threads.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 7
+
+static double _bench_now_us(void)
+{
+	return std::chrono::duration<double, std::micro>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename F>
+static double _bench_best_us(const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		const double start = _bench_now_us();
+		f();
+		best = std::min(best, _bench_now_us() - start);
+	}
+	return best;
+}
+
+static long _bench_file_size(const std::string& file)
+{
+	long bytes = 0;
+	FILE* f = fopen(file.c_str(), "rb");
+	if(f)
+	{
+		fseek(f, 0, SEEK_END);
+		bytes = ftell(f);
+		fclose(f);
+	}
+	return bytes;
+}
+
+static void _bench_frame(thread_pool& tp, long nr, long nc, int quality)
+{
+	/* Smooth shading with a little noise, closer to a photo than noise alone. */
+	dlib::rand rnd;
+	array2d<rgb_pixel> img(nr, nc);
+	for(long r=0;r<nr;r++)
+		for(long c=0;c<nc;c++)
+		{
+			const int n = rnd.get_random_8bit_number()%16;
+			img[r][c] = rgb_pixel((c*255/nc + n)&0xFF, (r*255/nr + n)&0xFF, ((r+c)/4 + n)&0xFF);
+		}
+	const std::string file = "/tmp/bench_jpeg_encode.jpg";
+
+	const double us = _bench_best_us([&](){ save_jpeg(img, file, quality); });
+	const long bytes = _bench_file_size(file);
+	const double par_us = _bench_best_us([&](){ save_jpeg(img, file, quality, tp); });
+	const long par_bytes = _bench_file_size(file);
+
+	printf("  %4ldx%-4ld quality %3d  1 thread %7.0f us %8ld bytes  %lu threads %7.0f us %8ld bytes\n",
+			nc, nr, quality, us, bytes, tp.num_threads_in_pool(), par_us, par_bytes);
+	remove(file.c_str());
+}
+
+int main(void)
+{
+	const char* none = getenv("JSIMD_FORCENONE");
+	const char* sse2 = getenv("JSIMD_FORCESSE2");
+	printf("JSIMD_FORCENONE=%s JSIMD_FORCESSE2=%s\n", none ? none : "", sse2 ? sse2 : "");
+	thread_pool tp(std::thread::hardware_concurrency());
+	const int qualities[] = { 75, 95 };
+	for(int quality : qualities)
+	{
+		_bench_frame(tp, 2448, 3264, quality);
+		_bench_frame(tp, 720, 1280, quality);
+		_bench_frame(tp, 480, 640, quality);
+	}
+	return 0;
+}
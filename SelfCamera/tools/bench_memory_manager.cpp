@@ -0,0 +1,127 @@
+/*
+ * bench_memory_manager.cpp
+ *
+ * Compares the memory manager that just calls new and delete
+ * (memory_manager_stateless_kernel_1, dlib's default) with the thread caching
+ * one (memory_manager_stateless_kernel_3), on the kind of
+ * allocations the frame pipeline makes. Each line is the best of a few
+ * runs, with 1, 2, 4, ... threads all doing the same thing at once, and
+ * gives the wall time divided by the work done by all of them:
+ *
+ *   frame   what one frame of face analysis allocates and frees: a 640x480
+ *           grey image, its pyramid, FHOG sized float planes and a few small
+ *           matrices, with every page written once
+ *   small   bursts of 64 byte objects, allocated and then freed in turn
+ *
+ * Usage:
+ *   bench_memory_manager [max threads]
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/bench_memory_manager.cpp
+//       inc/dlib/threads/*.cpp -lpthread -o bench_memory_manager
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <dlib/memory_manager_stateless.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 5
+
+static double _bench_now_us(void)
+{
+	return std::chrono::duration<double, std::micro>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* runs f on n threads at once and returns the best wall time of a few runs */
+template <typename F>
+static double _bench_best_us(unsigned long n, const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		std::vector<std::thread> threads;
+		const double start = _bench_now_us();
+		for(unsigned long t=0;t<n;t++)
+			threads.push_back(std::thread(f));
+		for(unsigned long t=0;t<n;t++)
+			threads[t].join();
+		best = std::min(best, _bench_now_us() - start);
+	}
+	return best;
+}
+
+template <typename MM>
+static void _bench_frame(const char* name, unsigned long threads)
+{
+	const int frames = 200;
+	const double us = _bench_best_us(threads, [&](){
+		typename MM::template rebind<unsigned char>::other mm;
+		std::vector<unsigned long> sizes;
+		/* the image and its pyramid */
+		for(unsigned long w=640, h=480; w >= 20; w=w*4/5, h=h*4/5)
+			sizes.push_back(w*h);
+		/* FHOG planes of the first levels */
+		for(unsigned long w=640, h=480; w >= 160; w=w*4/5, h=h*4/5)
+			sizes.push_back((w/8)*(h/8)*31*sizeof(float));
+		/* landmark and small matrix scratch */
+		for(int i=0;i<16;i++)
+			sizes.push_back(68*2*sizeof(float) + i*16);
+
+		std::vector<unsigned char*> blocks(sizes.size());
+		for(int f=0;f<frames;f++)
+		{
+			for(unsigned long i=0;i<sizes.size();i++)
+			{
+				blocks[i] = mm.allocate_array(sizes[i]);
+				for(unsigned long k=0;k<sizes[i];k+=4096)
+					blocks[i][k] = (unsigned char)k;
+			}
+			for(unsigned long i=0;i<sizes.size();i++)
+				mm.deallocate_array(blocks[i]);
+		}
+	});
+	printf("  %-8s frame  %8.1f us per frame\n", name, us/(frames*threads));
+}
+
+template <typename MM>
+static void _bench_small(const char* name, unsigned long threads)
+{
+	const int rounds = 2000;
+	const int burst = 256;
+	const double us = _bench_best_us(threads, [&](){
+		typename MM::template rebind<unsigned char>::other mm;
+		unsigned char* blocks[burst];
+		for(int r=0;r<rounds;r++)
+		{
+			for(int i=0;i<burst;i++)
+				blocks[i] = mm.allocate_array(64);
+			for(int i=0;i<burst;i++)
+				mm.deallocate_array(blocks[i]);
+		}
+	});
+	printf("  %-8s small  %8.1f ns per allocation\n", name, us*1000/(rounds*burst*threads));
+}
+
+int main(int argc, char** argv)
+{
+	const unsigned long max_threads = argc > 1 ? strtoul(argv[1], NULL, 10)
+			: std::max(1U, std::thread::hardware_concurrency());
+
+	/* 1, 2, 4, ... threads and max_threads last */
+	for(unsigned long n=1;n<=max_threads;n=(n == max_threads) ? n+1 : std::min(2*n, max_threads))
+	{
+		printf("%lu thread(s)\n", n);
+		_bench_frame<memory_manager_stateless_kernel_1<char> >("new", n);
+		_bench_frame<memory_manager_stateless_kernel_3<char> >("cached", n);
+		_bench_small<memory_manager_stateless_kernel_1<char> >("new", n);
+		_bench_small<memory_manager_stateless_kernel_3<char> >("cached", n);
+	}
+	return 0;
+}
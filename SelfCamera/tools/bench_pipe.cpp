@@ -0,0 +1,158 @@
+/*
+ * bench_pipe.cpp
+ *
+ * Compares dlib::pipe with dlib::ring_pipe, in both of its modes, for the
+ * hand-offs between the camera, analysis and encoder threads, with pointer
+ * sized items such as frame handles. Each line is the best of a few runs:
+ *
+ *   uncontended  one thread enqueues and dequeues, i.e. the cost of the
+ *                calls themselves, per item
+ *   stream       one thread enqueues and another one dequeues through a
+ *                pipe of 64 items, per item, one at a time and in batches
+ *   ping-pong    two threads bounce an item through two pipes of one item,
+ *                time per hand-off
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/bench_pipe.cpp inc/dlib/threads/*.cpp
+//       -lpthread -o bench_pipe
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <dlib/pipe.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 5
+#define BENCH_BATCH 16
+
+typedef void* bench_item;
+
+struct bench_spsc_pipe : public ring_pipe<bench_item>
+{
+	explicit bench_spsc_pipe(unsigned long size) : ring_pipe<bench_item>(size, true) {}
+};
+
+static double _bench_now_ns(void)
+{
+	return std::chrono::duration<double, std::nano>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename F>
+static double _bench_best_ns(const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		const double start = _bench_now_ns();
+		f();
+		best = std::min(best, _bench_now_ns() - start);
+	}
+	return best;
+}
+
+/* dlib::pipe has no batch calls, so move the items one at a time */
+static unsigned long _bench_enqueue_batch(pipe<bench_item>& p, bench_item* items, unsigned long num)
+{
+	unsigned long i = 0;
+	while(i < num && p.enqueue(items[i]))
+		i++;
+	return i;
+}
+
+static unsigned long _bench_dequeue_batch(pipe<bench_item>& p, bench_item* items, unsigned long)
+{
+	return p.dequeue(items[0]) ? 1 : 0;
+}
+
+static unsigned long _bench_enqueue_batch(ring_pipe<bench_item>& p, bench_item* items, unsigned long num)
+{
+	return p.enqueue_batch(items, num);
+}
+
+static unsigned long _bench_dequeue_batch(ring_pipe<bench_item>& p, bench_item* items, unsigned long num)
+{
+	return p.dequeue_batch(items, num);
+}
+
+template <typename P>
+static void _bench_uncontended(const char* name)
+{
+	const long items = 1000000;
+	P p(64);
+	const double ns = _bench_best_ns([&](){
+		bench_item item = NULL;
+		for(long i=0;i<items;i++)
+		{
+			p.enqueue(item);
+			p.dequeue(item);
+		}
+	});
+	printf("  %-10s uncontended      %7.1f ns per item\n", name, ns/items);
+}
+
+template <typename P>
+static void _bench_stream(const char* name, unsigned long batch)
+{
+	const long items = 1000000;
+	const double ns = _bench_best_ns([&](){
+		P p(64);
+		std::thread consumer([&](){
+			bench_item buf[BENCH_BATCH];
+			long left = items;
+			while(left > 0)
+				left -= _bench_dequeue_batch(p, buf, batch);
+		});
+		bench_item buf[BENCH_BATCH] = {};
+		for(long i=0;i<items;i+=batch)
+			_bench_enqueue_batch(p, buf, batch);
+		consumer.join();
+	});
+	printf("  %-10s stream, batch %2lu %7.1f ns per item\n", name, batch, ns/items);
+}
+
+template <typename P>
+static void _bench_ping_pong(const char* name)
+{
+	const long rounds = 20000;
+	const double ns = _bench_best_ns([&](){
+		P ping(1), pong(1);
+		std::thread other([&](){
+			bench_item item;
+			for(long i=0;i<rounds;i++)
+			{
+				ping.dequeue(item);
+				pong.enqueue(item);
+			}
+		});
+		bench_item item = NULL;
+		for(long i=0;i<rounds;i++)
+		{
+			ping.enqueue(item);
+			pong.dequeue(item);
+		}
+		other.join();
+	});
+	printf("  %-10s ping-pong        %7.1f ns per hand-off\n", name, ns/(2*rounds));
+}
+
+template <typename P>
+static void _bench_pipe(const char* name)
+{
+	_bench_uncontended<P>(name);
+	_bench_stream<P>(name, 1);
+	_bench_stream<P>(name, BENCH_BATCH);
+	_bench_ping_pong<P>(name);
+}
+
+int main(void)
+{
+	printf("%u CPU(s)\n", std::thread::hardware_concurrency());
+	_bench_pipe<pipe<bench_item> >("pipe");
+	_bench_pipe<ring_pipe<bench_item> >("ring_pipe");
+	_bench_pipe<bench_spsc_pipe>("spsc");
+	return 0;
+}
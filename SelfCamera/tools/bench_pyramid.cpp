@@ -0,0 +1,94 @@
+/*
+ * bench_pyramid.cpp
+ *
+ * Times pyramid_down<2> and pyramid_down<3> on grey frames of the preview
+ * and capture sizes. Each line is the best of a few runs, per call:
+ *
+ *   generic   the code every other pixel type goes through, which is what
+ *             unsigned char images used before (written to a uint16 image,
+ *             as unsigned char output now takes the fast path)
+ *   u8        the unsigned char path, with whatever SIMD the build enables
+ *   threads   the same with a thread_pool of the given size
+ *
+ * The u8 path gives exactly the generic output, which is checked too.
+ *
+ * Usage:
+ *   bench_pyramid [threads]
+ */
+// Build (from SelfCamera/), with -mavx2 or the target's NEON flags to see
+// the vector code, as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/bench_pyramid.cpp inc/dlib/threads/*.cpp
+//       -lpthread -o bench_pyramid
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <dlib/image_transforms.h>
+#include <dlib/rand.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 7
+
+static double _bench_now_us(void)
+{
+	return std::chrono::duration<double, std::micro>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename F>
+static double _bench_best_us(const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		const double start = _bench_now_us();
+		f();
+		best = std::min(best, _bench_now_us() - start);
+	}
+	return best;
+}
+
+template <typename PYR>
+static void _bench_size(const char* name, long nr, long nc, thread_pool& tp)
+{
+	dlib::rand rnd;
+	array2d<unsigned char> img(nr, nc);
+	for(long r=0;r<nr;r++)
+		for(long c=0;c<nc;c++)
+			img[r][c] = rnd.get_random_8bit_number();
+
+	PYR pyr;
+	array2d<uint16> generic;
+	aligned_array2d<unsigned char> down, down_tp;
+	const double generic_us = _bench_best_us([&](){ pyr(img, generic); });
+	const double u8_us = _bench_best_us([&](){ pyr(img, down); });
+	const double tp_us = _bench_best_us([&](){ pyr(img, down_tp, tp); });
+
+	long bad = 0;
+	for(long r=0;r<generic.nr();r++)
+		for(long c=0;c<generic.nc();c++)
+			bad += (generic[r][c] != down[r][c]) + (generic[r][c] != down_tp[r][c]);
+
+	printf("  %-16s %4ldx%-4ld generic %7.0f us  u8 %6.0f us  %lu threads %6.0f us  (%.1fx, %.1fx)%s\n",
+			name, nc, nr, generic_us, u8_us, tp.num_threads_in_pool(), tp_us,
+			generic_us/u8_us, generic_us/tp_us, bad ? "  MISMATCH" : "");
+}
+
+int main(int argc, char** argv)
+{
+	const unsigned long threads = argc > 1 ? strtoul(argv[1], NULL, 10)
+			: std::max(1U, std::thread::hardware_concurrency());
+	thread_pool tp(threads);
+
+	const long sizes[][2] = { {480, 640}, {720, 1280}, {1080, 1920} };
+	for(unsigned int i=0;i<sizeof(sizes)/sizeof(sizes[0]);i++)
+	{
+		_bench_size<pyramid_down<2> >("pyramid_down<2>", sizes[i][0], sizes[i][1], tp);
+		_bench_size<pyramid_down<3> >("pyramid_down<3>", sizes[i][0], sizes[i][1], tp);
+	}
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * bench_resize.cpp
+ *
+ * Times resizing grey planes and interleaved NV12 UV planes to the sizes
+ * the analysis and the stickers use. Each line is the best of a few runs,
+ * per call:
+ *
+ *   float     resize_image(), the floating point bilinear code every grey
+ *             pixel type goes through
+ *   bilinear  fixed_point_resizer with resize_filter_bilinear
+ *   area      fixed_point_resizer with resize_filter_area
+ *   call      resize_image_fixed_point(), which keeps a resizer per size
+ *             and thread, so it should cost the same as bilinear
+ *
+ * For UV planes there is no float code to compare with, as it would have to
+ * split the plane first, so only the fixed point times are given.
+ */
+// Build (from SelfCamera/), with -mavx2 or the target's NEON flags to see
+// the vector code, as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/bench_resize.cpp inc/dlib/threads/*.cpp
+//       -lpthread -o bench_resize
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+#include <dlib/image_transforms.h>
+#include <dlib/rand.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 7
+
+static double _bench_now_us(void)
+{
+	return std::chrono::duration<double, std::micro>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename F>
+static double _bench_best_us(const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		const double start = _bench_now_us();
+		f();
+		best = std::min(best, _bench_now_us() - start);
+	}
+	return best;
+}
+
+template <typename T>
+static void _bench_fill(array2d<T>& img, long nr, long nc)
+{
+	dlib::rand rnd;
+	img.set_size(nr, nc);
+	for(long r=0;r<nr;r++)
+		for(long c=0;c<nc;c++)
+			img[r][c] = (T)(rnd.get_random_8bit_number() & 0x7f);
+}
+
+static void _bench_grey(long nr, long nc, long out_nr, long out_nc)
+{
+	array2d<unsigned char> in;
+	aligned_array2d<unsigned char> out(out_nr, out_nc);
+	_bench_fill(in, nr, nc);
+
+	fixed_point_resizer bilinear(resize_filter_bilinear);
+	fixed_point_resizer area(resize_filter_area);
+	const double float_us = _bench_best_us([&](){ resize_image(in, out); });
+	const double bilinear_us = _bench_best_us([&](){ bilinear(in, out); });
+	const double area_us = _bench_best_us([&](){ area(in, out); });
+	const double call_us = _bench_best_us([&](){ resize_image_fixed_point(in, out); });
+
+	printf("  grey %4ldx%-4ld -> %4ldx%-4ld  float %6.0f us  bilinear %5.0f us  area %5.0f us  call %5.0f us  (%.1fx, %.1fx)\n",
+			nc, nr, out_nc, out_nr, float_us, bilinear_us, area_us, call_us,
+			float_us/bilinear_us, float_us/area_us);
+}
+
+static void _bench_uv(long nr, long nc, long out_nr, long out_nc)
+{
+	/* nc and out_nc count UV pairs */
+	array2d<unsigned char> in;
+	aligned_array2d<unsigned char> out(out_nr, 2*out_nc);
+	_bench_fill(in, nr, 2*nc);
+
+	fixed_point_resizer bilinear(resize_filter_bilinear, 2);
+	fixed_point_resizer area(resize_filter_area, 2);
+	const double bilinear_us = _bench_best_us([&](){ bilinear(in, out); });
+	const double area_us = _bench_best_us([&](){ area(in, out); });
+
+	printf("  uv   %4ldx%-4ld -> %4ldx%-4ld                 bilinear %5.0f us  area %5.0f us\n",
+			nc, nr, out_nc, out_nr, bilinear_us, area_us);
+}
+
+int main(void)
+{
+	/* half size analysis frames */
+	_bench_grey(720, 1280, 360, 640);
+	_bench_grey(480, 640, 240, 320);
+	/* an in between analysis scale and a sticker being enlarged */
+	_bench_grey(480, 640, 360, 480);
+	_bench_grey(120, 160, 300, 400);
+	/* the UV planes of the same frames */
+	_bench_uv(360, 640, 180, 320);
+	_bench_uv(240, 320, 120, 160);
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * bench_thread_pool.cpp
+ *
+ * Measures what dlib::thread_pool and parallel_for cost per task and how
+ * well they scale, with tasks of the sizes the frame pipeline issues (a
+ * tile of a filter, a face for the landmarks). Each line is the best of a
+ * few runs:
+ *
+ *   overhead   a parallel_for whose blocks do no work, i.e. what splitting
+ *              a loop costs, per call and per task
+ *   scaling    the same amount of work cut into tasks of a given size,
+ *              speed up over the same work on one thread
+ *   nested     a parallel_for inside each block of another one
+ *   fan-out    tasks that submit tasks and wait for them
+ *
+ * Usage:
+ *   bench_thread_pool [max threads]
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/bench_thread_pool.cpp inc/dlib/threads/*.cpp
+//       -lpthread -o bench_thread_pool
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <dlib/threads.h>
+
+using namespace dlib;
+
+#define BENCH_RUNS 5
+
+static double _bench_now_us(void)
+{
+	return std::chrono::duration<double, std::micro>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Burns about us microseconds without touching memory. */
+static void _bench_spin(double us)
+{
+	const double end = _bench_now_us() + us;
+	while(_bench_now_us() < end)
+		;
+}
+
+template <typename F>
+static double _bench_best_us(const F& f)
+{
+	double best = 1e30;
+	for(int i=0;i<BENCH_RUNS;i++)
+	{
+		const double start = _bench_now_us();
+		f();
+		best = std::min(best, _bench_now_us() - start);
+	}
+	return best;
+}
+
+static void _bench_overhead(thread_pool& tp)
+{
+	const long tasks = tp.num_threads_in_pool()*8;
+	const int calls = 1000;
+	const double us = _bench_best_us([&](){
+		for(int i=0;i<calls;i++)
+			parallel_for_blocked(tp, 0, tasks, [](long, long){});
+	});
+	printf("  overhead  %8.2f us per parallel_for, %6.0f ns per task\n",
+			us/calls, us*1000/(calls*tasks));
+}
+
+static void _bench_scaling(thread_pool& tp, double serial_us, double task_us)
+{
+	const long tasks = (long)(serial_us/task_us);
+	const double us = _bench_best_us([&](){
+		parallel_for(tp, 0, tasks, [&](long){ _bench_spin(task_us); }, 1);
+	});
+	printf("  scaling   %6.0f us tasks: %6.2fx (%5.0f%% of ideal)\n", task_us,
+			serial_us/us, 100*serial_us/(us*tp.num_threads_in_pool()));
+}
+
+static void _bench_nested(thread_pool& tp)
+{
+	std::atomic<long> count(0);
+	const double us = _bench_best_us([&](){
+		parallel_for(tp, 0, 64, [&](long){
+			parallel_for(tp, 0, 16, [&](long){ _bench_spin(5); count++; });
+		});
+	});
+	printf("  nested    %8.0f us for 64x16 tasks of 5 us\n", us);
+}
+
+struct bench_fan_out
+{
+	thread_pool* tp;
+	void child() { _bench_spin(10); }
+	void parent()
+	{
+		for(int i=0;i<8;i++)
+			tp->add_task(*this, &bench_fan_out::child);
+		tp->wait_for_all_tasks();
+	}
+};
+
+static void _bench_fan_out(thread_pool& tp)
+{
+	std::vector<bench_fan_out> parents(32);
+	const double us = _bench_best_us([&](){
+		for(unsigned long i=0;i<parents.size();i++)
+		{
+			parents[i].tp = &tp;
+			tp.add_task(parents[i], &bench_fan_out::parent);
+		}
+		tp.wait_for_all_tasks();
+	});
+	printf("  fan-out   %8.0f us for 32 tasks waiting on 8 tasks of 10 us each\n", us);
+}
+
+int main(int argc, char** argv)
+{
+	const unsigned long max_threads = argc > 1 ? strtoul(argv[1], NULL, 10)
+			: std::max(1U, std::thread::hardware_concurrency());
+
+	/* the same work on one thread, without a pool */
+	const double serial_us = 50000;
+
+	/* 1, 2, 4, ... threads and max_threads last */
+	for(unsigned long n=1;n<=max_threads;n=(n == max_threads) ? n+1 : std::min(2*n, max_threads))
+	{
+		thread_pool tp(n);
+		printf("%lu thread(s)\n", n);
+		_bench_overhead(tp);
+		_bench_scaling(tp, serial_us, 10);
+		_bench_scaling(tp, serial_us, 100);
+		_bench_scaling(tp, serial_us, 1000);
+		_bench_nested(tp);
+		_bench_fan_out(tp);
+	}
+	return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * convert_model.cpp
+ *
+ * Rewrites a landmark model in the bulk shape_predictor format, which the
+ * app loads with a few large reads instead of one small read per number.
+ * The build runs it on res/shape_predictor_68_face_landmarks.dat before
+ * packaging (Build/build_model.mk); a converted input comes out unchanged.
+ * The two files are checked to hold the same model before the output is
+ * kept.
+ *
+ * Usage:
+ *   convert_model shape_predictor_68_face_landmarks.dat \
+ *       res/shape_predictor_68_face_landmarks.dat
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/convert_model.cpp inc/dlib/threads/*.cpp
+//       -lpthread -o convert_model
+
+#include <stdio.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include <dlib/image_processing.h>
+
+using namespace dlib;
+
+static double _convert_load_ms(const std::string& path, shape_predictor* sp)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	deserialize(path) >> *sp;
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	if(argc != 3)
+	{
+		printf("Usage: convert_model <model in> <model out>\n");
+		return 1;
+	}
+
+	try
+	{
+		shape_predictor sp, converted;
+		const double old_ms = _convert_load_ms(argv[1], &sp);
+		{
+			std::ofstream out(argv[2], std::ios::binary);
+			serialize_bulk(sp, out);
+			if(!out)
+				throw serialization_error(std::string("can't write ") + argv[2]);
+		}
+		const double new_ms = _convert_load_ms(argv[2], &converted);
+
+		/* both must write the same version 1 stream if nothing was lost */
+		std::ostringstream a, b;
+		serialize(sp, a);
+		serialize(converted, b);
+		if(a.str() != b.str())
+		{
+			fprintf(stderr, "the converted model differs from %s\n", argv[1]);
+			remove(argv[2]);
+			return 1;
+		}
+
+		printf("%s: %lu parts, load %.0f ms -> %.0f ms\n", argv[2],
+				sp.num_parts(), old_ms, new_ms);
+		return 0;
+	}
+	catch(std::exception& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
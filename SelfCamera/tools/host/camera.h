@@ -0,0 +1,32 @@
+/*
+ * camera.h
+ *
+ * Host stand-in for the one part of the Tizen camera API the frame effects
+ * use: the NV12 preview frame. Only tools built on Linux put this directory
+ * on the include path; the app always gets the SDK's camera.h.
+ */
+
+#ifndef HOST_CAMERA_H_
+#define HOST_CAMERA_H_
+
+typedef enum {
+	CAMERA_PIXEL_FORMAT_NV12 = 0,
+} camera_pixel_format_e;
+
+typedef struct {
+	camera_pixel_format_e format;
+	int width;
+	int height;
+	int num_of_planes;
+	unsigned int timestamp;
+	union {
+		struct {
+			unsigned char *y;
+			unsigned int y_size;
+			unsigned char *uv;
+			unsigned int uv_size;
+		} double_plane;
+	} data;
+} camera_preview_data_s;
+
+#endif /* HOST_CAMERA_H_ */
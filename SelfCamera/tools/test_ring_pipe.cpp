@@ -0,0 +1,134 @@
+/*
+ * test_ring_pipe.cpp
+ *
+ * Checks dlib::ring_pipe, in both of its modes: that a size of 0 is refused
+ * in release builds too, that items come out in order one at a time and in
+ * batches, that disabling the pipe releases blocked threads, and that several
+ * producers and consumers pass every item exactly once. Prints "ok" and
+ * returns 0 when everything passes.
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/test_ring_pipe.cpp inc/dlib/threads/*.cpp
+//       -lpthread -o test_ring_pipe
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <dlib/pipe.h>
+
+using namespace dlib;
+
+#define TEST_CHECK(x) do { if(!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while(0)
+
+#define TEST_ITEMS 200000
+
+static void _test_zero_size(void)
+{
+	bool thrown = false;
+	try
+	{
+		ring_pipe<int> p(0);
+	}
+	catch(fatal_error&)
+	{
+		thrown = true;
+	}
+	TEST_CHECK(thrown);
+}
+
+static void _test_order(bool spsc)
+{
+	const unsigned long sizes[] = { 1, 3, 8, 13 };
+	for(unsigned long size : sizes)
+	{
+		ring_pipe<int> p(size, spsc);
+		TEST_CHECK(p.max_size() == size);
+		int next_in = 0, next_out = 0;
+		for(int round=0;round<50;round++)
+		{
+			for(unsigned long i=0;i<size;i++)
+			{
+				int v = next_in++;
+				TEST_CHECK(p.enqueue_or_timeout(v, 0));
+			}
+			int v = -1;
+			TEST_CHECK(!p.enqueue_or_timeout(v, 0));
+			TEST_CHECK(p.size() == size);
+
+			int out[16];
+			const unsigned long n = p.dequeue_batch(out, size/2 + 1);
+			TEST_CHECK(n == size/2 + 1);
+			for(unsigned long i=0;i<n;i++)
+				TEST_CHECK(out[i] == next_out++);
+			while(p.size() != 0)
+			{
+				TEST_CHECK(p.dequeue(v));
+				TEST_CHECK(v == next_out++);
+			}
+		}
+	}
+}
+
+static void _test_disable(void)
+{
+	ring_pipe<int> p(2);
+	std::atomic<int> released(0);
+	std::thread t([&](){
+		int v;
+		if(!p.dequeue(v))
+			released++;
+	});
+	p.wait_for_num_blocked_dequeues(1);
+	p.disable();
+	t.join();
+	TEST_CHECK(released == 1);
+	int v = 1;
+	TEST_CHECK(!p.enqueue(v));
+}
+
+static void _test_threads(int producers, int consumers, bool spsc)
+{
+	ring_pipe<long> p(16, spsc);
+	std::atomic<long long> sum(0);
+	std::atomic<long> count(0);
+	std::vector<std::thread> threads;
+	for(int i=0;i<consumers;i++)
+		threads.push_back(std::thread([&](){
+			long v;
+			while(p.dequeue(v))
+			{
+				sum += v;
+				if(++count == (long)TEST_ITEMS*producers)
+					p.disable();
+			}
+		}));
+	for(int i=0;i<producers;i++)
+		threads.push_back(std::thread([&, i](){
+			for(long k=0;k<TEST_ITEMS;k++)
+			{
+				long v = (long)i*TEST_ITEMS + k + 1;
+				p.enqueue(v);
+			}
+		}));
+	for(auto& t : threads)
+		t.join();
+	const long long n = (long long)TEST_ITEMS*producers;
+	TEST_CHECK(count == n);
+	TEST_CHECK(sum == n*(n+1)/2);
+}
+
+int main(void)
+{
+	_test_zero_size();
+	_test_order(false);
+	_test_order(true);
+	_test_disable();
+	_test_threads(1, 1, true);
+	_test_threads(1, 1, false);
+	_test_threads(3, 3, false);
+	printf("ok\n");
+	return 0;
+}
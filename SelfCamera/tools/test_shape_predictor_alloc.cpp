@@ -0,0 +1,156 @@
+/*
+ * test_shape_predictor_alloc.cpp
+ *
+ * Checks that dlib::shape_predictor stays off the heap where it promises to:
+ * that once a workspace and a full_object_detection have been used for one
+ * prediction, predicting into them again allocates nothing, that the same
+ * holds for a plain point array, and that moving a model allocates nothing
+ * and leaves the landmarks unchanged. Allocations are counted by replacing
+ * the global operator new. The model is a synthetic 68 point one the size of
+ * the shipped model. Prints "ok" and returns 0 when everything passes.
+ */
+// Build (from SelfCamera/), as one command:
+//   g++ -O2 -std=c++11 -Iinc tools/test_shape_predictor_alloc.cpp
+//       inc/dlib/threads/*.cpp -lpthread -o test_shape_predictor_alloc
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <dlib/image_processing.h>
+#include <dlib/rand.h>
+
+using namespace dlib;
+
+#define TEST_CHECK(x) do { if(!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while(0)
+
+#define TEST_PARTS 68
+#define TEST_LEVELS 10
+#define TEST_TREES 50
+#define TEST_DEPTH 4
+#define TEST_FEATURES 400
+#define TEST_FRAMES 50
+
+static long _test_allocs = 0;
+
+void* operator new(size_t n)
+{
+	_test_allocs++;
+	void* p = malloc(n ? n : 1);
+	if(!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+static shape_predictor _test_model(void)
+{
+	dlib::rand rnd(1);
+	const long num_splits = (1<<TEST_DEPTH) - 1;
+	const long num_leaves = 1<<TEST_DEPTH;
+
+	matrix<float,0,1> initial_shape(2*TEST_PARTS);
+	for(long i=0;i<initial_shape.size();i++)
+		initial_shape(i) = rnd.get_random_float();
+
+	std::vector<std::vector<impl::regression_tree> > forests(TEST_LEVELS);
+	std::vector<std::vector<dlib::vector<float,2> > > pixel_coordinates(TEST_LEVELS);
+	for(int c=0;c<TEST_LEVELS;c++)
+	{
+		for(int k=0;k<TEST_FEATURES;k++)
+			pixel_coordinates[c].push_back(dlib::vector<float,2>(
+					rnd.get_random_float()*1.4f - 0.2f, rnd.get_random_float()*1.4f - 0.2f));
+		for(int t=0;t<TEST_TREES;t++)
+		{
+			impl::regression_tree tree;
+			for(long s=0;s<num_splits;s++)
+			{
+				impl::split_feature f;
+				f.idx1 = rnd.get_random_32bit_number()%TEST_FEATURES;
+				f.idx2 = rnd.get_random_32bit_number()%TEST_FEATURES;
+				f.thresh = (rnd.get_random_float() - 0.5f)*40;
+				tree.splits.push_back(f);
+			}
+			for(long l=0;l<num_leaves;l++)
+			{
+				matrix<float,0,1> v(2*TEST_PARTS);
+				for(long i=0;i<v.size();i++)
+					v(i) = (rnd.get_random_float() - 0.5f)*0.01f;
+				tree.leaf_values.push_back(v);
+			}
+			forests[c].push_back(tree);
+		}
+	}
+	return shape_predictor(initial_shape, forests, pixel_coordinates);
+}
+
+static rectangle _test_rect(int f)
+{
+	return rectangle(100 + f%37, 80 + f%23, 300 + f%41, 290 + f%19);
+}
+
+int main(void)
+{
+	shape_predictor sp = _test_model();
+	TEST_CHECK(sp.num_parts() == TEST_PARTS);
+
+	array2d<unsigned char> img(480, 640);
+	for(long r=0;r<img.nr();r++)
+		for(long c=0;c<img.nc();c++)
+			img[r][c] = (r*c/7 + r*3) & 255;
+
+	/* full_object_detection, reused across frames of varying rectangles */
+	shape_predictor_workspace ws;
+	full_object_detection det;
+	sp(img, _test_rect(0), ws, det);
+	_test_allocs = 0;
+	for(int f=1;f<TEST_FRAMES;f++)
+	{
+		sp(img, _test_rect(f), ws, det);
+		TEST_CHECK(det.get_rect() == _test_rect(f));
+	}
+	TEST_CHECK(_test_allocs == 0);
+
+	/* the in place results match the allocating operator() */
+	const full_object_detection expected = sp(img, _test_rect(TEST_FRAMES));
+	sp(img, _test_rect(TEST_FRAMES), ws, det);
+	TEST_CHECK(det.num_parts() == expected.num_parts());
+	for(unsigned long i=0;i<det.num_parts();i++)
+		TEST_CHECK(det.part(i) == expected.part(i));
+
+	/* a plain point array, with a workspace already sized by the calls above */
+	point parts[TEST_PARTS];
+	_test_allocs = 0;
+	for(int f=0;f<=TEST_FRAMES;f++)
+		sp(img, _test_rect(f), ws, parts);
+	TEST_CHECK(_test_allocs == 0);
+	for(unsigned long i=0;i<TEST_PARTS;i++)
+		TEST_CHECK(parts[i] == expected.part(i));
+
+	/* moving the model copies no trees and gives the same landmarks */
+	_test_allocs = 0;
+	shape_predictor moved(std::move(sp));
+	shape_predictor assigned;
+	assigned = std::move(moved);
+	TEST_CHECK(_test_allocs == 0);
+	TEST_CHECK(sp.num_levels_loaded() == 0);
+	TEST_CHECK(moved.num_levels_loaded() == 0);
+	TEST_CHECK(assigned.num_levels_loaded() == TEST_LEVELS);
+	assigned(img, _test_rect(TEST_FRAMES), ws, det);
+	for(unsigned long i=0;i<det.num_parts();i++)
+		TEST_CHECK(det.part(i) == expected.part(i));
+
+	printf("ok\n");
+	return 0;
+}